@@ -25,12 +25,17 @@ float3x3 GM_ToFloat3x3(float4x4 m)
 //--------------------------------------------------------------------------------------
 // Constant Buffer Variables
 //--------------------------------------------------------------------------------------
+// 按照更新频率划分常量缓存，每个对象都会改变的数据不会导致每帧数据被重新上传
 cbuffer WorldConstantBuffer: register( b0 ) 
 {
     matrix GM_WorldMatrix;
+    matrix GM_InverseTransposeModelMatrix;
+}
+
+cbuffer CameraConstantBuffer: register( b1 )
+{
     matrix GM_ViewMatrix;
     matrix GM_ProjectionMatrix;
-    matrix GM_InverseTransposeModelMatrix;
     matrix GM_InverseViewMatrix;
     float4 GM_ViewPosition;
 }
@@ -54,12 +59,23 @@ static const int GM_VertexColorOp_Add = 3;
 //--------------------------------------------------------------------------------------
 // Bones And Animations
 //--------------------------------------------------------------------------------------
-static const int GM_MaxBones = 128;
 static const int GM_NoAnimation = 0;
 static const int GM_SkeletalAnimation = 1;
 static const int GM_AffineAnimation = 2;
 int GM_UseAnimation = GM_NoAnimation;
-matrix GM_Bones[GM_MaxBones];
+
+// 骨骼调色板，一帧中所有动画模型的骨骼变换都存放在这里，GM_BoneOffset为当前模型的第一个骨骼所在的元素
+// 线性混合蒙皮时，每个骨骼占用4个元素，为矩阵的4行；对偶四元数蒙皮时，每个骨骼占用2个元素，依次为实部和对偶部
+static const int GM_LinearSkinning = 0;
+static const int GM_DualQuaternionSkinning = 1;
+StructuredBuffer<float4> GM_BonePalette;
+int GM_BoneOffset = 0;
+int GM_SkinningMode = GM_LinearSkinning;
+
+//--------------------------------------------------------------------------------------
+// Instancing
+//--------------------------------------------------------------------------------------
+int GM_UseInstancing = 0;
 
 //--------------------------------------------------------------------------------------
 // Textures, GM_LightAttributes, Materials
@@ -188,7 +204,11 @@ struct GMLight
     // Spotlight
     float CutOff;
 };
-GMLight GM_LightAttributes[50];
+cbuffer LightConstantBuffer
+{
+    GMLight GM_LightAttributes[50];
+    int GM_LightCount;
+}
 
 //--------------------------------------------------------------------------------------
 // Phong 光照模型
@@ -301,7 +321,6 @@ class GMPhongLightProxy
         return float3(1, 1, 1);
     }
 };
-int GM_LightCount;
 
 struct GMScreenInfo
 {
@@ -315,9 +334,13 @@ GMScreenInfo GM_ScreenInfo;
 //--------------------------------------------------------------------------------------
 // Gamma Correction
 //--------------------------------------------------------------------------------------
-bool GM_GammaCorrection;
-float GM_Gamma;
-float GM_GammaInv;
+cbuffer FrameConstantBuffer
+{
+    bool GM_GammaCorrection;
+    float GM_Gamma;
+    float GM_GammaInv;
+    bool GM_HDR;
+}
 
 float4 CalculateGammaCorrection(float4 factor)
 {
@@ -335,7 +358,6 @@ float4 CalculateGammaCorrectionIfNecessary(float4 factor)
 //--------------------------------------------------------------------------------------
 // HDR
 //--------------------------------------------------------------------------------------
-bool GM_HDR;
 
 interface IToneMapping
 {
@@ -382,7 +404,10 @@ struct GMShadowInfo
 Texture2D GM_ShadowMap;
 Texture2DMS<float4> GM_ShadowMapMSAA;
 
-GMShadowInfo GM_ShadowInfo;
+cbuffer ShadowConstantBuffer
+{
+    GMShadowInfo GM_ShadowInfo;
+}
 
 // Cascade Color
 static const float4 GM_CascadeColors[GM_MaxCascadeLevel] = {
@@ -415,6 +440,7 @@ struct VS_INPUT
     float4 Color       : COLOR;
     int4   BoneIDs     : BONES;
     float4 Weights     : WEIGHTS;
+    float4x4 InstanceWorld : INSTANCE_WORLD;
 };
 
 struct VS_OUTPUT
@@ -433,6 +459,96 @@ struct VS_OUTPUT
 typedef VS_OUTPUT PS_INPUT;
 typedef VS_OUTPUT GS_OUTPUT;
 
+matrix GM_GetWorldMatrix(VS_INPUT input)
+{
+    // 实例化绘制时，世界矩阵来自每个实例的数据
+    if (GM_UseInstancing)
+        return input.InstanceWorld;
+    return GM_WorldMatrix;
+}
+
+matrix GM_GetPaletteMatrix(int bone)
+{
+    int element = GM_BoneOffset + bone * 4;
+    return matrix(
+        GM_BonePalette[element],
+        GM_BonePalette[element + 1],
+        GM_BonePalette[element + 2],
+        GM_BonePalette[element + 3]
+    );
+}
+
+matrix GM_DualQuaternionToMatrix(float4 real, float4 dual)
+{
+    float len = length(real);
+    real /= len;
+    dual /= len;
+    float3 t = 2 * (dual.xyz * real.w - real.xyz * dual.w + cross(real.xyz, dual.xyz));
+
+    float x = real.x;
+    float y = real.y;
+    float z = real.z;
+    float w = real.w;
+    return matrix(
+        1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y), 0,
+        2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x), 0,
+        2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y), 0,
+        t, 1
+    );
+}
+
+matrix GM_GetSkinningMatrix(VS_INPUT input)
+{
+    // 仿射变换动画只有1个矩阵
+    if (GM_UseAnimation == GM_AffineAnimation)
+        return GM_GetPaletteMatrix(0);
+
+    if (GM_SkinningMode == GM_DualQuaternionSkinning)
+    {
+        float4 real0 = GM_BonePalette[GM_BoneOffset + input.BoneIDs[0] * 2];
+        float4 real = float4(0, 0, 0, 0);
+        float4 dual = float4(0, 0, 0, 0);
+        [unroll]
+        for (int i = 0; i < 4; ++i)
+        {
+            int element = GM_BoneOffset + input.BoneIDs[i] * 2;
+            float4 r = GM_BonePalette[element];
+            // q和-q表示相同的旋转，将所有的四元数翻转到同一个半球，避免混合时绕远路
+            float weight = dot(r, real0) < 0 ? -input.Weights[i] : input.Weights[i];
+            real += r * weight;
+            dual += GM_BonePalette[element + 1] * weight;
+        }
+        return GM_DualQuaternionToMatrix(real, dual);
+    }
+
+    matrix boneTransform = GM_GetPaletteMatrix(input.BoneIDs[0]) * input.Weights[0];
+    boneTransform += GM_GetPaletteMatrix(input.BoneIDs[1]) * input.Weights[1];
+    boneTransform += GM_GetPaletteMatrix(input.BoneIDs[2]) * input.Weights[2];
+    boneTransform += GM_GetPaletteMatrix(input.BoneIDs[3]) * input.Weights[3];
+    return boneTransform;
+}
+
+float3x3 GM_InverseTranspose3x3(float3x3 m)
+{
+    // 伴随矩阵的转置除以行列式，即为逆矩阵的转置
+    float3 r0 = cross(m[1], m[2]);
+    float3 r1 = cross(m[2], m[0]);
+    float3 r2 = cross(m[0], m[1]);
+    return float3x3(r0, r1, r2) / dot(m[0], r0);
+}
+
+void GM_TransformInstanceNormals(VS_INPUT input, inout VS_OUTPUT output)
+{
+    // 实例化绘制时GM_InverseTransposeModelMatrix为单位矩阵，法线和切线在顶点着色器中变换到世界坐标系
+    if (GM_UseInstancing)
+    {
+        float3x3 inverseTransposeWorldMatrix = GM_InverseTranspose3x3(GM_ToFloat3x3(input.InstanceWorld));
+        output.Normal = mul(output.Normal, inverseTransposeWorldMatrix);
+        output.Tangent = mul(output.Tangent, inverseTransposeWorldMatrix);
+        output.Bitangent = mul(output.Bitangent, inverseTransposeWorldMatrix);
+    }
+}
+
 class GMTangentSpace
 {
     float3 Normal_Tangent_N;
@@ -840,25 +956,22 @@ VS_OUTPUT VS_3D( VS_INPUT input )
 
     if (GM_UseAnimation == GM_SkeletalAnimation)
     {
-        matrix boneTransform = GM_Bones[input.BoneIDs[0]] * input.Weights[0];
-        boneTransform += GM_Bones[input.BoneIDs[1]] * input.Weights[1];
-        boneTransform += GM_Bones[input.BoneIDs[2]] * input.Weights[2];
-        boneTransform += GM_Bones[input.BoneIDs[3]] * input.Weights[3];
+        matrix boneTransform = GM_GetSkinningMatrix(input);
         output.Position = mul(output.Position, boneTransform);
         output.Normal = mul(input.Normal, GM_ToFloat3x3(boneTransform));
     }
     else if (GM_UseAnimation == GM_AffineAnimation)
     {
-        // 将仿射变换的值放到第1个Bones矩阵中
-        output.Position = mul(output.Position, GM_Bones[0]);
-        output.Normal = mul(GM_ToFloat4(input.Normal.xyz), GM_Bones[0]);
+        matrix affineTransform = GM_GetSkinningMatrix(input);
+        output.Position = mul(output.Position, affineTransform);
+        output.Normal = mul(GM_ToFloat4(input.Normal.xyz), affineTransform);
     }
     else
     {
         output.Normal = input.Normal;
     }
 
-    output.Position = mul(output.Position, GM_WorldMatrix);
+    output.Position = mul(output.Position, GM_GetWorldMatrix(input));
     output.WorldPos = output.Position;
     
     output.Position = mul(output.Position, GM_ViewMatrix);
@@ -870,6 +983,7 @@ VS_OUTPUT VS_3D( VS_INPUT input )
     output.Lightmap = input.Lightmap;
     output.Color = input.Color;
     output.Z = output.Position.z;
+    GM_TransformInstanceNormals(input, output);
     return output;
 }
 
@@ -1041,8 +1155,15 @@ VS_OUTPUT VS_Text(VS_INPUT input)
 
 float4 PS_Text(PS_INPUT input) : SV_TARGET
 {
-    float4 alpha = GM_AmbientTexture.Sample(GM_AmbientSampler, input.Texcoord);
-    return float4(input.Color.r, input.Color.g, input.Color.b, alpha.r * input.Color.a);
+    float alpha = GM_AmbientTexture.Sample(GM_AmbientSampler, input.Texcoord).r;
+
+    // 法线的x分量为1表示距离场字形，0.5为字形的边缘
+    if (input.Normal.x > 0.5f)
+    {
+        float width = fwidth(alpha);
+        alpha = smoothstep(0.5f - width, 0.5f + width, alpha);
+    }
+    return float4(input.Color.r, input.Color.g, input.Color.b, alpha * input.Color.a);
 }
 
 //--------------------------------------------------------------------------------------
@@ -1293,24 +1414,12 @@ VS_OUTPUT VS_Shadow( VS_INPUT input )
     VS_OUTPUT output;
     output.Position = GM_ToFloat4(input.Position);
 
-    if (GM_UseAnimation == GM_SkeletalAnimation)
-    {
-        matrix boneTransform = GM_Bones[input.BoneIDs[0]] * input.Weights[0];
-        boneTransform += GM_Bones[input.BoneIDs[1]] * input.Weights[1];
-        boneTransform += GM_Bones[input.BoneIDs[2]] * input.Weights[2];
-        boneTransform += GM_Bones[input.BoneIDs[3]] * input.Weights[3];
-        output.Position = mul(output.Position, boneTransform);
-    }
-    else if (GM_UseAnimation == GM_AffineAnimation)
-    {
-        // 将仿射变换的值放到第1个Bones矩阵中
-        output.Position = mul(output.Position, GM_Bones[0]);
-    }
-    else
+    if (GM_UseAnimation != GM_NoAnimation)
     {
+        output.Position = mul(output.Position, GM_GetSkinningMatrix(input));
     }
     
-    output.Position = mul(output.Position, GM_WorldMatrix);
+    output.Position = mul(output.Position, GM_GetWorldMatrix(input));
     output.WorldPos = output.Position;
     output.Position = mul(output.Position, GM_ShadowInfo.ShadowMatrix[GM_ShadowInfo.CurrentCascadeLevel]);
 
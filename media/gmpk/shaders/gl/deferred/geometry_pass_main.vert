@@ -4,21 +4,19 @@ void deferred_geometry_pass_calcCoords()
 {
     if (GM_UseAnimation == GM_SkeletalAnimation)
     {
-        mat4 boneTransform = GM_Bones[boneIDs[0]] * weights[0];
-        boneTransform += GM_Bones[boneIDs[1]] * weights[1];
-        boneTransform += GM_Bones[boneIDs[2]] * weights[2];
-        boneTransform += GM_Bones[boneIDs[3]] * weights[3];
+        mat4 boneTransform = GM_GetSkinningMatrix();
         position = boneTransform * position;
         normal = boneTransform * vec4(normal.xyz, 0);
     }
     else if (GM_UseAnimation == GM_AffineAnimation)
     {
-        // 将仿射变换的值放到第1个Bones矩阵中
-        position = GM_Bones[0] * position;
+        position = GM_GetSkinningMatrix() * position;
     }
 
-    gl_Position = GM_ProjectionMatrix * GM_ViewMatrix * GM_WorldMatrix * position;
-    _deferred_geometry_pass_position_world = GM_WorldMatrix * position;
+    GM_TransformInstanceNormals();
+    mat4 worldMatrix = GM_GetWorldMatrix();
+    gl_Position = GM_ProjectionMatrix * GM_ViewMatrix * worldMatrix * position;
+    _deferred_geometry_pass_position_world = worldMatrix * position;
     _normal = normal;
     _tangent = tangent;
     _bitangent = bitangent;
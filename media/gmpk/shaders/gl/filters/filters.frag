@@ -8,8 +8,15 @@ in vec2 _texCoords;
 out vec4 frag_color;
 uniform sampler2D GM_framebuffer;
 
-uniform int GM_HDR;
-uniform int GM_ToneMapping;
+// Gamma校正和HDR，所有着色器程序共享，与GMGLFrameBlock对应
+layout (std140) uniform GM_FrameBlock
+{
+    int GM_GammaCorrection;
+    float GM_Gamma;
+    float GM_GammaInv;
+    int GM_HDR;
+    int GM_ToneMapping;
+};
 vec4 calculateWithToneMapping(vec4 c)
 {
     const int ReinhardToneMapping = 0;
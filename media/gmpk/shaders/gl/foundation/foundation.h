@@ -5,14 +5,22 @@ precision mediump sampler2DShadow;
 #endif
 
 // 基本参数
-uniform mat4 GM_ViewMatrix;
 uniform mat4 GM_WorldMatrix;
-uniform mat4 GM_ProjectionMatrix;
 uniform mat4 GM_InverseTransposeModelMatrix;
-uniform mat4 GM_InverseViewMatrix;
 
-const int GM_MaxBones = 128;
-uniform mat4 GM_Bones[GM_MaxBones];
+// 相机，所有着色器程序共享，与GMGLCameraBlock对应
+layout (std140) uniform GM_CameraBlock
+{
+    mat4 GM_ViewMatrix;
+    mat4 GM_InverseViewMatrix;
+    mat4 GM_ProjectionMatrix;
+    vec4 GM_ViewPosition;
+};
+
+// 骨骼调色板，所有动画模型的骨骼变换都存放在这里，详见skinning.h
+uniform samplerBuffer GM_BonePalette;
+uniform int GM_BoneOffset;
+uniform int GM_SkinningMode;
 const int GM_NoAnimation = 0;
 const int GM_SkeletalAnimation = 1;
 const int GM_AffineAnimation = 2;
@@ -23,19 +31,26 @@ uniform int GM_UseAnimation;
 uniform int GM_UseAnimation = GM_NoAnimation;
 #endif
 
+// 实例化
+#if GL_ES
+uniform int GM_UseInstancing;
+#else
+uniform int GM_UseInstancing = 0;
+#endif
+
 // 类型变量
 uniform int GM_shader_type;
 uniform int GM_shader_proc;
 
+// 阴影，所有着色器程序共享，与GMGLShadowBlock对应
 const int GM_MaxCascadeLevel = 8;
-struct GMShadowInfo
+layout (std140) uniform GM_ShadowBlock
 {
     int HasShadow;
     mat4 ShadowMatrix[GM_MaxCascadeLevel];
     float EndClip[GM_MaxCascadeLevel];
     int CurrentCascadeLevel;
     vec4 Position;
-    sampler2D GM_ShadowMap;
     int ShadowMapWidth;
     int ShadowMapHeight;
     float BiasMin;
@@ -43,9 +58,8 @@ struct GMShadowInfo
     int CascadedShadowLevel;
     int ViewCascade;
     int PCFRows;
-};
-
-uniform GMShadowInfo GM_ShadowInfo;
+} GM_ShadowInfo;
+uniform sampler2D GM_ShadowMap;
 
 struct GMScreenInfo
 {
@@ -0,0 +1,31 @@
+// 实例化绘制
+// 实例化绘制时，每个实例的世界矩阵通过顶点属性gm_instanceWorldMatrix传入，此时GM_WorldMatrix和GM_InverseTransposeModelMatrix为单位矩阵
+mat4 GM_GetWorldMatrix()
+{
+    if (GM_UseInstancing == 1)
+        return gm_instanceWorldMatrix;
+    return GM_WorldMatrix;
+}
+
+mat3 GM_InverseTranspose3x3(mat3 m)
+{
+    // 伴随矩阵的转置除以行列式，即为逆矩阵的转置
+    vec3 c0 = cross(m[1], m[2]);
+    vec3 c1 = cross(m[2], m[0]);
+    vec3 c2 = cross(m[0], m[1]);
+    return mat3(c0, c1, c2) / dot(m[0], c0);
+}
+
+void GM_TransformInstanceNormals()
+{
+    // 片元着色器使用单位矩阵作为法线变换矩阵，因此在这里将法线和切线变换到世界坐标系
+    if (GM_UseInstancing == 1)
+    {
+        mat3 inverseTransposeWorldMatrix = GM_InverseTranspose3x3(mat3(gm_instanceWorldMatrix));
+        normal = vec4(inverseTransposeWorldMatrix * normal.xyz, normal.w);
+        tangent = vec4(inverseTransposeWorldMatrix * tangent.xyz, tangent.w);
+        bitangent = vec4(inverseTransposeWorldMatrix * bitangent.xyz, bitangent.w);
+        _tangent = tangent;
+        _bitangent = bitangent;
+    }
+}
@@ -26,8 +26,12 @@ struct GM_light_t
     float CutOff;
 };
 
-uniform GM_light_t GM_lights[MAX_LIGHT_COUNT];
-uniform int GM_LightCount;
+// 光源，所有着色器程序共享，与GMGLLightsBlock对应
+layout (std140) uniform GM_LightBlock
+{
+    GM_light_t GM_lights[MAX_LIGHT_COUNT];
+    int GM_LightCount;
+};
 
 const int GM_IlluminationModel_None = 0;
 const int GM_IlluminationModel_Phong = 1;
@@ -39,10 +43,15 @@ const int GM_PointLight = 0;
 const int GM_DirectionalLight = 1;
 const int GM_Spotlight = 2;
 
-// Gamma校正
-uniform int GM_GammaCorrection;
-uniform float GM_Gamma;
-uniform float GM_GammaInv;
+// Gamma校正和HDR，所有着色器程序共享，与GMGLFrameBlock对应
+layout (std140) uniform GM_FrameBlock
+{
+    int GM_GammaCorrection;
+    float GM_Gamma;
+    float GM_GammaInv;
+    int GM_HDR;
+    int GM_ToneMapping;
+};
 vec3 GM_CalculateGammaCorrection(vec3 factor)
 {
     return pow(factor, vec3(GM_GammaInv, GM_GammaInv, GM_GammaInv));
@@ -229,7 +238,7 @@ float GM_CalculateShadow_Multisampling(vec3 projCoords, int cascade, float bias)
                 float distance_i = float(i) * di, distance_j = float(j) * dj;
                 if ( (x + distance_i >= 0.f && y + distance_j >= 0.f) && (x + distance_i <= 1.f && y + distance_j <= 1.f) )
                 {
-                    closestDepth = texture(GM_ShadowInfo.GM_ShadowMap, vec2(x + distance_i, y + distance_j)).r;
+                    closestDepth = texture(GM_ShadowMap, vec2(x + distance_i, y + distance_j)).r;
                     result += ((projCoords.z - bias) > closestDepth) ? 0.f : 1.f;
                     ++samples;
                 }
@@ -251,7 +260,7 @@ float GM_CalculateShadow_Multisampling(vec3 projCoords, int cascade, float bias)
                 float distance_i = float(i) * di, distance_j = float(j) * dj;
                 if ( (x + distance_i >= 0.f && y + distance_j >= 0.f) && (x + distance_i <= float(GM_ShadowInfo.ShadowMapWidth) && y + distance_j <= float(GM_ShadowInfo.ShadowMapHeight)) )
                 {
-                    closestDepth = texture(GM_ShadowInfo.GM_ShadowMap, vec2(x + distance_i, y + distance_j)).r;
+                    closestDepth = texture(GM_ShadowMap, vec2(x + distance_i, y + distance_j)).r;
                     result += ((projCoords.z - bias) > closestDepth) ? 0.f : 1.f;
                     ++samples;
                 }
@@ -307,14 +316,14 @@ float GM_CalculateShadow(PS_3D_INPUT vertex)
         // 非多重采样不支持PCF
         if (GM_ShadowInfo.CascadedShadowLevel == 1)
         {
-            closestDepth = texture(GM_ShadowInfo.GM_ShadowMap, projCoords.xy).r;
+            closestDepth = texture(GM_ShadowMap, projCoords.xy).r;
         }
         else
         {
             // 每一份Shadow Map的缩放。例如，假设Cascade Level = 3，那么第一幅Shadow Map采样范围就是0~0.333。
             float projRatio = 1.f / float(GM_ShadowInfo.CascadedShadowLevel);
             vec2 projCoordsInCSM = vec2(projRatio * (projCoords.x + float(cascade)), projCoords.y);
-            closestDepth = texture(GM_ShadowInfo.GM_ShadowMap, projCoordsInCSM.xy).r;
+            closestDepth = texture(GM_ShadowMap, projCoordsInCSM.xy).r;
         }
     }
 
@@ -0,0 +1,65 @@
+// 骨骼动画
+// 一帧中所有动画模型的骨骼变换都存放在骨骼调色板GM_BonePalette中，每个纹素为4个浮点数，GM_BoneOffset为当前模型的第一个骨骼所在的纹素
+// 线性混合蒙皮时，每个骨骼占用4个纹素，为矩阵的4列；对偶四元数蒙皮时，每个骨骼占用2个纹素，依次为实部和对偶部
+const int GM_LinearSkinning = 0;
+const int GM_DualQuaternionSkinning = 1;
+
+mat4 GM_GetPaletteMatrix(int bone)
+{
+    int texel = GM_BoneOffset + bone * 4;
+    return mat4(
+        texelFetch(GM_BonePalette, texel),
+        texelFetch(GM_BonePalette, texel + 1),
+        texelFetch(GM_BonePalette, texel + 2),
+        texelFetch(GM_BonePalette, texel + 3)
+    );
+}
+
+mat4 GM_DualQuaternionToMatrix(vec4 real, vec4 dual)
+{
+    float len = length(real);
+    real /= len;
+    dual /= len;
+    vec3 t = 2.0 * (dual.xyz * real.w - real.xyz * dual.w + cross(real.xyz, dual.xyz));
+
+    float x = real.x;
+    float y = real.y;
+    float z = real.z;
+    float w = real.w;
+    return mat4(
+        1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + w * z), 2.0 * (x * z - w * y), 0.0,
+        2.0 * (x * y - w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + w * x), 0.0,
+        2.0 * (x * z + w * y), 2.0 * (y * z - w * x), 1.0 - 2.0 * (x * x + y * y), 0.0,
+        t, 1.0
+    );
+}
+
+mat4 GM_GetSkinningMatrix()
+{
+    // 仿射变换动画只有1个矩阵
+    if (GM_UseAnimation == GM_AffineAnimation)
+        return GM_GetPaletteMatrix(0);
+
+    if (GM_SkinningMode == GM_DualQuaternionSkinning)
+    {
+        vec4 real0 = texelFetch(GM_BonePalette, GM_BoneOffset + boneIDs[0] * 2);
+        vec4 real = vec4(0);
+        vec4 dual = vec4(0);
+        for (int i = 0; i < 4; ++i)
+        {
+            int texel = GM_BoneOffset + boneIDs[i] * 2;
+            vec4 r = texelFetch(GM_BonePalette, texel);
+            // q和-q表示相同的旋转，将所有的四元数翻转到同一个半球，避免混合时绕远路
+            float weight = dot(r, real0) < 0.0 ? -weights[i] : weights[i];
+            real += r * weight;
+            dual += texelFetch(GM_BonePalette, texel + 1) * weight;
+        }
+        return GM_DualQuaternionToMatrix(real, dual);
+    }
+
+    mat4 boneTransform = GM_GetPaletteMatrix(boneIDs[0]) * weights[0];
+    boneTransform += GM_GetPaletteMatrix(boneIDs[1]) * weights[1];
+    boneTransform += GM_GetPaletteMatrix(boneIDs[2]) * weights[2];
+    boneTransform += GM_GetPaletteMatrix(boneIDs[3]) * weights[3];
+    return boneTransform;
+}
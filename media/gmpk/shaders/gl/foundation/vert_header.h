@@ -8,6 +8,10 @@ layout (location = 5) in vec2 lightmapuv;
 layout (location = 6) in vec4 color;
 layout (location = 7) in ivec4 boneIDs;
 layout (location = 8) in vec4 weights;
+layout (location = 9) in mat4 gm_instanceWorldMatrix; // 占用9~12，仅在实例化绘制时有效
+
+// 使用八面体编码的属性，第0、1、2位分别表示法线、切线、副切线
+uniform int GM_OctahedralAttributes = 0;
 
 out vec4 _position;
 out vec4 _normal;
@@ -23,12 +27,25 @@ vec4 normal;
 vec4 tangent;
 vec4 bitangent;
 
+vec3 decode_octahedral(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * (step(0.0, v.xy) * 2.0 - 1.0);
+    return normalize(v);
+}
+
+vec3 decode_vertex_vector(vec3 v, int bit)
+{
+    return (GM_OctahedralAttributes & bit) != 0 ? decode_octahedral(v.xy) : v;
+}
+
 void init_layouts()
 {
     position = vec4(gm_position.xyz, 1);
-    normal = vec4(gm_normal.xyz, 1);
-    tangent = vec4(gm_tangent.xyz, 1);
-    bitangent = vec4(gm_bitangent.xyz, 1);
+    normal = vec4(decode_vertex_vector(gm_normal.xyz, 1), 1);
+    tangent = vec4(decode_vertex_vector(gm_tangent.xyz, 2), 1);
+    bitangent = vec4(decode_vertex_vector(gm_bitangent.xyz, 4), 1);
 
     _position = position;
     _normal = normal;
@@ -1,19 +1,10 @@
 void GM_Shadow()
 {
-    if (GM_UseAnimation == GM_SkeletalAnimation)
+    if (GM_UseAnimation != GM_NoAnimation)
     {
-        mat4 boneTransform = GM_Bones[boneIDs[0]] * weights[0];
-        boneTransform += GM_Bones[boneIDs[1]] * weights[1];
-        boneTransform += GM_Bones[boneIDs[2]] * weights[2];
-        boneTransform += GM_Bones[boneIDs[3]] * weights[3];
-        position = boneTransform * position;
-    }
-    else if (GM_UseAnimation == GM_AffineAnimation)
-    {
-        // 将仿射变换的值放到第1个Bones矩阵中
-        position = GM_Bones[0] * position;
+        position = GM_GetSkinningMatrix() * position;
     }
     
     position = _position;
-    gl_Position = GM_ShadowInfo.ShadowMatrix[GM_ShadowInfo.CurrentCascadeLevel] * GM_WorldMatrix * position;
+    gl_Position = GM_ShadowInfo.ShadowMatrix[GM_ShadowInfo.CurrentCascadeLevel] * GM_GetWorldMatrix() * position;
 }
\ No newline at end of file
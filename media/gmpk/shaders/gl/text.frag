@@ -1,13 +1,17 @@
 void GM_Text(void)
 {
+    float alpha = 0;
     if (GM_AmbientTextureAttribute.Enabled == 1)
     {
-        _frag_color = texture(GM_AmbientTextureAttribute.Texture, _uv * vec2(GM_AmbientTextureAttribute.ScaleX, GM_AmbientTextureAttribute.ScaleY));
+        alpha = texture(GM_AmbientTextureAttribute.Texture, _uv * vec2(GM_AmbientTextureAttribute.ScaleX, GM_AmbientTextureAttribute.ScaleY)).r;
     }
-    else
+
+    // 法线的x分量为1表示距离场字形，0.5为字形的边缘
+    if (_normal.x > 0.5)
     {
-        _frag_color = vec4(0, 0, 0, 0);
+        float width = fwidth(alpha);
+        alpha = smoothstep(0.5 - width, 0.5 + width, alpha);
     }
 
-    _frag_color = vec4(_color.rgb, _frag_color.r * _color.a);
+    _frag_color = vec4(_color.rgb, alpha * _color.a);
 }
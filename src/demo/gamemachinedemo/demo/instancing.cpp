@@ -0,0 +1,153 @@
+﻿#include "stdafx.h"
+#include "instancing.h"
+#include <gmwidget.h>
+#include <gmcontrols.h>
+
+namespace
+{
+	const gm::GMCameraLookAt s_lookAt = gm::GMCameraLookAt::makeLookAt(
+		GMVec3(0, 20.f, -40.f),
+		GMVec3(0, 0, 0)
+	);
+
+	constexpr gm::GMint32 s_gridSize = 32;
+	constexpr gm::GMfloat s_spacing = 2.f;
+}
+
+void Demo_Instancing::setLookAt()
+{
+	gm::GMCamera& camera = getDemonstrationWorld()->getContext()->getEngine()->getCamera();
+	camera.setPerspective(PI / 3, 1.333f, .1f, 3200);
+	camera.lookAt(s_lookAt);
+}
+
+Demo_Instancing::Demo_Instancing(DemonstrationWorld* parentDemonstrationWorld)
+	: Base(parentDemonstrationWorld)
+{
+	GM_CREATE_DATA();
+}
+
+void Demo_Instancing::init()
+{
+	D(d);
+	D_BASE(db, DemoHandler);
+	Base::init();
+
+	// 创建对象
+	getDemoWorldReference().reset(new gm::GMDemoGameWorld(db->parentDemonstrationWorld->getContext()));
+
+	gm::GMTextureAsset texture = gm::GMToolUtil::createTexture(getDemoWorldReference()->getContext(), "cube_diffuse.png");
+	getDemoWorldReference()->getAssets().addAsset(texture);
+
+	// 所有立方体共享同一个场景，因此共享模型和着色器
+	gm::GMSceneAsset cube;
+	gm::GMPrimitiveCreator::createCube(gm::GMPrimitiveCreator::one3(), cube);
+	gm::GMShader& shader = cube.getScene()->getModels()[0].getModel()->getShader();
+	shader.getMaterial().setAmbient(GMVec3(.2f));
+	shader.getMaterial().setDiffuse(GMVec3(.8f));
+	shader.getMaterial().setSpecular(GMVec3(.2f));
+	shader.getMaterial().setShininess(20);
+	gm::GMToolUtil::addTextureToShader(shader, texture, gm::GMTextureType::Diffuse);
+	gm::GMAsset asset = getDemoWorldReference()->getAssets().addAsset(cube);
+
+	const gm::GMfloat origin = -(s_gridSize - 1) * s_spacing * .5f;
+	for (gm::GMint32 z = 0; z < s_gridSize; ++z)
+	{
+		for (gm::GMint32 x = 0; x < s_gridSize; ++x)
+		{
+			gm::GMGameObject* gameObject = new gm::GMGameObject(asset);
+			gameObject->setTranslation(Translate(GMVec3(origin + x * s_spacing, 0, origin + z * s_spacing)));
+			gameObject->setScaling(Scale(GMVec3(.5f, .5f, .5f)));
+			gameObject->setInstancing(d->instancing);
+			asDemoGameWorld(getDemoWorldReference())->addObject(gm::GMString(L"cube") + gm::GMString(z * s_gridSize + x), gameObject);
+			d->gameObjects.push_back(gameObject);
+		}
+	}
+
+	gm::GMWidget* widget = createDefaultWidget();
+	auto top = getClientAreaTop();
+	gm::GMControlButton* button = nullptr;
+	widget->addControl(button = gm::GMControlButton::createControl(
+		widget,
+		L"开启/关闭实例化",
+		10,
+		top,
+		250,
+		30,
+		false
+	));
+
+	connect(*button, GM_SIGNAL(gm::GMControlButton, click), [=](gm::GMObject* sender, gm::GMObject* receiver) {
+		setInstancing(!d->instancing);
+	});
+
+	widget->setSize(widget->getSize().width, top + 40);
+}
+
+void Demo_Instancing::setInstancing(bool instancing)
+{
+	D(d);
+	d->instancing = instancing;
+	for (auto gameObject : d->gameObjects)
+	{
+		gameObject->setInstancing(instancing);
+	}
+}
+
+void Demo_Instancing::rotateObjects(gm::GMDuration dt)
+{
+	D(d);
+	// 每个立方体都在运动，实例数据每帧都需要重新上传
+	d->angle += dt;
+	for (gm::GMsize_t i = 0; i < d->gameObjects.size(); ++i)
+	{
+		gm::GMfloat phase = d->angle + static_cast<gm::GMfloat>(i) * .1f;
+		d->gameObjects[i]->setRotation(Rotate(phase, GMVec3(0, 1, 0)));
+	}
+}
+
+void Demo_Instancing::setDefaultLights()
+{
+	if (isInited())
+	{
+		gm::ILight* light = nullptr;
+		GM.getFactory()->createLight(gm::GMLightType::DirectionalLight, &light);
+		GM_ASSERT(light);
+		gm::GMfloat lightDirection[] = { .5f, -1.f, .5f };
+		light->setLightAttribute3(gm::GMLight::Direction, lightDirection);
+
+		gm::GMfloat ambientIntensity[] = { .6f, .6f, .6f };
+		light->setLightAttribute3(gm::GMLight::AmbientIntensity, ambientIntensity);
+
+		gm::GMfloat diffuseIntensity[] = { .8f, .8f, .8f };
+		light->setLightAttribute3(gm::GMLight::DiffuseIntensity, diffuseIntensity);
+		getDemonstrationWorld()->getContext()->getEngine()->addLight(light);
+	}
+}
+
+void Demo_Instancing::event(gm::GameMachineHandlerEvent evt)
+{
+	Base::event(evt);
+	switch (evt)
+	{
+	case gm::GameMachineHandlerEvent::FrameStart:
+		break;
+	case gm::GameMachineHandlerEvent::FrameEnd:
+		break;
+	case gm::GameMachineHandlerEvent::Update:
+		rotateObjects(GM.getRunningStates().lastFrameElapsed);
+		getDemoWorldReference()->updateGameWorld(GM.getRunningStates().lastFrameElapsed);
+		break;
+	case gm::GameMachineHandlerEvent::Render:
+		getDemoWorldReference()->renderScene();
+		break;
+	case gm::GameMachineHandlerEvent::Activate:
+		break;
+	case gm::GameMachineHandlerEvent::Deactivate:
+		break;
+	case gm::GameMachineHandlerEvent::Terminate:
+		break;
+	default:
+		break;
+	}
+}
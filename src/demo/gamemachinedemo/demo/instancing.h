@@ -0,0 +1,43 @@
+﻿#ifndef __DEMO_INSTANCING_H__
+#define __DEMO_INSTANCING_H__
+
+#include <gamemachine.h>
+#include <gmdemogameworld.h>
+#include "demonstration_world.h"
+
+GM_PRIVATE_OBJECT_ALIGNED(Demo_Instancing)
+{
+	Vector<gm::GMGameObject*> gameObjects;
+	bool instancing = true;
+	gm::GMfloat angle = 0;
+};
+
+class Demo_Instancing : public DemoHandler
+{
+	GM_DECLARE_PRIVATE(Demo_Instancing)
+	GM_DECLARE_BASE(DemoHandler)
+
+public:
+	Demo_Instancing(DemonstrationWorld* parentDemonstrationWorld);
+
+public:
+	virtual void init() override;
+	virtual void event(gm::GameMachineHandlerEvent evt) override;
+
+private:
+	void setInstancing(bool instancing);
+	void rotateObjects(gm::GMDuration dt);
+
+protected:
+	virtual void setLookAt() override;
+	virtual void setDefaultLights() override;
+
+protected:
+	const gm::GMString& getDescription() const
+	{
+		static gm::GMString desc = L"渲染大量共享同一个场景的立方体。开启实例化后，它们被合并为一次绘制。";
+		return desc;
+	}
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "sponza.h"
 #include <gmgameobject.h>
 #include <gmmodelreader.h>
+#include <gmgraphicengine.h>
 #include <gmcontrols.h>
 #include <gmimagebuffer.h>
 
@@ -207,12 +208,17 @@ void Demo_Sponza::createObject()
 		getDemoWorldReference()->getContext()
 	);
 
-	gm::GMAsset models;
-	gm::GMModelReader::load(loadSettings, models);
-	gm::GMAsset asset = getDemoWorldReference()->getAssets().addAsset(models);
-	d->sponza = new gm::GMGameObject(asset);
-	d->sponza->setCullOption(gm::GMGameObjectCullOption::AABB);
-	asDemoGameWorld(getDemoWorldReference())->addObject(L"sponza", d->sponza);
+	// 场景在工作线程中读取，纹理和顶点数据在之后的若干帧中上传，加载时窗口仍然可以响应
+	gm::GMGraphicEngine* engine = gm::gm_cast<gm::GMGraphicEngine*>(getDemoWorldReference()->getContext()->getEngine());
+	engine->getAssetStreamer().requestModel(loadSettings, 0, gm::GMSceneAsset(), [this, d](gm::GMAsset models) {
+		if (models.isEmpty())
+			return;
+
+		gm::GMAsset asset = getDemoWorldReference()->getAssets().addAsset(models);
+		d->sponza = new gm::GMGameObject(asset);
+		d->sponza->setCullOption(gm::GMGameObjectCullOption::AABB);
+		asDemoGameWorld(getDemoWorldReference())->addObject(L"sponza", d->sponza);
+	});
 
 	d->skyObject = createCubeMap(getDemoWorldReference()->getContext());
 	d->skyObject->setScaling(Scale(GMVec3(1500, 1500, 1500)));
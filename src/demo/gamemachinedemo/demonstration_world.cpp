@@ -36,6 +36,7 @@
 #include "demo/wave.h"
 #include "demo/effectreader.h"
 #include "demo/sponza.h"
+#include "demo/instancing.h"
 
 extern gm::GMRenderEnvironment GetRenderEnv();
 
@@ -59,6 +60,7 @@ namespace
 		world->addDemo(L"异步: 实现异步加载资源。", new Demo_Async(world));
 		world->addDemo(L"模型: 读取模型文件。", new Demo_Model(world));
 		world->addDemo(L"阴影: 使用CSM渲染场景。", new Demo_CSM(world));
+		world->addDemo(L"实例化: 渲染大量共享同一个场景的对象。", new Demo_Instancing(world));
 		// world->addDemo(L"模型: 使用ASSIMP读取各种模型文件。", new Demo_Assimp(world));
 		world->addDemo(L"物理: 演示相互碰撞的物体(Box)。", new Demo_Collision(world));
 		world->addDemo(L"物理: 演示相互碰撞的物体(Cone)。", new Demo_Collision_Cone(world));
@@ -0,0 +1 @@
+﻿#include "../src/gmdata/gmanimationclip.h"
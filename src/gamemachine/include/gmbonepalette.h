@@ -0,0 +1 @@
+﻿#include "../src/gmengine/gmbonepalette.h"
@@ -0,0 +1 @@
+﻿#include "../src/foundation/gmcommandqueue.h"
@@ -0,0 +1 @@
+﻿#include "../src/gmdata/gamepackage/gmgamepackagehandler.h"
@@ -0,0 +1 @@
+﻿#include "../src/gmdata/glyph/gmglyphatlas.h"
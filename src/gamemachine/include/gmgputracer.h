@@ -0,0 +1 @@
+﻿#include "../src/gmengine/gmgputracer.h"
@@ -0,0 +1 @@
+﻿#include "../src/gmengine/gmrendergraph.h"
@@ -7,6 +7,10 @@
 #include <chrono>
 #include <ctime>
 #include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
 #if !GM_WINDOWS
 #include <iostream>
 #endif
@@ -15,21 +19,336 @@ BEGIN_NS
 
 namespace
 {
-	GMString getFormattedTime()
+	// 每个线程的环形缓冲区能容纳的日志条数，必须是2的幂
+	constexpr GMsize_t RingCapacity = 1024;
+	// 每条日志最多保存的参数个数
+	constexpr GMsize_t MaxArguments = 8;
+	// 后台线程在没有被唤醒时，检查环形缓冲区的间隔
+	constexpr GMint32 SinkIntervalMilliseconds = 50;
+
+	typedef std::chrono::system_clock::time_point LogTime;
+
+	struct LogRecord
+	{
+		GMint64 sequence = 0;
+		LogTime time;
+		GMDebugLevel level = GMDebugLevel::Info;
+		GMString format;
+		GMString arguments[MaxArguments];
+		GMsize_t argumentCount = 0;
+	};
+
+	// 单生产者单消费者的环形缓冲区，生产者为写日志的线程，消费者为后台线程
+	struct LogRing
+	{
+		LogRecord records[RingCapacity];
+		GMAtomic<GMsize_t> head { 0 }; // 下一条要读取的日志，只由消费者修改
+		GMAtomic<GMsize_t> tail { 0 }; // 下一条要写入的日志，只由生产者修改
+		GMAtomic<GMsize_t> dropped { 0 };
+		GMAtomic<bool> closed { false }; // 生产者线程已经结束
+	};
+
+	// 线程结束时，标记其环形缓冲区，后台线程取完其中的日志后将其释放
+	struct LocalLogRing
+	{
+		std::shared_ptr<LogRing> ring;
+
+		~LocalLogRing()
+		{
+			if (ring)
+				ring->closed = true;
+		}
+	};
+
+	thread_local LocalLogRing t_ring;
+
+	GMString getFormattedTime(const LogTime& time)
 	{
-		auto now = std::chrono::system_clock::now();
-		std::time_t std_now = std::chrono::system_clock::to_time_t(now);
+		std::time_t std_now = std::chrono::system_clock::to_time_t(time);
 		std::tm* localTime = std::localtime(&std_now);
 		std::string r = std::asctime(localTime);
 		return r.substr(0, r.length() - 1);
 	}
+
+	const GMwchar* getPrefix(GMDebugLevel level)
+	{
+		switch (level)
+		{
+		case GMDebugLevel::Debug:
+			return L"debug";
+		case GMDebugLevel::Info:
+			return L"info";
+		case GMDebugLevel::Warning:
+			return L"warning";
+		case GMDebugLevel::Error:
+		default:
+			return L"error";
+		}
+	}
+
+	IDebugOutput::Method getMethod(GMDebugLevel level)
+	{
+		switch (level)
+		{
+		case GMDebugLevel::Debug:
+			return &IDebugOutput::debug;
+		case GMDebugLevel::Info:
+			return &IDebugOutput::info;
+		case GMDebugLevel::Warning:
+			return &IDebugOutput::warning;
+		case GMDebugLevel::Error:
+		default:
+			return &IDebugOutput::error;
+		}
+	}
+
+	GMString formatRecord(const LogRecord& record)
+	{
+		GMString string = record.format;
+		for (GMsize_t i = 0; i < record.argumentCount; ++i)
+		{
+			string = string.replace(L"{" + GMString(gm_sizet_to_int(i)) + L"}", record.arguments[i]);
+		}
+		GMString s = getFormattedTime(record.time) + L": [" + getPrefix(record.level) + L"] " + std::move(string);
+		s += "\n";
+		return s;
+	}
 }
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMDebugger)
 {
-	IDebugOutput* debugger = nullptr;
+	GMAtomic<IDebugOutput*> debugger { nullptr };
+	GMAtomic<GMint32> level { GM_DEBUG_MIN_LEVEL };
+	GMAtomic<GMint64> sequence { 0 };
+
+	// 所有线程的环形缓冲区
+	std::mutex ringsLock;
+	Vector<std::shared_ptr<LogRing>> rings;
+	GMsize_t droppedByClosedRings = 0;
+
+	// 后台线程的状态
+	std::mutex sinkLock;
+	std::condition_variable sinkCondition;
+	std::condition_variable flushCondition;
+	std::thread sink;
+	bool sinkStarted = false;
+	GMAtomic<bool> stopping { false };
+	GMint64 written = 0;
+	GMsize_t reportedDrops = 0;
+
+	// 输出，只在后台线程中使用，或者在后台线程不存在时同步使用
+	std::mutex outputLock;
+	std::ofstream logFile;
+
+	LogRing* getLocalRing();
+	void push(GMDebugLevel level, const GMString& string, const std::initializer_list<GMString>& arguments);
+	void sinkLoop();
+	GMsize_t collect(Vector<LogRecord>& batch);
+	GMsize_t getDroppedCount();
+	void write(const Vector<LogRecord>& batch);
+	void stop();
 };
 
+LogRing* GMDebuggerPrivate::getLocalRing()
+{
+	if (!t_ring.ring)
+	{
+		t_ring.ring = std::make_shared<LogRing>();
+		std::lock_guard<std::mutex> lock(ringsLock);
+		rings.push_back(t_ring.ring);
+	}
+
+	// 第一次写日志时启动后台线程
+	std::lock_guard<std::mutex> lock(sinkLock);
+	if (!sinkStarted && !stopping)
+	{
+		sinkStarted = true;
+		sink = std::thread([this]() { sinkLoop(); });
+	}
+	return t_ring.ring.get();
+}
+
+void GMDebuggerPrivate::push(GMDebugLevel level, const GMString& string, const std::initializer_list<GMString>& arguments)
+{
+	LogRing* ring = t_ring.ring ? t_ring.ring.get() : getLocalRing();
+	const GMsize_t tail = ring->tail.load(std::memory_order_relaxed);
+	const GMsize_t head = ring->head.load(std::memory_order_acquire);
+	if (tail - head >= RingCapacity)
+	{
+		// 缓冲区已满，丢弃而不是等待
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	LogRecord& record = ring->records[tail & (RingCapacity - 1)];
+	record.sequence = sequence.fetch_add(1, std::memory_order_relaxed);
+	record.time = std::chrono::system_clock::now();
+	record.level = level;
+	record.format = string;
+	record.argumentCount = 0;
+	for (decltype(auto) argument : arguments)
+	{
+		if (record.argumentCount == MaxArguments)
+			break;
+		record.arguments[record.argumentCount++] = argument;
+	}
+	ring->tail.store(tail + 1, std::memory_order_release);
+
+	// 只在缓冲区由空变为非空时唤醒后台线程，连续的日志会被一起取走
+	if (tail == head)
+		sinkCondition.notify_one();
+}
+
+void GMDebuggerPrivate::sinkLoop()
+{
+	Vector<LogRecord> batch;
+	std::unique_lock<std::mutex> lock(sinkLock);
+	while (true)
+	{
+		lock.unlock();
+		GMsize_t count = collect(batch);
+		if (count > 0)
+		{
+			// 按照提交的顺序输出
+			std::sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+				return a.sequence < b.sequence;
+			});
+			write(batch);
+			batch.clear();
+		}
+
+		GMsize_t dropped = getDroppedCount();
+		if (dropped != reportedDrops)
+		{
+			LogRecord record;
+			record.time = std::chrono::system_clock::now();
+			record.level = GMDebugLevel::Warning;
+			record.format = L"{0} log messages have been dropped because the log buffer is full.";
+			record.arguments[0] = GMString(gm_sizet_to_int(dropped - reportedDrops));
+			record.argumentCount = 1;
+			reportedDrops = dropped;
+			batch.push_back(std::move(record));
+			write(batch);
+			batch.clear();
+		}
+		lock.lock();
+
+		if (count > 0)
+		{
+			written += count;
+			flushCondition.notify_all();
+			continue;
+		}
+
+		if (stopping)
+			break;
+
+		sinkCondition.wait_for(lock, std::chrono::milliseconds(SinkIntervalMilliseconds));
+	}
+}
+
+GMsize_t GMDebuggerPrivate::collect(Vector<LogRecord>& batch)
+{
+	Vector<std::shared_ptr<LogRing>> snapshot;
+	{
+		std::lock_guard<std::mutex> lock(ringsLock);
+		snapshot = rings;
+	}
+
+	GMsize_t count = 0;
+	for (auto& ring : snapshot)
+	{
+		// 先读取closed，再取日志，保证取完时已经结束的线程不会再写入
+		bool closed = ring->closed.load(std::memory_order_acquire);
+		const GMsize_t head = ring->head.load(std::memory_order_relaxed);
+		const GMsize_t tail = ring->tail.load(std::memory_order_acquire);
+		for (GMsize_t i = head; i != tail; ++i)
+		{
+			batch.push_back(std::move(ring->records[i & (RingCapacity - 1)]));
+		}
+		ring->head.store(tail, std::memory_order_release);
+		count += tail - head;
+
+		if (closed)
+		{
+			std::lock_guard<std::mutex> lock(ringsLock);
+			droppedByClosedRings += ring->dropped.load(std::memory_order_relaxed);
+			rings.erase(std::find(rings.begin(), rings.end(), ring));
+		}
+	}
+	return count;
+}
+
+GMsize_t GMDebuggerPrivate::getDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(ringsLock);
+	GMsize_t dropped = droppedByClosedRings;
+	for (auto& ring : rings)
+	{
+		dropped += ring->dropped.load(std::memory_order_relaxed);
+	}
+	return dropped;
+}
+
+void GMDebuggerPrivate::write(const Vector<LogRecord>& batch)
+{
+	std::lock_guard<std::mutex> lock(outputLock);
+	IDebugOutput* output = debugger.load();
+	std::string console;
+	std::string file;
+	for (const auto& record : batch)
+	{
+		GMString s = formatRecord(record);
+		if (logFile.is_open())
+			file += s.toStdString();
+
+		if (output)
+		{
+			(output->*getMethod(record.level))(s);
+		}
+		else
+		{
+#if GM_WINDOWS
+			constexpr GMsize_t BUFLEN = 1024;
+			GMwchar buffer[BUFLEN];
+			std::wstring content = s.toStdWString();
+			std::wstringstream ss(content);
+			while (ss.getline(buffer, BUFLEN, '\n'))
+			{
+				OutputDebugStringW(buffer);
+			}
+			OutputDebugStringW(L"\n");
+#else
+			console += s.toStdString();
+			console += "\n";
+#endif
+		}
+	}
+
+#if !GM_WINDOWS
+	// 一批日志只刷新一次标准输出
+	if (!console.empty())
+		std::cout << console << std::flush;
+#endif
+
+	if (!file.empty())
+	{
+		logFile << file;
+		logFile.flush();
+	}
+}
+
+void GMDebuggerPrivate::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(sinkLock);
+		stopping = true;
+	}
+	sinkCondition.notify_one();
+	if (sink.joinable())
+		sink.join();
+}
+
 GMDebugger& GMDebugger::instance()
 {
 	static GMDebugger s_debugger;
@@ -43,6 +362,9 @@ GMDebugger::GMDebugger()
 
 GMDebugger::~GMDebugger()
 {
+	// 后台线程退出前会取完所有的日志
+	D(d);
+	d->stop();
 }
 
 void GMDebugger::setDebugOutput(IDebugOutput* output)
@@ -59,65 +381,110 @@ IDebugOutput* GMDebugger::getDebugOutput()
 	return nullptr;
 }
 
+void GMDebugger::setLevel(GMDebugLevel level)
+{
+	if (instance().data())
+		instance().data()->level = static_cast<GMint32>(level);
+}
+
+GMDebugLevel GMDebugger::getLevel()
+{
+	if (instance().data())
+		return static_cast<GMDebugLevel>(instance().data()->level.load());
+	return static_cast<GMDebugLevel>(GM_DEBUG_MIN_LEVEL);
+}
+
+bool GMDebugger::setLogFile(const GMString& path)
+{
+	GMDebuggerPrivate* d = instance().data();
+	if (!d)
+		return false;
+
+	std::lock_guard<std::mutex> lock(d->outputLock);
+	if (d->logFile.is_open())
+		d->logFile.close();
+
+	if (path.isEmpty())
+		return true;
+
+	d->logFile.open(path.toStdString(), std::ios::out | std::ios::app);
+	return d->logFile.is_open();
+}
+
+void GMDebugger::flush()
+{
+	GMDebuggerPrivate* d = instance().data();
+	if (!d)
+		return;
+
+	std::unique_lock<std::mutex> lock(d->sinkLock);
+	if (!d->sinkStarted || d->stopping)
+		return;
+
+	const GMint64 target = d->sequence.load();
+	d->sinkCondition.notify_one();
+	d->flushCondition.wait(lock, [d, target]() {
+		return d->written >= target || d->stopping;
+	});
+}
+
+GMsize_t GMDebugger::getDroppedCount()
+{
+	GMDebuggerPrivate* d = instance().data();
+	if (!d)
+		return 0;
+	return d->getDroppedCount();
+}
+
 void GMDebugger::info(const GMString& string, const std::initializer_list<GMString>& arguments)
 {
-	print(string, L"info", &IDebugOutput::info, arguments);
+	print(GMDebugLevel::Info, string, arguments);
 }
 
 void GMDebugger::warning(const GMString& string, const std::initializer_list<GMString>& arguments)
 {
-	print(string, L"warning", &IDebugOutput::warning, arguments);
+	print(GMDebugLevel::Warning, string, arguments);
 }
 
 void GMDebugger::debug(const GMString& string, const std::initializer_list<GMString>& arguments)
 {
-#if GM_DEBUG
-	print(string, L"debug", &IDebugOutput::debug, arguments);
-#endif
+	print(GMDebugLevel::Debug, string, arguments);
 }
 
 void GMDebugger::error(const GMString& string, const std::initializer_list<GMString>& arguments)
 {
-	print(string, L"error", &IDebugOutput::error, arguments);
+	print(GMDebugLevel::Error, string, arguments);
 }
 
 void GMDebugger::print(
-	GMString string,
-	const GMString& prefix,
-	IDebugOutput::Method method,
+	GMDebugLevel level,
+	const GMString& string,
 	const std::initializer_list<GMString>& arguments)
 {
 	D(d);
-	GMint32 i = 0;
-	for (decltype(auto) argument : arguments)
-	{
-		string = string.replace(L"{" + GMString(i++) + L"}", argument);
-	}
-	GMString s = getFormattedTime() + L": [" + prefix + L"] " + std::move(string);
-	s += "\n";
+	if (static_cast<GMint32>(level) < d->level.load(std::memory_order_relaxed))
+		return;
 
-	if (d->debugger)
-	{
-		(d->debugger->*method)(s);
-	}
-	else
+	if (d->stopping)
 	{
-#if GM_WINDOWS
-		constexpr GMsize_t BUFLEN = 1024;
-		GMwchar buffer[BUFLEN];
-		std::wstring content = s.toStdWString();
-		std::wstringstream ss(content);
-		while (ss.getline(buffer, BUFLEN, '\n'))
+		// 后台线程已经结束，直接输出
+		LogRecord record;
+		record.time = std::chrono::system_clock::now();
+		record.level = level;
+		record.format = string;
+		for (decltype(auto) argument : arguments)
 		{
-			OutputDebugStringW(buffer);
+			if (record.argumentCount == MaxArguments)
+				break;
+			record.arguments[record.argumentCount++] = argument;
 		}
-		OutputDebugStringW(L"\n");
-#else
-		std::cout << s.toStdString() << std::endl;
-#endif
+		d->write({ record });
+		return;
 	}
+
+	d->push(level, string, arguments);
 }
 
 Map<GMsize_t, void*> HookFactory::g_hooks;
 
-END_NS
\ No newline at end of file
+END_NS
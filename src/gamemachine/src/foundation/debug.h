@@ -18,7 +18,32 @@ GM_INTERFACE(IDebugOutput)
 	virtual void debug(const GMString& msg) = 0;
 };
 
+//! 日志的级别。
+enum class GMDebugLevel
+{
+	Debug, //!< 调试信息。
+	Info, //!< 一般信息。
+	Warning, //!< 警告。
+	Error, //!< 错误。
+};
+
+// 编译期的日志级别，0到3分别对应GMDebugLevel::Debug到GMDebugLevel::Error。低于此级别的日志宏会被展开为空语句
+#ifndef GM_DEBUG_MIN_LEVEL
+#	if GM_DEBUG
+#		define GM_DEBUG_MIN_LEVEL 0
+#	else
+#		define GM_DEBUG_MIN_LEVEL 1
+#	endif
+#endif
+
 GM_PRIVATE_CLASS(GMDebugger);
+//! 日志输出。
+/*!
+  写日志的线程只把日志的格式、参数和时间放入本线程的单生产者单消费者环形缓冲区中，不做格式化，也不等待输出。
+  一个后台线程从所有的环形缓冲区中取出日志，按照提交的顺序格式化，并成批地写入调试输出（或标准输出）和日志文件。<BR>
+  环形缓冲区已满时，新的日志会被丢弃并计数，写日志的线程永远不会被阻塞。后台线程会输出一条警告，说明丢弃了多少条日志。<BR>
+  因为输出在后台线程中进行，通过setDebugOutput()设置的IDebugOutput会在后台线程中被调用。
+*/
 class GM_EXPORT GMDebugger
 {
 	GM_DECLARE_PRIVATE(GMDebugger)
@@ -37,15 +62,36 @@ public:
 	static void setDebugOutput(IDebugOutput* output);
 	static IDebugOutput* getDebugOutput();
 
+	//! 设置运行时的日志级别，低于此级别的日志会被忽略。
+	/*!
+	  低于编译期级别GM_DEBUG_MIN_LEVEL的日志在编译时已经被移除，不受此设置影响。
+	  \param level 日志级别。
+	*/
+	static void setLevel(GMDebugLevel level);
+	static GMDebugLevel getLevel();
+
+	//! 设置日志文件。
+	/*!
+	  日志在写入调试输出的同时，追加到此文件中。
+	  \param path 日志文件的路径。如果为空，则关闭日志文件。
+	  \return 日志文件是否打开成功。
+	*/
+	static bool setLogFile(const GMString& path);
+
+	//! 等待此前提交的所有日志被写出。
+	static void flush();
+
+	//! 获取因为缓冲区已满而被丢弃的日志的条数。
+	static GMsize_t getDroppedCount();
+
 private:
 	void info(const GMString& string, const std::initializer_list<GMString>& arguments);
 	void warning(const GMString& string, const std::initializer_list<GMString>& arguments);
 	void debug(const GMString& string, const std::initializer_list<GMString>& arguments);
 	void error(const GMString& string, const std::initializer_list<GMString>& arguments);
 	void print(
-		GMString string,
-		const GMString& prefix,
-		IDebugOutput::Method method,
+		GMDebugLevel level,
+		const GMString& string,
 		const std::initializer_list<GMString>& arguments
 	);
 
@@ -76,10 +122,29 @@ public:
 };
 
 // debug macros:
+#if GM_DEBUG_MIN_LEVEL <= 0
+#define gm_debug gm::GMDebugger::instance().debug
+#else
+#define gm_debug(...) ((void)0)
+#endif
+
+#if GM_DEBUG_MIN_LEVEL <= 1
 #define gm_info gm::GMDebugger::instance().info
-#define gm_error gm::GMDebugger::instance().error
+#else
+#define gm_info(...) ((void)0)
+#endif
+
+#if GM_DEBUG_MIN_LEVEL <= 2
 #define gm_warning gm::GMDebugger::instance().warning
-#define gm_debug gm::GMDebugger::instance().debug
+#else
+#define gm_warning(...) ((void)0)
+#endif
+
+#if GM_DEBUG_MIN_LEVEL <= 3
+#define gm_error gm::GMDebugger::instance().error
+#else
+#define gm_error(...) ((void)0)
+#endif
 
 #if GM_WINDOWS
 	#if GM_DEBUG
@@ -3,6 +3,7 @@
 #include "gmdata/glyph/gmglyphmanager.h"
 #include "gmengine/gameobjects/gmgameobject.h"
 #include "gmconfigs.h"
+#include "gmprofile.h"
 #include "gmengine/ui/gmwidget.h"
 #include "gmmessage.h"
 #include "wrapper/dx11wrapper.h"
@@ -64,7 +65,7 @@ BEGIN_NS
 namespace
 {
 	static GMMessage s_frameUpdateMsg(GameMachineMessageType::FrameUpdate);
-	GMMutex s_callableLock;
+	GMMutex s_jobSystemLock;
 }
 
 
@@ -233,16 +234,7 @@ void GameMachinePrivate::initHandlers()
 
 void GameMachinePrivate::invokeCallables()
 {
-	GMMutexLock lock(&s_callableLock);
-	lock->lock();
-
-	while (!callableQueue.empty())
-	{
-		GMCallable callable = callableQueue.front();
-		if (callable)
-			callable();
-		callableQueue.pop();
-	}
+	callableQueue.execute();
 }
 
 IDestroyObject* GameMachinePrivate::registerManager(IDestroyObject* object)
@@ -278,6 +270,14 @@ void GameMachine::init(
 	D(d);
 	d->initSystemInfo();
 
+	{
+		// 调用者线程在等待任务时也会参与工作，因此工作线程比处理器核心数少一个
+		GMMutexLock lock(&s_jobSystemLock);
+		lock->lock();
+		if (!d->jobSystem)
+			d->jobSystem.reset(new GMJobSystem(d->states.systemInfo.numberOfProcessors - 1));
+	}
+
 	d->runningMode = desc.runningMode;
 	d->setRenderEnvironment(desc.renderEnvironment);
 	d->factory = gm_cast<IFactory*>(d->registerManager(desc.factory));
@@ -308,6 +308,16 @@ GMGamePackage* GameMachine::getGamePackageManager()
 	return d->gamePackageManager;
 }
 
+GMJobSystem* GameMachine::getJobSystem()
+{
+	D(d);
+	GMMutexLock lock(&s_jobSystemLock);
+	lock->lock();
+	// 任务系统只在init()和finalize()之间存在，不在这里创建，否则finalize()之后创建的工作线程将永远不会被回收
+	GM_ASSERT(d->jobSystem || !d->inited); // finalize()之后不应该再使用任务系统
+	return d->jobSystem.get();
+}
+
 IFactory* GameMachine::getFactory()
 {
 	D(d);
@@ -392,6 +402,8 @@ bool GameMachine::renderFrame(IWindow* window)
 
 	// 记录帧率
 	frameCounter.begin();
+	GM_TRACE_FRAME();
+	GM_TRACE_SCOPE("frame");
 
 	// 检查是否崩溃
 	if (d->checkCrashDown())
@@ -432,12 +444,22 @@ bool GameMachine::sendMessage(const GMMessage& msg)
 	return d->handleMessage(msg);
 }
 
-void GameMachine::invokeInMainThread(GMCallable callable)
+void GameMachine::invokeInMainThread(GMCallable callable, GMCommandPriority priority)
 {
 	D(d);
-	GMMutexLock lock(&s_callableLock);
-	lock->lock();
-	d->callableQueue.push(callable);
+	d->callableQueue.push(std::move(callable), priority);
+}
+
+void GameMachine::setInvokeBudget(GMint64 microseconds)
+{
+	D(d);
+	d->callableQueue.setBudget(microseconds);
+}
+
+const GMCommandQueueStats& GameMachine::getInvokeStats() const
+{
+	D(d);
+	return d->callableQueue.getStats();
 }
 
 void GameMachine::exit()
@@ -448,17 +470,12 @@ void GameMachine::exit()
 bool GameMachine::handleMessages()
 {
 	D(d);
+	GM_TRACE_COUNTER("Message queue depth", static_cast<GMint64>(d->messageQueue.size()));
 	GMMessage msg;
-	while (d->messageQueue.size() > 0)
+	while (d->messageQueue.pop(msg))
 	{
-		msg = d->messageQueue.front();
-
 		if (!d->handleMessage(msg))
-		{
-			d->messageQueue.pop();
 			return false;
-		}
-		d->messageQueue.pop();
 	}
 	d->lastMessage = msg;
 	return true;
@@ -489,6 +506,15 @@ void GameMachine::finalize()
 	{
 		GM_delete(window);
 	}
+
+	{
+		GMMutexLock lock(&s_jobSystemLock);
+		lock->lock();
+		d->jobSystem.reset();
+	}
+
+	// 日志在后台线程中输出，确保退出前所有的日志都已写出
+	GMDebugger::flush();
 }
 
 END_NS
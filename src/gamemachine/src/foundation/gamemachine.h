@@ -8,6 +8,7 @@
 #include <gmgamepackage.h>
 #include <gmthread.h>
 #include <gmmessage.h>
+#include <gmcommandqueue.h>
 
 extern "C"
 {
@@ -56,6 +57,7 @@ enum class GMProcessorArchitecture
 #define GM gm::GameMachine::instance()
 
 class GMWidget;
+class GMJobSystem;
 
 struct GMSystemInfo
 {
@@ -104,8 +106,6 @@ struct GMGameMachineDesc
 	GMGameMachineRunningMode runningMode = GMGameMachineRunningMode::GameMode;
 };
 
-typedef std::function<void()> GMCallable;
-
 GM_PRIVATE_CLASS(GameMachine);
 //! GameMachine类负责掌管整个进程的生命周期。
 /*!
@@ -155,6 +155,14 @@ public:
 	*/
 	GMGamePackage* getGamePackageManager();
 
+	//! 获取引擎的任务系统。
+	/*!
+	  任务系统拥有常驻的工作线程，引擎内部的并行计算（如粒子更新、视锥体裁剪）都在任务系统上执行。<BR>
+	  任务系统在init()时创建，在finalize()时销毁，工作线程数目为处理器核心数减1。
+	  \return 引擎的任务系统。如果在init()之前或者finalize()之后调用，返回nullptr。
+	*/
+	GMJobSystem* getJobSystem();
+
 	//! 获取程序当前的运行时状态。
 	/*!
 	  如当前窗口大小、上一帧执行时间等。
@@ -164,7 +172,8 @@ public:
 
 	//! 发送一条GameMachine的消息。
 	/*!
-	  发送一条GameMachine的消息。发送消息之后，此消息将会在下一轮消息循环时被执行。
+	  发送一条GameMachine的消息。发送消息之后，此消息将会在下一轮消息循环时被执行。<BR>
+	  可以在任意线程发送消息，消息队列是无锁的。
 	  \param msg 需要发送的GameMachine消息。
 	  \sa startGameMachine()
 	*/
@@ -249,10 +258,24 @@ public:
 
 	//! 将一个对象推入GameMachine可调用对象列表，它将在下一次GameMachine主线程循环的时候被调用。
 	/*!
-	  用户需要自己确保下一次调用可调用对象时，它是否还存在，需要自己确认函数中的生命周期管理是否正确。
+	  用户需要自己确保下一次调用可调用对象时，它是否还存在，需要自己确认函数中的生命周期管理是否正确。<BR>
+	  可以在任意线程调用此方法，提交时不加锁。如果设置了每帧的时间预算，普通优先级和低优先级的可调用对象可能会被推迟到之后的帧。
 	  \param callable 待调用的可调用对象。
+	  \param priority 可调用对象的优先级。
+	  \sa setInvokeBudget()
 	*/
-	void invokeInMainThread(GMCallable callable);
+	void invokeInMainThread(GMCallable callable, GMCommandPriority priority = GMCommandPriority::Normal);
+
+	//! 设置主线程每帧执行可调用对象的时间预算。
+	/*!
+	  超出预算之后，剩下的普通优先级和低优先级的可调用对象会留到下一帧执行。默认不限制时间。
+	  \param microseconds 时间预算，单位为微秒。如果小于等于0，则不限制时间。
+	  \sa invokeInMainThread()
+	*/
+	void setInvokeBudget(GMint64 microseconds);
+
+	//! 获取主线程最近一帧执行可调用对象的统计数据，如队列深度和等待时间。
+	const GMCommandQueueStats& getInvokeStats() const;
 
 	//! 退出程序。
 	void exit();
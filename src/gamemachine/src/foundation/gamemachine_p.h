@@ -1,6 +1,8 @@
 ﻿#ifndef __GAMEMACHINE_P_H__
 #define __GAMEMACHINE_P_H__
 #include <gmcommon.h>
+#include "gmasync.h"
+#include "gmcommandqueue.h"
 
 BEGIN_NS
 
@@ -15,10 +17,11 @@ GM_PRIVATE_OBJECT_UNALIGNED(GameMachine)
 	const IRenderContext* computeContext = nullptr;
 	IFactory* factory = nullptr;
 	GMGamePackage* gamePackageManager = nullptr;
+	GMOwnedPtr<GMJobSystem> jobSystem;
 	GMMessage lastMessage;
-	Queue<GMMessage> messageQueue;
+	GMMPSCQueue<GMMessage> messageQueue;
 	Vector<IDestroyObject*> managerQueue;
-	Queue<GMCallable> callableQueue;
+	GMCommandQueue callableQueue;
 	GMGameMachineRunningStates states;
 	GMGameMachineRunningMode runningMode;
 
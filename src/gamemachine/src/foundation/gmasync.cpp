@@ -1,8 +1,381 @@
 ﻿#include "stdafx.h"
 #include "gmasync.h"
+#include "gamemachine.h"
+#include <condition_variable>
+#include <thread>
 
 BEGIN_NS
 
+struct GMJob
+{
+	GMJobFunction function;
+	GMJobHandle parent;
+	GMAtomic<GMint32> unfinishedJobs; // 自身以及尚未结束的子任务数目
+	GMAtomic<GMint32> pendingDependencies; // 尚未结束的前置任务数目，以及一个run()的标记
+	std::mutex continuationLock;
+	Vector<GMJobHandle> continuations;
+	GMAtomic<bool> finished; // 在continuationLock中写入，createJob()等处会无锁读取
+
+	GMJob()
+		: unfinishedJobs(1)
+		, pendingDependencies(1)
+		, finished(false)
+	{
+	}
+};
+
+namespace
+{
+	struct GMJobQueue
+	{
+		std::mutex lock;
+		Deque<GMJobHandle> jobs;
+	};
+
+	class GMJobWorker : public GMThread
+	{
+	public:
+		GMJobWorker(GMJobSystemPrivate* system, GMint32 index)
+			: m_system(system)
+			, m_index(index)
+		{
+		}
+
+		virtual void run() override;
+
+	private:
+		GMJobSystemPrivate* m_system;
+		GMint32 m_index;
+	};
+
+	// wait()在没有可执行任务时，先让出时间片的次数，以及之后每次睡眠的时长
+	constexpr GMint32 WaitYieldCount = 64;
+	constexpr GMint32 WaitSleepMicroseconds = 50;
+
+	// 当前线程所属的任务系统，以及在此任务系统中的工作线程序号
+	thread_local GMJobSystemPrivate* t_system = nullptr;
+	thread_local GMint32 t_workerIndex = -1;
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMJobSystem)
+{
+	Vector<GMOwnedPtr<GMJobQueue>> workerQueues;
+	GMJobQueue sharedQueue;
+	Vector<GMOwnedPtr<GMJobWorker>> workers;
+	GMAtomic<GMint32> queuedJobs;
+	GMAtomic<bool> quit;
+	std::mutex sleepLock;
+	std::condition_variable sleepCondition;
+
+	void enqueue(const GMJobHandle& job);
+	GMJobHandle dequeue(GMint32 workerIndex);
+	void execute(const GMJobHandle& job);
+	void finish(GMJob* job);
+	void workerLoop(GMint32 workerIndex);
+	GMint32 currentWorkerIndex();
+};
+
+void GMJobWorker::run()
+{
+	m_system->workerLoop(m_index);
+}
+
+GMint32 GMJobSystemPrivate::currentWorkerIndex()
+{
+	return (t_system == this) ? t_workerIndex : -1;
+}
+
+void GMJobSystemPrivate::enqueue(const GMJobHandle& job)
+{
+	GMint32 workerIndex = currentWorkerIndex();
+	GMJobQueue& queue = workerIndex >= 0 ? *workerQueues[workerIndex] : sharedQueue;
+	{
+		std::lock_guard<std::mutex> lock(queue.lock);
+		queue.jobs.push_back(job);
+	}
+
+	++queuedJobs;
+	{
+		// 获取一次锁，避免工作线程在检查条件和进入睡眠之间错过通知
+		std::lock_guard<std::mutex> lock(sleepLock);
+	}
+	sleepCondition.notify_one();
+}
+
+GMJobHandle GMJobSystemPrivate::dequeue(GMint32 workerIndex)
+{
+	if (queuedJobs.load(std::memory_order_acquire) == 0)
+		return GMJobHandle();
+
+	GMJobHandle job;
+	// 先从自己的队列尾部取任务，这样最近提交的任务数据更可能还在缓存中
+	if (workerIndex >= 0)
+	{
+		GMJobQueue& queue = *workerQueues[workerIndex];
+		std::lock_guard<std::mutex> lock(queue.lock);
+		if (!queue.jobs.empty())
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+		}
+	}
+
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(sharedQueue.lock);
+		if (!sharedQueue.jobs.empty())
+		{
+			job = std::move(sharedQueue.jobs.front());
+			sharedQueue.jobs.pop_front();
+		}
+	}
+
+	if (!job)
+	{
+		// 从其它工作线程队列的头部窃取任务
+		GMsize_t count = workerQueues.size();
+		GMsize_t start = workerIndex >= 0 ? static_cast<GMsize_t>(workerIndex) + 1 : 0;
+		for (GMsize_t i = 0; i < count && !job; ++i)
+		{
+			GMJobQueue& queue = *workerQueues[(start + i) % count];
+			std::lock_guard<std::mutex> lock(queue.lock);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+			}
+		}
+	}
+
+	if (job)
+		--queuedJobs;
+	return job;
+}
+
+void GMJobSystemPrivate::execute(const GMJobHandle& job)
+{
+	if (job->function)
+		job->function();
+	finish(job.get());
+}
+
+void GMJobSystemPrivate::finish(GMJob* job)
+{
+	if (--job->unfinishedJobs > 0)
+		return;
+
+	Vector<GMJobHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->continuationLock);
+		job->finished.store(true, std::memory_order_release);
+		continuations.swap(job->continuations);
+	}
+
+	for (auto& continuation : continuations)
+	{
+		if (--continuation->pendingDependencies == 0)
+			enqueue(continuation);
+	}
+
+	if (job->parent)
+	{
+		GMJobHandle parent = std::move(job->parent);
+		finish(parent.get());
+	}
+}
+
+void GMJobSystemPrivate::workerLoop(GMint32 workerIndex)
+{
+	t_system = this;
+	t_workerIndex = workerIndex;
+	while (!quit)
+	{
+		GMJobHandle job = dequeue(workerIndex);
+		if (job)
+		{
+			execute(job);
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(sleepLock);
+			sleepCondition.wait(lock, [this]() {
+				return quit || queuedJobs.load() > 0;
+			});
+		}
+	}
+	t_system = nullptr;
+	t_workerIndex = -1;
+}
+
+GMJobSystem::GMJobSystem(GMint32 workerCount)
+{
+	GM_CREATE_DATA();
+	D(d);
+	if (workerCount <= 0)
+	{
+		workerCount = static_cast<GMint32>(std::thread::hardware_concurrency()) - 1;
+		if (workerCount < 1)
+			workerCount = 1;
+	}
+
+	d->queuedJobs = 0;
+	d->quit = false;
+	d->workerQueues.reserve(workerCount);
+	d->workers.reserve(workerCount);
+	for (GMint32 i = 0; i < workerCount; ++i)
+	{
+		d->workerQueues.emplace_back(new GMJobQueue());
+	}
+
+	// 所有队列创建完毕之后再启动线程，因为工作线程会窃取其它队列中的任务
+	for (GMint32 i = 0; i < workerCount; ++i)
+	{
+		d->workers.emplace_back(new GMJobWorker(d, i));
+		d->workers.back()->start();
+	}
+}
+
+GMJobSystem::~GMJobSystem()
+{
+	D(d);
+	{
+		std::lock_guard<std::mutex> lock(d->sleepLock);
+		d->quit = true;
+	}
+	d->sleepCondition.notify_all();
+	for (auto& worker : d->workers)
+	{
+		worker->join();
+	}
+}
+
+GMJobHandle GMJobSystem::createJob(GMJobFunction function, const GMJobHandle& parent)
+{
+	GMJobHandle job = std::make_shared<GMJob>();
+	job->function = std::move(function);
+	if (parent)
+	{
+		GM_ASSERT(!parent->finished.load(std::memory_order_acquire));
+		++parent->unfinishedJobs;
+		job->parent = parent;
+	}
+	return job;
+}
+
+void GMJobSystem::addDependency(const GMJobHandle& job, const GMJobHandle& dependency)
+{
+	GM_ASSERT(job && dependency && job != dependency);
+	std::lock_guard<std::mutex> lock(dependency->continuationLock);
+	if (!dependency->finished)
+	{
+		++job->pendingDependencies;
+		dependency->continuations.push_back(job);
+	}
+}
+
+void GMJobSystem::run(const GMJobHandle& job)
+{
+	D(d);
+	GM_ASSERT(job);
+	if (--job->pendingDependencies == 0)
+		d->enqueue(job);
+}
+
+void GMJobSystem::wait(const GMJobHandle& job)
+{
+	D(d);
+	GM_ASSERT(job);
+	GMint32 workerIndex = d->currentWorkerIndex();
+	GMint32 idleCount = 0;
+	while (job->unfinishedJobs.load(std::memory_order_acquire) > 0)
+	{
+		GMJobHandle other = d->dequeue(workerIndex);
+		if (other)
+		{
+			d->execute(other);
+			idleCount = 0;
+			continue;
+		}
+
+		// 没有可以执行的任务时逐步退避：先让出时间片，长时间等待则短暂睡眠，避免空转占满一个核心
+		if (idleCount < WaitYieldCount)
+		{
+			++idleCount;
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(WaitSleepMicroseconds));
+		}
+	}
+}
+
+bool GMJobSystem::isFinished(const GMJobHandle& job)
+{
+	GM_ASSERT(job);
+	return job->unfinishedJobs.load(std::memory_order_acquire) == 0;
+}
+
+void GMJobSystem::parallelFor(GMsize_t count, GMsize_t grainSize, GMJobRangeFunction function)
+{
+	if (count == 0)
+		return;
+
+	if (grainSize == 0)
+		grainSize = getDefaultGrainSize(count);
+
+	// 只有一份工作的时候，不需要经过任务队列
+	if (count <= grainSize)
+	{
+		function(0, count);
+		return;
+	}
+
+	GMJobHandle root = createJob(GMJobFunction());
+	for (GMsize_t begin = 0; begin < count; begin += grainSize)
+	{
+		GMsize_t end = begin + grainSize < count ? begin + grainSize : count;
+		run(createJob([&function, begin, end]() {
+			function(begin, end);
+		}, root));
+	}
+	run(root);
+	wait(root);
+}
+
+GMint32 GMJobSystem::getWorkerCount()
+{
+	D(d);
+	return static_cast<GMint32>(d->workers.size());
+}
+
+GMsize_t GMJobSystem::getDefaultGrainSize(GMsize_t count)
+{
+	// 每个线程（包括调用者线程）大约分配4个任务，以便负载不均时可以互相窃取
+	GMsize_t jobs = (static_cast<GMsize_t>(getWorkerCount()) + 1) * 4;
+	GMsize_t grainSize = (count + jobs - 1) / jobs;
+	return grainSize > 0 ? grainSize : 1;
+}
+
+GMJobSystem* GMAsync::getJobSystem()
+{
+	return GM.getJobSystem();
+}
+
+void GMAsync::parallelFor(GMsize_t count, GMsize_t grainSize, GMJobRangeFunction function)
+{
+	if (count == 0)
+		return;
+
+	GMJobSystem* jobSystem = getJobSystem();
+	if (!jobSystem)
+	{
+		function(0, count);
+		return;
+	}
+	jobSystem->parallelFor(count, grainSize, std::move(function));
+}
+
 GMMultithreadRenderHelper::GMMultithreadRenderHelper(IWindow* window)
 	: m_window(window)
 {
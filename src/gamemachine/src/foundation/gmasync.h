@@ -8,7 +8,86 @@ BEGIN_NS
 template <typename T>
 using GMFuture = std::future<T>;
 
-class GMAsync
+struct GMJob;
+typedef GMSharedPtr<GMJob> GMJobHandle;
+typedef std::function<void()> GMJobFunction;
+typedef std::function<void(GMsize_t, GMsize_t)> GMJobRangeFunction;
+
+GM_PRIVATE_CLASS(GMJobSystem);
+//! 引擎的任务系统。
+/*!
+  任务系统在创建时会为每个处理器核心创建一个常驻工作线程，每个工作线程拥有自己的任务双端队列。工作线程优先执行自己队列末尾的任务，
+  当自己的队列为空时，会从其它工作线程队列的头部窃取任务。<BR>
+  非工作线程提交的任务会被放入一个公共队列中。调用wait()的线程在等待时也会参与执行任务，因此在任务中嵌套等待其它任务不会死锁。<BR>
+  一般不需要自己创建任务系统，而是通过GameMachine::getJobSystem()获取引擎的任务系统。
+*/
+class GM_EXPORT GMJobSystem
+{
+	GM_DECLARE_PRIVATE(GMJobSystem)
+	GM_DISABLE_COPY_ASSIGN(GMJobSystem)
+
+public:
+	//! 构造一个任务系统。
+	/*!
+	  \param workerCount 工作线程的数量。如果小于等于0，则使用处理器核心数减1（调用者线程会在等待时参与工作）。
+	*/
+	GMJobSystem(GMint32 workerCount = 0);
+	~GMJobSystem();
+
+public:
+	//! 创建一个任务。
+	/*!
+	  创建的任务并不会马上执行，需要调用run()将其提交。<BR>
+	  如果指定了父任务，则父任务只有在所有子任务结束之后才被认为结束。子任务需要在父任务结束前创建。
+	  \param function 任务执行的函数。
+	  \param parent 父任务。
+	  \return 任务句柄。
+	  \sa run()
+	*/
+	GMJobHandle createJob(GMJobFunction function, const GMJobHandle& parent = GMJobHandle());
+
+	//! 为任务增加一个前置任务。
+	/*!
+	  任务只有在所有前置任务结束之后才会被执行，也就是说任务成为了前置任务的延续。必须在run()之前调用此方法。
+	  \param job 需要等待的任务。
+	  \param dependency 前置任务。
+	*/
+	void addDependency(const GMJobHandle& job, const GMJobHandle& dependency);
+
+	//! 提交一个任务。
+	/*!
+	  如果任务的前置任务都已经结束，任务会马上进入执行队列，否则会在最后一个前置任务结束时进入执行队列。
+	  \param job 需要提交的任务。
+	*/
+	void run(const GMJobHandle& job);
+
+	//! 等待一个任务结束。
+	/*!
+	  等待时，调用者线程会从任务队列中获取其它任务来执行，而不是空等。
+	  \param job 需要等待的任务。
+	*/
+	void wait(const GMJobHandle& job);
+
+	//! 判断一个任务（包括其子任务）是否已经结束。
+	bool isFinished(const GMJobHandle& job);
+
+	//! 并行执行一个区间内的计算，并且等待其结束。
+	/*!
+	  区间[0, count)会被切分为若干个大小为grainSize的子区间，每个子区间作为一个任务执行。
+	  \param count 区间的大小。
+	  \param grainSize 每个任务处理的元素个数。如果为0，则由任务系统根据工作线程数目决定。
+	  \param function 处理子区间[begin, end)的函数。
+	*/
+	void parallelFor(GMsize_t count, GMsize_t grainSize, GMJobRangeFunction function);
+
+	//! 获取工作线程的数量。
+	GMint32 getWorkerCount();
+
+	//! 获取处理count个元素时默认的粒度。
+	GMsize_t getDefaultGrainSize(GMsize_t count);
+};
+
+class GM_EXPORT GMAsync
 {
 public:
 	enum LaunchPolicy
@@ -23,44 +102,81 @@ public:
 		return std::async(static_cast<std::launch>(policy), std::forward<Function>(function), std::forward<Args>(args)...);
 	}
 
+	//! 在引擎的任务系统上并行处理一个随机访问迭代器区间，并等待其结束。
+	/*!
+	  \param iterBegin 区间的起始迭代器。
+	  \param iterEnd 区间的结束迭代器。
+	  \param grainSize 每个任务处理的元素个数。如果为0，则由任务系统决定。
+	  \param function 处理子区间的函数，参数为子区间的起始和结束迭代器。
+	*/
+	template <typename Iter, typename Function>
+	static void parallelFor(Iter iterBegin, Iter iterEnd, GMsize_t grainSize, Function&& function)
+	{
+		typedef typename std::iterator_traits<Iter>::iterator_category IterTag;
+		GM_STATIC_ASSERT(std::is_same<std::random_access_iterator_tag, IterTag>::value, "Iterator must be a random access iterator");
+		if (iterEnd == iterBegin)
+			return;
+
+		GMJobSystem* jobSystem = getJobSystem();
+		if (!jobSystem)
+		{
+			// 引擎尚未初始化或者已经结束，没有任务系统时在当前线程中执行
+			function(iterBegin, iterEnd);
+			return;
+		}
+
+		jobSystem->parallelFor(iterEnd - iterBegin, grainSize, [iterBegin, &function](GMsize_t first, GMsize_t last) {
+			function(iterBegin + first, iterBegin + last);
+		});
+	}
+
+	//! 在引擎的任务系统上并行处理区间[0, count)，并等待其结束。
+	/*!
+	  \param count 区间的大小。
+	  \param grainSize 每个任务处理的元素个数。如果为0，则由任务系统决定。
+	  \param function 处理子区间[begin, end)的函数。
+	*/
+	static void parallelFor(GMsize_t count, GMsize_t grainSize, GMJobRangeFunction function);
+
 	template <typename Iter, typename Function>
 	static void blockedAsync(LaunchPolicy policy, GMsize_t taskCount, Iter iterBegin, Iter iterEnd, Function&& function)
 	{
 		typedef typename std::iterator_traits<Iter>::iterator_category IterTag;
 		GM_STATIC_ASSERT(std::is_same<std::random_access_iterator_tag, IterTag>::value, "Iterator must be a random access iterator");
-		typedef decltype(async(Async, std::forward<Function>(function), Iter(), Iter())) FutureType;
 
-		// 用于缓存Async状态的future，否则future析构时将会进行等待
 		if (taskCount < 1)
 			taskCount = 1;
 
-		Vector<FutureType> futures;
-		futures.reserve(taskCount);
-
 		GMsize_t len = iterEnd - iterBegin;
-		GMsize_t step = (iterEnd - iterBegin) / taskCount;
-		if (taskCount > len)
-			taskCount = len;
+		if (len == 0)
+			return;
 
-		Iter iter = iterBegin;
-		for (GMsize_t i = 0; i < taskCount; ++i)
+		// 将区间切分为taskCount份，每份作为任务系统中的一个任务
+		GMsize_t step = (len + taskCount - 1) / taskCount;
+		if (policy == Async)
 		{
-			if (i < taskCount - 1)
-			{
-				futures.push_back(std::move(async(policy, std::forward<Function>(function), iter, iter + step)));
-				iter += step;
-			}
-			else
-			{
-				futures.push_back(std::move(async(policy, std::forward<Function>(function), iter, iterEnd)));
-			}
+			parallelFor(iterBegin, iterEnd, step, std::forward<Function>(function));
 		}
-
-		for (auto& future : futures)
+		else
 		{
-			future.wait();
+			Iter iter = iterBegin;
+			while (iter != iterEnd)
+			{
+				GMsize_t count = static_cast<GMsize_t>(iterEnd - iter);
+				if (count > step)
+					count = step;
+				function(iter, iter + count);
+				iter += count;
+			}
 		}
 	}
+
+	//! 获取引擎的任务系统。
+	/*!
+	  \return GameMachine所拥有的任务系统。引擎未初始化或者已经结束时返回nullptr。
+	  \sa GameMachine::getJobSystem()
+	*/
+	static GMJobSystem* getJobSystem();
 };
 
 GM_STATIC_ASSERT(GMAsync::Async == static_cast<GMint32>(std::launch::async), "LaunchPolicy must be same with std::luanch");
@@ -133,6 +133,10 @@ void GMBuffer::swap(GMBuffer& rhs)
 
 void GMBuffer::convertToStringBuffer()
 {
+	// 视图的末尾没有预留空间（例如资源包中未压缩的文件），需要先复制一份
+	if (!isOwned)
+		*this = GMBuffer(data, size, true);
+
 	// 在末尾补0
 	data[size] = 0;
 	data[size + 1] = 0;
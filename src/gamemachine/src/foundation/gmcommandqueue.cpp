@@ -0,0 +1,131 @@
+﻿#include "stdafx.h"
+#include "gmcommandqueue.h"
+#include "foundation/gmprofile.h"
+#include <algorithm>
+
+BEGIN_NS
+
+namespace
+{
+	struct QueuedCommand
+	{
+		GMCallable callable;
+		GMCommandPriority priority = GMCommandPriority::Normal;
+		GMint64 timestamp = 0; // 提交时的GMTracer::now()
+	};
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMCommandQueue)
+{
+	GMMPSCQueue<QueuedCommand> queue;
+	// 已经从无锁队列中取出、还没有执行的可调用对象，只有拥有队列的线程访问
+	Deque<QueuedCommand> backlog[static_cast<GMsize_t>(GMCommandPriority::Count)];
+	GMAtomic<GMsize_t> pending { 0 };
+	GMAtomic<GMint64> budget { 0 };
+	GMCommandQueueStats stats;
+};
+
+GMCommandQueue::GMCommandQueue()
+{
+	GM_CREATE_DATA();
+}
+
+GMCommandQueue::~GMCommandQueue()
+{
+
+}
+
+void GMCommandQueue::push(GMCallable callable, GMCommandPriority priority)
+{
+	D(d);
+	GM_ASSERT(priority < GMCommandPriority::Count);
+	QueuedCommand command;
+	command.callable = std::move(callable);
+	command.priority = priority;
+	command.timestamp = GMTracer::now();
+	d->pending.fetch_add(1, std::memory_order_relaxed);
+	d->queue.push(std::move(command));
+}
+
+GMsize_t GMCommandQueue::execute()
+{
+	D(d);
+	GM_TRACE_SCOPE("GMCommandQueue::execute");
+
+	QueuedCommand command;
+	while (d->queue.pop(command))
+	{
+		d->backlog[static_cast<GMsize_t>(command.priority)].push_back(std::move(command));
+	}
+
+	const GMint64 start = GMTracer::now();
+	const GMint64 budget = d->budget.load(std::memory_order_relaxed) * 1000;
+	GMCommandQueueStats stats;
+	GMint64 totalLatency = 0;
+	bool exhausted = false;
+	for (auto& backlog : d->backlog)
+	{
+		while (!backlog.empty())
+		{
+			QueuedCommand& front = backlog.front();
+			if (front.priority != GMCommandPriority::High && budget > 0 && stats.executed > 0)
+			{
+				if (exhausted || GMTracer::now() - start >= budget)
+				{
+					exhausted = true;
+					break;
+				}
+			}
+
+			command = std::move(front);
+			backlog.pop_front();
+
+			const GMint64 latency = GMTracer::now() - command.timestamp;
+			stats.maxLatency = std::max(stats.maxLatency, latency);
+			totalLatency += latency;
+			++stats.executed;
+			d->pending.fetch_sub(1, std::memory_order_relaxed);
+
+			if (command.callable)
+				command.callable();
+		}
+
+		stats.carriedOver += backlog.size();
+	}
+
+	stats.depth = d->pending.load(std::memory_order_relaxed);
+	stats.elapsed = GMTracer::now() - start;
+	if (stats.executed > 0)
+		stats.averageLatency = totalLatency / static_cast<GMint64>(stats.executed);
+	d->stats = stats;
+
+	GM_TRACE_COUNTER("Command queue depth", static_cast<GMint64>(stats.depth));
+	GM_TRACE_COUNTER("Command queue max latency (ns)", stats.maxLatency);
+	return stats.executed;
+}
+
+void GMCommandQueue::setBudget(GMint64 microseconds) GM_NOEXCEPT
+{
+	D(d);
+	d->budget.store(microseconds, std::memory_order_relaxed);
+}
+
+GMint64 GMCommandQueue::getBudget() const GM_NOEXCEPT
+{
+	D(d);
+	return d->budget.load(std::memory_order_relaxed);
+}
+
+GMsize_t GMCommandQueue::getPendingCount() const GM_NOEXCEPT
+{
+	D(d);
+	return d->pending.load(std::memory_order_relaxed);
+}
+
+const GMCommandQueueStats& GMCommandQueue::getStats() const GM_NOEXCEPT
+{
+	D(d);
+	return d->stats;
+}
+
+END_NS
@@ -0,0 +1,156 @@
+﻿#ifndef __GMCOMMANDQUEUE_H__
+#define __GMCOMMANDQUEUE_H__
+#include <gmcommon.h>
+BEGIN_NS
+
+typedef std::function<void()> GMCallable;
+
+//! 多生产者、单消费者的无锁队列。
+/*!
+  任意线程都可以调用push()，只有一个线程（消费者）可以调用pop()。push()只需要一次原子交换，不会阻塞，也不会被消费者阻塞。<BR>
+  每个元素占用一个单独分配的节点。生产者在交换之后、链接节点之前被挂起时，消费者会暂时看不到这个节点以及它之后的节点，
+  pop()返回false，直到节点被链接上。
+*/
+template <typename T>
+class GMMPSCQueue
+{
+	GM_DISABLE_COPY_ASSIGN(GMMPSCQueue)
+
+	struct Node
+	{
+		GMAtomic<Node*> next { nullptr };
+		T value;
+	};
+
+public:
+	GMMPSCQueue()
+		: m_head(&m_stub)
+		, m_tail(&m_stub)
+	{
+	}
+
+	~GMMPSCQueue()
+	{
+		T value;
+		while (pop(value));
+		if (m_tail != &m_stub)
+			delete m_tail;
+	}
+
+public:
+	//! 将一个元素放入队列末尾，可以在任意线程调用。
+	void push(T value)
+	{
+		Node* node = new Node();
+		node->value = std::move(value);
+		m_size.fetch_add(1, std::memory_order_relaxed);
+		Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	//! 从队列头部取出一个元素，只能在消费者线程调用。
+	/*!
+	  \param value 取出的元素。
+	  \return 是否取出了元素。
+	*/
+	bool pop(OUT T& value)
+	{
+		// m_tail是一个已经取出过的哑节点，它的下一个节点才是队列头部
+		Node* tail = m_tail;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (!next)
+			return false;
+
+		value = std::move(next->value);
+		m_tail = next;
+		if (tail != &m_stub)
+			delete tail;
+		m_size.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	//! 获取队列中元素的大致数目，可以在任意线程调用。
+	GMsize_t size() const GM_NOEXCEPT
+	{
+		return m_size.load(std::memory_order_relaxed);
+	}
+
+private:
+	GMAtomic<Node*> m_head;
+	Node* m_tail;
+	Node m_stub;
+	GMAtomic<GMsize_t> m_size { 0 };
+};
+
+//! 可调用对象的优先级。
+enum class GMCommandPriority
+{
+	High, //!< 高优先级，不受每帧时间预算的限制，每次都会全部执行。用于必须在下一帧之前完成的工作，如创建模型的顶点数据。
+	Normal, //!< 普通优先级。
+	Low, //!< 低优先级，在高优先级和普通优先级的可调用对象执行完之后才会执行。
+
+	Count,
+};
+
+//! 命令队列最近一次执行的统计数据。
+struct GMCommandQueueStats
+{
+	GMsize_t depth = 0; //!< 执行之后仍在等待的可调用对象数目，包括被推迟到下一次执行的对象。
+	GMsize_t executed = 0; //!< 本次执行的可调用对象数目。
+	GMsize_t carriedOver = 0; //!< 因为超出时间预算而被推迟到下一次执行的可调用对象数目。
+	GMint64 elapsed = 0; //!< 本次执行所花费的时间，单位为纳秒。
+	GMint64 maxLatency = 0; //!< 本次执行的可调用对象从提交到被执行的最长等待时间，单位为纳秒。
+	GMint64 averageLatency = 0; //!< 本次执行的可调用对象从提交到被执行的平均等待时间，单位为纳秒。
+};
+
+GM_PRIVATE_CLASS(GMCommandQueue);
+//! 在一个线程中按优先级执行其它线程提交的可调用对象。
+/*!
+  任意线程都可以通过push()提交可调用对象，提交时不加锁。拥有队列的线程（通常是主线程）调用execute()执行它们，
+  执行时也不持有任何锁，因此可调用对象中可以再次提交可调用对象，它们会在下一次execute()时执行。<BR>
+  每次execute()按照优先级从高到低执行，同一优先级按照提交的顺序执行。设置了时间预算时，超出预算后剩下的普通优先级和低优先级的
+  可调用对象会留到下一次execute()，并排在之后提交的同一优先级的对象前面。
+*/
+class GM_EXPORT GMCommandQueue
+{
+	GM_DECLARE_PRIVATE(GMCommandQueue)
+	GM_DISABLE_COPY_ASSIGN(GMCommandQueue)
+
+public:
+	GMCommandQueue();
+	~GMCommandQueue();
+
+public:
+	//! 提交一个可调用对象，可以在任意线程调用。
+	/*!
+	  \param callable 待执行的可调用对象。
+	  \param priority 可调用对象的优先级。
+	*/
+	void push(GMCallable callable, GMCommandPriority priority = GMCommandPriority::Normal);
+
+	//! 执行已经提交的可调用对象，只能在拥有队列的线程调用。
+	/*!
+	  高优先级的可调用对象总是全部执行。其它优先级在超出时间预算之后停止执行，但每次至少会执行一个，以保证队列总能向前推进。
+	  \return 本次执行的可调用对象数目。
+	  \sa setBudget()
+	*/
+	GMsize_t execute();
+
+	//! 设置每次execute()的时间预算。
+	/*!
+	  \param microseconds 时间预算，单位为微秒。如果小于等于0，则不限制时间，每次执行所有已经提交的可调用对象。
+	*/
+	void setBudget(GMint64 microseconds) GM_NOEXCEPT;
+
+	//! 获取每次execute()的时间预算，单位为微秒。
+	GMint64 getBudget() const GM_NOEXCEPT;
+
+	//! 获取等待执行的可调用对象的大致数目，可以在任意线程调用。
+	GMsize_t getPendingCount() const GM_NOEXCEPT;
+
+	//! 获取最近一次execute()的统计数据，只能在拥有队列的线程调用。
+	const GMCommandQueueStats& getStats() const GM_NOEXCEPT;
+};
+
+END_NS
+#endif
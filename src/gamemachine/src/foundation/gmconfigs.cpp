@@ -65,6 +65,7 @@ void GMConfigs::init()
 	renderConfig.set(GMRenderConfigs::ToneMapping, GMToneMapping::Reinhard);
 	renderConfig.set(GMRenderConfigs::BlendFactor_Vec3, GMVec3(1, 1, 1));
 	renderConfig.set(GMRenderConfigs::ViewCascade_Bool, false);
+	renderConfig.set(GMRenderConfigs::KeepDepthAfterDraw_Bool, true);
 }
 
 GMConfig& GMConfigs::getConfig(Category state)
@@ -70,6 +70,7 @@ enum class GMRenderConfigs
 	ToneMapping,
 	ViewCascade_Bool,
 	BlendFactor_Vec3,
+	KeepDepthAfterDraw_Bool,
 	Max,
 };
 
@@ -1,119 +1,357 @@
 ﻿#include "stdafx.h"
 #include "gmprofile.h"
-#include "foundation/gamemachine.h"
+#include <chrono>
+#include <fstream>
+#include <mutex>
 
 BEGIN_NS
 
-//Profile
-static IProfileHandler* g_handler = nullptr;
-static GMProfileSessions g_sessions;
+namespace
+{
+	GM_STATIC_ASSERT((GMTracer::BufferCapacity & (GMTracer::BufferCapacity - 1)) == 0, "Trace buffer capacity must be a power of 2.");
+
+	// 单个线程的环形缓冲区，只有所属的线程写入
+	struct TraceBuffer
+	{
+		GMTraceEvent events[GMTracer::BufferCapacity];
+		GMAtomic<GMsize_t> written { 0 }; // 已经写入的事件总数
+		GMAtomic<GMsize_t> start { 0 }; // reset()时的written，在此之前的事件不再导出
+		GMAtomic<bool> closed { false }; // 所属的线程已经结束
+		GMint32 tid = 0;
+	};
+
+	// 线程结束时，标记其缓冲区，下次reset()时将其释放
+	struct LocalTraceBuffer
+	{
+		std::shared_ptr<TraceBuffer> buffer;
+
+		~LocalTraceBuffer()
+		{
+			if (buffer)
+				buffer->closed = true;
+		}
+	};
+
+	const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+	GMAtomic<bool> s_enabled { false };
+	GMAtomic<GMint64> s_frame { 0 };
+
+	std::mutex s_buffersLock;
+	Vector<std::shared_ptr<TraceBuffer>> s_buffers;
+	GMint32 s_nextTid = 1; // 0留给GPU
+
+	std::mutex s_namesLock;
+	Set<std::wstring> s_names;
+
+	thread_local LocalTraceBuffer t_buffer;
+
+	// GPU的事件在Chrome Trace中显示为一个单独的线程
+	constexpr GMint32 GPUTid = 0;
+
+	TraceBuffer* registerThread()
+	{
+		t_buffer.buffer = std::make_shared<TraceBuffer>();
+		std::lock_guard<std::mutex> lock(s_buffersLock);
+		t_buffer.buffer->tid = s_nextTid++;
+		s_buffers.push_back(t_buffer.buffer);
+		return t_buffer.buffer.get();
+	}
+
+	void record(GMTraceEventType type, const GMwchar* name, GMint64 timestamp, GMint64 value) GM_NOEXCEPT
+	{
+		TraceBuffer* buffer = t_buffer.buffer ? t_buffer.buffer.get() : registerThread();
+		const GMsize_t index = buffer->written.load(std::memory_order_relaxed);
+		GMTraceEvent& e = buffer->events[index & (GMTracer::BufferCapacity - 1)];
+		e.name = name;
+		e.timestamp = timestamp;
+		e.value = value;
+		e.type = type;
+		buffer->written.store(index + 1, std::memory_order_release);
+	}
+
+	// 读取一个线程的缓冲区。如果是其它线程的缓冲区，读取期间被覆盖的事件会被丢弃
+	void readBuffer(const TraceBuffer& buffer, bool currentThread, Vector<GMTraceEvent>& events)
+	{
+		const GMsize_t capacity = GMTracer::BufferCapacity;
+		const GMsize_t written = buffer.written.load(std::memory_order_acquire);
+		GMsize_t first = buffer.start.load(std::memory_order_relaxed);
+		if (written > capacity)
+			first = std::max(first, written - capacity);
+
+		const GMsize_t offset = events.size();
+		for (GMsize_t i = first; i < written; ++i)
+		{
+			events.push_back(buffer.events[i & (capacity - 1)]);
+		}
+
+		if (currentThread)
+			return;
+
+		// 写入者在读取期间写下的事件占用了最早的若干个位置，正在写入的事件还会再占用一个位置
+		const GMsize_t writtenAfter = buffer.written.load(std::memory_order_acquire);
+		if (writtenAfter + 1 > first + capacity)
+		{
+			GMsize_t overwritten = std::min(writtenAfter + 1 - capacity - first, written - first);
+			events.erase(events.begin() + offset, events.begin() + offset + overwritten);
+		}
+	}
+
+	void appendUTF8(std::string& out, GMuint32 c)
+	{
+		if (c < 0x80)
+		{
+			out += static_cast<char>(c);
+		}
+		else if (c < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (c >> 6));
+			out += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (c >> 12));
+			out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (c >> 18));
+			out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (c & 0x3F));
+		}
+	}
+
+	// 以JSON字符串的形式写入名称，GMwchar在Windows下是UTF-16，其它平台是UTF-32
+	void appendName(std::string& out, const GMwchar* name)
+	{
+		out += '"';
+		for (const GMwchar* p = name; p && *p; ++p)
+		{
+			GMuint32 c = static_cast<GMuint32>(*p);
+			if (c >= 0xD800 && c < 0xDC00 && p[1] >= 0xDC00 && p[1] < 0xE000)
+			{
+				c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<GMuint32>(p[1]) - 0xDC00);
+				++p;
+			}
 
-void GMProfile::setHandler(IProfileHandler* handler)
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += static_cast<char>(c);
+			}
+			else if (c < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out += escaped;
+			}
+			else
+			{
+				appendUTF8(out, c);
+			}
+		}
+		out += '"';
+	}
+
+	// Chrome Trace的时间单位为微秒，保留到纳秒
+	void appendTimestamp(std::string& out, GMint64 ns)
+	{
+		if (ns < 0)
+		{
+			out += '-';
+			ns = -ns;
+		}
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%lld.%03lld", static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+		out += buffer;
+	}
+
+	void appendEventHeader(std::string& out, const char* phase, GMint64 timestamp, GMint32 tid)
+	{
+		out += ",\n{\"ph\":\"";
+		out += phase;
+		out += "\",\"pid\":1,\"tid\":";
+		out += std::to_string(tid);
+		out += ",\"ts\":";
+		appendTimestamp(out, timestamp);
+	}
+
+	void appendThreadName(std::string& out, GMint32 tid, const std::string& name)
+	{
+		out += ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":";
+		out += std::to_string(tid);
+		out += ",\"name\":\"thread_name\",\"args\":{\"name\":\"";
+		out += name;
+		out += "\"}}";
+	}
+
+	void appendEvents(std::string& out, GMint32 tid, const Vector<GMTraceEvent>& events)
+	{
+		// 开始事件可能已经被覆盖，不输出没有对应开始事件的结束事件
+		GMint32 depth = 0;
+		for (const auto& e : events)
+		{
+			switch (e.type)
+			{
+			case GMTraceEventType::Begin:
+				++depth;
+				appendEventHeader(out, "B", e.timestamp, tid);
+				out += ",\"cat\":\"cpu\",\"name\":";
+				appendName(out, e.name);
+				out += '}';
+				break;
+			case GMTraceEventType::End:
+				if (depth == 0)
+					break;
+				--depth;
+				appendEventHeader(out, "E", e.timestamp, tid);
+				out += '}';
+				break;
+			case GMTraceEventType::Frame:
+				appendEventHeader(out, "i", e.timestamp, tid);
+				out += ",\"s\":\"g\",\"name\":\"Frame ";
+				out += std::to_string(e.value);
+				out += "\"}";
+				break;
+			case GMTraceEventType::Counter:
+				appendEventHeader(out, "C", e.timestamp, tid);
+				out += ",\"name\":";
+				appendName(out, e.name);
+				out += ",\"args\":{\"value\":";
+				out += std::to_string(e.value);
+				out += "}}";
+				break;
+			case GMTraceEventType::GPUSpan:
+				appendEventHeader(out, "X", e.timestamp, GPUTid);
+				out += ",\"dur\":";
+				appendTimestamp(out, e.value - e.timestamp);
+				out += ",\"cat\":\"gpu\",\"name\":";
+				appendName(out, e.name);
+				out += '}';
+				break;
+			default:
+				GM_ASSERT(false);
+				break;
+			}
+		}
+	}
+}
+
+void GMTracer::setEnabled(bool enabled) GM_NOEXCEPT
 {
-	g_handler = handler;
+	s_enabled.store(enabled, std::memory_order_relaxed);
 }
 
-void GMProfile::clearHandler()
+bool GMTracer::isEnabled() GM_NOEXCEPT
 {
-	setHandler(nullptr);
+#if GM_ENABLE_TRACE
+	return s_enabled.load(std::memory_order_relaxed);
+#else
+	return false;
+#endif
 }
 
-void GMProfile::resetTimeline()
+GMint64 GMTracer::now() GM_NOEXCEPT
 {
-	for (auto& session : g_sessions.sessions)
-	{
-		session.second.firstProfileTimeInCycle = -1;
-	}
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
 }
 
-GMProfileSessions::GMProfileSession& GMProfile::profileSession()
+void GMTracer::beginScope(const GMwchar* name) GM_NOEXCEPT
 {
-	return g_sessions.sessions[GMThread::getCurrentThreadId()];
+	record(GMTraceEventType::Begin, name, now(), 0);
 }
 
-GM_PRIVATE_OBJECT_UNALIGNED(GMProfile)
+void GMTracer::endScope() GM_NOEXCEPT
 {
-	GM_DECLARE_PUBLIC(GMProfile)
-	GMDebugConfig debugConfig;
-	GMStopwatch stopwatch;
-	GMfloat durationSinceLastProfile = 0; // 距离上一次Profile的时间
-	bool valid = false;
-	GMString name;
-	void startRecord(const GMString& name);
-	void stopRecord();
-};
-
-GMProfile::GMProfile(IGraphicEngine* engine)
+	record(GMTraceEventType::End, nullptr, now(), 0);
+}
+
+void GMTracer::markFrame() GM_NOEXCEPT
 {
-	GM_CREATE_DATA();
-	GM_SET_PD();
-	D(d);
-	d->debugConfig = engine->getConfigs().getConfig(GMConfigs::Debug).asDebugConfig();
+	GMint64 frame = s_frame.fetch_add(1, std::memory_order_relaxed);
+	if (isEnabled())
+		record(GMTraceEventType::Frame, nullptr, now(), frame);
 }
 
-GMProfile::GMProfile(IGraphicEngine* engine, const GMString& name)
-	: GMProfile(engine)
+void GMTracer::counter(const GMwchar* name, GMint64 value) GM_NOEXCEPT
 {
-	D(d);
-	d->startRecord(name);
+	if (isEnabled())
+		record(GMTraceEventType::Counter, name, now(), value);
 }
 
-GMProfile::GMProfile(IGraphicEngine* engine, const GMwchar* name)
-	: GMProfile(engine)
+void GMTracer::gpuSpan(const GMwchar* name, GMint64 begin, GMint64 end) GM_NOEXCEPT
 {
-	D(d);
-	// 这里先判断，阻止赋值GMString
-	if (!d->debugConfig.get(GMDebugConfigs::RunProfile_Bool).toBool())
-		return;
+	if (isEnabled())
+		record(GMTraceEventType::GPUSpan, name, begin, end);
+}
 
-	d->startRecord(name);
+const GMwchar* GMTracer::intern(const GMString& name)
+{
+	std::lock_guard<std::mutex> lock(s_namesLock);
+	return s_names.insert(name.toStdWString()).first->c_str();
 }
 
-GMProfile::~GMProfile()
+void GMTracer::reset()
 {
-	D(d);
-	d->stopRecord();
+	std::lock_guard<std::mutex> lock(s_buffersLock);
+	for (auto iter = s_buffers.begin(); iter != s_buffers.end(); )
+	{
+		TraceBuffer& buffer = **iter;
+		if (buffer.closed)
+		{
+			iter = s_buffers.erase(iter);
+		}
+		else
+		{
+			buffer.start.store(buffer.written.load(std::memory_order_acquire), std::memory_order_relaxed);
+			++iter;
+		}
+	}
 }
 
-void GMProfilePrivate::startRecord(const GMString& name)
+void GMTracer::getThreadEvents(Vector<GMTraceEvent>& events)
 {
-	P_D(d);
-	static GMint64 frequency = GMClock::highResolutionTimerFrequency();
-	if (!g_handler)
-		return;
-
-	if (!debugConfig.get(GMDebugConfigs::RunProfile_Bool).toBool())
-		return;
-
-	GMProfileSessions::GMProfileSession& ps = d->profileSession();
-
-	valid = true;
-	this->name = name;
-	GMint64 now = GMClock::highResolutionTimer();
-	if (ps.firstProfileTimeInCycle < 0)
-		ps.firstProfileTimeInCycle = now;
-	GM_ASSERT(now - ps.firstProfileTimeInCycle >= 0);
-	durationSinceLastProfile = (now - ps.firstProfileTimeInCycle) / (GMfloat) frequency;
-	g_handler->beginProfile(name, durationSinceLastProfile, GMThread::getCurrentThreadId(), ps.level);
-
-	ps.level++;
-	stopwatch.start();
+	events.clear();
+	if (t_buffer.buffer)
+		readBuffer(*t_buffer.buffer, true, events);
 }
 
-void GMProfilePrivate::stopRecord()
+std::string GMTracer::exportChromeTrace()
 {
-	P_D(pd);
-	stopwatch.stop();
-	if (!valid)
-		return;
-
-	if (!g_handler)
-		return;
-
-	GMProfileSessions::GMProfileSession& ps = pd->profileSession();
-	GMThreadId id = GMThread::getCurrentThreadId();
-	GMint32& level = ps.level;
-	g_handler->endProfile(name, stopwatch.timeInSecond(), id, --level);
+	Vector<std::shared_ptr<TraceBuffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(s_buffersLock);
+		buffers = s_buffers;
+	}
+
+	std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	out += "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"GameMachine\"}}";
+	appendThreadName(out, GPUTid, "GPU");
+
+	Vector<GMTraceEvent> events;
+	for (const auto& buffer : buffers)
+	{
+		appendThreadName(out, buffer->tid, "Thread " + std::to_string(buffer->tid));
+		events.clear();
+		readBuffer(*buffer, buffer == t_buffer.buffer, events);
+		appendEvents(out, buffer->tid, events);
+	}
+	out += "\n]}\n";
+	return out;
+}
+
+bool GMTracer::exportChromeTrace(const GMString& path)
+{
+	std::ofstream file(path.toStdString(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		gm_warning(gm_dbg_wrap("Cannot open trace file {0}."), path);
+		return false;
+	}
+
+	file << exportChromeTrace();
+	return file.good();
 }
 
-END_NS
\ No newline at end of file
+END_NS
@@ -1,53 +1,157 @@
 ﻿#ifndef __GMPROFILE_H__
 #define __GMPROFILE_H__
 #include <gmcommon.h>
-#include <gmthread.h>
-#include <stack>
 BEGIN_NS
 
-#define GM_PROFILE(engine, name) gm::GMProfile __profile(engine, L ## name)
-#define GM_PROFILE_HANDLER(ptr) gm::GMProfile::setHandler(ptr)
-#define GM_PROFILE_CLEAR_HANDLER() gm::GMProfile::clearHandler()
-#define GM_PROFILE_RESET_TIMELINE() gm::GMProfile::resetTimeline()
+// 编译期开关，为0时所有的跟踪宏都被展开为空语句
+#ifndef GM_ENABLE_TRACE
+#	define GM_ENABLE_TRACE 1
+#endif
 
-GM_INTERFACE(IProfileHandler)
+#define GM_TRACE_CONCAT_IMPL(a, b) a ## b
+#define GM_TRACE_CONCAT(a, b) GM_TRACE_CONCAT_IMPL(a, b)
+
+#if GM_ENABLE_TRACE
+#define GM_TRACE_SCOPE(name) gm::GMTraceScope GM_TRACE_CONCAT(__trace_, __LINE__)(L ## name)
+#define GM_TRACE_SCOPE_INTERNED(name) gm::GMTraceScope GM_TRACE_CONCAT(__trace_, __LINE__)(name)
+#define GM_TRACE_COUNTER(name, value) gm::GMTracer::counter(L ## name, value)
+#define GM_TRACE_FRAME() gm::GMTracer::markFrame()
+#else
+#define GM_TRACE_SCOPE(name) ((void)0)
+#define GM_TRACE_SCOPE_INTERNED(name) ((void)0)
+#define GM_TRACE_COUNTER(name, value) ((void)0)
+#define GM_TRACE_FRAME() ((void)0)
+#endif
+
+// 兼容原有的用法，engine参数不再使用
+#define GM_PROFILE(engine, name) GM_TRACE_SCOPE(name)
+#define GM_PROFILE_RESET_TIMELINE() gm::GMTracer::reset()
+
+//! 跟踪事件的类型。
+enum class GMTraceEventType : GMuint32
 {
-	virtual void beginProfile(const GMString& name, GMfloat durationSinceStartInSecond, GMThreadId id, GMint32 level) = 0;
-	virtual void endProfile(const GMString& name, GMfloat elapsedInSecond, GMThreadId id, GMint32 level) = 0;
+	Begin, //!< 作用域开始。
+	End, //!< 作用域结束。
+	Frame, //!< 帧标记，value为帧序号。
+	Counter, //!< 计数器，value为计数器的值。
+	GPUSpan, //!< GPU上的一段时间，timestamp为开始时间，value为结束时间。
 };
 
-struct GMProfileSessions : public GMObject
+//! 一个跟踪事件。
+/*!
+  name必须指向一个在整个程序运行期间都有效的字符串，例如字符串常量或者由GMTracer::intern()返回的字符串，
+  记录事件时不会复制它。
+*/
+struct GMTraceEvent
 {
-	struct GMProfileSession
+	const GMwchar* name; //!< 事件名称。
+	GMint64 timestamp; //!< 事件发生的时间，单位为纳秒。
+	GMint64 value; //!< 事件的值，含义取决于type。
+	GMTraceEventType type; //!< 事件类型。
+};
+
+//! 帧跟踪器。
+/*!
+  每个线程将跟踪事件写入自己的环形缓冲区，写入时不加锁，也不分配内存。缓冲区满了以后，新的事件会覆盖最早的事件，
+  因此缓冲区中总是保存着最近若干帧的事件。<BR>
+  跟踪默认是关闭的，关闭时每个作用域只需要读取一次原子变量。通过exportChromeTrace()，可以将所有线程的事件导出为
+  Chrome Trace Event格式的JSON，用chrome://tracing或者Perfetto UI打开。
+*/
+class GM_EXPORT GMTracer
+{
+public:
+	enum
 	{
-		GMProfileSession() : level(0) {};
-		GMint32 level;
-		GMint64 firstProfileTimeInCycle = -1;
+		//! 每个线程的环形缓冲区能容纳的事件数，必须是2的幂。
+		BufferCapacity = 1 << 14,
 	};
 
-	Map<GMThreadId, GMProfileSession> sessions;
+public:
+	//! 开启或者关闭跟踪。
+	static void setEnabled(bool enabled) GM_NOEXCEPT;
+
+	//! 获取跟踪是否开启。
+	static bool isEnabled() GM_NOEXCEPT;
+
+	//! 获取跟踪器的当前时间，单位为纳秒。
+	static GMint64 now() GM_NOEXCEPT;
+
+	//! 记录一个作用域的开始。
+	/*!
+	  \param name 作用域名称，必须在整个程序运行期间有效。
+	*/
+	static void beginScope(const GMwchar* name) GM_NOEXCEPT;
+
+	//! 记录一个作用域的结束。
+	static void endScope() GM_NOEXCEPT;
+
+	//! 记录一个帧标记，帧序号自动递增。
+	static void markFrame() GM_NOEXCEPT;
+
+	//! 记录计数器的值。
+	/*!
+	  \param name 计数器名称，必须在整个程序运行期间有效。
+	  \param value 计数器的值。
+	*/
+	static void counter(const GMwchar* name, GMint64 value) GM_NOEXCEPT;
+
+	//! 记录一段GPU时间。
+	/*!
+	  GPU时间由GMGPUTracer从时间戳查询中得到，并已经换算到跟踪器的时间。
+	  \param name 名称，必须在整个程序运行期间有效。
+	  \param begin 开始时间，单位为纳秒。
+	  \param end 结束时间，单位为纳秒。
+	*/
+	static void gpuSpan(const GMwchar* name, GMint64 begin, GMint64 end) GM_NOEXCEPT;
+
+	//! 获取一个字符串的驻留副本，其地址在整个程序运行期间有效，相同的字符串返回相同的地址。
+	/*!
+	  用于名称不是字符串常量的作用域，例如渲染图中的渲染阶段。
+	*/
+	static const GMwchar* intern(const GMString& name);
+
+	//! 清空所有线程的事件。
+	static void reset();
+
+	//! 获取当前线程的缓冲区中的事件，按照记录的顺序排列。
+	static void getThreadEvents(Vector<GMTraceEvent>& events);
+
+	//! 将所有线程的事件导出为Chrome Trace Event格式的JSON。
+	static std::string exportChromeTrace();
+
+	//! 将所有线程的事件以Chrome Trace Event格式写入文件。
+	/*!
+	  \param path 文件路径。
+	  \return 是否写入成功。
+	*/
+	static bool exportChromeTrace(const GMString& path);
 };
 
-GM_PRIVATE_CLASS(GMProfile);
-class GMProfile : public IDestroyObject
+//! 记录一个作用域的开始和结束。
+/*!
+  构造时如果跟踪没有开启，析构时也不会记录，因此作用域中途开启跟踪不会产生不成对的事件。
+*/
+class GMTraceScope
 {
-	GM_DECLARE_PRIVATE(GMProfile)
+	GM_DISABLE_COPY_ASSIGN(GMTraceScope)
 
 public:
-	static GMProfileSessions::GMProfileSession& profileSession();
+	GMTraceScope(const GMwchar* name) GM_NOEXCEPT
+		: m_active(GMTracer::isEnabled())
+	{
+		if (m_active)
+			GMTracer::beginScope(name);
+	}
 
-public:
-	GMProfile(IGraphicEngine* engine);
-	GMProfile(IGraphicEngine* engine, const GMString& name);
-	GMProfile(IGraphicEngine* engine, const GMwchar* name);
-	~GMProfile();
+	~GMTraceScope()
+	{
+		if (m_active)
+			GMTracer::endScope();
+	}
 
-public:
-	static void setHandler(IProfileHandler* handler);
-	static void clearHandler();
-	static void resetTimeline();
+private:
+	bool m_active;
 };
 
-
 END_NS
-#endif
\ No newline at end of file
+#endif
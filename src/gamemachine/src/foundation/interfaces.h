@@ -509,6 +509,8 @@ GM_INTERFACE(IGBuffer)
 	virtual void geometryPass(const GMGameObjectContainer& objects) = 0;
 	virtual void lightPass() = 0;
 	virtual IFramebuffers* getGeometryFramebuffers() = 0;
+	virtual void setGeometryFramebuffers(IFramebuffers* framebuffers) = 0;
+	virtual const Vector<GMFramebufferFormat>& getGeometryFramebufferFormats() = 0;
 	virtual void setGeometryPassingState(GMGeometryPassingState) = 0;
 	virtual GMGeometryPassingState getGeometryPassingState() = 0;
 };
@@ -802,6 +804,15 @@ GM_INTERFACE(ITechnique)
 	virtual void beginModel(GMModel* model, const GMGameObject* parent) = 0;
 	virtual void endModel() = 0;
 	virtual void draw(GMModel* model) = 0;
+
+	//! 以实例化的方式绘制模型。
+	/*!
+	  模型只会被绘制一次，每个实例使用transforms中对应的世界矩阵。调用前同样需要调用beginModel()。
+	  \param model 需要绘制的模型。
+	  \param transforms 每个实例的世界矩阵。
+	  \param count 实例的数量。
+	*/
+	virtual void drawInstanced(GMModel* model, const GMMat4* transforms, GMsize_t count) = 0;
 };
 
 struct GMWindowStates
@@ -174,6 +174,11 @@ public:
 	{
 		D_OF(d, windowImpl);
 		wglMakeCurrent(d->hDC, *d->hRC);
+
+		// 切换到此上下文的OpenGL状态缓存。创建窗口时引擎可能还没有创建，引擎初始化时会自行切换
+		GMGLGraphicEngine* engine = gm_cast<GMGLGraphicEngine*>(getEngine());
+		if (engine)
+			engine->getStateCache().makeCurrent();
 	}
 
 private:
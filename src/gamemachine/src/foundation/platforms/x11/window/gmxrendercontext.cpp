@@ -1,5 +1,7 @@
 ﻿#include "stdafx.h"
 #include "gmxrendercontext.h"
+#include "gmgl/gmglgraphic_engine.h"
+#include "gmgl/gmglhelper.h"
 #include <GL/glx.h>
 #include <X11/Xlib.h>
 #include <gmwindow.h>
@@ -71,7 +73,15 @@ void GMXRenderContext::switchToContext() const
 	D(d);
 	bool result = glXMakeContextCurrent(getDisplay(), d->window->getWindowHandle(), d->window->getWindowHandle(), getGlxContext());
 	if (!result)
+	{
 		gm_error(gm_dbg_wrap("Failed to switch glx context."));
+		return;
+	}
+
+	// 切换到此上下文的OpenGL状态缓存。创建窗口时引擎可能还没有创建，引擎初始化时会自行切换
+	GMGLGraphicEngine* engine = gm_cast<GMGLGraphicEngine*>(getEngine());
+	if (engine)
+		engine->getStateCache().makeCurrent();
 }
 
 void GMXRenderContext::initX(IWindow* window, const char* displayName)
@@ -2,7 +2,9 @@
 #include "gmgamepackage.h"
 #include "gmgamepackagehandler.h"
 #include "gmgamepackage_p.h"
+#include "foundation/gmasync.h"
 #include <sys/stat.h>
+#include <algorithm>
 
 BEGIN_NS
 GMGamePackage::GMGamePackage()
@@ -81,6 +83,22 @@ bool GMGamePackage::readFileFromPath(const GMString& path, REF GMBuffer* buffer)
 	return b;
 }
 
+bool GMGamePackage::readFilesFromPath(const Vector<GMString>& paths, OUT Vector<GMBuffer>& buffers)
+{
+	buffers.clear();
+	buffers.resize(paths.size());
+
+	// Vector<bool>的元素不能在多个线程中同时写入
+	Vector<GMbyte> results(paths.size(), 0);
+	GMAsync::parallelFor(paths.size(), 1, [&](GMsize_t begin, GMsize_t end) {
+		for (GMsize_t i = begin; i < end; ++i)
+		{
+			results[i] = readFileFromPath(paths[i], &buffers[i]) ? 1 : 0;
+		}
+	});
+	return std::find(results.begin(), results.end(), 0) == results.end();
+}
+
 bool GMGamePackage::exists(GMPackageIndex index, const GMString& filename)
 {
 	D(d);
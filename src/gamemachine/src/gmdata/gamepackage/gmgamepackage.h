@@ -113,6 +113,16 @@ public:
 	*/
 	bool readFileFromPath(const GMString& path, REF GMBuffer* buffer);
 
+	//! 在引擎的任务系统上并行读取多个资源。
+	/*!
+	  对每个路径调用readFileFromPath()，因此同样会触发钩子。对于zip资源包，压缩的文件会在多个工作线程中同时解压。
+	  \param paths 资源的完整路径。
+	  \param buffers 读取的结果，与paths一一对应。读取失败的资源对应一个空的缓存。
+	  \return 是否所有的资源都成功读取。
+	  \sa readFileFromPath()
+	*/
+	bool readFilesFromPath(const Vector<GMString>& paths, OUT Vector<GMBuffer>& buffers);
+
 	bool exists(GMPackageIndex index, const GMString& filename);
 
 protected:
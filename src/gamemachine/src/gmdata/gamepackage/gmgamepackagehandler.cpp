@@ -1,5 +1,13 @@
 ﻿#include "stdafx.h"
 #include <fstream>
+#include <limits>
+#include <zlib.h>
+#if !GM_WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "gmgamepackagehandler.h"
 #include "foundation/utilities/tools.h"
 #include "foundation/gamemachine.h"
@@ -13,10 +21,10 @@ BEGIN_NS
 
 namespace
 {
-	template <class char_t>
-	char_t toLower(char_t in)
-	{
-		return (in >= (char_t)'A' && in <= (char_t)'Z') ? (char_t)(in + 0x20) : in;
+	template <class char_t>
+	char_t toLower(char_t in)
+	{
+		return (in >= (char_t)'A' && in <= (char_t)'Z') ? (char_t)(in + 0x20) : in;
 	}
 
 	GMString toLower(const GMString& in)
@@ -199,11 +207,120 @@ bool GMDefaultGamePackageHandler::nextPackageCandidate()
 	return true;
 }
 
-#define CHECK(err) if (err != UNZ_OK) return false
+namespace
+{
+	// zip格式中的签名和固定长度
+	constexpr GMuint32 LocalHeaderSignature = 0x04034b50;
+	constexpr GMuint32 CentralHeaderSignature = 0x02014b50;
+	constexpr GMuint32 EndOfCentralDirectorySignature = 0x06054b50;
+	constexpr GMuint32 Zip64EndOfCentralDirectorySignature = 0x06064b50;
+	constexpr GMuint32 Zip64LocatorSignature = 0x07064b50;
+	constexpr GMsize_t LocalHeaderSize = 30;
+	constexpr GMsize_t CentralHeaderSize = 46;
+	constexpr GMsize_t EndOfCentralDirectorySize = 22;
+	constexpr GMsize_t Zip64EndOfCentralDirectorySize = 56;
+	constexpr GMsize_t Zip64LocatorSize = 20;
+	constexpr GMsize_t MaxCommentSize = 0xFFFF;
+	constexpr GMushort Zip64ExtraId = 0x0001;
+	constexpr GMuint32 MethodStored = 0;
+	constexpr GMuint32 MethodDeflated = 8;
+
+	// zip中的整数都是小端序，且不一定对齐
+	GMushort readU16(const GMbyte* p)
+	{
+		return static_cast<GMushort>(p[0] | (p[1] << 8));
+	}
+
+	GMuint32 readU32(const GMbyte* p)
+	{
+		return static_cast<GMuint32>(p[0]) | (static_cast<GMuint32>(p[1]) << 8) | (static_cast<GMuint32>(p[2]) << 16) | (static_cast<GMuint32>(p[3]) << 24);
+	}
+
+	GMint64 readU64(const GMbyte* p)
+	{
+		return static_cast<GMint64>(readU32(p)) | (static_cast<GMint64>(readU32(p + 4)) << 32);
+	}
+}
+
+// 一个被映射到内存中的分卷
+struct GMZipArchive
+{
+	GMbyte* data = nullptr;
+	GMsize_t size = 0;
+#if GM_WINDOWS
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif
+
+	bool open(const GMString& path);
+	void close();
+};
+
+bool GMZipArchive::open(const GMString& path)
+{
+	// 以写时复制的方式映射，调用者修改视图中的数据时不会写回文件，也不会因为页面只读而崩溃
+#if GM_WINDOWS
+	file = CreateFileW(path.toStdWString().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX)
+		return false;
+
+	size = static_cast<GMsize_t>(fileSize.QuadPart);
+	mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (!mapping)
+		return false;
+
+	data = static_cast<GMbyte*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+	return !!data;
+#else
+	int fd = ::open(path.toStdString().c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || static_cast<uint64_t>(st.st_size) > SIZE_MAX)
+	{
+		::close(fd);
+		return false;
+	}
+
+	size = static_cast<GMsize_t>(st.st_size);
+	void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (ptr == MAP_FAILED)
+		return false;
+
+	data = static_cast<GMbyte*>(ptr);
+	return true;
+#endif
+}
+
+void GMZipArchive::close()
+{
+#if GM_WINDOWS
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data)
+		munmap(data, size);
+#endif
+	data = nullptr;
+	size = 0;
+}
 
 GMZipGamePackageHandler::GMZipGamePackageHandler(GMGamePackage* pk)
 	: GMDefaultGamePackageHandler(pk)
-	, m_packageIndex(0)
+	, m_cacheSize(0)
+	, m_cacheBudget(DefaultCacheBudget)
 	, m_packageCount(1)
 {
 }
@@ -221,7 +338,7 @@ void GMZipGamePackageHandler::init()
 
 GMZipGamePackageHandler::~GMZipGamePackageHandler()
 {
-	releaseUnzFile();
+	releaseArchives();
 }
 
 bool GMZipGamePackageHandler::readFileFromPath(const GMString& path, REF GMBuffer* buffer)
@@ -234,82 +351,174 @@ bool GMZipGamePackageHandler::readFileFromPath(const GMString& path, REF GMBuffe
 	return false;
 }
 
-void GMZipGamePackageHandler::initFiles()
+void GMZipGamePackageHandler::setCacheBudget(GMsize_t bytes)
+{
+	GMMutexLock m(&m_cacheMutex);
+	m->lock();
+	m_cacheBudget = bytes;
+	trimCache(m_cacheBudget);
+}
+
+GMsize_t GMZipGamePackageHandler::getCacheBudget()
+{
+	GMMutexLock m(&m_cacheMutex);
+	m->lock();
+	return m_cacheBudget;
+}
+
+GMsize_t GMZipGamePackageHandler::getCacheSize()
+{
+	GMMutexLock m(&m_cacheMutex);
+	m->lock();
+	return m_cacheSize;
+}
+
+bool GMZipGamePackageHandler::loadZip()
 {
 	PKD(d);
-	releaseUnzFile();
-	m_ufs.clear();
+	releaseArchives();
+	m_entries.clear();
 
 	// 遍历pk0, pk1, ..., pkn，寻找n
 	GMsize_t idx = d->packagePath.findLastOf('.');
-	if (idx > 0)
-	{
-		GMString nameWithoutAffix = d->packagePath.substr(0, idx);
-		m_packageCount = 1;
-		while (true)
-		{
-			if (!GMPath::fileExists(nameWithoutAffix + ".pk" + GMString(m_packageCount)))
-				break;
+	if (idx == GMString::npos || idx == 0)
+		return false;
 
-			++m_packageCount;
-		}
+	GMString nameWithoutAffix = d->packagePath.substr(0, idx);
+	m_packageCount = 1;
+	while (GMPath::fileExists(nameWithoutAffix + ".pk" + GMString(m_packageCount)))
+	{
+		++m_packageCount;
 	}
 
-	m_ufs.resize(m_packageCount);
+	for (GMint32 n = 0; n < m_packageCount; ++n)
+	{
+		if (!loadArchive(n, nameWithoutAffix + ".pk" + GMString(n)))
+			return false;
+	}
+	return true;
 }
 
-bool GMZipGamePackageHandler::loadZip()
+bool GMZipGamePackageHandler::loadArchive(GMint32 index, const GMString& path)
 {
-	PKD(d);
-	initFiles();
+	GMZipArchive* archive = new GMZipArchive();
+	m_archives.push_back(archive);
+	if (!archive->open(path))
+	{
+		gm_error(gm_dbg_wrap("cannot map package file {0}"), path);
+		return false;
+	}
 
-	for (GMint32 n = 0; n < m_packageCount; ++n)
+	const GMbyte* data = archive->data;
+	const GMsize_t size = archive->size;
+	if (size < EndOfCentralDirectorySize)
+		return false;
+
+	// 从末尾向前寻找中央目录结束记录，它后面可能跟着一段注释
+	GMsize_t eocd = size - EndOfCentralDirectorySize;
+	const GMsize_t searchEnd = size > EndOfCentralDirectorySize + MaxCommentSize ? size - EndOfCentralDirectorySize - MaxCommentSize : 0;
+	while (readU32(data + eocd) != EndOfCentralDirectorySignature)
+	{
+		if (eocd == searchEnd)
+			return false;
+		--eocd;
+	}
+
+	GMint64 entryCount = readU16(data + eocd + 10);
+	GMint64 directorySize = readU32(data + eocd + 12);
+	GMint64 directoryOffset = readU32(data + eocd + 16);
+
+	// 超过4GB或者65535个文件的资源包使用ZIP64格式，真正的值记录在ZIP64中央目录结束记录中
+	if (eocd >= Zip64LocatorSize && readU32(data + eocd - Zip64LocatorSize) == Zip64LocatorSignature)
+	{
+		GMint64 zip64Offset = readU64(data + eocd - Zip64LocatorSize + 8);
+		if (zip64Offset < 0 || static_cast<uint64_t>(zip64Offset) + Zip64EndOfCentralDirectorySize > size)
+			return false;
+
+		const GMbyte* zip64 = data + zip64Offset;
+		if (readU32(zip64) != Zip64EndOfCentralDirectorySignature)
+			return false;
+
+		entryCount = readU64(zip64 + 32);
+		directorySize = readU64(zip64 + 40);
+		directoryOffset = readU64(zip64 + 48);
+	}
+
+	if (directoryOffset < 0 || directorySize < 0 || static_cast<uint64_t>(directoryOffset + directorySize) > size)
+		return false;
+
+	const GMbyte* p = data + directoryOffset;
+	const GMbyte* end = p + directorySize;
+	m_entries.reserve(m_entries.size() + static_cast<GMsize_t>(entryCount));
+	for (GMint64 i = 0; i < entryCount; ++i)
 	{
-		// 打开zip
-		GMsize_t idx = d->packagePath.findLastOf('.');
-		GM_ASSERT(idx > 0);
-		GMString nameWithoutAffix = d->packagePath.substr(0, idx);
-		GMString packagePath = nameWithoutAffix + ".pk" + GMString(n);
-		m_ufs[n] = unzOpen64(packagePath.toStdString().c_str());
-
-		// 获取文件名
-		unz_global_info64 gi;
-		GMint32 err = unzGetGlobalInfo64(m_ufs[n], &gi);
-		CHECK(err);
-		for (GMint32 i = 0; i < gi.number_entry; i++)
+		if (p + CentralHeaderSize > end || readU32(p) != CentralHeaderSignature)
+			return false;
+
+		GMZipEntry entry;
+		entry.archive = index;
+		entry.encrypted = (readU16(p + 8) & 1) != 0;
+		entry.method = readU16(p + 10);
+		entry.compressedSize = readU32(p + 20);
+		entry.uncompressedSize = readU32(p + 24);
+		entry.localHeaderOffset = readU32(p + 42);
+		const GMsize_t nameLength = readU16(p + 28);
+		const GMsize_t extraLength = readU16(p + 30);
+		const GMsize_t commentLength = readU16(p + 32);
+		const GMbyte* name = p + CentralHeaderSize;
+		const GMbyte* extra = name + nameLength;
+		if (extra + extraLength + commentLength > end)
+			return false;
+
+		// ZIP64扩展字段依次记录值为0xFFFFFFFF的解压大小、压缩大小和偏移
+		const GMbyte* extraEnd = extra + extraLength;
+		for (const GMbyte* field = extra; field + 4 <= extraEnd; )
 		{
-			while (true)
-			{
-				char filename[FILENAME_MAX];
-				unz_file_info64 file_info;
-				err = unzGetCurrentFileInfo64(m_ufs[n], &file_info, filename, sizeof(filename), NULL, 0, NULL, 0);
-				CHECK(err);
-
-				GMString normalized = normalizePath(filename);
-				auto& b = m_buffers[normalized];
-				b.first = n;
+			const GMbyte* value = field + 4;
+			const GMbyte* fieldEnd = value + readU16(field + 2);
+			if (fieldEnd > extraEnd)
 				break;
-			}
-			if ((i + 1) < gi.number_entry)
+
+			if (readU16(field) == Zip64ExtraId)
 			{
-				err = unzGoToNextFile(m_ufs[n]);
-				CHECK(err);
+				if (entry.uncompressedSize == 0xFFFFFFFF && value + 8 <= fieldEnd)
+				{
+					entry.uncompressedSize = readU64(value);
+					value += 8;
+				}
+				if (entry.compressedSize == 0xFFFFFFFF && value + 8 <= fieldEnd)
+				{
+					entry.compressedSize = readU64(value);
+					value += 8;
+				}
+				if (entry.localHeaderOffset == 0xFFFFFFFF && value + 8 <= fieldEnd)
+					entry.localHeaderOffset = readU64(value);
+				break;
 			}
+			field = fieldEnd;
 		}
+
+		std::string fileName(reinterpret_cast<const char*>(name), nameLength);
+		m_entries[normalizePath(fileName)] = entry;
+		p = extra + extraLength + commentLength;
 	}
 	return true;
 }
 
-void GMZipGamePackageHandler::releaseUnzFile()
+void GMZipGamePackageHandler::releaseArchives()
 {
-	for (auto& uf : m_ufs)
+	for (auto archive : m_archives)
 	{
-		if (uf)
-		{
-			unzClose(uf);
-			uf = nullptr;
-		}
+		archive->close();
+		GM_delete(archive);
 	}
+	m_archives.clear();
+
+	GMMutexLock m(&m_cacheMutex);
+	m->lock();
+	m_cache.clear();
+	m_lru.clear();
+	m_cacheSize = 0;
 }
 
 GMString GMZipGamePackageHandler::fromRelativePath(const GMString& in)
@@ -353,52 +562,133 @@ GMString GMZipGamePackageHandler::fromRelativePath(const GMString& in)
 
 bool GMZipGamePackageHandler::loadBuffer(const GMString& path, REF GMBuffer* buffer)
 {
-	constexpr GMuint32 bufSize = 4096;
-
-	// 如果已经有数据了，不需要从zip中读取
+	// 文件列表在加载之后不再改变，因此查找不需要加锁
 	GMString normalized = normalizePath(path);
-	auto iter = m_buffers.find(normalized);
-	if (iter == m_buffers.end())
+	auto iter = m_entries.find(normalized);
+	if (iter == m_entries.end())
+		return false;
+
+	const GMZipEntry& entry = iter->second;
+	if (entry.encrypted)
+	{
+		gm_warning(gm_dbg_wrap("encrypted file {0} is not supported."), normalized);
 		return false;
+	}
 
-	GMBuffer& targetBuffer = iter->second.second;
-	if (targetBuffer.getSize() > 0)
+	// 本地文件头中的文件名和扩展字段可能与中央目录中的不同，数据的位置需要从本地文件头中计算
+	const GMZipArchive* archive = m_archives[entry.archive];
+	if (entry.localHeaderOffset < 0 || static_cast<uint64_t>(entry.localHeaderOffset) + LocalHeaderSize > archive->size)
+		return false;
+
+	GMbyte* header = archive->data + entry.localHeaderOffset;
+	if (readU32(header) != LocalHeaderSignature)
+		return false;
+
+	GMint64 dataOffset = entry.localHeaderOffset + LocalHeaderSize + readU16(header + 26) + readU16(header + 28);
+	if (static_cast<uint64_t>(dataOffset + entry.compressedSize) > archive->size)
+		return false;
+
+	GMbyte* data = archive->data + dataOffset;
+	if (entry.method == MethodStored)
 	{
-		*buffer = targetBuffer;
+		// 未压缩的文件直接返回映射内存的视图
+		*buffer = GMBuffer::createBufferView(data, static_cast<GMsize_t>(entry.uncompressedSize));
 		return true;
 	}
 
-	// 获取path的索引，取出相应的zip file
-	unzFile uf = m_ufs[iter->second.first];
-	std::string stdFileName = normalized.toStdString();
-	if (UNZ_OK != unzLocateFile(uf, stdFileName.c_str(), false))
+	if (entry.method != MethodDeflated)
+	{
+		gm_warning(gm_dbg_wrap("compression method {0} of file {1} is not supported."), GMString(static_cast<GMint32>(entry.method)), normalized);
 		return false;
+	}
 
-	char filename[FILENAME_MAX];
-	unz_file_info64 file_info;
+	if (findCachedBuffer(normalized, buffer))
+		return true;
 
-	GMint32 err = unzGetCurrentFileInfo64(uf, &file_info, filename, sizeof(filename), NULL, 0, NULL, 0);
-	CHECK(err);
+	// 在锁外解压，不同的文件可以同时解压
+	if (!inflateEntry(entry, data, buffer))
+	{
+		gm_warning(gm_dbg_wrap("cannot inflate file {0}."), normalized);
+		return false;
+	}
 
-	err = unzOpenCurrentFilePassword(uf, nullptr);
-	CHECK(err);
+	cacheBuffer(normalized, *buffer);
+	return true;
+}
 
-	// 构建数据
-	targetBuffer.resize(file_info.uncompressed_size);
-	GMbyte* ptr = targetBuffer.getData();
-	do
+bool GMZipGamePackageHandler::inflateEntry(const GMZipEntry& entry, const GMbyte* data, REF GMBuffer* buffer)
+{
+	if (static_cast<uint64_t>(entry.compressedSize) > std::numeric_limits<uInt>::max()
+		|| static_cast<uint64_t>(entry.uncompressedSize) > std::numeric_limits<uInt>::max())
 	{
-		err = unzReadCurrentFile(uf, ptr, bufSize);
-		if (err < 0)
-			return false;
-		if (err > 0)
-			ptr += err;
-	} while (err > 0);
+		return false;
+	}
+
+	GMBuffer result(nullptr, static_cast<GMsize_t>(entry.uncompressedSize));
+	z_stream stream = {};
+	stream.next_in = const_cast<Bytef*>(data);
+	stream.avail_in = static_cast<uInt>(entry.compressedSize);
+	stream.next_out = result.getData();
+	stream.avail_out = static_cast<uInt>(entry.uncompressedSize);
+
+	// zip中的数据是没有zlib头的原始deflate流
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return false;
+
+	GMint32 err = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+	if (err != Z_STREAM_END || stream.total_out != static_cast<uLong>(entry.uncompressedSize))
+		return false;
+
+	*buffer = std::move(result);
+	return true;
+}
+
+bool GMZipGamePackageHandler::findCachedBuffer(const GMString& path, REF GMBuffer* buffer)
+{
+	GMMutexLock m(&m_cacheMutex);
+	m->lock();
+	auto iter = m_cache.find(path);
+	if (iter == m_cache.end())
+		return false;
 
-	*buffer = targetBuffer;
+	// 移到LRU链表的头部
+	m_lru.splice(m_lru.begin(), m_lru, iter->second.lru);
+	*buffer = iter->second.buffer;
 	return true;
 }
 
+void GMZipGamePackageHandler::cacheBuffer(const GMString& path, const GMBuffer& buffer)
+{
+	GMMutexLock m(&m_cacheMutex);
+	m->lock();
+	const GMsize_t size = buffer.getSize();
+	if (size > m_cacheBudget)
+		return;
+
+	// 另一个线程可能同时解压了同一个文件
+	if (m_cache.find(path) != m_cache.end())
+		return;
+
+	trimCache(m_cacheBudget - size);
+	m_lru.push_front(path);
+	m_cache[path] = { buffer, m_lru.begin() };
+	m_cacheSize += size;
+}
+
+void GMZipGamePackageHandler::trimCache(GMsize_t budget)
+{
+	// 调用者已经持有m_cacheMutex
+	while (m_cacheSize > budget && !m_lru.empty())
+	{
+		auto iter = m_cache.find(m_lru.back());
+		GM_ASSERT(iter != m_cache.end());
+		m_cacheSize -= iter->second.buffer.getSize();
+		m_cache.erase(iter);
+		m_lru.pop_back();
+	}
+}
+
 GMString GMZipGamePackageHandler::pathRoot(GMPackageIndex index)
 {
 	PKD(d);
@@ -442,12 +732,12 @@ GMString GMZipGamePackageHandler::pathOf(GMPackageIndex index, const GMString& f
 bool GMZipGamePackageHandler::exists(GMPackageIndex index, const GMString& fileName)
 {
 	GMString path = pathOf(index, normalizePath(fileName));
-	bool existed = (m_buffers.find(path) != m_buffers.end());
+	bool existed = (m_entries.find(path) != m_entries.end());
 	if (!fileName.endsWith(L'/') && !existed)
 	{
 		// 可能它是个目录
 		path = pathOf(index, fileName + L"/");
-		existed = (m_buffers.find(path) != m_buffers.end());
+		existed = (m_entries.find(path) != m_entries.end());
 	}
 	return existed;
 }
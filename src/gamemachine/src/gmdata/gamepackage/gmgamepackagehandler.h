@@ -3,10 +3,9 @@
 #include <gmcommon.h>
 #include <gmthread.h>
 #include "gmgamepackage.h"
-#include "contrib/minizip/unzip.h"
 BEGIN_NS
 
-class GMDefaultGamePackageHandler : public IGamePackageHandler
+class GM_EXPORT GMDefaultGamePackageHandler : public IGamePackageHandler
 {
 public:
 	GMDefaultGamePackageHandler(GMGamePackage* pk);
@@ -34,11 +33,38 @@ protected:
 	GMMutex m_mutex;
 };
 
-class GMZipGamePackageHandler : public GMDefaultGamePackageHandler
+struct GMZipArchive;
+
+//! zip资源包中的一个文件。
+struct GMZipEntry
+{
+	GMint32 archive = 0; //!< 所在分卷的序号。
+	GMuint32 method = 0; //!< 压缩方法，0为Stored，8为Deflated。
+	bool encrypted = false; //!< 是否被加密。
+	GMint64 localHeaderOffset = 0; //!< 本地文件头在分卷中的偏移。
+	GMint64 compressedSize = 0; //!< 压缩后的大小。
+	GMint64 uncompressedSize = 0; //!< 解压后的大小。
+};
+
+//! zip资源包（.pk0, .pk1, ..., .pkN）的处理器。
+/*!
+  所有的分卷在加载时被映射到内存中，只解析中央目录，不读取文件数据。<BR>
+  未压缩(Stored)的文件直接以指向映射内存的GMBuffer视图返回，不复制数据。压缩(Deflated)的文件在调用者的线程中一次性解压，
+  不同的文件可以在多个线程中同时读取，配合GMGamePackage::readFilesFromPath()在任务系统上并行解压。<BR>
+  解压后的数据放在一个有字节预算的LRU缓存中，超出预算时淘汰最久没有被读取的文件。已经返回给调用者的GMBuffer是引用计数的，
+  淘汰不会使其失效。<BR>
+  视图所指向的内存在资源包被卸载之前一直有效。映射是写时复制的，修改视图中的数据不会写回资源包。
+*/
+class GM_EXPORT GMZipGamePackageHandler : public GMDefaultGamePackageHandler
 {
 	typedef GMDefaultGamePackageHandler Base;
 
 public:
+	enum
+	{
+		DefaultCacheBudget = 256 * 1024 * 1024, //!< 默认的缓存预算，单位为字节。
+	};
+
 	GMZipGamePackageHandler(GMGamePackage* pk);
 	~GMZipGamePackageHandler();
 
@@ -48,23 +74,47 @@ public:
 	virtual GMString pathOf(GMPackageIndex index, const GMString& fileName) override;
 	virtual bool exists(GMPackageIndex index, const GMString& fileName) override;
 
+public:
+	//! 设置解压缓存的预算。
+	/*!
+	  \param bytes 缓存中解压后的数据最多占用的字节数。如果为0，则不缓存。
+	*/
+	void setCacheBudget(GMsize_t bytes);
+	GMsize_t getCacheBudget();
+
+	//! 获取缓存中解压后的数据当前占用的字节数。
+	GMsize_t getCacheSize();
+
 protected:
 	virtual GMString pathRoot(GMPackageIndex index) override;
 
 private:
-	void initFiles();
 	bool loadZip();
-	void releaseUnzFile();
+	bool loadArchive(GMint32 index, const GMString& path);
+	void releaseArchives();
 	GMString fromRelativePath(const GMString& in);
 	bool loadBuffer(const GMString& path, REF GMBuffer* buffer);
+	bool inflateEntry(const GMZipEntry& entry, const GMbyte* data, REF GMBuffer* buffer);
+	bool findCachedBuffer(const GMString& path, REF GMBuffer* buffer);
+	void cacheBuffer(const GMString& path, const GMBuffer& buffer);
+	void trimCache(GMsize_t budget);
 
 private:
-	Vector<unzFile> m_ufs;
-	HashMap<GMString, Pair<GMint32, GMBuffer>, GMStringHashFunctor> m_buffers;
-	GMint32 m_packageCount;
+	typedef List<GMString> LRUList;
+	struct CachedBuffer
+	{
+		GMBuffer buffer;
+		LRUList::iterator lru;
+	};
 
-protected:
-	GMint32 m_packageIndex;
+	Vector<GMZipArchive*> m_archives;
+	HashMap<GMString, GMZipEntry, GMStringHashFunctor> m_entries;
+	HashMap<GMString, CachedBuffer, GMStringHashFunctor> m_cache;
+	LRUList m_lru; // 最近读取的文件在前面
+	GMsize_t m_cacheSize;
+	GMsize_t m_cacheBudget;
+	GMMutex m_cacheMutex;
+	GMint32 m_packageCount;
 };
 
 END_NS
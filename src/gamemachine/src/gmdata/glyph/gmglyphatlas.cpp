@@ -0,0 +1,327 @@
+﻿#include "stdafx.h"
+#include "gmglyphatlas.h"
+
+BEGIN_NS
+
+namespace
+{
+	// 天际线的一段，从x开始，宽度为width，高度为y
+	struct SkylineNode
+	{
+		GMint32 x;
+		GMint32 y;
+		GMint32 width;
+	};
+
+	struct GlyphAtlasPage
+	{
+		Vector<GMbyte> pixels;
+		Vector<SkylineNode> skyline;
+		GMint64 lastUsedFrame = 0;
+		GMRect dirty = { 0, 0, 0, 0 };
+		bool hasDirty = false;
+	};
+
+	// 区域之间的间隔，防止采样时混入相邻字形的像素
+	constexpr GMint32 RegionSpacing = 1;
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMGlyphAtlas)
+{
+	GMint32 pageWidth = 0;
+	GMint32 pageHeight = 0;
+	GMint32 maxPages = 0;
+	GMint64 frame = 0;
+	Vector<GlyphAtlasPage> pages;
+};
+
+GMGlyphAtlas::GMGlyphAtlas(GMint32 pageWidth, GMint32 pageHeight, GMint32 maxPages)
+{
+	GM_CREATE_DATA();
+	D(d);
+	GM_ASSERT(pageWidth > 0 && pageHeight > 0 && maxPages > 0);
+	d->pageWidth = pageWidth;
+	d->pageHeight = pageHeight;
+	d->maxPages = maxPages;
+	d->pages.reserve(maxPages);
+}
+
+GMGlyphAtlas::~GMGlyphAtlas()
+{
+
+}
+
+GMint32 GMGlyphAtlas::getPageWidth() const GM_NOEXCEPT
+{
+	D(d);
+	return d->pageWidth;
+}
+
+GMint32 GMGlyphAtlas::getPageHeight() const GM_NOEXCEPT
+{
+	D(d);
+	return d->pageHeight;
+}
+
+GMint32 GMGlyphAtlas::getMaxPages() const GM_NOEXCEPT
+{
+	D(d);
+	return d->maxPages;
+}
+
+GMint32 GMGlyphAtlas::getPageCount() const GM_NOEXCEPT
+{
+	D(d);
+	return gm_sizet_to_int(d->pages.size());
+}
+
+void GMGlyphAtlas::nextFrame() GM_NOEXCEPT
+{
+	D(d);
+	++d->frame;
+}
+
+GMint64 GMGlyphAtlas::getFrame() const GM_NOEXCEPT
+{
+	D(d);
+	return d->frame;
+}
+
+bool GMGlyphAtlas::allocate(GMint32 width, GMint32 height, OUT GMGlyphAtlasRegion& region, OUT GMint32& evictedPage)
+{
+	D(d);
+	evictedPage = -1;
+	region = GMGlyphAtlasRegion();
+	if (width <= 0 || height <= 0)
+		return false;
+
+	const GMint32 paddedWidth = width + RegionSpacing;
+	const GMint32 paddedHeight = height + RegionSpacing;
+	if (paddedWidth > d->pageWidth || paddedHeight > d->pageHeight)
+		return false;
+
+	// 优先放入已有的页中
+	GMint32 page = -1, index = -1, x = 0, y = 0;
+	for (GMint32 i = 0; i < getPageCount(); ++i)
+	{
+		index = findPosition(i, paddedWidth, paddedHeight, x, y);
+		if (index >= 0)
+		{
+			page = i;
+			break;
+		}
+	}
+
+	if (page < 0)
+	{
+		if (getPageCount() < d->maxPages)
+		{
+			// 创建新的一页
+			d->pages.emplace_back();
+			page = getPageCount() - 1;
+			d->pages[page].pixels.resize(static_cast<GMsize_t>(d->pageWidth) * d->pageHeight);
+			clearPage(page);
+		}
+		else
+		{
+			// 所有的页都已满，清空一页
+			page = selectEvictingPage();
+			clearPage(page);
+			evictedPage = page;
+		}
+
+		index = findPosition(page, paddedWidth, paddedHeight, x, y);
+		GM_ASSERT(index >= 0);
+	}
+
+	addSkylineLevel(page, index, x, y, paddedWidth, paddedHeight);
+	touch(page);
+
+	region.page = page;
+	region.x = x;
+	region.y = y;
+	region.width = width;
+	region.height = height;
+	return true;
+}
+
+void GMGlyphAtlas::touch(GMint32 page) GM_NOEXCEPT
+{
+	D(d);
+	GM_ASSERT(page >= 0 && page < getPageCount());
+	d->pages[page].lastUsedFrame = d->frame;
+}
+
+GMint64 GMGlyphAtlas::getLastUsedFrame(GMint32 page) const GM_NOEXCEPT
+{
+	D(d);
+	GM_ASSERT(page >= 0 && page < getPageCount());
+	return d->pages[page].lastUsedFrame;
+}
+
+void GMGlyphAtlas::clear()
+{
+	D(d);
+	for (GMint32 i = 0; i < getPageCount(); ++i)
+	{
+		clearPage(i);
+	}
+}
+
+void GMGlyphAtlas::write(const GMGlyphAtlasRegion& region, const GMbyte* pixels, GMint32 pitch)
+{
+	D(d);
+	GM_ASSERT(region.page >= 0 && region.page < getPageCount());
+	GM_ASSERT(region.x + region.width <= d->pageWidth && region.y + region.height <= d->pageHeight);
+	GlyphAtlasPage& page = d->pages[region.page];
+	for (GMint32 row = 0; row < region.height; ++row)
+	{
+		memcpy(page.pixels.data() + static_cast<GMsize_t>(region.y + row) * d->pageWidth + region.x,
+			pixels + static_cast<GMsize_t>(row) * pitch,
+			region.width);
+	}
+
+	// 合并到脏区域
+	if (!page.hasDirty)
+	{
+		page.dirty = { region.x, region.y, region.width, region.height };
+		page.hasDirty = true;
+	}
+	else
+	{
+		GMint32 right = std::max(page.dirty.x + page.dirty.width, region.x + region.width);
+		GMint32 bottom = std::max(page.dirty.y + page.dirty.height, region.y + region.height);
+		page.dirty.x = std::min(page.dirty.x, region.x);
+		page.dirty.y = std::min(page.dirty.y, region.y);
+		page.dirty.width = right - page.dirty.x;
+		page.dirty.height = bottom - page.dirty.y;
+	}
+}
+
+const GMbyte* GMGlyphAtlas::getPixels(GMint32 page) const
+{
+	D(d);
+	GM_ASSERT(page >= 0 && page < getPageCount());
+	return d->pages[page].pixels.data();
+}
+
+bool GMGlyphAtlas::takeDirtyRect(GMint32 page, OUT GMRect& rect)
+{
+	D(d);
+	GM_ASSERT(page >= 0 && page < getPageCount());
+	GlyphAtlasPage& p = d->pages[page];
+	if (!p.hasDirty)
+		return false;
+
+	rect = p.dirty;
+	p.hasDirty = false;
+	return true;
+}
+
+GMint32 GMGlyphAtlas::findPosition(GMint32 page, GMint32 width, GMint32 height, OUT GMint32& x, OUT GMint32& y)
+{
+	D(d);
+	// Bottom-Left规则：选择放置后顶部最低的位置，相同时选择最左边的位置
+	const Vector<SkylineNode>& skyline = d->pages[page].skyline;
+	GMint32 bestIndex = -1, bestTop = d->pageHeight + 1;
+	for (GMsize_t i = 0; i < skyline.size(); ++i)
+	{
+		const SkylineNode& node = skyline[i];
+		if (node.x + width > d->pageWidth)
+			break;
+
+		// 区域会覆盖从第i段开始的若干段，它的底部为这些段中最高的一段
+		GMint32 top = 0, remaining = width;
+		for (GMsize_t j = i; remaining > 0; ++j)
+		{
+			GM_ASSERT(j < skyline.size());
+			top = std::max(top, skyline[j].y);
+			remaining -= skyline[j].width;
+		}
+
+		if (top + height <= d->pageHeight && top + height < bestTop)
+		{
+			bestTop = top + height;
+			bestIndex = gm_sizet_to_int(i);
+			x = node.x;
+			y = top;
+		}
+	}
+	return bestIndex;
+}
+
+void GMGlyphAtlas::addSkylineLevel(GMint32 page, GMint32 index, GMint32 x, GMint32 y, GMint32 width, GMint32 height)
+{
+	D(d);
+	Vector<SkylineNode>& skyline = d->pages[page].skyline;
+	skyline.insert(skyline.begin() + index, { x, y + height, width });
+
+	// 新的一段遮住了后面的段，将它们缩短或者删除
+	for (GMsize_t i = index + 1; i < skyline.size(); )
+	{
+		const SkylineNode& prev = skyline[i - 1];
+		SkylineNode& node = skyline[i];
+		GMint32 overlap = prev.x + prev.width - node.x;
+		if (overlap <= 0)
+			break;
+
+		if (node.width > overlap)
+		{
+			node.x += overlap;
+			node.width -= overlap;
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+	}
+
+	// 合并高度相同的相邻段
+	for (GMsize_t i = 1; i < skyline.size(); )
+	{
+		if (skyline[i - 1].y == skyline[i].y)
+		{
+			skyline[i - 1].width += skyline[i].width;
+			skyline.erase(skyline.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void GMGlyphAtlas::clearPage(GMint32 page)
+{
+	D(d);
+	GlyphAtlasPage& p = d->pages[page];
+	p.skyline.clear();
+	p.skyline.push_back({ 0, 0, d->pageWidth });
+
+	// 清空整页的位图，防止旧字形残留在新字形的间隔中
+	std::fill(p.pixels.begin(), p.pixels.end(), 0);
+	p.dirty = { 0, 0, d->pageWidth, d->pageHeight };
+	p.hasDirty = true;
+}
+
+GMint32 GMGlyphAtlas::selectEvictingPage() const
+{
+	D(d);
+	// 优先选择当前帧没有使用过的页中，最近最少使用的页。如果所有的页都在当前帧使用过，只能选择其中最早使用的页
+	GMint32 candidate = -1, fallback = 0;
+	for (GMint32 i = 0; i < getPageCount(); ++i)
+	{
+		GMint64 lastUsed = d->pages[i].lastUsedFrame;
+		if (lastUsed < d->frame && (candidate < 0 || lastUsed < d->pages[candidate].lastUsedFrame))
+			candidate = i;
+		if (lastUsed < d->pages[fallback].lastUsedFrame)
+			fallback = i;
+	}
+
+	if (candidate < 0)
+	{
+		gm_warning(gm_dbg_wrap("All glyph atlas pages are used in current frame. Evicting page {0}."), GMString(fallback));
+		return fallback;
+	}
+	return candidate;
+}
+
+END_NS
@@ -0,0 +1,101 @@
+﻿#ifndef __GMGLYPHATLAS_H__
+#define __GMGLYPHATLAS_H__
+#include <gmcommon.h>
+
+BEGIN_NS
+
+//! 字形图集中的一块区域。
+struct GMGlyphAtlasRegion
+{
+	GMint32 page = -1; //!< 区域所在的页，-1表示无效的区域。
+	GMint32 x = 0; //!< 区域在页中的横坐标。
+	GMint32 y = 0; //!< 区域在页中的纵坐标。
+	GMint32 width = 0; //!< 区域的宽度。
+	GMint32 height = 0; //!< 区域的高度。
+};
+
+GM_PRIVATE_CLASS(GMGlyphAtlas);
+//! 多页的字形图集。
+/*!
+  每一页使用天际线（Skyline）算法装箱，区域之间保留1个像素的间隔。每一页在内存中保存一份单通道的位图，
+  被写入的部分会合并为这一页的脏区域，由使用者在合适的时机一次性上传到纹理，而不是每个字形上传一次。<BR>
+  所有页都已满时，图集会整页清空一页，以便重新分配：优先选择当前帧没有使用过的页中，最近最少使用的页。
+  分配和touch()会将页标记为在当前帧使用过。
+*/
+class GM_EXPORT GMGlyphAtlas
+{
+	GM_DECLARE_PRIVATE(GMGlyphAtlas)
+	GM_DISABLE_COPY_ASSIGN(GMGlyphAtlas)
+
+public:
+	//! 构造一个字形图集。
+	/*!
+	  \param pageWidth 每一页的宽度。
+	  \param pageHeight 每一页的高度。
+	  \param maxPages 最多的页数。
+	*/
+	GMGlyphAtlas(GMint32 pageWidth, GMint32 pageHeight, GMint32 maxPages);
+	~GMGlyphAtlas();
+
+public:
+	GMint32 getPageWidth() const GM_NOEXCEPT;
+	GMint32 getPageHeight() const GM_NOEXCEPT;
+	GMint32 getMaxPages() const GM_NOEXCEPT;
+
+	//! 获取已经创建的页数。
+	GMint32 getPageCount() const GM_NOEXCEPT;
+
+	//! 开始新的一帧，用于判断页是否在当前帧使用过。
+	void nextFrame() GM_NOEXCEPT;
+
+	//! 获取当前帧的序号。
+	GMint64 getFrame() const GM_NOEXCEPT;
+
+	//! 分配一块区域。
+	/*!
+	  如果现有的页都放不下，且页数没有达到上限，则创建新的一页；否则清空一页再分配。
+	  \param width 区域的宽度。
+	  \param height 区域的高度。
+	  \param region 分配到的区域。
+	  \param evictedPage 如果分配时清空了某一页，返回该页的序号，否则返回-1。原来在这一页中的区域都已失效。
+	  \return 是否分配成功。如果区域比一页还大，将会失败。
+	*/
+	bool allocate(GMint32 width, GMint32 height, OUT GMGlyphAtlasRegion& region, OUT GMint32& evictedPage);
+
+	//! 将某一页标记为在当前帧使用过。
+	void touch(GMint32 page) GM_NOEXCEPT;
+
+	//! 获取某一页最后一次使用时的帧序号。
+	GMint64 getLastUsedFrame(GMint32 page) const GM_NOEXCEPT;
+
+	//! 清空所有的页，所有的区域都将失效。
+	void clear();
+
+	//! 将位图写入一块区域，并将其合并到这一页的脏区域中。
+	/*!
+	  \param region 由allocate()分配的区域。
+	  \param pixels 位图的数据，每个像素占1个字节，大小与区域相同。
+	  \param pitch 位图每一行的字节数。
+	*/
+	void write(const GMGlyphAtlasRegion& region, const GMbyte* pixels, GMint32 pitch);
+
+	//! 获取某一页的位图，每一行的字节数为页的宽度。
+	const GMbyte* getPixels(GMint32 page) const;
+
+	//! 取出某一页的脏区域，并将这一页标记为干净。
+	/*!
+	  \param page 页的序号。
+	  \param rect 脏区域。
+	  \return 这一页是否有脏区域。
+	*/
+	bool takeDirtyRect(GMint32 page, OUT GMRect& rect);
+
+private:
+	GMint32 findPosition(GMint32 page, GMint32 width, GMint32 height, OUT GMint32& x, OUT GMint32& y);
+	void addSkylineLevel(GMint32 page, GMint32 index, GMint32 x, GMint32 y, GMint32 width, GMint32 height);
+	void clearPage(GMint32 page);
+	GMint32 selectEvictingPage() const;
+};
+
+END_NS
+#endif
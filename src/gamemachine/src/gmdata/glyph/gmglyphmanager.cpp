@@ -1,9 +1,9 @@
 ﻿#include "stdafx.h"
 #include "gmglyphmanager.h"
+#include "gmglyphatlas.h"
 #include "foundation/utilities/tools.h"
 #include "ft2build.h"
 #include "freetype/freetype.h"
-#include "freetype/ftglyph.h"
 #include "foundation/gamemachine.h"
 #include "gmdata/gamepackage/gmgamepackage.h"
 
@@ -39,6 +39,74 @@ namespace
 		FT_Error err = FT_New_Memory_Face(g_lib.library, buffer.getData(), (FT_Long) buffer.getSize(), 0, face);
 		return err;
 	}
+
+	GMGlyphKey makeGlyphKey(GMFontHandle font, GMFontSizePt fontSize, GMwchar c)
+	{
+		GM_ASSERT(font <= 0xFFFF && fontSize >= 0 && fontSize <= 0xFFFF);
+		return (static_cast<GMGlyphKey>(font & 0xFFFF) << 48)
+			| (static_cast<GMGlyphKey>(fontSize & 0xFFFF) << 32)
+			| static_cast<GMuint32>(c);
+	}
+
+	GMFontHandle getKeyFont(GMGlyphKey key)
+	{
+		return static_cast<GMFontHandle>(key >> 48);
+	}
+
+	GMFontSizePt getKeyFontSize(GMGlyphKey key)
+	{
+		return static_cast<GMFontSizePt>((key >> 32) & 0xFFFF);
+	}
+
+	GMwchar getKeyChar(GMGlyphKey key)
+	{
+		return static_cast<GMwchar>(key & 0xFFFFFFFF);
+	}
+
+	GMint32 scaleMetric(GMint32 value, GMfloat scale)
+	{
+		return Round(value * scale);
+	}
+
+	// 由灰度位图生成有向距离场，输出的位图每一边比原位图多spread个像素
+	// 0.5表示字形的边缘，大于0.5的部分在字形内部
+	void generateDistanceField(const GMbyte* src, GMint32 width, GMint32 height, GMint32 pitch, GMint32 spread, Vector<GMbyte>& out)
+	{
+		const GMint32 outWidth = width + spread * 2;
+		const GMint32 outHeight = height + spread * 2;
+		out.resize(static_cast<GMsize_t>(outWidth) * outHeight);
+
+		auto inside = [=](GMint32 x, GMint32 y) {
+			if (x < 0 || y < 0 || x >= width || y >= height)
+				return false;
+			return src[y * pitch + x] >= 128;
+		};
+
+		// 在spread范围内寻找最近的、内外状态相反的像素
+		for (GMint32 oy = 0; oy < outHeight; ++oy)
+		{
+			for (GMint32 ox = 0; ox < outWidth; ++ox)
+			{
+				const GMint32 sx = ox - spread, sy = oy - spread;
+				const bool in = inside(sx, sy);
+				GMint32 nearestSq = (spread + 1) * (spread + 1);
+				for (GMint32 dy = -spread; dy <= spread; ++dy)
+				{
+					for (GMint32 dx = -spread; dx <= spread; ++dx)
+					{
+						GMint32 distanceSq = dx * dx + dy * dy;
+						if (distanceSq < nearestSq && inside(sx + dx, sy + dy) != in)
+							nearestSq = distanceSq;
+					}
+				}
+
+				// 边缘在两个像素中心的中间
+				GMfloat distance = Min(Sqrt(static_cast<GMfloat>(nearestSq)) - .5f, static_cast<GMfloat>(spread));
+				GMfloat value = .5f + (in ? distance : -distance) / (spread * 2);
+				out[oy * outWidth + ox] = static_cast<GMbyte>(Clamp(value, 0.f, 1.f) * 255 + .5f);
+			}
+		}
+	}
 }
 
 // 用于管理字形的类
@@ -51,7 +119,8 @@ struct GMFontMeta
 	GMBuffer buffer;
 };
 
-typedef HashMap<GMFontHandle, HashMap<GMint32, HashMap<GMwchar, GMGlyphInfo> > > CharList;
+// 所有的字形放在同一个散列表中，字形被移出图集时不会被删除，因此其地址一直有效
+typedef HashMap<GMGlyphKey, GMGlyphInfo> CharList;
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMGlyphManager)
 {
@@ -59,55 +128,90 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMGlyphManager)
 
 	const IRenderContext* context = nullptr;
 	CharList chars;
-	GMint32 cursor_u, cursor_v;
-	GMfloat maxHeight;
+	GMGlyphAtlas atlas { GMGlyphManager::PAGE_WIDTH, GMGlyphManager::PAGE_HEIGHT, GMGlyphManager::MAX_PAGES };
+	Vector<GMGlyphKey> pageGlyphs[GMGlyphManager::MAX_PAGES]; // 每一页中的字形
+	GMuint32 generation = 0;
+	bool sdf = false;
+	Vector<GMbyte> distanceField;
 	Vector<GMFontMeta> fonts;
 
 	GMFontHandle defaultCN = GMInvalidFontHandle;
 	GMFontHandle defaultEN = GMInvalidFontHandle;
-
-	const GMGlyphInfo& createChar(GMwchar c, GMFontSizePt fontSize, GMFontHandle font);
-	GMFontMeta* getFont(GMFontHandle);
-	GMGlyphInfo& insertChar(GMFontSizePt fontSize, GMFontHandle font, GMwchar ch, const GMGlyphInfo& glyph);
-	const GMGlyphInfo& getCharInner(GMwchar c, GMFontSizePt fontSize, GMFontHandle font, GMFontHandle candidate);
+
+	GMFontMeta* getFont(GMFontHandle);
+	GMGlyphInfo& insertChar(const GMGlyphInfo& glyph);
+	const GMGlyphInfo& getCharInner(GMwchar c, GMFontSizePt fontSize, GMFontHandle font, GMFontHandle candidate);
+	bool isResident(const GMGlyphInfo& glyph);
+	bool makeResident(GMGlyphInfo& glyph);
+	FT_Face loadGlyph(GMFontHandle font, GMwchar c, GMFontSizePt fontSize);
+	bool rasterize(GMGlyphInfo& glyph);
+	bool rasterizeSDF(GMGlyphInfo& glyph);
+	bool rasterizeDistanceField(GMGlyphInfo& glyph);
+	bool storeBitmap(GMGlyphInfo& glyph, const GMbyte* pixels, GMint32 width, GMint32 height, GMint32 pitch, GMint32 border);
+	void evictPage(GMint32 page);
+	void evictAll();
 };
 
 const GMGlyphInfo& GMGlyphManagerPrivate::getCharInner(GMwchar c, GMFontSizePt fontSize, GMFontHandle font, GMFontHandle candidate)
 {
 	static const GMGlyphInfo err = { false };
-	if (font >= fonts.size())
+	if (font >= fonts.size() || fontSize <= 0)
 		return err;
 
-	auto& charsWithSize = chars[font][fontSize];
-	auto iter = charsWithSize.find(c);
-	if (iter != charsWithSize.end())
-		return (*iter).second;
+	GMGlyphKey key = makeGlyphKey(font, fontSize, c);
+	auto iter = chars.find(key);
+	if (iter != chars.end())
+	{
+		GMGlyphInfo& glyph = iter->second;
+		makeResident(glyph);
+		return glyph;
+	}
 
-	const GMGlyphInfo& glyph = createChar(c, fontSize, font);
-	if (!glyph.valid)
+	GMGlyphInfo glyph = { false };
+	glyph.key = key;
+	glyph.page = -1;
+	if (!rasterize(glyph))
 	{
 		//如果没有拿到当前的字形，需要换一种默认字体匹配
 		return getCharInner(c, fontSize, candidate, candidate + 1);
 	}
-	return glyph;
+	return insertChar(glyph);
 }
 
-GMGlyphInfo& GMGlyphManagerPrivate::insertChar(GMint32 fontSize, GMFontHandle font, GMwchar ch, const GMGlyphInfo& glyph)
+GMGlyphInfo& GMGlyphManagerPrivate::insertChar(const GMGlyphInfo& glyph)
 {
-	auto result = chars[font][fontSize].insert({ ch, glyph });
+	auto result = chars.insert({ glyph.key, glyph });
 	GM_ASSERT(result.second);
 	return (*(result.first)).second;
 }
 
-const GMGlyphInfo& GMGlyphManagerPrivate::createChar(GMwchar c, GMFontSizePt fontSize, GMFontHandle font)
+bool GMGlyphManagerPrivate::isResident(const GMGlyphInfo& glyph)
+{
+	if (glyph.sdf != sdf)
+		return false;
+
+	// 没有位图的字形（如空格）不占用图集
+	return glyph.page >= 0 || glyph.texWidth == 0 || glyph.texHeight == 0;
+}
+
+bool GMGlyphManagerPrivate::makeResident(GMGlyphInfo& glyph)
+{
+	if (isResident(glyph))
+	{
+		if (glyph.page >= 0)
+			atlas.touch(glyph.page);
+		return true;
+	}
+	return rasterize(glyph);
+}
+
+FT_Face GMGlyphManagerPrivate::loadGlyph(GMFontHandle font, GMwchar c, GMFontSizePt fontSize)
 {
-	static GMGlyphInfo errGlyph = { false };
-	FT_Glyph glyph;
 	FT_Error error;
 	FT_UInt charIndex;
 	GMFontMeta* f = getFont(font);
 	if (!f)
-		return errGlyph;
+		return nullptr;
 
 	FT_Face face = (FT_Face)f->face;
 	error = FT_Select_Charmap(face, FT_ENCODING_UNICODE);
@@ -118,64 +222,161 @@ const GMGlyphInfo& GMGlyphManagerPrivate::createChar(GMwchar c, GMFontSizePt fon
 
 	charIndex = FT_Get_Char_Index(face, c);
 	if (charIndex == 0)
-		return errGlyph;
+		return nullptr;
 
 	error = FT_Load_Glyph(face, charIndex, FT_LOAD_DEFAULT);
 	GM_ASSERT(error == FT_Err_Ok);
 
 	error = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
 	GM_ASSERT(error == FT_Err_Ok);
+	return face;
+}
 
-	error = FT_Get_Glyph(face->glyph, &glyph);
-	GM_ASSERT(error == FT_Err_Ok);
+bool GMGlyphManagerPrivate::rasterize(GMGlyphInfo& glyph)
+{
+	if (sdf)
+		return rasterizeSDF(glyph);
+
+	FT_Face face = loadGlyph(getKeyFont(glyph.key), getKeyChar(glyph.key), getKeyFontSize(glyph.key));
+	if (!face)
+		return false;
+
+	const FT_Bitmap& bitmap = face->glyph->bitmap;
+	glyph.valid = true;
+	glyph.sdf = false;
+	glyph.width = face->glyph->metrics.width >> 6;
+	glyph.height = face->glyph->metrics.height >> 6;
+	glyph.bearingX = face->glyph->metrics.horiBearingX >> 6;
+	glyph.bearingY = face->glyph->metrics.horiBearingY >> 6;
+	glyph.advance = face->glyph->metrics.horiAdvance >> 6;
+	glyph.texWidth = bitmap.width;
+	glyph.texHeight = bitmap.rows;
+	return storeBitmap(glyph, bitmap.buffer, bitmap.width, bitmap.rows, bitmap.pitch, 0);
+}
 
-	error = FT_Glyph_To_Bitmap(&glyph, FT_RENDER_MODE_NORMAL, 0, 1);
-	GM_ASSERT(error == FT_Err_Ok);
-	FT_BitmapGlyph bitmapGlyph = (FT_BitmapGlyph)glyph;
+bool GMGlyphManagerPrivate::rasterizeSDF(GMGlyphInfo& glyph)
+{
+	// 所有字号共用按照SDF_BASE_SIZE生成的距离场，以字号为0的键保存
+	GMGlyphKey baseKey = makeGlyphKey(getKeyFont(glyph.key), 0, getKeyChar(glyph.key));
+	GMGlyphInfo* base = nullptr;
+	auto iter = chars.find(baseKey);
+	if (iter == chars.end())
+	{
+		GMGlyphInfo info = { false };
+		info.key = baseKey;
+		info.page = -1;
+		if (!rasterizeDistanceField(info))
+			return false;
+		base = &insertChar(info);
+	}
+	else
+	{
+		base = &iter->second;
+		if (!isResident(*base) && !rasterizeDistanceField(*base))
+			return false;
+		if (base->page >= 0)
+			atlas.touch(base->page);
+	}
+
+	const GMfloat scale = static_cast<GMfloat>(getKeyFontSize(glyph.key)) / GMGlyphManager::SDF_BASE_SIZE;
+	glyph.valid = true;
+	glyph.sdf = true;
+	glyph.width = scaleMetric(base->width, scale);
+	glyph.height = scaleMetric(base->height, scale);
+	glyph.bearingX = scaleMetric(base->bearingX, scale);
+	glyph.bearingY = scaleMetric(base->bearingY, scale);
+	glyph.advance = scaleMetric(base->advance, scale);
+	glyph.x = base->x;
+	glyph.y = base->y;
+	glyph.texWidth = base->texWidth;
+	glyph.texHeight = base->texHeight;
+	glyph.page = base->page;
+
+	// 与距离场记录在同一页中，距离场被移出图集时，此字形也随之失效
+	if (glyph.page >= 0)
+		pageGlyphs[glyph.page].push_back(glyph.key);
+	return true;
+}
 
-	// 创建结构
-	if (cursor_u + bitmapGlyph->bitmap.width > GMGlyphManager::CANVAS_WIDTH)
+bool GMGlyphManagerPrivate::rasterizeDistanceField(GMGlyphInfo& glyph)
+{
+	FT_Face face = loadGlyph(getKeyFont(glyph.key), getKeyChar(glyph.key), GMGlyphManager::SDF_BASE_SIZE);
+	if (!face)
+		return false;
+
+	const FT_Bitmap& bitmap = face->glyph->bitmap;
+	glyph.valid = true;
+	glyph.sdf = true;
+	glyph.width = face->glyph->metrics.width >> 6;
+	glyph.height = face->glyph->metrics.height >> 6;
+	glyph.bearingX = face->glyph->metrics.horiBearingX >> 6;
+	glyph.bearingY = face->glyph->metrics.horiBearingY >> 6;
+	glyph.advance = face->glyph->metrics.horiAdvance >> 6;
+	glyph.texWidth = bitmap.width;
+	glyph.texHeight = bitmap.rows;
+	if (bitmap.width == 0 || bitmap.rows == 0)
 	{
-		cursor_v += maxHeight + 1;
-		maxHeight = 0;
-		cursor_u = 0;
-		if (cursor_v + bitmapGlyph->bitmap.rows > GMGlyphManager::CANVAS_HEIGHT)
-		{
-			gm_error(gm_dbg_wrap("no texture space for glyph!"));
-			GM_ASSERT(false);
-			// 释放资源
-			FT_Done_Glyph(glyph);
-			return errGlyph;
-		}
+		glyph.page = -1;
+		return true;
 	}
 
-	GMGlyphInfo glyphInfo = { 0 };
-	glyphInfo.valid = true;
-	glyphInfo.x = cursor_u;
-	glyphInfo.y = cursor_v;
-	glyphInfo.width = face->glyph->metrics.width >> 6;
-	glyphInfo.height = face->glyph->metrics.height >> 6;
-	glyphInfo.bearingX = face->glyph->metrics.horiBearingX >> 6;
-	glyphInfo.bearingY = face->glyph->metrics.horiBearingY >> 6;
-	glyphInfo.advance = face->glyph->metrics.horiAdvance >> 6;
-
-	if (maxHeight < glyphInfo.height)
-		maxHeight = glyphInfo.height;
-	cursor_u += bitmapGlyph->bitmap.width + 1;
-
-	// 创建纹理
-	P_D(pd);
-	GMGlyphBitmap bitmap = {
-		bitmapGlyph->bitmap.buffer,
-		bitmapGlyph->bitmap.width,
-		bitmapGlyph->bitmap.rows
-	};
-	pd->updateTexture(bitmap, glyphInfo);
+	// 距离场四周多出SDF_SPREAD个像素，字形在纹理中的位置不包括这部分
+	const GMint32 spread = GMGlyphManager::SDF_SPREAD;
+	const GMint32 width = bitmap.width + spread * 2;
+	generateDistanceField(bitmap.buffer, bitmap.width, bitmap.rows, bitmap.pitch, spread, distanceField);
+	return storeBitmap(glyph, distanceField.data(), width, bitmap.rows + spread * 2, width, spread);
+}
+
+bool GMGlyphManagerPrivate::storeBitmap(GMGlyphInfo& glyph, const GMbyte* pixels, GMint32 width, GMint32 height, GMint32 pitch, GMint32 border)
+{
+	glyph.page = -1;
+	if (width == 0 || height == 0)
+		return true;
+
+	GMGlyphAtlasRegion region;
+	GMint32 evictedPage = -1;
+	if (!atlas.allocate(width, height, region, evictedPage))
+	{
+		gm_error(gm_dbg_wrap("no texture space for glyph!"));
+		return false;
+	}
 
-	// 释放资源
-	FT_Done_Glyph(glyph);
+	if (evictedPage >= 0)
+		evictPage(evictedPage);
 
-	return insertChar(fontSize, font, c, glyphInfo);
+	atlas.write(region, pixels, pitch);
+	glyph.page = region.page;
+	glyph.x = region.x + border;
+	glyph.y = region.page * GMGlyphManager::PAGE_HEIGHT + region.y + border;
+	pageGlyphs[region.page].push_back(glyph.key);
+	return true;
+}
+
+void GMGlyphManagerPrivate::evictPage(GMint32 page)
+{
+	// 字形仍然保留在散列表中，下次使用时重新光栅化
+	for (auto key : pageGlyphs[page])
+	{
+		auto iter = chars.find(key);
+		if (iter != chars.end() && iter->second.page == page)
+			iter->second.page = -1;
+	}
+	pageGlyphs[page].clear();
+	++generation;
+}
+
+void GMGlyphManagerPrivate::evictAll()
+{
+	atlas.clear();
+	for (auto& glyphs : pageGlyphs)
+	{
+		glyphs.clear();
+	}
+	for (auto& c : chars)
+	{
+		c.second.page = -1;
+	}
+	++generation;
 }
 
 GMFontMeta* GMGlyphManagerPrivate::getFont(GMFontHandle handle)
@@ -191,6 +392,65 @@ const GMGlyphInfo& GMGlyphManager::getChar(GMwchar c, GMint32 fontSize, GMFontHa
 	return d->getCharInner(c, fontSize, font, 0);
 }
 
+bool GMGlyphManager::touchGlyph(const GMGlyphInfo& glyph)
+{
+	D(d);
+	if (!glyph.valid)
+		return false;
+
+	auto iter = d->chars.find(glyph.key);
+	if (iter == d->chars.end())
+		return false;
+	return d->makeResident(iter->second);
+}
+
+void GMGlyphManager::beginFrame()
+{
+	D(d);
+	d->atlas.nextFrame();
+}
+
+void GMGlyphManager::flush()
+{
+	D(d);
+	for (GMint32 page = 0; page < d->atlas.getPageCount(); ++page)
+	{
+		GMRect rc;
+		if (d->atlas.takeDirtyRect(page, rc))
+		{
+			GMGlyphBitmap bitmap = {
+				d->atlas.getPixels(page) + rc.y * PAGE_WIDTH + rc.x,
+				static_cast<GMuint32>(rc.width),
+				static_cast<GMuint32>(rc.height),
+				PAGE_WIDTH
+			};
+			updateTexture(bitmap, rc.x, page * PAGE_HEIGHT + rc.y);
+		}
+	}
+}
+
+GMuint32 GMGlyphManager::getGeneration() const
+{
+	D(d);
+	return d->generation;
+}
+
+void GMGlyphManager::setSDFEnabled(bool enabled)
+{
+	D(d);
+	if (d->sdf == enabled)
+		return;
+
+	d->sdf = enabled;
+	d->evictAll();
+}
+
+bool GMGlyphManager::isSDFEnabled() const
+{
+	D(d);
+	return d->sdf;
+}
+
 const IRenderContext* GMGlyphManager::getContext()
 {
 	D(d);
@@ -5,20 +5,28 @@
 #include <gmassets.h>
 
 BEGIN_NS
+// 字形缓存的键，由字体(16位)、字号(16位)和字符(32位)组成
+typedef uint64_t GMGlyphKey;
+
 struct GMGlyphInfo
 {
 	bool valid;
 	GMint32 x, y; // 字形在纹理中的位置
-	GMint32 width, height; // 字形在纹理中的大小
+	GMint32 width, height; // 字形的大小
 	GMint32 bearingX, bearingY;
 	GMint32 advance;
+	GMint32 texWidth, texHeight; // 字形在纹理中的大小，距离场字形的大小与之不同
+	GMint32 page; // 字形所在的图集页，-1表示字形已经被移出图集
+	bool sdf; // 是否为距离场字形
+	GMGlyphKey key;
 };
 
 struct GMGlyphBitmap
 {
-	GMbyte* buffer;
+	const GMbyte* buffer;
 	GMuint32 width;
 	GMuint32 rows;
+	GMuint32 pitch; // 每一行的字节数
 };
 
 GM_PRIVATE_CLASS(GMGlyphManager);
@@ -27,11 +35,21 @@ class GM_EXPORT GMGlyphManager : public GMObject
 	GM_DECLARE_PRIVATE(GMGlyphManager);
 
 public:
-	// 文字纹理的大小
+	// 文字纹理的大小。图集的每一页在纹理中纵向排列
+	enum
+	{
+		PAGE_WIDTH = 1024,
+		PAGE_HEIGHT = 1024,
+		MAX_PAGES = 4,
+		CANVAS_WIDTH = PAGE_WIDTH,
+		CANVAS_HEIGHT = PAGE_HEIGHT * MAX_PAGES,
+	};
+
+	// 距离场字形的参数
 	enum
 	{
-		CANVAS_WIDTH = 1024,
-		CANVAS_HEIGHT = 1024,
+		SDF_BASE_SIZE = 32, // 距离场字形只按照这个字号光栅化一次，其它字号共用
+		SDF_SPREAD = 4, // 距离场的最大距离，单位为像素
 	};
 
 public:
@@ -48,11 +66,42 @@ public:
 	GMFontHandle getDefaultFontCN();
 	GMFontHandle getDefaultFontEN();
 
+	//! 确保字形在图集中，并将其所在的页标记为在当前帧使用过。
+	/*!
+	  字形所在的页被清空后，字形会被重新光栅化，其在纹理中的位置将会改变。
+	  \param glyph 由getChar()获取的字形。
+	  \return 字形是否在图集中。
+	*/
+	bool touchGlyph(const GMGlyphInfo& glyph);
+
+	//! 开始新的一帧，用于选择需要清空的图集页。
+	void beginFrame();
+
+	//! 将这一帧新光栅化的字形上传到纹理，每一页的脏区域只上传一次。
+	void flush();
+
+	//! 获取图集的版本号。每当有图集页被清空，版本号都会增加，使用字形的对象需要重新计算顶点。
+	GMuint32 getGeneration() const;
+
+	//! 设置是否使用有向距离场(SDF)渲染字形。
+	/*!
+	  使用距离场时，每个字符只光栅化一次，所有的字号共用同一份距离场，缩放时边缘仍然清晰。
+	  切换后，图集会被清空。
+	*/
+	void setSDFEnabled(bool enabled);
+	bool isSDFEnabled() const;
+
 public:
 	virtual GMTextureAsset glyphTexture() = 0;
 
 private:
-	virtual void updateTexture(const GMGlyphBitmap& bitmapGlyph, const GMGlyphInfo& glyphInfo) = 0;
+	//! 更新纹理的一块区域。
+	/*!
+	  \param bitmap 需要上传的位图。
+	  \param x 区域在纹理中的横坐标。
+	  \param y 区域在纹理中的纵坐标。
+	*/
+	virtual void updateTexture(const GMGlyphBitmap& bitmap, GMint32 x, GMint32 y) = 0;
 
 protected:
 	const IRenderContext* getContext();
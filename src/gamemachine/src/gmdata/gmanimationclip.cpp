@@ -0,0 +1,288 @@
+﻿#include "stdafx.h"
+#include "gmanimationclip.h"
+
+BEGIN_NS
+
+namespace
+{
+	// 一条关键帧轨道在关键帧数组中的范围
+	struct Track
+	{
+		GMuint32 begin = 0;
+		GMuint32 count = 0;
+	};
+
+	struct Channel
+	{
+		Track positions;
+		Track rotations;
+		Track scalings;
+	};
+
+	GM_ALIGNED_STRUCT(ClipNode)
+	{
+		GMNode* node = nullptr;
+		GMsize_t parent = GMAnimationClip::InvalidIndex;
+		GMsize_t channel = GMAnimationClip::InvalidIndex;
+		GMMat4 transformToParent;
+	};
+
+	struct ModelBinding
+	{
+		Vector<GMsize_t> boneNodes; //!< 有骨骼的模型，每个骨骼对应的节点
+		AlignedVector<GMMat4> boneOffsets; //!< 每个骨骼的偏移矩阵
+		GMsize_t node = GMAnimationClip::InvalidIndex; //!< 没有骨骼的模型所在的节点
+		bool hasSkeleton = false;
+	};
+
+	template <typename T, typename Container>
+	Track appendTrack(const AlignedVector<GMNodeAnimationKeyframe<T>>& frames, Vector<GMDuration>& times, Container& values)
+	{
+		Track track;
+		track.begin = gm_sizet_to_uint(times.size());
+		track.count = gm_sizet_to_uint(frames.size());
+		for (const auto& frame : frames)
+		{
+			times.push_back(frame.time);
+			values.push_back(frame.value);
+		}
+		return track;
+	}
+
+	// 从游标开始向后查找第一个满足animationTime < times[i + 1]的i。时间倒退（循环播放）时从头查找。
+	GMuint32 findKey(const GMDuration* times, GMuint32 count, GMDuration animationTime, GMuint32& cursor)
+	{
+		GM_ASSERT(count > 1);
+		GMuint32 i = cursor;
+		if (i >= count - 1 || animationTime < times[i])
+			i = 0;
+
+		while (i < count - 2 && !(animationTime < times[i + 1]))
+		{
+			++i;
+		}
+		cursor = i;
+		return i;
+	}
+
+	template <typename T, typename Container>
+	T sample(const Track& track, const Vector<GMDuration>& times, const Container& values, GMDuration animationTime, GMuint32& cursor)
+	{
+		if (track.count == 0)
+			return T();
+
+		if (track.count == 1)
+			return values[track.begin];
+
+		GMuint32 i = track.begin + findKey(times.data() + track.begin, track.count, animationTime, cursor);
+		GMfloat factor = (animationTime - times[i]) / (times[i + 1] - times[i]);
+		return Lerp(values[i], values[i + 1], factor);
+	}
+}
+
+GM_PRIVATE_OBJECT_ALIGNED(GMAnimationClip)
+{
+	const GMNodeAnimation* animation = nullptr;
+	GMMat4 globalInverseTransform;
+	AlignedVector<ClipNode> nodes;
+	Vector<Channel> channels;
+	Vector<ModelBinding> models;
+
+	// 关键帧按照类型分别存放，时间和值分开存放
+	Vector<GMDuration> positionTimes;
+	AlignedVector<GMVec3> positionValues;
+	Vector<GMDuration> rotationTimes;
+	AlignedVector<GMQuat> rotationValues;
+	Vector<GMDuration> scalingTimes;
+	AlignedVector<GMVec3> scalingValues;
+
+	void flatten(GMNode* node, GMsize_t parent, const Map<GMString, GMsize_t>& channelMap);
+};
+
+void GMAnimationClipPrivate::flatten(GMNode* node, GMsize_t parent, const Map<GMString, GMsize_t>& channelMap)
+{
+	ClipNode clipNode;
+	clipNode.node = node;
+	clipNode.parent = parent;
+	clipNode.transformToParent = node->getTransformToParent();
+	auto iter = channelMap.find(node->getName());
+	if (iter != channelMap.end())
+		clipNode.channel = iter->second;
+
+	GMsize_t index = nodes.size();
+	nodes.push_back(clipNode);
+	for (auto child : node->getChildren())
+	{
+		flatten(child, index, channelMap);
+	}
+}
+
+GMAnimationClip::GMAnimationClip(GMScene* scene, const GMNodeAnimation* animation)
+{
+	GM_CREATE_DATA();
+	D(d);
+	GM_ASSERT(scene && scene->getRootNode() && animation);
+	d->animation = animation;
+
+	// 同名的通道以第一个为准，与按名字线性查找的结果一致
+	Map<GMString, GMsize_t> channelMap;
+	for (const auto& animationNode : animation->nodes)
+	{
+		Channel channel;
+		channel.positions = appendTrack(animationNode.positions, d->positionTimes, d->positionValues);
+		channel.rotations = appendTrack(animationNode.rotations, d->rotationTimes, d->rotationValues);
+		channel.scalings = appendTrack(animationNode.scalings, d->scalingTimes, d->scalingValues);
+		channelMap.insert({ animationNode.name, d->channels.size() });
+		d->channels.push_back(channel);
+	}
+
+	GMNode* root = scene->getRootNode();
+	d->globalInverseTransform = Inverse(root->getTransformToParent());
+	d->flatten(root, InvalidIndex, channelMap);
+
+	// 解析每个模型的骨骼和节点
+	for (auto& asset : scene->getModels())
+	{
+		GMModel* model = asset.getModel();
+		ModelBinding binding;
+		GMSkeleton* skeleton = model->getSkeleton();
+		if (skeleton)
+		{
+			binding.hasSkeleton = true;
+			for (const auto& bone : skeleton->getBones().getBones())
+			{
+				binding.boneNodes.push_back(findNode(bone.name));
+				binding.boneOffsets.push_back(bone.offsetMatrix);
+			}
+		}
+		else
+		{
+			for (auto node : model->getNodes())
+			{
+				for (GMsize_t i = 0; i < d->nodes.size(); ++i)
+				{
+					if (d->nodes[i].node == node)
+						binding.node = i;
+				}
+			}
+		}
+		d->models.push_back(std::move(binding));
+	}
+}
+
+GMAnimationClip::~GMAnimationClip()
+{
+
+}
+
+const GMNodeAnimation* GMAnimationClip::getAnimation() const GM_NOEXCEPT
+{
+	D(d);
+	return d->animation;
+}
+
+GMsize_t GMAnimationClip::getNodeCount() const GM_NOEXCEPT
+{
+	D(d);
+	return d->nodes.size();
+}
+
+GMsize_t GMAnimationClip::getModelCount() const GM_NOEXCEPT
+{
+	D(d);
+	return d->models.size();
+}
+
+GMsize_t GMAnimationClip::getCursorCount() const GM_NOEXCEPT
+{
+	D(d);
+	// 每个通道的位置、旋转、缩放各有一个游标
+	return d->channels.size() * 3;
+}
+
+GMsize_t GMAnimationClip::findNode(const GMString& name) const
+{
+	D(d);
+	GMsize_t result = InvalidIndex;
+	for (GMsize_t i = 0; i < d->nodes.size(); ++i)
+	{
+		if (d->nodes[i].node->getName() == name)
+			result = i;
+	}
+	return result;
+}
+
+GMDuration GMAnimationClip::getAnimationTime(GMDuration elapsed) const
+{
+	D(d);
+	GMfloat ticks = elapsed * d->animation->frameRate;
+	return Fmod(ticks, d->animation->duration);
+}
+
+void GMAnimationClip::evaluate(GMDuration animationTime, Vector<GMuint32>& cursors, AlignedVector<GMMat4>& globalTransforms) const
+{
+	D(d);
+	GM_ASSERT(cursors.size() == getCursorCount());
+	globalTransforms.resize(d->nodes.size());
+	for (GMsize_t i = 0; i < d->nodes.size(); ++i)
+	{
+		const ClipNode& node = d->nodes[i];
+		GMMat4 nodeTransformation;
+		if (node.channel != InvalidIndex)
+		{
+			const Channel& channel = d->channels[node.channel];
+			GMuint32* cursor = &cursors[node.channel * 3];
+			GMVec3 position = sample<GMVec3>(channel.positions, d->positionTimes, d->positionValues, animationTime, cursor[0]);
+			GMQuat rotation = sample<GMQuat>(channel.rotations, d->rotationTimes, d->rotationValues, animationTime, cursor[1]);
+			GMVec3 scaling = sample<GMVec3>(channel.scalings, d->scalingTimes, d->scalingValues, animationTime, cursor[2]);
+			nodeTransformation = Scale(scaling) * QuatToMatrix(rotation) * Translate(position);
+		}
+		else
+		{
+			nodeTransformation = node.transformToParent;
+		}
+
+		// 父节点总是在子节点之前计算
+		globalTransforms[i] = (node.parent == InvalidIndex) ? nodeTransformation : nodeTransformation * globalTransforms[node.parent];
+	}
+}
+
+void GMAnimationClip::computeModelTransforms(GMsize_t modelIndex, const AlignedVector<GMMat4>& globalTransforms, AlignedVector<GMMat4>& transforms) const
+{
+	D(d);
+	GM_ASSERT(modelIndex < d->models.size());
+	const ModelBinding& binding = d->models[modelIndex];
+	if (binding.hasSkeleton)
+	{
+		// 在骨骼动画中，transforms表示每个骨骼的变换
+		GMsize_t boneCount = binding.boneNodes.size();
+		transforms.resize(boneCount);
+		for (GMsize_t i = 0; i < boneCount; ++i)
+		{
+			GMsize_t node = binding.boneNodes[i];
+			if (node != InvalidIndex)
+				transforms[i] = binding.boneOffsets[i] * globalTransforms[node] * d->globalInverseTransform;
+			else
+				transforms[i] = Zero<GMMat4>();
+		}
+	}
+	else
+	{
+		// 没有骨骼的模型，变换为其所在节点的全局变换
+		transforms.clear();
+		if (binding.node != InvalidIndex)
+			transforms.push_back(globalTransforms[binding.node]);
+	}
+}
+
+void GMAnimationClip::applyNodeTransforms(const AlignedVector<GMMat4>& globalTransforms) const
+{
+	D(d);
+	GM_ASSERT(globalTransforms.size() == d->nodes.size());
+	for (GMsize_t i = 0; i < d->nodes.size(); ++i)
+	{
+		d->nodes[i].node->setGlobalTransform(globalTransforms[i]);
+	}
+}
+
+END_NS
@@ -0,0 +1,87 @@
+﻿#ifndef __GMANIMATIONCLIP_H__
+#define __GMANIMATIONCLIP_H__
+#include <gmcommon.h>
+#include "gmmodel.h"
+BEGIN_NS
+
+GM_PRIVATE_CLASS(GMAnimationClip);
+//! 预先编译的动画片段。
+/*!
+  动画片段由一个场景和它的一个节点动画编译而成。编译时，节点树被展开为数组，父节点总是在子节点之前；
+  每个节点对应的动画通道，以及每个模型的骨骼对应的节点，都在编译时通过名字确定，计算时不再需要比较字符串。<BR>
+  关键帧的时间和值分别存放在连续的数组中。查找关键帧时，从上一次的位置（游标）开始向后查找，游标由每个对象各自保存，
+  因此多个对象可以同时使用同一个动画片段进行计算。
+*/
+class GMAnimationClip
+{
+	GM_DECLARE_PRIVATE(GMAnimationClip)
+	GM_DISABLE_COPY_ASSIGN(GMAnimationClip)
+
+public:
+	enum
+	{
+		InvalidIndex = -1,
+	};
+
+	//! 编译一个动画片段。
+	/*!
+	  \param scene 动画所在的场景，必须有根节点。
+	  \param animation 节点动画。
+	*/
+	GMAnimationClip(GMScene* scene, const GMNodeAnimation* animation);
+	~GMAnimationClip();
+
+public:
+	//! 获取编译时使用的节点动画。
+	const GMNodeAnimation* getAnimation() const GM_NOEXCEPT;
+
+	//! 获取节点的数目。
+	GMsize_t getNodeCount() const GM_NOEXCEPT;
+
+	//! 获取编译时场景中模型的数目。
+	GMsize_t getModelCount() const GM_NOEXCEPT;
+
+	//! 获取每个对象需要保存的游标的数目。
+	GMsize_t getCursorCount() const GM_NOEXCEPT;
+
+	//! 根据节点的名字查找节点的索引。
+	/*!
+	  \param name 节点的名字。
+	  \return 节点的索引。如果有多个节点同名，返回最后一个。如果没有找到，返回InvalidIndex。
+	*/
+	GMsize_t findNode(const GMString& name) const;
+
+	//! 将对象播放的时间转换为动画的时间。
+	/*!
+	  \param elapsed 对象播放的时间，单位是秒。
+	  \return 动画中的时间，单位是帧（tick），循环播放。
+	*/
+	GMDuration getAnimationTime(GMDuration elapsed) const;
+
+	//! 计算所有节点的全局变换。
+	/*!
+	  \param animationTime 动画中的时间。
+	  \param cursors 关键帧游标，大小为getCursorCount()。第一次计算前应该全部置为0。
+	  \param globalTransforms 输出的每个节点的全局变换，大小为getNodeCount()。
+	*/
+	void evaluate(GMDuration animationTime, Vector<GMuint32>& cursors, AlignedVector<GMMat4>& globalTransforms) const;
+
+	//! 根据节点的全局变换，计算一个模型的变换。
+	/*!
+	  对于有骨骼的模型，结果为每个骨骼的最终变换；对于没有骨骼的模型，结果只有一个元素，为模型所在节点的全局变换。
+	  \param modelIndex 模型在场景中的索引。
+	  \param globalTransforms 由evaluate()得到的节点的全局变换。
+	  \param transforms 输出的变换。
+	*/
+	void computeModelTransforms(GMsize_t modelIndex, const AlignedVector<GMMat4>& globalTransforms, AlignedVector<GMMat4>& transforms) const;
+
+	//! 将节点的全局变换写回到场景中的节点。
+	/*!
+	  场景中的节点被共享同一个场景的所有对象共享，因此此方法不应该在多个线程中同时调用。
+	  \param globalTransforms 由evaluate()得到的节点的全局变换。
+	*/
+	void applyNodeTransforms(const AlignedVector<GMMat4>& globalTransforms) const;
+};
+
+END_NS
+#endif
@@ -1,5 +1,6 @@
 ﻿#include "stdafx.h"
 #include "gmmodel.h"
+#include "gmanimationclip.h"
 #include <linearmath.h>
 #include <algorithm>
 #include <iterator>
@@ -23,6 +24,7 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMScene)
 	GMOwnedPtr<GMSkeletalAnimations> animations;
 	GMOwnedPtr<GMNode> root;
 	GMAnimationType animationType = GMAnimationType::NoAnimation;
+	Vector<GMOwnedPtr<GMAnimationClip>> clips;
 };
 
 GM_DEFINE_PROPERTY(GMScene, Vector<GMAsset>, Models, models)
@@ -42,6 +44,7 @@ void GMScene::addModelAsset(GMModelAsset model)
 	D(d);
 	GM_ASSERT(model.getModel());
 	d->models.push_back(model);
+	d->clips.clear();
 }
 
 void GMScene::swap(GMScene* scene)
@@ -51,6 +54,8 @@ void GMScene::swap(GMScene* scene)
 	using std::swap;
 	d->models.swap(d_rhs->models);
 	d->root.swap(d_rhs->root);
+	d->clips.clear();
+	d_rhs->clips.clear();
 }
 
 bool GMScene::hasAnimation() GM_NOEXCEPT
@@ -75,6 +80,7 @@ void GMScene::setRootNode(GMNode* root)
 {
 	D(d);
 	d->root.reset(root);
+	d->clips.clear();
 }
 
 void GMScene::setAnimations(AUTORELEASE GMSkeletalAnimations* animations)
@@ -82,6 +88,26 @@ void GMScene::setAnimations(AUTORELEASE GMSkeletalAnimations* animations)
 	D(d);
 	GM_ASSERT(d->animationType != GMAnimationType::NoAnimation);
 	d->animations.reset(animations);
+	d->clips.clear();
+}
+
+const GMAnimationClip* GMScene::getAnimationClip(GMsize_t index)
+{
+	D(d);
+	if (!d->animations || !d->root || index >= d->animations->getAnimationCount())
+		return nullptr;
+
+	if (d->clips.size() != d->animations->getAnimationCount())
+	{
+		d->clips.clear();
+		d->clips.resize(d->animations->getAnimationCount());
+	}
+
+	// 模型列表可能被直接修改，模型数目改变时重新编译
+	GMOwnedPtr<GMAnimationClip>& clip = d->clips[index];
+	if (!clip || clip->getModelCount() != d->models.size())
+		clip.reset(new GMAnimationClip(this, d->animations->getAnimation(index)));
+	return clip.get();
 }
 
 GMSkeletalAnimations* GMScene::getAnimations() GM_NOEXCEPT
@@ -96,6 +122,326 @@ bool GMScene::isEmpty() GM_NOEXCEPT
 	return d->models.empty();
 }
 
+namespace
+{
+	GMuint32 getDimension(GMVertexDataType type)
+	{
+		static const GMuint32 s_dimensions[] = {
+			GMVertex::PositionDimension,
+			GMVertex::NormalDimension,
+			GMVertex::TexcoordDimension,
+			GMVertex::TangentDimension,
+			GMVertex::BitangentDimension,
+			GMVertex::LightmapDimension,
+			GMVertex::ColorDimension,
+			GMVertex::BoneIDsDimension,
+			GMVertex::WeightsDimension,
+		};
+		GM_STATIC_ASSERT(GM_array_size(s_dimensions) == static_cast<GMsize_t>(GMVertexDataType::EndOfVertexDataType), "Dimensions mismatch.");
+		return s_dimensions[static_cast<GMsize_t>(type)];
+	}
+
+	bool isFormatSupported(GMVertexDataType type, GMVertexAttributeFormat format)
+	{
+		switch (format)
+		{
+		case GMVertexAttributeFormat::Unused:
+			return type != GMVertexDataType::Position;
+		case GMVertexAttributeFormat::Float:
+			return true;
+		case GMVertexAttributeFormat::HalfFloat:
+			return type != GMVertexDataType::BoneIds;
+		case GMVertexAttributeFormat::Octahedral:
+			return type == GMVertexDataType::Normal || type == GMVertexDataType::Tangent || type == GMVertexDataType::Bitangent;
+		case GMVertexAttributeFormat::UNorm8:
+			return type == GMVertexDataType::Color;
+		case GMVertexAttributeFormat::UInt8:
+			return type == GMVertexDataType::BoneIds;
+		case GMVertexAttributeFormat::UNorm16:
+			return type == GMVertexDataType::Weights;
+		default:
+			return false;
+		}
+	}
+
+	GMuint32 getComponentSize(GMVertexAttributeFormat format)
+	{
+		switch (format)
+		{
+		case GMVertexAttributeFormat::Float:
+			return 4;
+		case GMVertexAttributeFormat::HalfFloat:
+		case GMVertexAttributeFormat::Octahedral:
+		case GMVertexAttributeFormat::UNorm16:
+			return 2;
+		case GMVertexAttributeFormat::UNorm8:
+		case GMVertexAttributeFormat::UInt8:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	GMushort floatToHalf(GMfloat value)
+	{
+		GMuint32 bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+		GMuint32 sign = (bits >> 16) & 0x8000;
+		GMuint32 rawExponent = (bits >> 23) & 0xFF;
+		GMint32 exponent = static_cast<GMint32>(rawExponent) - 127 + 15;
+		GMuint32 mantissa = bits & 0x7FFFFF;
+
+		// 无穷大和NaN
+		if (rawExponent == 0xFF)
+			return static_cast<GMushort>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+		// 超出范围，变为无穷大
+		if (exponent >= 0x1F)
+			return static_cast<GMushort>(sign | 0x7C00);
+
+		// 非规格化数
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+				return static_cast<GMushort>(sign);
+
+			mantissa |= 0x800000;
+			GMuint32 shift = static_cast<GMuint32>(14 - exponent);
+			GMuint32 half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1)
+				++half;
+			return static_cast<GMushort>(sign | half);
+		}
+
+		// 舍入时的进位会正确地进入指数
+		GMuint32 half = sign | (static_cast<GMuint32>(exponent) << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000)
+			++half;
+		return static_cast<GMushort>(half);
+	}
+
+	template <typename T>
+	T toNormalized(GMfloat value, GMfloat minValue, GMfloat scale)
+	{
+		value = Clamp(value, minValue, 1.f);
+		return static_cast<T>(Round(value * scale));
+	}
+
+	// 将单位向量投影到八面体上，再将下半部分翻折到上半部分，得到[-1, 1]范围内的二维坐标
+	void encodeOctahedral(const GMfloat* v, GMshort* out)
+	{
+		GMfloat l1 = Fabs(v[0]) + Fabs(v[1]) + Fabs(v[2]);
+		GMfloat x = 0, y = 0;
+		if (l1 > 0)
+		{
+			x = v[0] / l1;
+			y = v[1] / l1;
+			if (v[2] < 0)
+			{
+				GMfloat ox = x;
+				x = (1 - Fabs(y)) * (ox >= 0 ? 1 : -1);
+				y = (1 - Fabs(ox)) * (y >= 0 ? 1 : -1);
+			}
+		}
+		out[0] = toNormalized<GMshort>(x, -1.f, 32767.f);
+		out[1] = toNormalized<GMshort>(y, -1.f, 32767.f);
+	}
+}
+
+GMVertexLayout::GMVertexLayout()
+{
+	m_formats.fill(GMVertexAttributeFormat::Float);
+	updateOffsets();
+	GM_ASSERT(m_stride == sizeof(GMVertex));
+}
+
+GMVertexLayout GMVertexLayout::compactLayout()
+{
+	GMVertexLayout layout;
+	layout.set(GMVertexDataType::Normal, GMVertexAttributeFormat::Octahedral)
+		.set(GMVertexDataType::Texcoord, GMVertexAttributeFormat::HalfFloat)
+		.set(GMVertexDataType::Tangent, GMVertexAttributeFormat::Octahedral)
+		.set(GMVertexDataType::Bitangent, GMVertexAttributeFormat::Octahedral)
+		.set(GMVertexDataType::Lightmap, GMVertexAttributeFormat::HalfFloat)
+		.set(GMVertexDataType::Color, GMVertexAttributeFormat::UNorm8)
+		.set(GMVertexDataType::BoneIds, GMVertexAttributeFormat::UInt8)
+		.set(GMVertexDataType::Weights, GMVertexAttributeFormat::UNorm16);
+	return layout;
+}
+
+GMVertexLayout& GMVertexLayout::set(GMVertexDataType type, GMVertexAttributeFormat format)
+{
+	if (!isFormatSupported(type, format))
+	{
+		gm_warning(gm_dbg_wrap("Vertex attribute {0} does not support format {1}."), GMString(static_cast<GMint32>(type)), GMString(static_cast<GMint32>(format)));
+		return *this;
+	}
+
+	m_formats[static_cast<GMsize_t>(type)] = format;
+	updateOffsets();
+	return *this;
+}
+
+GMVertexAttributeFormat GMVertexLayout::getFormat(GMVertexDataType type) const GM_NOEXCEPT
+{
+	return m_formats[static_cast<GMsize_t>(type)];
+}
+
+GMuint32 GMVertexLayout::getComponentCount(GMVertexDataType type) const GM_NOEXCEPT
+{
+	switch (getFormat(type))
+	{
+	case GMVertexAttributeFormat::Unused:
+		return 0;
+	case GMVertexAttributeFormat::Octahedral:
+		return 2;
+	case GMVertexAttributeFormat::HalfFloat:
+		// 补齐到4字节
+		return getDimension(type) == 3 ? 4 : getDimension(type);
+	default:
+		return getDimension(type);
+	}
+}
+
+GMuint32 GMVertexLayout::getOffset(GMVertexDataType type) const GM_NOEXCEPT
+{
+	return m_offsets[static_cast<GMsize_t>(type)];
+}
+
+GMuint32 GMVertexLayout::getStride() const GM_NOEXCEPT
+{
+	return m_stride;
+}
+
+bool GMVertexLayout::isDefault() const GM_NOEXCEPT
+{
+	for (auto format : m_formats)
+	{
+		if (format != GMVertexAttributeFormat::Float)
+			return false;
+	}
+	return true;
+}
+
+GMint32 GMVertexLayout::getOctahedralMask() const GM_NOEXCEPT
+{
+	GMint32 mask = 0;
+	if (getFormat(GMVertexDataType::Normal) == GMVertexAttributeFormat::Octahedral)
+		mask |= 1;
+	if (getFormat(GMVertexDataType::Tangent) == GMVertexAttributeFormat::Octahedral)
+		mask |= 2;
+	if (getFormat(GMVertexDataType::Bitangent) == GMVertexAttributeFormat::Octahedral)
+		mask |= 4;
+	return mask;
+}
+
+void GMVertexLayout::pack(const GMVertex& vertex, GMbyte* out) const
+{
+	if (isDefault())
+	{
+		memcpy(out, &vertex, sizeof(GMVertex));
+		return;
+	}
+
+	memset(out, 0, m_stride);
+	const GMfloat* attributes[] = {
+		vertex.positions.data(),
+		vertex.normals.data(),
+		vertex.texcoords.data(),
+		vertex.tangents.data(),
+		vertex.bitangents.data(),
+		vertex.lightmaps.data(),
+		vertex.color.data(),
+		nullptr, // 骨骼索引是整数，单独处理
+		vertex.weights.data(),
+	};
+
+	GM_FOREACH_ENUM_CLASS(type, GMVertexDataType::Position, GMVertexDataType::EndOfVertexDataType)
+	{
+		GMsize_t i = static_cast<GMsize_t>(type);
+		GMbyte* dst = out + m_offsets[i];
+		GMuint32 dimension = getDimension(type);
+		const GMfloat* src = attributes[i];
+		switch (m_formats[i])
+		{
+		case GMVertexAttributeFormat::Unused:
+			break;
+		case GMVertexAttributeFormat::Float:
+			if (type == GMVertexDataType::BoneIds)
+				memcpy(dst, vertex.boneIds.data(), sizeof(vertex.boneIds));
+			else
+				memcpy(dst, src, sizeof(GMfloat) * dimension);
+			break;
+		case GMVertexAttributeFormat::HalfFloat:
+		{
+			GMushort values[4] = { 0 };
+			for (GMuint32 c = 0; c < dimension; ++c)
+			{
+				values[c] = floatToHalf(src[c]);
+			}
+			memcpy(dst, values, sizeof(GMushort) * getComponentCount(type));
+			break;
+		}
+		case GMVertexAttributeFormat::Octahedral:
+		{
+			GMshort values[2];
+			encodeOctahedral(src, values);
+			memcpy(dst, values, sizeof(values));
+			break;
+		}
+		case GMVertexAttributeFormat::UNorm8:
+			for (GMuint32 c = 0; c < dimension; ++c)
+			{
+				dst[c] = toNormalized<GMbyte>(src[c], 0.f, 255.f);
+			}
+			break;
+		case GMVertexAttributeFormat::UInt8:
+			for (GMuint32 c = 0; c < dimension; ++c)
+			{
+				GM_ASSERT(vertex.boneIds[c] >= 0 && vertex.boneIds[c] < 256);
+				dst[c] = static_cast<GMbyte>(vertex.boneIds[c]);
+			}
+			break;
+		case GMVertexAttributeFormat::UNorm16:
+		{
+			GMushort values[4];
+			for (GMuint32 c = 0; c < dimension; ++c)
+			{
+				values[c] = toNormalized<GMushort>(src[c], 0.f, 65535.f);
+			}
+			memcpy(dst, values, sizeof(GMushort) * dimension);
+			break;
+		}
+		default:
+			GM_ASSERT(false);
+			break;
+		}
+	}
+}
+
+bool GMVertexLayout::operator==(const GMVertexLayout& rhs) const GM_NOEXCEPT
+{
+	return m_formats == rhs.m_formats;
+}
+
+bool GMVertexLayout::operator!=(const GMVertexLayout& rhs) const GM_NOEXCEPT
+{
+	return !(*this == rhs);
+}
+
+void GMVertexLayout::updateOffsets()
+{
+	GMuint32 offset = 0;
+	GM_FOREACH_ENUM_CLASS(type, GMVertexDataType::Position, GMVertexDataType::EndOfVertexDataType)
+	{
+		GMsize_t i = static_cast<GMsize_t>(type);
+		m_offsets[i] = offset;
+		GMuint32 size = getComponentCount(type) * getComponentSize(m_formats[i]);
+		offset += (size + 3) & ~3u;
+	}
+	m_stride = offset;
+}
+
 GM_PRIVATE_OBJECT_UNALIGNED(GMModelDataProxy)
 {
 	const IRenderContext* context = nullptr;
@@ -161,6 +507,29 @@ void GMModelDataProxy::packVertices(Vector<GMVertex>& vertices)
 	}
 }
 
+void GMModelDataProxy::packVertices(const GMVertexLayout& layout, Vector<GMbyte>& vertices)
+{
+	GMModel* model = getModel();
+	GMParts& parts = model->getParts();
+	GMsize_t count = 0;
+	for (auto& part : parts)
+	{
+		count += part->vertices().size();
+	}
+
+	GMuint32 stride = layout.getStride();
+	vertices.resize(count * stride);
+	GMbyte* ptr = vertices.data();
+	for (auto& part : parts)
+	{
+		for (auto& vertex : part->vertices())
+		{
+			layout.pack(vertex, ptr);
+			ptr += stride;
+		}
+	}
+}
+
 void GMModelDataProxy::packIndices(Vector<GMuint32>& indices)
 {
 	GMModel* model = getModel();
@@ -193,6 +562,7 @@ void GMModelDataProxy::prepareParentModel()
 		d->model->setModelBuffer(parent->getModelBuffer());
 		d->model->setPrimitiveTopologyMode(parent->getPrimitiveTopologyMode());
 		d->model->setVerticesCount(parent->getVerticesCount());
+		d->model->setVertexLayout(parent->getVertexLayout());
 	}
 }
 
@@ -214,6 +584,8 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMModel)
 	Vector<GMNode*> nodes;
 	// 骨骼变换矩阵，对于无骨骼的model，使用首个元素表示变换。
 	AlignedVector<GMMat4> boneTransformations;
+	GMVertexLayout vertexLayout;
+	GMSkinningMode skinningMode = GMSkinningMode::Linear;
 };
 
 GM_DEFINE_PROPERTY(GMModel, GMTopologyMode, PrimitiveTopologyMode, mode);
@@ -224,6 +596,8 @@ GM_DEFINE_PROPERTY(GMModel, GMModelDrawMode, DrawMode, drawMode);
 GM_DEFINE_PROPERTY(GMModel, GMRenderTechniqueID, TechniqueId, techniqueId);
 GM_DEFINE_PROPERTY(GMModel, Vector<GMNode*>, Nodes, nodes)
 GM_DEFINE_PROPERTY(GMModel, AlignedVector<GMMat4>, BoneTransformations, boneTransformations)
+GM_DEFINE_PROPERTY(GMModel, GMVertexLayout, VertexLayout, vertexLayout)
+GM_DEFINE_PROPERTY(GMModel, GMSkinningMode, SkinningMode, skinningMode)
 
 GMModel::GMModel()
 {
@@ -251,6 +625,8 @@ GMModel::GMModel(GMModelAsset parentAsset)
 	setDrawMode(parentModel->getDrawMode());
 	setPrimitiveTopologyMode(parentModel->getPrimitiveTopologyMode());
 	setVerticesCount(parentModel->getVerticesCount());
+	setVertexLayout(parentModel->getVertexLayout());
+	setSkinningMode(parentModel->getSkinningMode());
 
 	doNotTransferAnymore();
 }
@@ -367,8 +743,10 @@ GMModelBuffer::GMModelBuffer()
 	D(d);
 	d->ref = 1;
 	// 创建一个空的proxy，用于dispose
-	// 它本身不会包含任何数据
-	GM.getFactory()->createModelDataProxy(nullptr, nullptr, &d->modelDataProxy);
+	// 它本身不会包含任何数据。没有设置工厂时（例如只在CPU端使用模型），不需要proxy
+	IFactory* factory = GM.getFactory();
+	if (factory)
+		factory->createModelDataProxy(nullptr, nullptr, &d->modelDataProxy);
 }
 
 GMModelBuffer::~GMModelBuffer()
@@ -380,7 +758,8 @@ GMModelBuffer::~GMModelBuffer()
 void GMModelBuffer::dispose()
 {
 	D(d);
-	d->modelDataProxy->dispose(this);
+	if (d->modelDataProxy)
+		d->modelDataProxy->dispose(this);
 }
 
 void GMModelBuffer::addRef()
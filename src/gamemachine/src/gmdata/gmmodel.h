@@ -13,6 +13,7 @@ struct ID3D11Buffer;
 BEGIN_NS
 
 class GMAnimationEvaluator;
+class GMAnimationClip;
 struct GMSceneAnimatorNode;
 struct GMNodeAnimation;
 
@@ -167,6 +168,7 @@ enum class GMModelBufferType
 };
 
 class GMModelBuffer;
+class GMVertexLayout;
 GM_PRIVATE_CLASS(GMModelDataProxy);
 class GM_EXPORT GMModelDataProxy : public GMObject, public IQueriable
 {
@@ -197,6 +199,7 @@ protected:
 protected:
 	void prepareTangentSpace();
 	void packVertices(Vector<GMVertex>& vertices);
+	void packVertices(const GMVertexLayout& layout, Vector<GMbyte>& vertices);
 	void packIndices(Vector<GMuint32>& indices);
 	void prepareParentModel();
 };
@@ -277,6 +280,104 @@ enum class GMVertexDataType
 
 #define gmVertexIndex(i) ((GMuint32)i)
 
+//! 顶点属性在顶点缓存中的存储格式。
+enum class GMVertexAttributeFormat
+{
+	Unused, //!< 顶点缓存中不包含此属性，着色器读到的值为(0, 0, 0, 1)。
+	Float, //!< 32位浮点数。
+	HalfFloat, //!< 16位浮点数，适用于纹理坐标、法线等精度要求不高的属性。
+	Octahedral, //!< 八面体编码的单位向量，占用2个16位有符号归一化整数，仅适用于法线、切线和副切线。
+	UNorm8, //!< 8位无符号归一化整数，仅适用于顶点颜色。
+	UInt8, //!< 8位无符号整数，仅适用于骨骼索引。
+	UNorm16, //!< 16位无符号归一化整数，仅适用于骨骼权重。
+};
+
+//! 骨骼动画的蒙皮方式。
+enum class GMSkinningMode
+{
+	Linear, //!< 线性混合蒙皮，每个骨骼占用一个4x4矩阵。
+	DualQuaternion, //!< 对偶四元数蒙皮，每个骨骼只占用线性混合蒙皮一半的空间，关节弯曲时不会塌陷。骨骼变换只能包含旋转和平移。
+};
+
+//! 描述顶点缓存中每个顶点的布局。
+/*!
+  默认的布局中，所有属性都以32位浮点数（骨骼索引为32位整数）存储，与GMVertex的内存布局一致。<BR>
+  对于不需要某些属性的模型，或者精度要求不高的属性，可以选择更紧凑的格式，以减少显存占用和顶点读取的带宽。
+  每个属性在顶点中的偏移按照4字节对齐。<BR>
+  需要通过GMModelDataProxy::getBuffer()直接修改顶点缓存的模型，必须使用默认的布局。<BR>
+  目前只有OpenGL使用此布局，DirectX11仍然上传完整的GMVertex。
+*/
+class GM_EXPORT GMVertexLayout
+{
+public:
+	//! 构造一个默认的顶点布局。
+	GMVertexLayout();
+
+	//! 获取一个紧凑的顶点布局。
+	/*!
+	  位置使用32位浮点数，法线、切线、副切线使用八面体编码，纹理坐标使用16位浮点数，
+	  顶点颜色使用8位归一化整数，骨骼索引使用8位整数，骨骼权重使用16位归一化整数，每个顶点占用48字节。
+	  \return 紧凑的顶点布局。
+	*/
+	static GMVertexLayout compactLayout();
+
+public:
+	//! 设置某个顶点属性的存储格式。
+	/*!
+	  如果格式不适用于此属性，将会被忽略。
+	  \param type 顶点属性。
+	  \param format 存储格式。
+	  \return 此布局的引用，以便链式调用。
+	*/
+	GMVertexLayout& set(GMVertexDataType type, GMVertexAttributeFormat format);
+
+	//! 获取某个顶点属性的存储格式。
+	GMVertexAttributeFormat getFormat(GMVertexDataType type) const GM_NOEXCEPT;
+
+	//! 获取某个顶点属性在顶点缓存中的分量数。
+	/*!
+	  八面体编码的属性有2个分量，16位浮点数的三维属性会补齐为4个分量。
+	  \param type 顶点属性。
+	  \return 分量数。如果布局中不包含此属性，返回0。
+	*/
+	GMuint32 getComponentCount(GMVertexDataType type) const GM_NOEXCEPT;
+
+	//! 获取某个顶点属性在一个顶点中的字节偏移。
+	GMuint32 getOffset(GMVertexDataType type) const GM_NOEXCEPT;
+
+	//! 获取一个顶点占用的字节数。
+	GMuint32 getStride() const GM_NOEXCEPT;
+
+	//! 判断此布局是否为默认的布局。
+	bool isDefault() const GM_NOEXCEPT;
+
+	//! 获取使用八面体编码的属性的掩码，法线、切线、副切线分别对应第0、1、2位。
+	GMint32 getOctahedralMask() const GM_NOEXCEPT;
+
+	//! 按照此布局编码一个顶点。
+	/*!
+	  \param vertex 需要编码的顶点。
+	  \param out 输出的缓存，至少能容纳getStride()个字节。
+	*/
+	void pack(const GMVertex& vertex, GMbyte* out) const;
+
+	bool operator==(const GMVertexLayout& rhs) const GM_NOEXCEPT;
+	bool operator!=(const GMVertexLayout& rhs) const GM_NOEXCEPT;
+
+private:
+	void updateOffsets();
+
+private:
+	enum
+	{
+		AttributeCount = static_cast<GMint32>(GMVertexDataType::EndOfVertexDataType),
+	};
+
+	Array<GMVertexAttributeFormat, AttributeCount> m_formats;
+	Array<GMuint32, AttributeCount> m_offsets;
+	GMuint32 m_stride;
+};
+
 GM_PRIVATE_CLASS(GMModel);
 class GM_EXPORT GMModel : public IDestroyObject
 {
@@ -299,6 +400,8 @@ public:
 	GM_DECLARE_PROPERTY(GMRenderTechniqueID, TechniqueId);
 	GM_DECLARE_PROPERTY(Vector<GMNode*>, Nodes)
 	GM_DECLARE_PROPERTY(AlignedVector<GMMat4>, BoneTransformations)
+	GM_DECLARE_PROPERTY(GMVertexLayout, VertexLayout)
+	GM_DECLARE_PROPERTY(GMSkinningMode, SkinningMode)
 
 public:
 	void setModelDataProxy(AUTORELEASE GMModelDataProxy* modelDataProxy);
@@ -350,11 +453,6 @@ class GM_EXPORT GMScene : public GMObject
 	GM_DECLARE_PROPERTY(GMAnimationType, AnimationType)
 
 public:
-	enum
-	{
-		MaxBoneCount = 128,
-	};
-
 	static GMSceneAsset createSceneFromSingleModel(GMModelAsset modelAsset);
 
 public:
@@ -369,6 +467,15 @@ public:
 	bool hasAnimation() GM_NOEXCEPT;
 	GMNode* getRootNode() GM_NOEXCEPT;
 
+	//! 获取一个动画对应的预先编译的动画片段。
+	/*!
+	  动画片段在第一次获取时编译，之后被所有使用此场景的对象共享。场景的模型、根节点或者动画改变时，动画片段会被重新编译。<BR>
+	  此方法不是线程安全的。
+	  \param index 动画的索引。
+	  \return 动画片段。如果场景没有动画或者根节点，返回nullptr。
+	*/
+	const GMAnimationClip* getAnimationClip(GMsize_t index);
+
 public:
 	GMModel* operator[](GMsize_t i);
 };
@@ -295,7 +295,6 @@ void GMModelReader_MD5Mesh::buildModel(const GMModelLoadSettings& settings, GMMo
 	if (!models)
 		return;
 	
-	static GMint32 numberOfProcessors = GM.getRunningStates().systemInfo.numberOfProcessors;
 	// 临时结构，用于缓存顶点、法线
 	struct Vertex
 	{
@@ -330,11 +329,10 @@ void GMModelReader_MD5Mesh::buildModel(const GMModelLoadSettings& settings, GMMo
 
 		AlignedVector<Vertex> vertices;
 		vertices.resize(mesh.vertices.size());
-		GMAsync::blockedAsync(
-			GMAsync::Async,
-			numberOfProcessors,
+		GMAsync::parallelFor(
 			mesh.vertices.begin(),
 			mesh.vertices.end(),
+			0,
 			[&vertices, &mesh, &d](auto begin, auto end) {
 				GMint32 index = begin - mesh.vertices.begin();
 				for (auto iter = begin; iter != end; ++iter)
@@ -357,33 +355,24 @@ void GMModelReader_MD5Mesh::buildModel(const GMModelLoadSettings& settings, GMMo
 			}
 		);
 
-		GMAsync::blockedAsync(
-			GMAsync::Async,
-			numberOfProcessors,
-			mesh.triangleIndices.begin(),
-			mesh.triangleIndices.end(),
-			[&vertices](auto begin, auto end) {
-				for (auto iter = begin; iter != end; ++iter)
-				{
-					const auto& triIdx = *iter;
-					GMVec3 v0 = vertices[triIdx[0]].position;
-					GMVec3 v1 = vertices[triIdx[1]].position;
-					GMVec3 v2 = vertices[triIdx[2]].position;
-					GMVec3 normal = Cross(v2 - v0, v1 - v0);
-
-					// 计算法线
-					vertices[triIdx[0]].normal += normal;
-					vertices[triIdx[1]].normal += normal;
-					vertices[triIdx[2]].normal += normal;
-				}
-			}
-		);
+		// 不同的三角形会共享顶点，累加法线时不能并行，否则会产生数据竞争
+		for (const auto& triIdx : mesh.triangleIndices)
+		{
+			GMVec3 v0 = vertices[triIdx[0]].position;
+			GMVec3 v1 = vertices[triIdx[1]].position;
+			GMVec3 v2 = vertices[triIdx[2]].position;
+			GMVec3 normal = Cross(v2 - v0, v1 - v0);
+
+			// 计算法线
+			vertices[triIdx[0]].normal += normal;
+			vertices[triIdx[1]].normal += normal;
+			vertices[triIdx[2]].normal += normal;
+		}
 
-		GMAsync::blockedAsync(
-			GMAsync::Async,
-			numberOfProcessors,
+		GMAsync::parallelFor(
 			vertices.begin(),
 			vertices.end(),
+			0,
 			[](auto begin, auto end) {
 				for (auto iter = begin; iter != end; ++iter)
 				{
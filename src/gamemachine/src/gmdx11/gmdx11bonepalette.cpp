@@ -0,0 +1,88 @@
+﻿#include "stdafx.h"
+#include "gmdx11bonepalette.h"
+#include <gmcom.h>
+#include "gmdx11helper.h"
+#include "gmengine/gmbonepalette.h"
+
+BEGIN_NS
+
+namespace
+{
+	constexpr GMsize_t InitialCapacity = 1024;
+	constexpr GMsize_t ElementSize = sizeof(GMfloat) * 4;
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMDx11BonePaletteBuffer)
+{
+	GMComPtr<ID3D11Buffer> buffer;
+	GMComPtr<ID3D11ShaderResourceView> view;
+	GMsize_t capacity = 0;
+	GMsize_t uploaded = 0;
+	GMuint32 generation = 0;
+};
+
+GMDx11BonePaletteBuffer::GMDx11BonePaletteBuffer()
+{
+	GM_CREATE_DATA();
+}
+
+GMDx11BonePaletteBuffer::~GMDx11BonePaletteBuffer()
+{
+
+}
+
+ID3D11ShaderResourceView* GMDx11BonePaletteBuffer::commit(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const GMBonePalette& palette)
+{
+	D(d);
+	const GMsize_t size = palette.getSize();
+	if (d->generation != palette.getGeneration())
+	{
+		d->generation = palette.getGeneration();
+		d->uploaded = 0;
+	}
+
+	if (!d->buffer || size > d->capacity)
+	{
+		GMsize_t capacity = d->capacity ? d->capacity : InitialCapacity;
+		while (capacity < size)
+		{
+			capacity *= 2;
+		}
+
+		D3D11_BUFFER_DESC bufDesc = { 0 };
+		bufDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufDesc.ByteWidth = gm_sizet_to<UINT>(capacity * ElementSize);
+		bufDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufDesc.StructureByteStride = gm_sizet_to<UINT>(ElementSize);
+
+		// 之前的绘制仍然引用着旧的缓存，由DirectX负责在它们完成之后释放
+		d->view.clear();
+		d->buffer.clear();
+		GM_DX_HR(device->CreateBuffer(&bufDesc, nullptr, &d->buffer));
+		GM_DX11_SET_OBJECT_NAME_A(d->buffer, "GM_BonePalette");
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+		viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		viewDesc.Buffer.FirstElement = 0;
+		viewDesc.Buffer.NumElements = gm_sizet_to<UINT>(capacity);
+		GM_DX_HR(device->CreateShaderResourceView(d->buffer, &viewDesc, &d->view));
+		d->capacity = capacity;
+		d->uploaded = 0;
+	}
+
+	if (size > d->uploaded)
+	{
+		D3D11_BOX box = { 0 };
+		box.left = gm_sizet_to<UINT>(d->uploaded * ElementSize);
+		box.right = gm_sizet_to<UINT>(size * ElementSize);
+		box.bottom = 1;
+		box.back = 1;
+		deviceContext->UpdateSubresource(d->buffer, 0, &box, palette.getData() + d->uploaded * 4, 0, 0);
+		d->uploaded = size;
+	}
+	return d->view;
+}
+
+END_NS
@@ -0,0 +1,36 @@
+﻿#ifndef __GMDX11BONEPALETTE_H__
+#define __GMDX11BONEPALETTE_H__
+#include <gmcommon.h>
+#include <gmdxincludes.h>
+BEGIN_NS
+
+class GMBonePalette;
+
+GM_PRIVATE_CLASS(GMDx11BonePaletteBuffer);
+//! 将骨骼调色板上传到DirectX11结构化缓存(Structured Buffer)。
+/*!
+  着色器中的GM_BonePalette是一个StructuredBuffer<float4>。<BR>
+  调色板在一帧中只会不断追加，因此每次提交只通过UpdateSubresource上传新追加的部分。容量不足时，缓存按2倍重新创建。
+*/
+class GMDx11BonePaletteBuffer
+{
+	GM_DECLARE_PRIVATE(GMDx11BonePaletteBuffer)
+	GM_DISABLE_COPY_ASSIGN(GMDx11BonePaletteBuffer)
+
+public:
+	GMDx11BonePaletteBuffer();
+	~GMDx11BonePaletteBuffer();
+
+public:
+	//! 上传调色板中还没有上传的部分。
+	/*!
+	  \param device 用于创建缓存的设备。
+	  \param deviceContext 用于上传数据的设备上下文。
+	  \param palette 本帧的骨骼调色板。
+	  \return 调色板的着色器资源视图。
+	*/
+	ID3D11ShaderResourceView* commit(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const GMBonePalette& palette);
+};
+
+END_NS
+#endif
@@ -2,8 +2,6 @@
 #include <gamemachine.h>
 #include "gmdx11glyphmanager.h"
 #include "ft2build.h"
-#include "freetype/freetype.h"
-#include "freetype/ftglyph.h"
 #include "foundation/utilities/tools.h"
 #include "gmdxincludes.h"
 #include "gmdx11helper.h"
@@ -33,13 +31,13 @@ GMTextureAsset GMDx11GlyphManager::glyphTexture()
 	D(d);
 	if (d->texture.isEmpty())
 	{
-		d->texture = GMAsset(GMAssetType::Texture, new GMDx11GlyphTexture(getContext()));
+		d->texture = GMAsset(GMAssetType::Texture, new GMDx11GlyphTexture(getContext(), this));
 		d->texture.getTexture()->init();
 	}
 	return d->texture;
 }
 
-void GMDx11GlyphManager::updateTexture(const GMGlyphBitmap& bitmapGlyph, const GMGlyphInfo& glyphInfo)
+void GMDx11GlyphManager::updateTexture(const GMGlyphBitmap& bitmap, GMint32 x, GMint32 y)
 {
 	D(d);
 	if (!d->deviceContext)
@@ -52,11 +50,11 @@ void GMDx11GlyphManager::updateTexture(const GMGlyphBitmap& bitmapGlyph, const G
 		glyphTexture();
 
 	D3D11_BOX box = {
-		(UINT)glyphInfo.x, //left
-		(UINT)glyphInfo.y, //top
+		(UINT)x, //left
+		(UINT)y, //top
 		0, //front
-		(UINT)(glyphInfo.x + glyphInfo.width), //right
-		(UINT)(glyphInfo.y + glyphInfo.height), //bottom
+		(UINT)(x + bitmap.width), //right
+		(UINT)(y + bitmap.rows), //bottom
 		1 //back
 	};
 	
@@ -65,8 +63,8 @@ void GMDx11GlyphManager::updateTexture(const GMGlyphBitmap& bitmapGlyph, const G
 		texture->getD3D11Texture(),
 		0,
 		&box,
-		bitmapGlyph.buffer,
-		bitmapGlyph.width,
+		bitmap.buffer,
+		bitmap.pitch,
 		0
 	);
 }
@@ -74,12 +72,15 @@ void GMDx11GlyphManager::updateTexture(const GMGlyphBitmap& bitmapGlyph, const G
 GM_PRIVATE_OBJECT_UNALIGNED(GMDx11GlyphTexture)
 {
 	GMComPtr<ID3D11Texture2D> texture;
+	GMGlyphManager* glyphManager = nullptr;
 };
 
-GMDx11GlyphTexture::GMDx11GlyphTexture(const IRenderContext* context)
+GMDx11GlyphTexture::GMDx11GlyphTexture(const IRenderContext* context, GMGlyphManager* glyphManager)
 	: GMDx11Texture(context, nullptr)
 {
 	GM_CREATE_DATA();
+	D(d);
+	d->glyphManager = glyphManager;
 }
 
 void GMDx11GlyphTexture::init()
@@ -131,6 +132,8 @@ void GMDx11GlyphTexture::bindSampler(GMTextureSampler* sampler)
 void GMDx11GlyphTexture::useTexture(GMint32)
 {
 	D(d);
+	// 使用纹理之前，上传新光栅化的字形
+	d->glyphManager->flush();
 	Base::useTexture((GMint32)GMTextureType::Ambient);
 }
 
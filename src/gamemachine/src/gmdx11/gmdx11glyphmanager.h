@@ -13,7 +13,7 @@ class GMDx11GlyphTexture : public GMDx11Texture
 	GM_DECLARE_BASE(GMDx11Texture)
 
 public:
-	GMDx11GlyphTexture(const IRenderContext* context);
+	GMDx11GlyphTexture(const IRenderContext* context, GMGlyphManager* glyphManager);
 
 public:
 	virtual void init() override;
@@ -36,7 +36,7 @@ public:
 
 public:
 	virtual GMTextureAsset glyphTexture() override;
-	virtual void updateTexture(const GMGlyphBitmap& bitmapGlyph, const GMGlyphInfo& glyphInfo) override;
+	virtual void updateTexture(const GMGlyphBitmap& bitmap, GMint32 x, GMint32 y) override;
 };
 
 END_NS
@@ -0,0 +1,113 @@
+﻿#include "stdafx.h"
+#include "gmdx11gputracer.h"
+#include <gmcom.h>
+#include "gmdx11helper.h"
+#include "foundation/gmprofile.h"
+
+BEGIN_NS
+
+namespace
+{
+	struct Dx11TraceQueries
+	{
+		GMComPtr<ID3D11Query> disjoint;
+		GMComPtr<ID3D11Query> start; // 这一帧的起点
+		Vector<GMComPtr<ID3D11Query>> queries;
+		GMint32 used = 0;
+		GMint64 startTime = 0; // 起点对应的CPU时间
+	};
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMDx11GPUTracer)
+{
+	GMComPtr<ID3D11Device> device;
+	GMComPtr<ID3D11DeviceContext> deviceContext;
+	Dx11TraceQueries frames[GMGPUTracer::FramesInFlight];
+
+	GMComPtr<ID3D11Query> createQuery(D3D11_QUERY type);
+};
+
+GMComPtr<ID3D11Query> GMDx11GPUTracerPrivate::createQuery(D3D11_QUERY type)
+{
+	D3D11_QUERY_DESC desc = {};
+	desc.Query = type;
+	GMComPtr<ID3D11Query> query;
+	GM_DX_HR(device->CreateQuery(&desc, &query));
+	return query;
+}
+
+GMDx11GPUTracer::GMDx11GPUTracer(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
+{
+	GM_CREATE_DATA();
+	D(d);
+	d->device = device;
+	d->deviceContext = deviceContext;
+}
+
+GMDx11GPUTracer::~GMDx11GPUTracer()
+{
+
+}
+
+void GMDx11GPUTracer::beginQueries(GMint32 frame)
+{
+	D(d);
+	Dx11TraceQueries& f = d->frames[frame];
+	if (!f.disjoint)
+	{
+		f.disjoint = d->createQuery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+		f.start = d->createQuery(D3D11_QUERY_TIMESTAMP);
+	}
+
+	f.used = 0;
+	d->deviceContext->Begin(f.disjoint);
+	d->deviceContext->End(f.start);
+	f.startTime = GMTracer::now();
+}
+
+void GMDx11GPUTracer::endQueries(GMint32 frame)
+{
+	D(d);
+	d->deviceContext->End(d->frames[frame].disjoint);
+}
+
+GMint32 GMDx11GPUTracer::queryTimestamp(GMint32 frame)
+{
+	D(d);
+	Dx11TraceQueries& f = d->frames[frame];
+	if (f.used == gm_sizet_to_int(f.queries.size()))
+		f.queries.push_back(d->createQuery(D3D11_QUERY_TIMESTAMP));
+
+	d->deviceContext->End(f.queries[f.used]);
+	return f.used++;
+}
+
+bool GMDx11GPUTracer::resolveQueries(GMint32 frame, OUT Vector<GMint64>& timestamps)
+{
+	D(d);
+	Dx11TraceQueries& f = d->frames[frame];
+	timestamps.resize(f.used);
+
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (d->deviceContext->GetData(f.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+	if (disjoint.Disjoint || disjoint.Frequency == 0)
+		return false;
+
+	UINT64 start = 0;
+	if (d->deviceContext->GetData(f.start, &start, sizeof(start), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+
+	for (GMint32 i = 0; i < f.used; ++i)
+	{
+		UINT64 ticks = 0;
+		if (d->deviceContext->GetData(f.queries[i], &ticks, sizeof(ticks), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return false;
+
+		const GMint64 delta = static_cast<GMint64>(ticks) - static_cast<GMint64>(start);
+		timestamps[i] = f.startTime + static_cast<GMint64>(static_cast<double>(delta) * 1e9 / disjoint.Frequency);
+	}
+	return true;
+}
+
+END_NS
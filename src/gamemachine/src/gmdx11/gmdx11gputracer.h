@@ -0,0 +1,31 @@
+﻿#ifndef __GMDX11GPUTRACER_H__
+#define __GMDX11GPUTRACER_H__
+#include <gmcommon.h>
+#include <gmdxincludes.h>
+#include <gmgputracer.h>
+BEGIN_NS
+
+GM_PRIVATE_CLASS(GMDx11GPUTracer);
+//! 使用DirectX11时间戳查询(D3D11_QUERY_TIMESTAMP)实现的GPU跟踪。
+/*!
+  每一帧的查询包含在一个D3D11_QUERY_TIMESTAMP_DISJOINT查询中，由它给出时间戳的频率。如果这一帧中GPU的频率发生了变化，结果会被丢弃。<BR>
+  DirectX11无法直接读取GPU的当前时间，因此每一帧的第一个时间戳对应于这一帧开始记录查询时的GMTracer::now()，GPU的时间会因此略早于实际。
+*/
+class GMDx11GPUTracer : public GMGPUTracer
+{
+	GM_DECLARE_PRIVATE(GMDx11GPUTracer)
+	GM_DECLARE_BASE(GMGPUTracer)
+
+public:
+	GMDx11GPUTracer(ID3D11Device* device, ID3D11DeviceContext* deviceContext);
+	~GMDx11GPUTracer();
+
+protected:
+	virtual void beginQueries(GMint32 frame) override;
+	virtual void endQueries(GMint32 frame) override;
+	virtual GMint32 queryTimestamp(GMint32 frame) override;
+	virtual bool resolveQueries(GMint32 frame, OUT Vector<GMint64>& timestamps) override;
+};
+
+END_NS
+#endif
@@ -6,6 +6,8 @@
 #include "foundation/utilities/utilities.h"
 #include "gmengine/gameobjects/gmgameobject.h"
 #include "gmdx11gbuffer.h"
+#include "gmdx11bonepalette.h"
+#include "gmdx11gputracer.h"
 #include "gmdx11glyphmanager.h"
 #include "gmengine/gmcsmhelper.h"
 #include "gmengine/gmgraphicengine_p.h"
@@ -23,6 +25,8 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMDx11GraphicEngine)
 	GMComPtr<ID3D11RenderTargetView> renderTargetView;
 	GMScopedPtr<IShaderProgram> shaderProgram;
 	GMDx11CubeMapState cubemapState;
+	GMDx11BonePaletteBuffer bonePaletteBuffer;
+	GMOwnedPtr<GMDx11GPUTracer> gpuTracer;
 
 	bool inited = false;
 	bool ready = false;
@@ -161,6 +165,12 @@ GMDx11CubeMapState& GMDx11GraphicEngine::getCubeMapState()
 	return d->cubemapState;
 }
 
+GMDx11BonePaletteBuffer& GMDx11GraphicEngine::getBonePaletteBuffer()
+{
+	D(d);
+	return d->bonePaletteBuffer;
+}
+
 IShaderProgram* GMDx11GraphicEngine::getShaderProgram(GMShaderProgramType type)
 {
 	D(d);
@@ -336,4 +346,12 @@ GMGlyphManager* GMDx11GraphicEngine::getGlyphManager()
 	return d->glyphManager;
 }
 
+GMGPUTracer* GMDx11GraphicEngine::getGPUTracer()
+{
+	D(d);
+	if (!d->gpuTracer && d->device)
+		d->gpuTracer = gm_makeOwnedPtr<GMDx11GPUTracer>(d->device, d->deviceContext);
+	return d->gpuTracer.get();
+}
+
 END_NS
\ No newline at end of file
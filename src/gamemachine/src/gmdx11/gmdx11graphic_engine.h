@@ -20,6 +20,7 @@ struct GMDx11CubeMapState
 
 class GMDx11Framebuffers;
 class GMDx11GBuffer;
+class GMDx11BonePaletteBuffer;
 GM_PRIVATE_CLASS(GMDx11GraphicEngine);
 class GMDx11GraphicEngine : public GMGraphicEngine
 {
@@ -38,6 +39,7 @@ public:
 	virtual IFramebuffers* getDefaultFramebuffers() override;
 	virtual ITechnique* getTechnique(GMModelType objectType) override;
 	virtual GMGlyphManager* getGlyphManager() override;
+	virtual GMGPUTracer* getGPUTracer() override;
 
 public:
 	virtual bool setInterface(GameMachineInterfaceID, void*);
@@ -54,6 +56,12 @@ public:
 	ID3D11DepthStencilView* getDepthStencilView();
 	ID3D11RenderTargetView* getRenderTargetView();
 	const GMVec2 getCurrentFilterKernelDelta();
+
+	//! 获取此引擎的骨骼调色板缓存。
+	/*!
+	  绘制动画模型之前，需要将GMGraphicEngine::getBonePalette()提交到此缓存。
+	*/
+	GMDx11BonePaletteBuffer& getBonePaletteBuffer();
 };
 
 END_NS
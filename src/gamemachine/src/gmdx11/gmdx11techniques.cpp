@@ -8,6 +8,7 @@
 #include "gmdx11graphic_engine.h"
 #include "gmdx11gbuffer.h"
 #include "gmdx11framebuffer.h"
+#include "gmdx11bonepalette.h"
 
 BEGIN_NS
 
@@ -20,6 +21,7 @@ BEGIN_NS
 #define GMSHADER_SEMANTIC_NAME_COLOR "COLOR"
 #define GMSHADER_SEMANTIC_NAME_BONES "BONES"
 #define GMSHADER_SEMANTIC_NAME_WEIGHTS "WEIGHTS"
+#define GMSHADER_SEMANTIC_NAME_INSTANCE_WORLD "INSTANCE_WORLD"
 #define BIT32_OFFSET(i) (sizeof(GMfloat) * i)
 #define CHECK_VAR(var) if (!var->IsValid()) { return; }
 
@@ -59,6 +61,13 @@ namespace
 
 		{ GMSHADER_SEMANTIC_NAME_WEIGHTS, 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, BIT32_OFFSET(24), D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		// 4
+
+		// 实例化绘制时每个实例的世界矩阵，位于第1个顶点缓存槽
+		{ GMSHADER_SEMANTIC_NAME_INSTANCE_WORLD, 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, BIT32_OFFSET(0), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ GMSHADER_SEMANTIC_NAME_INSTANCE_WORLD, 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, BIT32_OFFSET(4), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ GMSHADER_SEMANTIC_NAME_INSTANCE_WORLD, 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, BIT32_OFFSET(8), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ GMSHADER_SEMANTIC_NAME_INSTANCE_WORLD, 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, BIT32_OFFSET(12), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		// 16
 	};
 
 	inline D3D_PRIMITIVE_TOPOLOGY getMode(GMTopologyMode mode)
@@ -343,6 +352,9 @@ public:
 	EFFECT_VARIABLE(AlbedoTexture, GM_VariablesDesc.AlbedoTextureName);
 	EFFECT_VARIABLE(MetallicRoughnessAOTexture, GM_VariablesDesc.MetallicRoughnessAOTextureName);
 
+	// Animation
+	EFFECT_VARIABLE_AS_SHADER_RESOURCE(BonePalette, GM_VariablesDesc.BonePalette)
+
 private:
 	ID3DX11Effect* m_effect = nullptr;
 };
@@ -378,6 +390,10 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMDx11Technique)
 	Map<ID3DX11EffectVariable*, GMTextureAttributeBank> textureVariables;
 	GMShaderVariablesIndices indexBank = { 0 };
 	GMint64 lastShadowVersion = { 0 };
+	GMComPtr<ID3D11Buffer> instanceBuffer;
+	GMsize_t instanceBufferCapacity = 0;
+	GMsize_t instanceCount = 0;
+	GMComPtr<ID3D11Buffer> defaultInstanceBuffer;
 
 	GMTextureAsset getWhiteTexture();
 };
@@ -399,27 +415,29 @@ GMTextureAsset GMDx11TechniquePrivate::getWhiteTexture()
 
 void GMDx11Technique::updateBoneTransforms(IShaderProgram* shaderProgram, GMModel* model)
 {
-	D(d);
-	static const GMMat4 s_zero = Zero<GMMat4>();
-	auto bones = d->effect->GetVariableByName(GM_VariablesDesc.Bones.toStdString().c_str());
-	const auto& transforms = model->getBoneTransformations();
-	for (UINT i = 0; i < gm_sizet_to_uint(transforms.size()); ++i)
-	{
-		const auto& transform = transforms[i];
-		bones->GetElement(i)->AsMatrix()->SetMatrix(ValuePointer(transform));
-	}
+	setBonePalette(shaderProgram, model, model->getSkinningMode());
 }
 
 void GMDx11Technique::updateNodeTransforms(IShaderProgram* shaderProgram, GMModel* model)
+{
+	// 仿射变换动画只使用第1个矩阵
+	if (!model->getBoneTransformations().empty())
+		setBonePalette(shaderProgram, model, GMSkinningMode::Linear);
+}
+
+void GMDx11Technique::setBonePalette(IShaderProgram* shaderProgram, GMModel* model, GMSkinningMode mode)
 {
 	D(d);
-	auto bones = d->effect->GetVariableByName(GM_VariablesDesc.Bones.toStdString().c_str());
-	const auto& transforms = model->getBoneTransformations();
-	if (!transforms.empty())
-	{
-		const auto& transform = transforms[0];
-		bones->GetElement(0)->AsMatrix()->SetMatrix(ValuePointer(transform));
-	}
+	// 骨骼变换追加到本帧的骨骼调色板中，着色器只需要知道它们在调色板中的位置
+	GMDx11GraphicEngine* engine = getEngine();
+	GMBonePalette& palette = engine->getBonePalette();
+	GMsize_t offset = palette.add(model, mode);
+	ID3D11ShaderResourceView* view = engine->getBonePaletteBuffer().commit(engine->getDevice(), d->deviceContext, palette);
+
+	GMDx11EffectVariableBank& bank = getVarBank();
+	GM_DX_HR(bank.BonePalette()->SetResource(view));
+	shaderProgram->setInt(VI(BoneOffset), gm_sizet_to<GMint32>(offset));
+	shaderProgram->setInt(VI(SkinningMode), static_cast<GMint32>(mode));
 }
 
 void GMDx11Technique::setCascadeEndClip(GMCascadeLevel level, GMfloat endClip)
@@ -1005,6 +1023,9 @@ void GMDx11Technique::prepareBuffer(GMModel* model)
 	GM_ASSERT(vertexBuffer);
 	GM_DX11_SET_OBJECT_NAME_A(vertexBuffer, "GM_VERTEX_BUFFER");
 	d->deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	if (d->instanceCount == 0)
+		bindDefaultInstanceBuffer();
+
 	if (model->getDrawMode() == GMModelDrawMode::Index)
 	{
 		GMComPtr<ID3D11Buffer> indexBuffer;
@@ -1196,6 +1217,83 @@ void GMDx11Technique::setGamma(IShaderProgram* shaderProgram)
 	}
 }
 
+void GMDx11Technique::drawInstanced(GMModel* model, const GMMat4* transforms, GMsize_t count)
+{
+	D(d);
+	if (!count)
+		return;
+
+	prepareInstanceBuffer(transforms, count);
+
+	// 世界矩阵由实例数据给出，法线在顶点着色器中变换到世界坐标系
+	IShaderProgram* shaderProgram = getEngine()->getShaderProgram();
+	shaderProgram->setMatrix4(VI(ModelMatrix), Identity<GMMat4>());
+	shaderProgram->setMatrix4(VI(InverseTransposeModelMatrix), Identity<GMMat4>());
+	shaderProgram->setInt(VI(UseInstancing), 1);
+	d->instanceCount = count;
+	draw(model);
+	d->instanceCount = 0;
+	shaderProgram->setInt(VI(UseInstancing), 0);
+	bindDefaultInstanceBuffer();
+}
+
+void GMDx11Technique::bindDefaultInstanceBuffer()
+{
+	D(d);
+	// 输入布局总是包含槽1的实例数据，非实例化绘制时绑定一个只有单位矩阵的缓存，避免槽1为空
+	if (!d->defaultInstanceBuffer)
+	{
+		GMMat4 identity = Identity<GMMat4>();
+		D3D11_BUFFER_DESC bufDesc = { 0 };
+		bufDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufDesc.ByteWidth = sizeof(GMMat4);
+		bufDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA bufData = { 0 };
+		bufData.pSysMem = &identity;
+		GM_DX_HR(getEngine()->getDevice()->CreateBuffer(&bufDesc, &bufData, &d->defaultInstanceBuffer));
+		GM_DX11_SET_OBJECT_NAME_A(d->defaultInstanceBuffer, "GM_DEFAULT_INSTANCE_BUFFER");
+	}
+
+	GMuint32 stride = sizeof(GMMat4);
+	GMuint32 offset = 0;
+	d->deviceContext->IASetVertexBuffers(1, 1, &d->defaultInstanceBuffer, &stride, &offset);
+}
+
+void GMDx11Technique::prepareInstanceBuffer(const GMMat4* transforms, GMsize_t count)
+{
+	D(d);
+	if (!d->instanceBuffer || d->instanceBufferCapacity < count)
+	{
+		// 容量按2倍增长，避免实例数目变化时频繁创建缓存
+		GMsize_t capacity = d->instanceBufferCapacity ? d->instanceBufferCapacity : 64;
+		while (capacity < count)
+		{
+			capacity *= 2;
+		}
+
+		D3D11_BUFFER_DESC bufDesc = { 0 };
+		bufDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufDesc.ByteWidth = gm_sizet_to<UINT>(capacity * sizeof(GMMat4));
+		bufDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bufDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		d->instanceBuffer.clear();
+		GM_DX_HR(getEngine()->getDevice()->CreateBuffer(&bufDesc, nullptr, &d->instanceBuffer));
+		GM_DX11_SET_OBJECT_NAME_A(d->instanceBuffer, "GM_INSTANCE_BUFFER");
+		d->instanceBufferCapacity = capacity;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	GM_DX_HR(d->deviceContext->Map(d->instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+	memcpy(mappedResource.pData, transforms, count * sizeof(GMMat4));
+	d->deviceContext->Unmap(d->instanceBuffer, 0);
+
+	GMuint32 stride = sizeof(GMMat4);
+	GMuint32 offset = 0;
+	d->deviceContext->IASetVertexBuffers(1, 1, &d->instanceBuffer, &stride, &offset);
+}
+
 void GMDx11Technique::draw(GMModel* model)
 {
 	prepareScreenInfo();
@@ -1222,11 +1320,26 @@ void GMDx11Technique::passAllAndDraw(GMModel* model)
 	{
 		ID3DX11EffectPass* pass = tech->GetPassByIndex(p);
 		pass->Apply(0, d->deviceContext);
+		drawPrimitives(model);
+	}
+}
+
+void GMDx11Technique::drawPrimitives(GMModel* model)
+{
+	D(d);
+	if (d->instanceCount > 0)
+	{
 		if (model->getDrawMode() == GMModelDrawMode::Vertex)
-			d->deviceContext->Draw(gm_sizet_to<UINT>(model->getVerticesCount()), 0);
+			d->deviceContext->DrawInstanced(gm_sizet_to<UINT>(model->getVerticesCount()), gm_sizet_to<UINT>(d->instanceCount), 0, 0);
 		else
-			d->deviceContext->DrawIndexed(gm_sizet_to<UINT>(model->getVerticesCount()), 0, 0);
+			d->deviceContext->DrawIndexedInstanced(gm_sizet_to<UINT>(model->getVerticesCount()), gm_sizet_to<UINT>(d->instanceCount), 0, 0, 0);
+		return;
 	}
+
+	if (model->getDrawMode() == GMModelDrawMode::Vertex)
+		d->deviceContext->Draw(gm_sizet_to<UINT>(model->getVerticesCount()), 0);
+	else
+		d->deviceContext->DrawIndexed(gm_sizet_to<UINT>(model->getVerticesCount()), 0, 0);
 }
 
 ID3DX11EffectTechnique* GMDx11Technique::getTechnique()
@@ -1431,10 +1544,7 @@ void GMDx11Technique_Deferred_3D::passAllAndDraw(GMModel* model)
 
 		GM_ASSERT(framebuffers);
 		framebuffers->bind();
-		if (model->getDrawMode() == GMModelDrawMode::Vertex)
-			d->deviceContext->Draw(gm_sizet_to<UINT>(model->getVerticesCount()), 0);
-		else
-			d->deviceContext->DrawIndexed(gm_sizet_to<UINT>(model->getVerticesCount()), 0, 0);
+		drawPrimitives(model);
 		framebuffers->unbind();
 	}
 }
@@ -1448,10 +1558,7 @@ void GMDx11Technique_Deferred_3D_LightPass::passAllAndDraw(GMModel* model)
 	{
 		ID3DX11EffectPass* pass = getTechnique()->GetPassByIndex(p);
 		pass->Apply(0, d->deviceContext);
-		if (model->getDrawMode() == GMModelDrawMode::Vertex)
-			d->deviceContext->Draw(gm_sizet_to<UINT>(model->getVerticesCount()), 0);
-		else
-			d->deviceContext->DrawIndexed(gm_sizet_to<UINT>(model->getVerticesCount()), 0, 0);
+		drawPrimitives(model);
 	}
 }
 
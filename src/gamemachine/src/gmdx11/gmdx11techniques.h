@@ -38,6 +38,7 @@ public:
 	virtual void beginModel(GMModel* model, const GMGameObject* parent) override;
 	virtual void endModel() override;
 	virtual void draw(GMModel* model) override;
+	virtual void drawInstanced(GMModel* model, const GMMat4* transforms, GMsize_t count) override;
 	virtual const char* getTechniqueName() = 0;
 	virtual const IRenderContext* getContext();
 
@@ -49,6 +50,8 @@ protected:
 	virtual void prepareTextures(GMModel* model);
 	virtual void passAllAndDraw(GMModel* model);
 	virtual void prepareBuffer(GMModel* model);
+	virtual void prepareInstanceBuffer(const GMMat4* transforms, GMsize_t count);
+	void bindDefaultInstanceBuffer();
 	virtual void prepareLights();
 	virtual void prepareMaterials(GMModel* model);
 	virtual void prepareRasterizer(GMModel* model);
@@ -64,8 +67,10 @@ protected:
 	GMDx11EffectVariableBank& getVarBank();
 	GMDx11GraphicEngine* getEngine();
 	GMModel* getCurrentModel();
+	void drawPrimitives(GMModel* model);
 	void updateBoneTransforms(IShaderProgram* shaderProgram, GMModel* model);
 	void updateNodeTransforms(IShaderProgram* shaderProgram, GMModel* model);
+	void setBonePalette(IShaderProgram* shaderProgram, GMModel* model, GMSkinningMode mode);
 	virtual void setCascadeEndClip(GMCascadeLevel level, GMfloat endClip);
 	virtual void setCascadeCameraVPMatrices(GMCascadeLevel level);
 
@@ -225,7 +225,7 @@ void GMDx11Texture::init()
 			{
 				GM.invokeInMainThread([d]() {
 					d->deviceContext->GenerateMips(d->shaderResourceView);
-				});
+				}, GMCommandPriority::High);
 			}
 		}
 	}
@@ -154,6 +154,7 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMTextGameObject)
 	Vector<GMVertex> vericesCache;
 	GMTypoTextBuffer* textBuffer = nullptr;
 	GMTextDrawMode drawMode = GMTextDrawMode::Immediate;
+	GMuint32 glyphGeneration = 0;
 
 	void update();
 	GMScene* createScene();
@@ -173,9 +174,15 @@ void GMTextGameObjectPrivate::update()
 		pd->markDirty();
 	}
 
+	// 字形图集有页被清空时，字形在纹理中的位置可能已经改变
+	GMGlyphManager* glyphManager = pd->getContext()->getEngine()->getGlyphManager();
+	if (glyphGeneration != glyphManager->getGeneration())
+		pd->markDirty();
+
 	// 如果字符被更改，则更新其缓存
 	if (pd->isDirty())
 	{
+		glyphGeneration = glyphManager->getGeneration();
 		updateVertices(scene);
 		pd->cleanDirty();
 	}
@@ -205,6 +212,7 @@ void GMTextGameObjectPrivate::updateVertices(GMScene* scene)
 		typoEngine = new GMTypoEngine(pd->getContext());
 
 	GMModel* model = scene->getModels()[0].getModel();
+	GMGlyphManager* glyphManager = pd->getContext()->getEngine()->getGlyphManager();
 	constexpr GMfloat Z = 0;
 	const GMRect& rect = pd->getRenderRect();
 	GMRectF coord = pd->toViewportRect(pd->getGeometry(), rect);
@@ -261,7 +269,11 @@ void GMTextGameObjectPrivate::updateVertices(GMScene* scene)
 			pResultColor = typoResult.color;
 		}
 
-		if (glyph.width > 0 && glyph.height > 0)
+		// 缓存的排版结果中的字形可能已经被移出图集，需要重新光栅化
+		if (!glyphManager->touchGlyph(glyph))
+			continue;
+
+		if (glyph.width > 0 && glyph.height > 0 && glyph.page >= 0)
 		{
 			// 如果width和height为0，视为空格，只占用空间而已
 			// 否则：按照TriangleList创建顶点：0 2 1, 1 2 3
@@ -270,10 +282,12 @@ void GMTextGameObjectPrivate::updateVertices(GMScene* scene)
 			// 让所有字体origin开始的x轴平齐
 
 			// 采用左上角为原点的Texcoord坐标系
+			// 距离场字形在法线的x分量中标记，由着色器重建边缘
+			const GMfloat sdf = glyph.sdf ? 1.f : 0.f;
 
 			GMVertex V0 = {
 				{ coord.x + X(typoResult.x), coord.y - Y(typoResult.y + lineHeight - glyph.bearingY), Z },
-				{ 0 },
+				{ sdf, 0, 0 },
 				{ UV_X(glyph.x), UV_Y(glyph.y) },
 				{ 0 },
 				{ 0 },
@@ -282,8 +296,8 @@ void GMTextGameObjectPrivate::updateVertices(GMScene* scene)
 			};
 			GMVertex V1 = {
 				{ coord.x + X(typoResult.x), coord.y - Y(typoResult.y + lineHeight - (glyph.bearingY - glyph.height)), Z },
-				{ 0 },
-				{ UV_X(glyph.x), UV_Y(glyph.y + glyph.height) },
+				{ sdf, 0, 0 },
+				{ UV_X(glyph.x), UV_Y(glyph.y + glyph.texHeight) },
 				{ 0 },
 				{ 0 },
 				{ 0 },
@@ -291,8 +305,8 @@ void GMTextGameObjectPrivate::updateVertices(GMScene* scene)
 			};
 			GMVertex V2 = {
 				{ coord.x + X(typoResult.x + typoResult.width), coord.y - Y(typoResult.y + lineHeight - glyph.bearingY), Z },
-				{ 0 },
-				{ UV_X(glyph.x + glyph.width), UV_Y(glyph.y) },
+				{ sdf, 0, 0 },
+				{ UV_X(glyph.x + glyph.texWidth), UV_Y(glyph.y) },
 				{ 0 },
 				{ 0 },
 				{ 0 },
@@ -300,8 +314,8 @@ void GMTextGameObjectPrivate::updateVertices(GMScene* scene)
 			};
 			GMVertex V3 = {
 				{ coord.x + X(typoResult.x + typoResult.width), coord.y - Y(typoResult.y + lineHeight - (glyph.bearingY - glyph.height)), Z },
-				{ 0 },
-				{ UV_X(glyph.x + glyph.width), UV_Y(glyph.y + glyph.height) },
+				{ sdf, 0, 0 },
+				{ UV_X(glyph.x + glyph.texWidth), UV_Y(glyph.y + glyph.texHeight) },
 				{ 0 },
 				{ 0 },
 				{ 0 },
@@ -3,189 +3,75 @@
 #include "foundation/gmasync.h"
 #include "foundation/gamemachine.h"
 #include "gmengine/gmgameworld.h"
+#include "gmdata/gmanimationclip.h"
 #include <algorithm>
 
 BEGIN_NS
 
-namespace
-{
-	template <typename T>
-	GMsize_t findIndex(GMDuration animationTime, const AlignedVector<GMNodeAnimationKeyframe<T>>& frames)
-	{
-		GM_ASSERT(frames.size() > 0);
-		for (GMsize_t i = 0; i < frames.size() - 1; ++i)
-		{
-			const GMNodeAnimationKeyframe<T>& frame = frames[i + 1];
-			if (animationTime < frame.time)
-				return i;
-		}
-
-		GM_ASSERT(false);
-		return 0;
-	}
-}
-
 GM_PRIVATE_OBJECT_ALIGNED(GMAnimationEvaluator)
 {
-	const GMNodeAnimation* animation = nullptr;
+	const GMAnimationClip* clip = nullptr;
 	GMDuration duration = 0;
-	AlignedVector<GMMat4> transforms;
-	GMSkeletonPtr skeleton = nullptr;
-	GMNodePtr rootNode = nullptr;
-	GMMat4 globalInverseTransform;
+	Vector<GMuint32> cursors;
+	AlignedVector<GMMat4> globalTransforms;
+	Vector<AlignedVector<GMMat4>> modelTransforms;
 };
 
-GM_DEFINE_PROPERTY(GMAnimationEvaluator, GMSkeletonPtr, Skeleton, skeleton)
-GM_DEFINE_PROPERTY(GMAnimationEvaluator, GMNodePtr, RootNode, rootNode)
-GM_DEFINE_PROPERTY(GMAnimationEvaluator, GMNodeAnimationPtr, Animation, animation)
-GM_DEFINE_GETTER(GMAnimationEvaluator, AlignedVector<GMMat4>, Transforms, transforms)
-GMAnimationEvaluator::GMAnimationEvaluator(GMNode* root, GMSkeleton* skeleton)
+GMAnimationEvaluator::GMAnimationEvaluator()
 {
 	GM_CREATE_DATA();
+}
 
+void GMAnimationEvaluator::setClip(const GMAnimationClip* clip)
+{
 	D(d);
-	setRootNode(root);
-	setSkeleton(skeleton);
-	d->globalInverseTransform = Inverse(root->getTransformToParent());
+	GM_ASSERT(clip);
+	if (d->clip != clip || d->cursors.size() != clip->getCursorCount())
+	{
+		d->clip = clip;
+		d->cursors.assign(clip->getCursorCount(), 0);
+	}
 }
 
 void GMAnimationEvaluator::update(GMDuration dt)
 {
 	D(d);
+	GM_ASSERT(d->clip);
 	d->duration += dt;
 
-	GMfloat ticks = d->duration * d->animation->frameRate;
-	GMDuration animationTime = Fmod(ticks, d->animation->duration);
-
-	updateNode(animationTime, d->rootNode, Identity<GMMat4>());
-	AlignedVector<GMMat4>& transforms = d->transforms;
+	GMDuration animationTime = d->clip->getAnimationTime(d->duration);
+	d->clip->evaluate(animationTime, d->cursors, d->globalTransforms);
 
-	if (d->skeleton)
+	GMsize_t modelCount = d->clip->getModelCount();
+	d->modelTransforms.resize(modelCount);
+	for (GMsize_t i = 0; i < modelCount; ++i)
 	{
-		// 在骨骼动画中，transforms表示每个骨骼的变换
-		GMsize_t boneCount = d->skeleton->getBones().getBones().size();
-		transforms.resize(boneCount);
-
-		for (GMsize_t i = 0; i < boneCount; ++i)
-		{
-			transforms[i] = d->skeleton->getBones().getBones()[i].finalTransformation;
-		}
+		d->clip->computeModelTransforms(i, d->globalTransforms, d->modelTransforms[i]);
 	}
 }
 
-void GMAnimationEvaluator::reset()
+void GMAnimationEvaluator::apply(GMScene* scene)
 {
 	D(d);
-	d->duration = 0;
-}
-
-void GMAnimationEvaluator::updateNode(GMDuration animationTime, GMNode* node, const GMMat4& parentTransformation)
-{
-	D(d);
-	const GMString& nodeName = node->getName();
-	const GMNodeAnimationNode* animationNode = findAnimationNode(nodeName);
-	GMMat4 nodeTransformation = node->getTransformToParent();
-	GMfloat factor = 0;
-
-	if (animationNode)
-	{
-		// Position
-		GMVec3 currentPosition;
-		if (!animationNode->positions.empty())
-		{
-			const auto& v = animationNode->positions;
-			if (v.size() > 1)
-			{
-				GMfloat frameIdx = findIndex(animationTime, v);
-				GMfloat nextFrameIdx = frameIdx + 1;
-				const auto& frame = v[frameIdx];
-				const auto& nextFrame = v[nextFrameIdx];
-				factor = (animationTime - frame.time) / (nextFrame.time - frame.time);
-				currentPosition = Lerp(frame.value, nextFrame.value, factor);
-			}
-			else
-			{
-				currentPosition = v[0].value;
-			}
-		}
-
-		// Rotation
-		GMQuat currentRotation;
-		if (!animationNode->rotations.empty())
-		{
-			const auto& v = animationNode->rotations;
-			if (v.size() > 1)
-			{
-				GMfloat frameIdx = findIndex(animationTime, v);
-				GMfloat nextFrameIdx = frameIdx + 1;
-				const auto& frame = v[frameIdx];
-				const auto& nextFrame = v[nextFrameIdx];
-				factor = (animationTime - frame.time) / (nextFrame.time - frame.time);
-				GMDuration diffTime = nextFrame.time - frame.time;
-				currentRotation = Lerp(frame.value, nextFrame.value, factor);
-			}
-			else
-			{
-				currentRotation = v[0].value;
-			}
-		}
-
-		// Scaling
-		GMVec3 currentScaling;
-		if (!animationNode->scalings.empty())
-		{
-			const auto& v = animationNode->scalings;
-			if (v.size() > 1)
-			{
-				GMfloat frameIdx = findIndex(animationTime, v);
-				GMfloat nextFrameIdx = frameIdx + 1;
-				const auto& frame = v[frameIdx];
-				const auto& nextFrame = v[nextFrameIdx];
-				factor = (animationTime - frame.time) / (nextFrame.time - frame.time);
-				GMDuration diffTime = nextFrame.time - frame.time;
-				currentScaling = Lerp(frame.value, nextFrame.value, factor);
-			}
-			else
-			{
-				currentScaling = v[0].value;
-			}
-		}
-
-		nodeTransformation = Scale(currentScaling) * QuatToMatrix(currentRotation) * Translate(currentPosition);
-	}
+	GM_ASSERT(d->clip);
+	d->clip->applyNodeTransforms(d->globalTransforms);
 
-	GMMat4 globalTransformation = nodeTransformation * parentTransformation;
-	node->setGlobalTransform(globalTransformation);
-
-	// 把变换结果保存
-	if (d->skeleton)
+	auto& models = scene->getModels();
+	GM_ASSERT(models.size() == d->modelTransforms.size());
+	for (GMsize_t i = 0; i < models.size(); ++i)
 	{
-		// 如果是骨骼动画，结果保存到骨骼节点
-		auto& boneMapping = d->skeleton->getBones().getBoneNameIndexMap();
-		auto& boneInfo = d->skeleton->getBones().getBones();
-		if (boneMapping.find(nodeName) != boneMapping.end())
-		{
-			GMsize_t idx = boneMapping[nodeName];
-			auto& bone = boneInfo[idx];
-			bone.finalTransformation = bone.offsetMatrix * globalTransformation * d->globalInverseTransform;
-		}
-	}
-
-	for (auto& child : node->getChildren())
-	{
-		updateNode(animationTime, child, globalTransformation);
+		GMModel* model = models[i].getModel();
+		const auto& transforms = d->modelTransforms[i];
+		// 没有骨骼并且不在节点树中的模型，保持原来的变换
+		if (model->getSkeleton() || !transforms.empty())
+			model->getBoneTransformations() = transforms;
 	}
 }
 
-const GMNodeAnimationNode* GMAnimationEvaluator::findAnimationNode(const GMString& name)
+void GMAnimationEvaluator::reset()
 {
 	D(d);
-	for (auto& node : d->animation->nodes)
-	{
-		if (node.name == name)
-			return &node;
-	}
-	return nullptr;
+	d->duration = 0;
 }
 
 GM_PRIVATE_OBJECT_ALIGNED(GMAnimationGameObjectHelper)
@@ -195,9 +81,10 @@ GM_PRIVATE_OBJECT_ALIGNED(GMAnimationGameObjectHelper)
 	bool playing = true;
 	GMGameObject* host = nullptr;
 	GMVec4 skeletonColor = GMVec4(0, 1, 0, 1);
-	Map<GMModel*, GMAnimationEvaluator*> modelEvaluatorMap;
+	GMOwnedPtr<GMAnimationEvaluator> evaluator;
 	Vector<GMString> nameList;
 	GMsize_t animationIndex = 0;
+	bool updatedInBatch = false;
 };
 
 GMAnimationGameObjectHelper::GMAnimationGameObjectHelper(GMGameObject* host)
@@ -209,57 +96,79 @@ GMAnimationGameObjectHelper::GMAnimationGameObjectHelper(GMGameObject* host)
 }
 
 GMAnimationGameObjectHelper::~GMAnimationGameObjectHelper()
+{
+}
+
+void GMAnimationGameObjectHelper::update(GMDuration dt)
 {
 	D(d);
-	for (auto& kv : d->modelEvaluatorMap)
+	if (d->updatedInBatch)
 	{
-		GM_delete(kv.second);
+		// 本帧已经由updateBatch()计算过
+		d->updatedInBatch = false;
+		return;
+	}
+
+	GMAnimationEvaluator* evaluator = prepare();
+	if (evaluator)
+	{
+		evaluator->update(dt);
+		evaluator->apply(d->host->getScene());
 	}
 }
 
-void GMAnimationGameObjectHelper::update(GMDuration dt)
+void GMAnimationGameObjectHelper::updateBatch(GMAnimationGameObjectHelper* const* helpers, GMsize_t count, GMDuration dt)
 {
-	D(d);
-	if (d->playing)
+	// 编译动画片段会修改场景，在调用者线程中完成
+	Vector<GMAnimationGameObjectHelper*> activeHelpers;
+	Vector<GMAnimationEvaluator*> evaluators;
+	for (GMsize_t i = 0; i < count; ++i)
 	{
-		GMScene* scene = d->host->getScene();
-		if (!scene)
-			return;
+		GMAnimationEvaluator* evaluator = helpers[i]->prepare();
+		if (evaluator)
+		{
+			activeHelpers.push_back(helpers[i]);
+			evaluators.push_back(evaluator);
+		}
+	}
 
-		for (auto& model : scene->getModels())
+	GMAsync::parallelFor(evaluators.begin(), evaluators.end(), 1, [dt](auto begin, auto end) {
+		for (auto iter = begin; iter != end; ++iter)
 		{
-			auto animations = scene->getAnimations();
-			if (animations)
-			{
-				GMSkeleton* skeleton = model.getModel()->getSkeleton();
-				GMAnimationEvaluator* evaluator = d->modelEvaluatorMap[model.getModel()];
-				if (!evaluator)
-					evaluator = d->modelEvaluatorMap[model.getModel()] = new GMAnimationEvaluator(scene->getRootNode(), skeleton);
-
-				evaluator->setAnimation(animations->getAnimation(d->animationIndex));
-				evaluator->update(dt);
-
-				if (skeleton)
-				{
-					auto& transforms = evaluator->getTransforms();
-					model.getModel()->getBoneTransformations().swap(transforms);
-				}
-				else
-				{
-					// global transform 都记录在了对应的node上，找到对应的node，赋值给boneTransformations[0]
-					for (auto node : model.getModel()->getNodes())
-					{
-						GM_ASSERT(node);
-						auto& modelTransforms = model.getModel()->getBoneTransformations();
-						modelTransforms.clear();
-						modelTransforms.push_back(node->getGlobalTransform());
-					}
-				}
-			}
+			(*iter)->update(dt);
 		}
+	});
+
+	// 共享场景的对象会写入同一个模型，因此在调用者线程中依次写入
+	for (GMsize_t i = 0; i < activeHelpers.size(); ++i)
+	{
+		D_OF(d, activeHelpers[i]);
+		evaluators[i]->apply(d->host->getScene());
+		d->updatedInBatch = true;
 	}
 }
 
+GMAnimationEvaluator* GMAnimationGameObjectHelper::prepare()
+{
+	D(d);
+	if (!d->playing)
+		return nullptr;
+
+	GMScene* scene = d->host->getScene();
+	if (!scene)
+		return nullptr;
+
+	// 每次都从场景中获取动画片段，因为场景改变时动画片段会被重新编译
+	const GMAnimationClip* clip = scene->getAnimationClip(d->animationIndex);
+	if (!clip)
+		return nullptr;
+
+	if (!d->evaluator)
+		d->evaluator.reset(new GMAnimationEvaluator());
+	d->evaluator->setClip(clip);
+	return d->evaluator.get();
+}
+
 void GMAnimationGameObjectHelper::play()
 {
 	D(d);
@@ -275,11 +184,8 @@ void GMAnimationGameObjectHelper::pause()
 void GMAnimationGameObjectHelper::reset(bool update)
 {
 	D(d);
-	for (auto& evaluator : d->modelEvaluatorMap)
-	{
-		if (evaluator.second)
-			evaluator.second->reset();
-	}
+	if (d->evaluator)
+		d->evaluator->reset();
 
 	if (update)
 	{
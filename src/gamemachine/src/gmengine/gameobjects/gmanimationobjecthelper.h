@@ -4,29 +4,33 @@
 #include <gmgameobject.h>
 BEGIN_NS
 
-GM_DECLARE_POINTER(GMSkeleton);
-GM_DECLARE_POINTER(GMNode);
-typedef const GMNodeAnimation* GMNodeAnimationPtr;
+class GMAnimationClip;
 GM_PRIVATE_CLASS(GMAnimationEvaluator);
+//! 一个对象的动画计算状态。
+/*!
+  动画片段被所有共享场景的对象共享，每个对象只保存自己的播放时间、关键帧游标和计算结果。
+  一个对象中所有模型的骨骼都来自同一棵节点树，因此每一帧只计算一次节点树，再由它得到每个模型的变换。<BR>
+  不同对象的update()可以在多个线程中同时调用，apply()会修改共享的模型和节点，只能在一个线程中调用。
+*/
 class GMAnimationEvaluator
 {
 	GM_DECLARE_PRIVATE(GMAnimationEvaluator)
 	GM_DISABLE_COPY_ASSIGN(GMAnimationEvaluator)
-	GM_DECLARE_PROPERTY(GMSkeletonPtr, Skeleton)
-	GM_DECLARE_PROPERTY(GMNodePtr, RootNode)
-	GM_DECLARE_PROPERTY(GMNodeAnimationPtr, Animation)
-	GM_DECLARE_GETTER_ACCESSOR(AlignedVector<GMMat4>, Transforms, public)
 
 public:
-	GMAnimationEvaluator(GMNode* root, GMSkeleton* skeleton);
+	GMAnimationEvaluator();
 
 public:
+	//! 设置需要计算的动画片段。动画片段改变时，关键帧游标会被重置。
+	void setClip(const GMAnimationClip* clip);
+
+	//! 推进播放时间，计算节点树和每个模型的变换。
 	void update(GMDuration dt);
-	void reset();
 
-private:
-	void updateNode(GMDuration animationTime, GMNode* node, const GMMat4& parentTransformation);
-	const GMNodeAnimationNode* findAnimationNode(const GMString& name);
+	//! 将计算结果写入场景的模型和节点。
+	void apply(GMScene* scene);
+
+	void reset();
 };
 
 GM_PRIVATE_CLASS(GMAnimationGameObjectHelper);
@@ -44,6 +48,16 @@ public:
 public:
 	virtual void update(GMDuration dt);
 
+	//! 并行地计算多个对象的动画。
+	/*!
+	  所有对象的节点树和骨骼变换在任务系统中并行计算，之后在调用者线程中写入模型。
+	  本帧中这些对象接下来的update()将不再重复计算。
+	  \param helpers 对象的动画辅助类。
+	  \param count 对象的数目。
+	  \param dt 距离上一帧的时间。
+	*/
+	static void updateBatch(GMAnimationGameObjectHelper* const* helpers, GMsize_t count, GMDuration dt);
+
 public:
 	void play();
 	void pause();
@@ -56,6 +70,9 @@ public:
 
 public:
 	bool isPlaying() GM_NOEXCEPT;
+
+private:
+	GMAnimationEvaluator* prepare();
 };
 
 END_NS
@@ -79,13 +79,52 @@ void GMGameObjectPrivate::releaseAllBufferHandle()
 void GMGameObjectPrivate::updateTransformMatrix()
 {
 	transforms.transformMatrix = transforms.scaling * QuatToMatrix(transforms.rotation) * transforms.translation;
+
+	// 通知世界对象的包围盒已经改变，世界会在绘制前统一更新场景BVH
+	if (world)
+	{
+		P_D(pd);
+		world->markObjectBoundsDirty(pd);
+	}
+}
+
+void GMGameObjectPrivate::calculateWorldAABB(REF GMVec3& min, REF GMVec3& max)
+{
+	// 将所有Model的AABB合并，再变换到世界坐标系
+	GMVec4 localMin(FLT_MAX, FLT_MAX, FLT_MAX, 1);
+	GMVec4 localMax(-FLT_MAX, -FLT_MAX, -FLT_MAX, 1);
+	for (const auto& aabb : cullAABB)
+	{
+		for (const auto& point : aabb.points)
+		{
+			localMin = MinComponent(localMin, point);
+			localMax = MaxComponent(localMax, point);
+		}
+	}
+
+	min = GMVec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	max = GMVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (GMint32 i = 0; i < 8; ++i)
+	{
+		GMVec4 corner(
+			(i & 1) ? localMax.getX() : localMin.getX(),
+			(i & 2) ? localMax.getY() : localMin.getY(),
+			(i & 4) ? localMax.getZ() : localMin.getZ(),
+			1
+		);
+		GMVec3 transformed = corner * transforms.transformMatrix;
+		min = MinComponent(min, transformed);
+		max = MaxComponent(max, transformed);
+	}
 }
 
 GM_DEFINE_PROPERTY(GMGameObject, GMGameObjectRenderPriority, RenderPriority, renderPriority)
+GM_DEFINE_PROPERTY(GMGameObject, bool, Instancing, instancing)
 
 GMGameObject::GMGameObject()
 {
 	GM_CREATE_DATA();
+	GM_SET_PD();
 
 	D(d);
 	d->helper = new GMAnimationGameObjectHelper(this);
@@ -227,6 +266,23 @@ void GMGameObject::update(GMDuration dt)
 	}
 }
 
+void GMGameObject::updateAnimations(GMGameObject* const* objects, GMsize_t count, GMDuration dt)
+{
+	Vector<GMAnimationGameObjectHelper*> helpers;
+	helpers.reserve(count);
+	for (GMsize_t i = 0; i < count; ++i)
+	{
+		GMGameObject* object = objects[i];
+		if (object->getAnimationType() != GMAnimationType::NoAnimation)
+		{
+			D_OF(d, object);
+			GM_ASSERT(d->helper);
+			helpers.push_back(d->helper);
+		}
+	}
+	GMAnimationGameObjectHelper::updateBatch(helpers.data(), helpers.size(), dt);
+}
+
 bool GMGameObject::canDeferredRendering()
 {
 	D(d);
@@ -248,6 +304,30 @@ bool GMGameObject::canDeferredRendering()
 	return true;
 }
 
+bool GMGameObject::canInstancing()
+{
+	D(d);
+	if (!d->instancing || !d->attributes.visible)
+		return false;
+
+	if (getAnimationType() != GMAnimationType::NoAnimation)
+		return false;
+
+	GMScene* scene = getScene();
+	if (!scene)
+		return false;
+
+	for (decltype(auto) model : scene->getModels())
+	{
+		if (model.getModel()->getType() != GMModelType::Model3D)
+			return false;
+
+		if (model.getModel()->getShader().getBlend() == true)
+			return false;
+	}
+	return true;
+}
+
 const IRenderContext* GMGameObject::getContext()
 {
 	D(d);
@@ -394,6 +474,10 @@ void GMGameObject::setCullOption(GMGameObjectCullOption option, GMCamera* camera
 			shader.setCulled(false);
 		}
 	}
+
+	// 裁剪方式改变后，对象可能需要加入或者离开场景BVH
+	if (d->world)
+		d->world->markObjectBoundsDirty(this);
 }
 
 
@@ -611,11 +695,12 @@ void GMGameObject::cull()
 			// 计算每个Model的AABB是否与相机Frustum有交集，如果没有，则不进行绘制
 			GM_ASSERT(d->cullAABB.size() == models.size());
 
-			GMAsync::blockedAsync(
-				GMAsync::Async,
-				GM.getRunningStates().systemInfo.numberOfProcessors,
+			// 每个任务处理若干个Model，Model较少时直接在当前线程完成
+			enum { ModelsPerJob = 16 };
+			GMAsync::parallelFor(
 				d->cullAABB.begin(),
 				d->cullAABB.end(),
+				ModelsPerJob,
 				[d, &models, this](auto begin, auto end) {
 				// 计算一下数据偏移
 				for (auto iter = begin; iter != end; ++iter)
@@ -27,6 +27,7 @@ class GM_EXPORT GMGameObject : public GMObject
 {
 	GM_DECLARE_PRIVATE(GMGameObject)
 	GM_DECLARE_PROPERTY(GMGameObjectRenderPriority, RenderPriority)
+	GM_DECLARE_PROPERTY(bool, Instancing)
 	GM_FRIEND_CLASS(GMGameWorld)
 
 public:
@@ -75,6 +76,23 @@ public:
 	virtual void draw();
 	virtual void update(GMDuration dt);
 	virtual bool canDeferredRendering();
+
+	//! 并行地计算多个对象的动画。
+	/*!
+	  没有动画的对象会被忽略。本帧中这些对象接下来的update()不会再重复计算动画。
+	  \param objects 需要计算动画的对象。
+	  \param count 对象的数目。
+	  \param dt 距离上一帧的时间。
+	*/
+	static void updateAnimations(GMGameObject* const* objects, GMsize_t count, GMDuration dt);
+
+	//! 判断此对象是否可以与共享同一个场景的对象合并为一次实例化绘制。
+	/*!
+	  只有通过setInstancing(true)开启了实例化，并且可见、没有动画、所有模型都是不透明的3D模型的对象，才可以实例化绘制。<BR>
+	  实例化绘制时不会调用对象的draw()，onRenderShader()也只对批次中的第一个对象调用。如果子类重写了这些方法，不应该开启实例化。
+	  \return 是否可以实例化绘制。
+	*/
+	virtual bool canInstancing();
 	virtual const IRenderContext* getContext();
 	virtual void onRenderShader(GMModel*, IShaderProgram* shaderProgram) const {}
 
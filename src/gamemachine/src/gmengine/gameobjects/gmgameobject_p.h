@@ -2,6 +2,7 @@
 #define __GAMEOBJECT_P_H__
 #include <gmcommon.h>
 #include <linearmath.h>
+#include <gmscenebvh.h>
 
 BEGIN_NS
 
@@ -9,8 +10,10 @@ struct IComputeShaderProgram;
 
 GM_PRIVATE_OBJECT_ALIGNED(GMGameObject)
 {
+	GM_DECLARE_PUBLIC(GMGameObject)
 	GMuint32 id = 0;
 	GMGameObjectRenderPriority renderPriority = GMGameObjectRenderPriority::Normal; //!< 渲染优先级。优先级最高的对象将会在GMGameWorld中被优先渲染。
+	bool instancing = false; //!< 是否允许与共享同一个场景的对象合并为一次实例化绘制。
 	GMOwnedPtr<GMPhysicsObject> physics;
 	GMGameWorld* world = nullptr;
 	const IRenderContext* context = nullptr;
@@ -34,6 +37,10 @@ GM_PRIVATE_OBJECT_ALIGNED(GMGameObject)
 	GMComputeUAVHandle cullResultUAV = 0;
 	GMsize_t cullSize = 0;
 	bool cullGPUAccelerationValid = true;
+	GMint32 bvhProxy = GMSceneBVH::InvalidProxy; //!< 对象在GMGameWorld场景BVH中的代理。
+	bool bvhBoundsDirty = false; //!< 对象的包围盒是否需要在下一次绘制前同步到场景BVH中。
+	GMint32 renderListId = -1; //!< 对象所在的GMGameWorld渲染列表，-1表示不在渲染列表中。
+	GMint64 renderListOrder = 0; //!< 对象在渲染列表中的次序，越小越靠前。
 
 	GM_ALIGNED_16(struct)
 	{
@@ -56,6 +63,7 @@ GM_PRIVATE_OBJECT_ALIGNED(GMGameObject)
 	void setAutoUpdateTransformMatrix(bool autoUpdateTransformMatrix) GM_NOEXCEPT;
 	void releaseAllBufferHandle();
 	void updateTransformMatrix();
+	void calculateWorldAABB(REF GMVec3& min, REF GMVec3& max);
 };
 
 END_NS
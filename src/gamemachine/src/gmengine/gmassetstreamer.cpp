@@ -0,0 +1,506 @@
+﻿#include "stdafx.h"
+#include "gmassetstreamer.h"
+#include "foundation/gamemachine.h"
+#include "foundation/gmasync.h"
+#include "gmdata/gmimage.h"
+#include "gmdata/gmmodel.h"
+#include "gmdata/imagereader/gmimagereader.h"
+#include "foundation/gmprofile.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+BEGIN_NS
+
+struct GMAssetStreamRequest
+{
+	struct Upload
+	{
+		GMAssetUploadFunction function;
+		GMsize_t bytes = 0;
+	};
+
+	GMAssetDecodeFunction decode;
+	GMAssetStreamCallback callback;
+	GMAsset placeholder;
+	GMAsset asset;
+	Vector<Upload> uploads; // 解码时只有解码线程访问，解码结束后由streamer的锁保护
+	GMsize_t nextUpload = 0;
+	GMint32 priority = 0;
+	GMint64 sequence = 0;
+	GMAtomic<GMAssetStreamState> state { GMAssetStreamState::Pending };
+};
+
+namespace
+{
+	// 当前线程正在解码的请求
+	thread_local GMAssetStreamRequest* t_decoding = nullptr;
+
+	// 堆顶为优先级最高、最早提交的请求
+	struct RequestOrder
+	{
+		bool operator()(const GMAssetStreamHandle& a, const GMAssetStreamHandle& b) const
+		{
+			if (a->priority != b->priority)
+				return a->priority < b->priority;
+			return a->sequence > b->sequence;
+		}
+	};
+
+	bool removeFromHeap(Vector<GMAssetStreamHandle>& heap, const GMAssetStreamHandle& handle)
+	{
+		auto iter = std::find(heap.begin(), heap.end(), handle);
+		if (iter == heap.end())
+			return false;
+
+		heap.erase(iter);
+		std::make_heap(heap.begin(), heap.end(), RequestOrder());
+		return true;
+	}
+
+	GMsize_t getVerticesBytes(GMModel* model)
+	{
+		GMsize_t count = 0;
+		for (auto part : model->getParts())
+		{
+			count += part->vertices().size();
+		}
+		return count * sizeof(GMVertex);
+	}
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMAssetStreamer)
+{
+	const IRenderContext* context = nullptr;
+	GMJobSystem* jobSystem = nullptr;
+	GMMutex lock;
+	Vector<GMAssetStreamHandle> pending; // 等待解码的请求
+	Vector<GMAssetStreamHandle> uploading; // 等待上传的请求
+	Vector<GMAssetStreamHandle> failed; // 等待调用回调的失败请求
+	List<GMJobHandle> jobs;
+	GMint64 nextSequence = 0;
+	GMsize_t active = 0;
+	GMint64 budgetMicroseconds = GMAssetStreamer::DefaultUploadBudgetMicroseconds;
+	GMsize_t budgetBytes = GMAssetStreamer::DefaultUploadBudgetBytes;
+
+	GMJobSystem* getJobSystem();
+	void decodeNext();
+	void decode(const GMAssetStreamHandle& handle);
+	bool hasUpload(const GMAssetStreamHandle& handle);
+	void complete(const GMAssetStreamHandle& handle);
+};
+
+GMJobSystem* GMAssetStreamerPrivate::getJobSystem()
+{
+	return jobSystem ? jobSystem : GMAsync::getJobSystem();
+}
+
+void GMAssetStreamerPrivate::decodeNext()
+{
+	GMAssetStreamHandle handle;
+	{
+		GMMutexLock m(&lock);
+		m->lock();
+		if (pending.empty())
+			return;
+
+		std::pop_heap(pending.begin(), pending.end(), RequestOrder());
+		handle = std::move(pending.back());
+		pending.pop_back();
+		handle->state = GMAssetStreamState::Decoding;
+	}
+	decode(handle);
+}
+
+void GMAssetStreamerPrivate::decode(const GMAssetStreamHandle& handle)
+{
+	GMAsset asset;
+	t_decoding = handle.get();
+	bool success = handle->decode(asset);
+	t_decoding = nullptr;
+
+	GMMutexLock m(&lock);
+	m->lock();
+	if (handle->state == GMAssetStreamState::Cancelled)
+	{
+		handle->uploads.clear();
+		return;
+	}
+
+	if (success)
+	{
+		handle->asset = std::move(asset);
+		handle->state = GMAssetStreamState::Uploading;
+		uploading.push_back(handle);
+		std::push_heap(uploading.begin(), uploading.end(), RequestOrder());
+	}
+	else
+	{
+		handle->uploads.clear();
+		handle->state = GMAssetStreamState::Failed;
+		failed.push_back(handle);
+		--active;
+	}
+}
+
+bool GMAssetStreamerPrivate::hasUpload(const GMAssetStreamHandle& handle)
+{
+	// 调用者已经持有lock
+	return handle->nextUpload < handle->uploads.size();
+}
+
+void GMAssetStreamerPrivate::complete(const GMAssetStreamHandle& handle)
+{
+	// 调用者已经持有lock，并且已经将请求从uploading中移除
+	handle->uploads.clear();
+	handle->uploads.shrink_to_fit();
+	handle->state = GMAssetStreamState::Ready;
+	--active;
+}
+
+GMAssetStreamer::GMAssetStreamer(const IRenderContext* context, GMJobSystem* jobSystem)
+{
+	GM_CREATE_DATA();
+
+	D(d);
+	d->context = context;
+	d->jobSystem = jobSystem;
+}
+
+GMAssetStreamer::~GMAssetStreamer()
+{
+	D(d);
+	List<GMJobHandle> jobs;
+	{
+		GMMutexLock m(&d->lock);
+		m->lock();
+		for (auto& handle : d->pending)
+		{
+			handle->state = GMAssetStreamState::Cancelled;
+		}
+		d->pending.clear();
+		jobs.swap(d->jobs);
+	}
+
+	// 任务中引用了私有数据，需要等待正在解码的任务结束
+	if (GMJobSystem* jobSystem = d->getJobSystem())
+	{
+		for (auto& job : jobs)
+		{
+			jobSystem->wait(job);
+		}
+	}
+}
+
+GMAssetStreamHandle GMAssetStreamer::request(
+	GMAssetDecodeFunction decode,
+	GMint32 priority,
+	const GMAsset& placeholder,
+	GMAssetStreamCallback callback
+)
+{
+	D(d);
+	GMAssetStreamHandle handle = std::make_shared<GMAssetStreamRequest>();
+	handle->decode = std::move(decode);
+	handle->callback = std::move(callback);
+	handle->placeholder = placeholder;
+	handle->priority = priority;
+	{
+		GMMutexLock m(&d->lock);
+		m->lock();
+		handle->sequence = d->nextSequence++;
+		d->pending.push_back(handle);
+		std::push_heap(d->pending.begin(), d->pending.end(), RequestOrder());
+		++d->active;
+	}
+
+	// 每个任务解码一个当前优先级最高的请求，不一定是这一个
+	GMJobSystem* jobSystem = d->getJobSystem();
+	if (jobSystem)
+	{
+		GMJobHandle job = jobSystem->createJob([d]() { d->decodeNext(); });
+		{
+			GMMutexLock m(&d->lock);
+			m->lock();
+			d->jobs.push_back(job);
+		}
+		jobSystem->run(job);
+	}
+	else
+	{
+		d->decodeNext();
+	}
+	return handle;
+}
+
+GMAssetStreamHandle GMAssetStreamer::requestTexture(
+	GMPackageIndex index,
+	const GMString& filename,
+	GMint32 priority,
+	const GMTextureAsset& placeholder,
+	GMAssetStreamCallback callback
+)
+{
+	D(d);
+	const IRenderContext* context = d->context;
+	auto decode = [context, index, filename](REF GMAsset& asset) {
+		GMBuffer buffer;
+		if (!GM.getGamePackageManager()->readFile(index, filename, &buffer))
+			return false;
+
+		GMImage* image = nullptr;
+		if (!GMImageReader::load(buffer.getData(), buffer.getSize(), &image))
+		{
+			if (image)
+				image->destroy();
+			return false;
+		}
+
+		// 需要GPU的图形引擎在工厂中通过deferUpload()推迟纹理的创建
+		GM.getFactory()->createTexture(context, image, asset);
+		image->destroy();
+		return !asset.isEmpty();
+	};
+	return request(decode, priority, placeholder, std::move(callback));
+}
+
+GMAssetStreamHandle GMAssetStreamer::requestModel(
+	const GMModelLoadSettings& settings,
+	GMint32 priority,
+	const GMSceneAsset& placeholder,
+	GMAssetStreamCallback callback
+)
+{
+	D(d);
+	const IRenderContext* context = settings.context ? settings.context : d->context;
+	GMModelLoadSettings settingsCopy = settings;
+	settingsCopy.context = context;
+	auto decode = [context, settingsCopy](REF GMAsset& asset) {
+		if (!GMModelReader::load(settingsCopy, asset))
+			return false;
+
+		GMScene* scene = asset.getScene();
+		if (!scene)
+			return false;
+
+		// 每个模型的顶点数据作为一次单独的上传，大的场景可以分摊到多帧中
+		for (GMAsset model : scene->getModels())
+		{
+			GMsize_t bytes = getVerticesBytes(model.getModel());
+			deferUpload([context, model]() mutable {
+				context->getEngine()->createModelDataProxy(context, model.getModel());
+			}, bytes);
+		}
+		return true;
+	};
+	return request(decode, priority, placeholder, std::move(callback));
+}
+
+GMAssetStreamState GMAssetStreamer::getState(const GMAssetStreamHandle& handle)
+{
+	return handle ? handle->state.load() : GMAssetStreamState::Failed;
+}
+
+GMAsset GMAssetStreamer::getAsset(const GMAssetStreamHandle& handle)
+{
+	D(d);
+	if (!handle)
+		return GMAsset();
+
+	GMMutexLock m(&d->lock);
+	m->lock();
+	return handle->state == GMAssetStreamState::Ready ? handle->asset : handle->placeholder;
+}
+
+void GMAssetStreamer::cancel(const GMAssetStreamHandle& handle)
+{
+	D(d);
+	if (!handle)
+		return;
+
+	GMMutexLock m(&d->lock);
+	m->lock();
+	switch (handle->state)
+	{
+	case GMAssetStreamState::Pending:
+		removeFromHeap(d->pending, handle);
+		break;
+	case GMAssetStreamState::Uploading:
+		// 已经执行的上传不会被撤销，资产随请求一起释放
+		removeFromHeap(d->uploading, handle);
+		handle->uploads.clear();
+		handle->asset = GMAsset();
+		break;
+	case GMAssetStreamState::Decoding:
+		// 解码结束时丢弃结果
+		break;
+	default:
+		return;
+	}
+	handle->state = GMAssetStreamState::Cancelled;
+	--d->active;
+}
+
+GMAssetStreamState GMAssetStreamer::finish(const GMAssetStreamHandle& handle)
+{
+	D(d);
+	if (!handle)
+		return GMAssetStreamState::Failed;
+
+	bool claimed = false;
+	{
+		GMMutexLock m(&d->lock);
+		m->lock();
+		if (handle->state == GMAssetStreamState::Pending)
+		{
+			removeFromHeap(d->pending, handle);
+			handle->state = GMAssetStreamState::Decoding;
+			claimed = true;
+		}
+	}
+
+	if (claimed)
+	{
+		d->decode(handle);
+	}
+	else
+	{
+		while (handle->state == GMAssetStreamState::Decoding)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	GMAssetStreamCallback callback;
+	for (;;)
+	{
+		GMAssetStreamRequest::Upload upload;
+		{
+			GMMutexLock m(&d->lock);
+			m->lock();
+			if (handle->state == GMAssetStreamState::Failed)
+			{
+				// 失败的回调在这里调用，update()中不再调用
+				auto iter = std::find(d->failed.begin(), d->failed.end(), handle);
+				if (iter != d->failed.end())
+				{
+					d->failed.erase(iter);
+					callback = handle->callback;
+				}
+				break;
+			}
+
+			if (handle->state != GMAssetStreamState::Uploading)
+				break;
+
+			if (!d->hasUpload(handle))
+			{
+				removeFromHeap(d->uploading, handle);
+				d->complete(handle);
+				callback = handle->callback;
+				break;
+			}
+			upload = std::move(handle->uploads[handle->nextUpload++]);
+		}
+		upload.function();
+	}
+
+	if (callback)
+		callback(handle->state == GMAssetStreamState::Ready ? handle->asset : GMAsset());
+	return handle->state;
+}
+
+void GMAssetStreamer::update()
+{
+	GM_TRACE_SCOPE("GMAssetStreamer::update");
+	D(d);
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+	const std::chrono::microseconds budget(d->budgetMicroseconds);
+	GMsize_t bytes = 0;
+	bool first = true;
+
+	Vector<GMAssetStreamHandle> completed;
+	{
+		GMMutexLock m(&d->lock);
+		m->lock();
+		completed.swap(d->failed);
+
+		// 顺便清理已经结束的任务
+		if (GMJobSystem* jobSystem = d->getJobSystem())
+		{
+			d->jobs.remove_if([jobSystem](const GMJobHandle& job) { return jobSystem->isFinished(job); });
+		}
+	}
+
+	for (;;)
+	{
+		GMAssetStreamRequest::Upload upload;
+		{
+			GMMutexLock m(&d->lock);
+			m->lock();
+			if (d->uploading.empty())
+				break;
+
+			GMAssetStreamHandle handle = d->uploading.front();
+			if (!d->hasUpload(handle))
+			{
+				// 上传全部完成的请求不占用预算
+				std::pop_heap(d->uploading.begin(), d->uploading.end(), RequestOrder());
+				d->uploading.pop_back();
+				d->complete(handle);
+				completed.push_back(handle);
+				continue;
+			}
+
+			// 至少执行一个上传，保证超过预算的上传也能完成
+			if (!first && (bytes >= d->budgetBytes || Clock::now() - start >= budget))
+				break;
+
+			upload = std::move(handle->uploads[handle->nextUpload++]);
+		}
+
+		upload.function();
+		bytes += upload.bytes;
+		first = false;
+	}
+
+	// 回调中可能提交新的请求，因此在锁外调用
+	for (const auto& handle : completed)
+	{
+		if (handle->callback)
+			handle->callback(handle->state == GMAssetStreamState::Ready ? handle->asset : GMAsset());
+	}
+}
+
+void GMAssetStreamer::setUploadBudget(GMint64 microseconds, GMsize_t bytes)
+{
+	D(d);
+	GMMutexLock m(&d->lock);
+	m->lock();
+	d->budgetMicroseconds = microseconds;
+	d->budgetBytes = bytes;
+}
+
+GMsize_t GMAssetStreamer::getPendingCount()
+{
+	D(d);
+	GMMutexLock m(&d->lock);
+	m->lock();
+	return d->active;
+}
+
+bool GMAssetStreamer::isDecodingThread()
+{
+	return !!t_decoding;
+}
+
+void GMAssetStreamer::deferUpload(GMAssetUploadFunction upload, GMsize_t bytes)
+{
+	if (t_decoding)
+		t_decoding->uploads.push_back({ std::move(upload), bytes });
+	else
+		upload();
+}
+
+END_NS
@@ -0,0 +1,166 @@
+﻿#ifndef __GMASSETSTREAMER_H__
+#define __GMASSETSTREAMER_H__
+#include <gmcommon.h>
+#include <gmassets.h>
+#include <gmgamepackage.h>
+#include <gmmodelreader.h>
+BEGIN_NS
+
+class GMJobSystem;
+
+//! 流式加载请求的状态。
+enum class GMAssetStreamState
+{
+	Pending, //!< 等待解码。
+	Decoding, //!< 正在读取和解码。
+	Uploading, //!< 解码完成，等待在主线程中上传。
+	Ready, //!< 资产已经可以使用。
+	Failed, //!< 读取或者解码失败。
+	Cancelled, //!< 请求被取消。
+};
+
+struct GMAssetStreamRequest;
+typedef GMSharedPtr<GMAssetStreamRequest> GMAssetStreamHandle;
+
+//! 解码函数，在工作线程中执行。
+/*!
+  解码函数读取并解码资产，需要访问GPU的操作通过GMAssetStreamer::deferUpload()推迟到主线程。
+  \param asset 解码得到的资产。
+  \return 是否解码成功。
+*/
+typedef std::function<bool(REF GMAsset& asset)> GMAssetDecodeFunction;
+
+//! 请求结束时在主线程中调用的回调。资产就绪时参数为资产，失败时参数为空资产，取消的请求不会调用回调。
+typedef std::function<void(GMAsset asset)> GMAssetStreamCallback;
+
+//! 上传函数，在主线程中执行。
+typedef std::function<void()> GMAssetUploadFunction;
+
+GM_PRIVATE_CLASS(GMAssetStreamer);
+//! 资产的流式加载器。
+/*!
+  读取和解码在引擎的任务系统中进行，优先级高的请求先被解码。需要访问GPU的上传（例如创建纹理、传输顶点数据）被推迟到主线程，
+  由update()在每帧的时间和字节预算内执行，因此加载大量资产时窗口不会停止响应。<BR>
+  每个请求返回一个句柄，资产就绪之前，getAsset()返回请求时指定的占位资产。<BR>
+  每个图形引擎拥有一个加载器，并在最外层的GMGraphicEngine::begin()中调用update()。
+  \sa GMGraphicEngine::getAssetStreamer()
+*/
+class GM_EXPORT GMAssetStreamer
+{
+	GM_DECLARE_PRIVATE(GMAssetStreamer)
+	GM_DISABLE_COPY_ASSIGN(GMAssetStreamer)
+
+public:
+	enum
+	{
+		DefaultUploadBudgetMicroseconds = 4000, //!< 每帧上传的默认时间预算，单位为微秒。
+		DefaultUploadBudgetBytes = 16 * 1024 * 1024, //!< 每帧上传的默认字节预算。
+	};
+
+	//! 构造一个流式加载器。
+	/*!
+	  \param context 上传资产时使用的绘制环境上下文。
+	  \param jobSystem 解码所用的任务系统。如果为空，则使用引擎的任务系统；如果引擎没有任务系统，解码在请求的线程中进行。
+	*/
+	GMAssetStreamer(const IRenderContext* context, GMJobSystem* jobSystem = nullptr);
+	~GMAssetStreamer();
+
+public:
+	//! 提交一个流式加载请求。
+	/*!
+	  \param decode 解码函数，在工作线程中执行。
+	  \param priority 优先级，数值大的请求先被解码和上传。优先级相同的请求按照提交的顺序处理。
+	  \param placeholder 资产就绪之前使用的占位资产。
+	  \param callback 请求结束时在主线程中调用的回调。
+	  \return 请求的句柄。
+	*/
+	GMAssetStreamHandle request(
+		GMAssetDecodeFunction decode,
+		GMint32 priority = 0,
+		const GMAsset& placeholder = GMAsset(),
+		GMAssetStreamCallback callback = GMAssetStreamCallback()
+	);
+
+	//! 流式加载一张纹理。
+	/*!
+	  \param index 纹理所在的资源类型。
+	  \param filename 纹理的文件名。
+	  \param priority 优先级。
+	  \param placeholder 纹理就绪之前使用的占位纹理。
+	  \param callback 请求结束时在主线程中调用的回调。
+	  \return 请求的句柄。
+	  \sa request()
+	*/
+	GMAssetStreamHandle requestTexture(
+		GMPackageIndex index,
+		const GMString& filename,
+		GMint32 priority = 0,
+		const GMTextureAsset& placeholder = GMTextureAsset(),
+		GMAssetStreamCallback callback = GMAssetStreamCallback()
+	);
+
+	//! 流式加载一个模型场景。
+	/*!
+	  模型读取器创建的纹理和场景中每个模型的顶点数据都在主线程中上传。
+	  \param settings 模型的读取配置。
+	  \param priority 优先级。
+	  \param placeholder 场景就绪之前使用的占位场景。
+	  \param callback 请求结束时在主线程中调用的回调。
+	  \return 请求的句柄。
+	  \sa request()
+	*/
+	GMAssetStreamHandle requestModel(
+		const GMModelLoadSettings& settings,
+		GMint32 priority = 0,
+		const GMSceneAsset& placeholder = GMSceneAsset(),
+		GMAssetStreamCallback callback = GMAssetStreamCallback()
+	);
+
+	//! 获取请求的状态。
+	GMAssetStreamState getState(const GMAssetStreamHandle& handle);
+
+	//! 获取请求的资产。资产就绪之前返回占位资产。
+	GMAsset getAsset(const GMAssetStreamHandle& handle);
+
+	//! 取消一个请求。已经就绪的请求不受影响。
+	void cancel(const GMAssetStreamHandle& handle);
+
+	//! 在主线程中完成一个请求。
+	/*!
+	  如果请求还没有开始解码，则在当前线程中解码；如果正在解码，则等待解码结束。之后立即执行它的所有上传，不受预算限制。
+	  \param handle 请求的句柄。
+	  \return 请求最终的状态。
+	*/
+	GMAssetStreamState finish(const GMAssetStreamHandle& handle);
+
+	//! 在预算内执行上传，并调用已经结束的请求的回调。必须在主线程中调用。
+	/*!
+	  每次调用至少执行一个上传，因此超过预算的上传也能完成。
+	*/
+	void update();
+
+	//! 设置每次update()的预算。
+	/*!
+	  \param microseconds 时间预算，单位为微秒。
+	  \param bytes 字节预算。
+	*/
+	void setUploadBudget(GMint64 microseconds, GMsize_t bytes);
+
+	//! 获取还没有结束的请求数目。
+	GMsize_t getPendingCount();
+
+public:
+	//! 判断当前线程是否正在为某个流式加载请求解码。
+	static bool isDecodingThread();
+
+	//! 提交一个需要在主线程中执行的上传。
+	/*!
+	  如果当前线程正在为某个请求解码，上传会在这个请求的解码结束后，由update()在预算内执行。否则立即执行。
+	  \param upload 上传函数。
+	  \param bytes 上传的字节数，用于计算预算。
+	*/
+	static void deferUpload(GMAssetUploadFunction upload, GMsize_t bytes);
+};
+
+END_NS
+#endif
@@ -0,0 +1,179 @@
+﻿#include "stdafx.h"
+#include "gmbonepalette.h"
+
+BEGIN_NS
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMBonePalette)
+{
+	Vector<GMfloat> data;
+	HashMap<const GMModel*, GMsize_t> offsets;
+	GMuint32 generation = 0;
+};
+
+GMBonePalette::GMBonePalette()
+{
+	GM_CREATE_DATA();
+}
+
+GMBonePalette::~GMBonePalette()
+{
+
+}
+
+void GMBonePalette::clear()
+{
+	D(d);
+	d->data.clear();
+	d->offsets.clear();
+	++d->generation;
+}
+
+GMsize_t GMBonePalette::add(GMModel* model, GMSkinningMode mode)
+{
+	D(d);
+	GM_ASSERT(model);
+	auto iter = d->offsets.find(model);
+	if (iter != d->offsets.end())
+		return iter->second;
+
+	const auto& transforms = model->getBoneTransformations();
+	GMsize_t offset = add(transforms.data(), transforms.size(), mode);
+	d->offsets[model] = offset;
+	return offset;
+}
+
+GMsize_t GMBonePalette::add(const GMMat4* transforms, GMsize_t count, GMSkinningMode mode)
+{
+	D(d);
+	const GMsize_t offset = getSize();
+	const GMsize_t stride = getBoneStride(mode);
+	d->data.resize(d->data.size() + count * stride * 4);
+
+	GMfloat* dst = d->data.data() + offset * 4;
+	for (GMsize_t i = 0; i < count; ++i, dst += stride * 4)
+	{
+		if (mode == GMSkinningMode::DualQuaternion)
+		{
+			GMVec4 real, dual;
+			toDualQuaternion(transforms[i], real, dual);
+			GMFloat4 f4Real, f4Dual;
+			real.loadFloat4(f4Real);
+			dual.loadFloat4(f4Dual);
+			memcpy(dst, &f4Real[0], sizeof(GMfloat) * 4);
+			memcpy(dst + 4, &f4Dual[0], sizeof(GMfloat) * 4);
+		}
+		else
+		{
+			memcpy(dst, ValuePointer(transforms[i]), sizeof(GMfloat) * 16);
+		}
+	}
+	return offset;
+}
+
+const GMfloat* GMBonePalette::getData() const
+{
+	D(d);
+	return d->data.data();
+}
+
+GMsize_t GMBonePalette::getSize() const
+{
+	D(d);
+	return d->data.size() / 4;
+}
+
+GMuint32 GMBonePalette::getGeneration() const
+{
+	D(d);
+	return d->generation;
+}
+
+GMsize_t GMBonePalette::getBoneStride(GMSkinningMode mode)
+{
+	return mode == GMSkinningMode::DualQuaternion ? 2 : 4;
+}
+
+void GMBonePalette::toDualQuaternion(const GMMat4& transform, OUT GMVec4& real, OUT GMVec4& dual)
+{
+	// 矩阵按行存放，行向量右乘矩阵。r(i, j)为列向量形式的旋转矩阵的第i行第j列
+	GMFloat16 m;
+	transform.loadFloat16(m);
+	auto r = [&m](GMint32 i, GMint32 j) { return m[j][i]; };
+
+	GMfloat x, y, z, w;
+	GMfloat trace = r(0, 0) + r(1, 1) + r(2, 2);
+	if (trace > 0)
+	{
+		GMfloat s = Sqrt(trace + 1.f) * 2.f;
+		w = .25f * s;
+		x = (r(2, 1) - r(1, 2)) / s;
+		y = (r(0, 2) - r(2, 0)) / s;
+		z = (r(1, 0) - r(0, 1)) / s;
+	}
+	else if (r(0, 0) > r(1, 1) && r(0, 0) > r(2, 2))
+	{
+		GMfloat s = Sqrt(1.f + r(0, 0) - r(1, 1) - r(2, 2)) * 2.f;
+		w = (r(2, 1) - r(1, 2)) / s;
+		x = .25f * s;
+		y = (r(0, 1) + r(1, 0)) / s;
+		z = (r(0, 2) + r(2, 0)) / s;
+	}
+	else if (r(1, 1) > r(2, 2))
+	{
+		GMfloat s = Sqrt(1.f + r(1, 1) - r(0, 0) - r(2, 2)) * 2.f;
+		w = (r(0, 2) - r(2, 0)) / s;
+		x = (r(0, 1) + r(1, 0)) / s;
+		y = .25f * s;
+		z = (r(1, 2) + r(2, 1)) / s;
+	}
+	else
+	{
+		GMfloat s = Sqrt(1.f + r(2, 2) - r(0, 0) - r(1, 1)) * 2.f;
+		w = (r(1, 0) - r(0, 1)) / s;
+		x = (r(0, 2) + r(2, 0)) / s;
+		y = (r(1, 2) + r(2, 1)) / s;
+		z = .25f * s;
+	}
+
+	// 对偶部为 0.5 * t * real，t为纯四元数(平移, 0)
+	GMVec3 q(x, y, z);
+	GMVec3 t(m[3][0], m[3][1], m[3][2]);
+	GMVec3 v = (t * w + Cross(t, q)) * .5f;
+	real = GMVec4(x, y, z, w);
+	dual = GMVec4(v.getX(), v.getY(), v.getZ(), -.5f * Dot(t, q));
+}
+
+GMMat4 GMBonePalette::fromDualQuaternion(const GMVec4& real, const GMVec4& dual)
+{
+	GMfloat len = Length(real);
+	GMVec4 r = real / len;
+	GMVec4 d = dual / len;
+	GMVec3 rv(r.getX(), r.getY(), r.getZ());
+	GMVec3 dv(d.getX(), d.getY(), d.getZ());
+	GMVec3 t = (dv * r.getW() - rv * d.getW() + Cross(rv, dv)) * 2.f;
+
+	GMfloat x = r.getX(), y = r.getY(), z = r.getZ(), w = r.getW();
+	GMFloat16 m;
+	m[0][0] = 1.f - 2.f * (y * y + z * z);
+	m[0][1] = 2.f * (x * y + w * z);
+	m[0][2] = 2.f * (x * z - w * y);
+	m[0][3] = 0;
+	m[1][0] = 2.f * (x * y - w * z);
+	m[1][1] = 1.f - 2.f * (x * x + z * z);
+	m[1][2] = 2.f * (y * z + w * x);
+	m[1][3] = 0;
+	m[2][0] = 2.f * (x * z + w * y);
+	m[2][1] = 2.f * (y * z - w * x);
+	m[2][2] = 1.f - 2.f * (x * x + y * y);
+	m[2][3] = 0;
+	m[3][0] = t.getX();
+	m[3][1] = t.getY();
+	m[3][2] = t.getZ();
+	m[3][3] = 1.f;
+
+	GMMat4 result;
+	result.setFloat16(m);
+	return result;
+}
+
+END_NS
@@ -0,0 +1,81 @@
+﻿#ifndef __GMBONEPALETTE_H__
+#define __GMBONEPALETTE_H__
+#include <gmcommon.h>
+#include <linearmath.h>
+#include <gmmodel.h>
+BEGIN_NS
+
+GM_PRIVATE_CLASS(GMBonePalette);
+//! 一帧中所有动画模型共用的骨骼调色板。
+/*!
+  绘制动画模型时，它的骨骼变换被追加到调色板中，着色器通过模型在调色板中的偏移和骨骼索引读取骨骼变换，因此骨骼数目不再受统一变量数目的限制，
+  也不必在每次绘制时上传整个骨骼数组。<BR>
+  调色板以4个浮点数为一个单位。线性混合蒙皮的每个骨骼占用4个单位，依次存放矩阵的4行；对偶四元数蒙皮的每个骨骼占用2个单位，依次存放实部和对偶部。<BR>
+  同一帧中多次绘制同一个模型（例如绘制阴影和绘制模型本身）时，它的骨骼变换只追加一次。图形引擎在每一帧开始时清空调色板。
+*/
+class GM_EXPORT GMBonePalette
+{
+	GM_DECLARE_PRIVATE(GMBonePalette)
+	GM_DISABLE_COPY_ASSIGN(GMBonePalette)
+
+public:
+	GMBonePalette();
+	~GMBonePalette();
+
+public:
+	//! 清空调色板。
+	void clear();
+
+	//! 将一个模型的骨骼变换追加到调色板中。
+	/*!
+	  如果此模型的骨骼变换在上一次clear()之后已经追加过，直接返回之前的偏移。
+	  \param model 需要绘制的模型，其骨骼变换为GMModel::getBoneTransformations()。
+	  \param mode 蒙皮方式。
+	  \return 此模型的第一个骨骼在调色板中的偏移，以4个浮点数为单位。
+	*/
+	GMsize_t add(GMModel* model, GMSkinningMode mode);
+
+	//! 将一组骨骼变换追加到调色板中。
+	/*!
+	  \param transforms 骨骼变换。
+	  \param count 骨骼变换的数目。
+	  \param mode 蒙皮方式。
+	  \return 第一个骨骼在调色板中的偏移，以4个浮点数为单位。
+	*/
+	GMsize_t add(const GMMat4* transforms, GMsize_t count, GMSkinningMode mode);
+
+	//! 获取调色板的数据。
+	const GMfloat* getData() const;
+
+	//! 获取调色板的大小，以4个浮点数为单位。
+	GMsize_t getSize() const;
+
+	//! 获取调色板被清空的次数。
+	/*!
+	  图形引擎据此判断已经上传到显卡的数据是否仍然有效。
+	*/
+	GMuint32 getGeneration() const;
+
+public:
+	//! 获取一个骨骼在调色板中占用的单位数。
+	static GMsize_t getBoneStride(GMSkinningMode mode);
+
+	//! 将只包含旋转和平移的变换转换为对偶四元数。
+	/*!
+	  \param transform 骨骼变换。缩放和切变将被忽略。
+	  \param real 对偶四元数的实部，表示旋转，分量依次为x、y、z、w。
+	  \param dual 对偶四元数的对偶部，包含平移。
+	*/
+	static void toDualQuaternion(const GMMat4& transform, OUT GMVec4& real, OUT GMVec4& dual);
+
+	//! 将对偶四元数转换为变换矩阵，与着色器中的计算方式相同。
+	/*!
+	  \param real 对偶四元数的实部，不必是单位四元数。
+	  \param dual 对偶四元数的对偶部。
+	  \return 变换矩阵。
+	*/
+	static GMMat4 fromDualQuaternion(const GMVec4& real, const GMVec4& dual);
+};
+
+END_NS
+#endif
@@ -6,6 +6,8 @@
 #include <time.h>
 #include "foundation/gamemachine.h"
 #include "gmphysics/gmphysicsworld_p.h"
+#include "gmengine/gameobjects/gmgameobject_p.h"
+#include "gmgraphicengine.h"
 
 BEGIN_NS
 
@@ -24,10 +26,31 @@ namespace
 		}
 		return false;
 	}
+
+	enum
+	{
+		ForwardRenderList,
+		DeferredRenderList,
+		RenderListCount,
+	};
+
+	struct GMGameWorldSceneCuller : public ISceneCuller
+	{
+		GMGameWorldPrivate* world = nullptr;
+
+		virtual void cull(
+			const GMFrustumPlanes& planes,
+			const GMGameObjectContainer& forwardRenderingObjects,
+			const GMGameObjectContainer& deferredRenderingObjects,
+			REF GMGameObjectContainer& visibleForwardRenderingObjects,
+			REF GMGameObjectContainer& visibleDeferredRenderingObjects
+		) override;
+	};
 }
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMGameWorld)
 {
+	GM_DECLARE_PUBLIC(GMGameWorld)
 	const IRenderContext* context = nullptr;
 	GMOwnedPtr<GMPhysicsWorld> physicsWorld = nullptr;
 	Set<GMOwnedPtr<GMGameObject>> gameObjects;
@@ -37,12 +60,182 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMGameWorld)
 	GMMutex renderListMutex;
 	GMMutex addObjectMutex;
 	GMOwnedPtr<IParticleSystemManager> particleSystemMgr;
+	GMSceneBVH sceneBVH;
+	GMMutex sceneBVHMutex;
+	GMGameWorldSceneCuller sceneCuller;
+	Vector<GMGameObject*> dirtyBoundsObjects;
+	GMint64 renderListFrontOrder = 0;
+	GMint64 renderListBackOrder = 0;
+	Vector<GMGameObject*> unboundedObjects[RenderListCount]; // 在渲染列表中但不在场景BVH中的对象
+	bool unboundedObjectsDirty = true;
+	Vector<GMGameObject*> queryResult;
+
+	GMGameObjectContainer& getRenderList(GMint32 id);
+	GMint32 getRenderListId(const GMGameObjectContainer& objects);
+	void addToRenderList(GMint32 id, GMGameObject* object, bool front);
+	void updateObjectBounds(GMGameObject* object);
+	void updateDirtyBounds();
+	void removeObjectBounds(GMGameObject* object);
+	void updateUnboundedObjects();
+	void filterVisibleObjects(const GMGameObjectContainer& objects, REF GMGameObjectContainer& visibleObjects);
 };
 
+GMGameObjectContainer& GMGameWorldPrivate::getRenderList(GMint32 id)
+{
+	GM_ASSERT(id == ForwardRenderList || id == DeferredRenderList);
+	return id == ForwardRenderList ? renderList.forward : renderList.deferred;
+}
+
+GMint32 GMGameWorldPrivate::getRenderListId(const GMGameObjectContainer& objects)
+{
+	if (&objects == &renderList.forward)
+		return ForwardRenderList;
+	if (&objects == &renderList.deferred)
+		return DeferredRenderList;
+	return -1;
+}
+
+void GMGameWorldPrivate::addToRenderList(GMint32 id, GMGameObject* object, bool front)
+{
+	// 记录对象在渲染列表中的次序，裁剪后可以据此恢复可见对象在渲染列表中的顺序
+	D_OF(od, object);
+	od->renderListId = id;
+	od->renderListOrder = front ? --renderListFrontOrder : ++renderListBackOrder;
+	if (front)
+		getRenderList(id).push_front(object);
+	else
+		getRenderList(id).push_back(object);
+	unboundedObjectsDirty = true;
+}
+
+void GMGameWorldPrivate::updateObjectBounds(GMGameObject* object)
+{
+	D_OF(od, object);
+	od->bvhBoundsDirty = false;
+
+	// 指定了裁剪相机的对象由自己裁剪，不放入场景BVH
+	bool cullable = od->cullOption == GMGameObjectCullOption::AABB && !od->cullCamera && !od->cullAABB.empty();
+	if (!cullable)
+	{
+		removeObjectBounds(object);
+		return;
+	}
+
+	GMVec3 min, max;
+	od->calculateWorldAABB(min, max);
+	if (od->bvhProxy == GMSceneBVH::InvalidProxy)
+	{
+		od->bvhProxy = sceneBVH.createProxy(min, max, object);
+		unboundedObjectsDirty = true;
+	}
+	else
+	{
+		sceneBVH.moveProxy(od->bvhProxy, min, max);
+	}
+}
+
+void GMGameWorldPrivate::updateDirtyBounds()
+{
+	for (auto object : dirtyBoundsObjects)
+	{
+		updateObjectBounds(object);
+	}
+	dirtyBoundsObjects.clear();
+}
+
+void GMGameWorldPrivate::removeObjectBounds(GMGameObject* object)
+{
+	D_OF(od, object);
+	if (od->bvhProxy != GMSceneBVH::InvalidProxy)
+	{
+		sceneBVH.destroyProxy(od->bvhProxy);
+		od->bvhProxy = GMSceneBVH::InvalidProxy;
+		unboundedObjectsDirty = true;
+	}
+}
+
+void GMGameWorldPrivate::updateUnboundedObjects()
+{
+	// 只有渲染列表或者场景BVH的成员改变时才需要重新收集
+	if (!unboundedObjectsDirty)
+		return;
+
+	for (GMint32 id = 0; id < RenderListCount; ++id)
+	{
+		unboundedObjects[id].clear();
+		for (auto object : getRenderList(id))
+		{
+			D_OF(od, object);
+			if (od->bvhProxy == GMSceneBVH::InvalidProxy)
+				unboundedObjects[id].push_back(object);
+		}
+	}
+	unboundedObjectsDirty = false;
+}
+
+void GMGameWorldPrivate::filterVisibleObjects(const GMGameObjectContainer& objects, REF GMGameObjectContainer& visibleObjects)
+{
+	P_D(pd);
+	visibleObjects.clear();
+
+	GMint32 id = getRenderListId(objects);
+	if (id < 0)
+	{
+		// 不是本世界的渲染列表，只能逐个判断。不在场景BVH中的对象（如没有AABB的对象，或者其它世界的对象）总是被认为可见
+		for (auto object : objects)
+		{
+			D_OF(od, object);
+			if (od->world != pd || od->bvhProxy == GMSceneBVH::InvalidProxy || sceneBVH.isVisible(od->bvhProxy))
+				visibleObjects.push_back(object);
+		}
+		return;
+	}
+
+	// 可见对象来自场景BVH的查询结果，再加上不在场景BVH中的对象，开销只与可见对象的数目有关
+	for (auto object : queryResult)
+	{
+		D_OF(od, object);
+		if (od->renderListId == id)
+			visibleObjects.push_back(object);
+	}
+	visibleObjects.insert(visibleObjects.end(), unboundedObjects[id].begin(), unboundedObjects[id].end());
+	visibleObjects.sort([](GMGameObject* a, GMGameObject* b) {
+		D_OF(ad, a);
+		D_OF(bd, b);
+		return ad->renderListOrder < bd->renderListOrder;
+	});
+}
+
+void GMGameWorldSceneCuller::cull(
+	const GMFrustumPlanes& planes,
+	const GMGameObjectContainer& forwardRenderingObjects,
+	const GMGameObjectContainer& deferredRenderingObjects,
+	REF GMGameObjectContainer& visibleForwardRenderingObjects,
+	REF GMGameObjectContainer& visibleDeferredRenderingObjects
+)
+{
+	GMMutexLock mutexGuard(&world->sceneBVHMutex);
+	mutexGuard->lock();
+	world->updateUnboundedObjects();
+	world->queryResult.clear();
+	world->sceneBVH.query(planes, &world->queryResult);
+	world->filterVisibleObjects(forwardRenderingObjects, visibleForwardRenderingObjects);
+	world->filterVisibleObjects(deferredRenderingObjects, visibleDeferredRenderingObjects);
+}
+
 namespace
 {
 	void updateGameObjects(GMDuration dt, GMPhysicsWorld* phyw, const Set<GMOwnedPtr<GMGameObject>>& gameObjects)
 	{
+		// 先并行计算所有对象的动画
+		Vector<GMGameObject*> objects;
+		objects.reserve(gameObjects.size());
+		for (decltype(auto) gameObject : gameObjects)
+		{
+			objects.push_back(gameObject.get());
+		}
+		GMGameObject::updateAnimations(objects.data(), objects.size(), dt);
+
 		for (decltype(auto) gameObject : gameObjects)
 		{
 			gameObject->update(dt);
@@ -51,20 +244,9 @@ namespace
 		}
 	}
 
-	void addToContainerByPriority(GMGameObjectContainer& c, GMGameObject* o, GMGameObjectRenderPriority hint = GMGameObjectRenderPriority::Normal)
+	bool isHighPriority(GMGameObject* o, GMGameObjectRenderPriority hint = GMGameObjectRenderPriority::Normal)
 	{
-		if (hint == GMGameObjectRenderPriority::High)
-		{
-			c.push_front(o);
-		}
-		else
-		{
-			GMGameObjectRenderPriority priority = o->getRenderPriority();
-			if (priority == GMGameObjectRenderPriority::High)
-				c.push_front(o);
-			else
-				c.push_back(o);
-		}
+		return hint == GMGameObjectRenderPriority::High || o->getRenderPriority() == GMGameObjectRenderPriority::High;
 	}
 }
 
@@ -72,9 +254,11 @@ GM_DEFINE_PROPERTY(GMGameWorld, GMRenderPreference, RenderPreference, renderPref
 GMGameWorld::GMGameWorld(const IRenderContext* context)
 {
 	GM_CREATE_DATA();
+	GM_SET_PD();
 
 	D(d);
 	d->context = context;
+	d->sceneCuller.world = d;
 }
 
 GMGameWorld::~GMGameWorld()
@@ -95,13 +279,14 @@ void GMGameWorld::addObjectAndInit(AUTORELEASE GMGameObject* obj)
 	obj->setContext(getContext());
 	obj->onAppendingObjectToWorld();
 	d->gameObjects.insert(GMOwnedPtr<GMGameObject>(obj));
+	markObjectBoundsDirty(obj);
 
 	obj->foreachModel([d, this](GMModel* m) {
 		const IRenderContext* context = getContext();
 		if (context->getEngine()->isCurrentMainThread())
 			context->getEngine()->createModelDataProxy(d->context, m);
 		else
-			GM.invokeInMainThread([context, d, m]() {context->getEngine()->createModelDataProxy(d->context, m); });
+			GM.invokeInMainThread([context, d, m]() {context->getEngine()->createModelDataProxy(d->context, m); }, GMCommandPriority::High);
 	});
 }
 
@@ -116,6 +301,18 @@ void GMGameWorld::renderScene()
 	D(d);
 	static GMGameObjectContainer s_emptyList;
 	IGraphicEngine* engine = d->context->getEngine();
+
+	// 绘制时通过场景BVH裁剪对象。渲染可能嵌套，所以结束时恢复之前的裁剪器
+	GMGraphicEngine* graphicEngine = gm_cast<GMGraphicEngine*>(engine);
+	{
+		// 一帧中所有对象的变换改变都在这里一次性同步到场景BVH
+		GMMutexLock mutexGuard(&d->sceneBVHMutex);
+		mutexGuard->lock();
+		d->updateDirtyBounds();
+	}
+	ISceneCuller* lastSceneCuller = graphicEngine->getSceneCuller();
+	graphicEngine->setSceneCuller(&d->sceneCuller);
+
 	engine->begin();
 	if (d->particleSystemMgr)
 		d->particleSystemMgr->render();
@@ -130,6 +327,7 @@ void GMGameWorld::renderScene()
 		engine->draw(d->renderList.forward, d->renderList.deferred);
 	}
 	engine->end();
+	graphicEngine->setSceneCuller(lastSceneCuller);
 }
 
 bool GMGameWorld::removeObject(GMGameObject* obj)
@@ -150,6 +348,19 @@ bool GMGameWorld::removeObject(GMGameObject* obj)
 		return false;
 
 	removeFromRenderList(obj);
+	{
+		GMMutexLock mutexGuard(&d->sceneBVHMutex);
+		mutexGuard->lock();
+		D_OF(od, obj);
+		if (od->bvhBoundsDirty)
+		{
+			auto iter = std::find(d->dirtyBoundsObjects.begin(), d->dirtyBoundsObjects.end(), obj);
+			if (iter != d->dirtyBoundsObjects.end())
+				d->dirtyBoundsObjects.erase(iter);
+			od->bvhBoundsDirty = false;
+		}
+		d->removeObjectBounds(obj);
+	}
 	obj->onRemovingObjectFromWorld();
 	objs.erase(*eraseTarget);
 	return true;
@@ -181,8 +392,17 @@ void GMGameWorld::clearRenderList()
 	D(d);
 	GMMutexLock mutexGuard(&d->renderListMutex);
 	mutexGuard->lock();
+	for (GMint32 id = 0; id < RenderListCount; ++id)
+	{
+		for (auto object : d->getRenderList(id))
+		{
+			D_OF(od, object);
+			od->renderListId = -1;
+		}
+	}
 	d->renderList.deferred.clear();
 	d->renderList.forward.clear();
+	d->unboundedObjectsDirty = true;
 }
 
 GMRenderList& GMGameWorld::getRenderList()
@@ -199,14 +419,14 @@ void GMGameWorld::addToRenderList(GMGameObject* object)
 
 	if (GMQueryCapability(GMCapability::SupportDeferredRendering) && object->canDeferredRendering())
 	{
-		addToContainerByPriority(d->renderList.deferred, object);
+		d->addToRenderList(DeferredRenderList, object, isHighPriority(object));
 	}
 	else
 	{
 		if (needBlend(object))
-			addToContainerByPriority(d->renderList.forward, object);
+			d->addToRenderList(ForwardRenderList, object, isHighPriority(object));
 		else
-			addToContainerByPriority(d->renderList.forward, object, GMGameObjectRenderPriority::High);
+			d->addToRenderList(ForwardRenderList, object, isHighPriority(object, GMGameObjectRenderPriority::High));
 	}
 }
 
@@ -214,6 +434,12 @@ bool GMGameWorld::removeFromRenderList(GMGameObject* object)
 {
 	D(d);
 	bool flag = false;
+	{
+		D_OF(od, object);
+		od->renderListId = -1;
+		d->unboundedObjectsDirty = true;
+	}
+
 	{
 		auto iter = std::find(d->renderList.forward.begin(), d->renderList.forward.end(), object);
 		if (iter != d->renderList.forward.end())
@@ -240,6 +466,32 @@ GMAssets& GMGameWorld::getAssets()
 	D(d); return d->assets;
 }
 
+GMSceneBVH& GMGameWorld::getSceneBVH()
+{
+	D(d);
+	GMMutexLock mutexGuard(&d->sceneBVHMutex);
+	mutexGuard->lock();
+	d->updateDirtyBounds();
+	return d->sceneBVH;
+}
+
+void GMGameWorld::markObjectBoundsDirty(GMGameObject* object)
+{
+	D(d);
+	D_OF(od, object);
+	// 一帧内多次改变变换时只需要记录一次，不用每次都加锁和更新场景BVH
+	if (od->bvhBoundsDirty)
+		return;
+
+	GMMutexLock mutexGuard(&d->sceneBVHMutex);
+	mutexGuard->lock();
+	if (!od->bvhBoundsDirty)
+	{
+		od->bvhBoundsDirty = true;
+		d->dirtyBoundsObjects.push_back(object);
+	}
+}
+
 IParticleSystemManager* GMGameWorld::getParticleSystemManager()
 {
 	D(d); return d->particleSystemMgr.get();
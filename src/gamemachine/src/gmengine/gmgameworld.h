@@ -7,6 +7,7 @@
 #include "gameobjects/gmgameobject.h"
 #include <gmassets.h>
 #include <gmparticle.h>
+#include <gmscenebvh.h>
 
 BEGIN_NS
 
@@ -32,6 +33,7 @@ class GM_EXPORT GMGameWorld : public GMObject
 {
 	GM_DECLARE_PRIVATE(GMGameWorld)
 	GM_FRIEND_CLASS(GMPhysicsWorld)
+	GM_FRIEND_CLASS(GMGameObject)
 	GM_DECLARE_PROPERTY(GMRenderPreference, RenderPreference)
 
 public:
@@ -57,8 +59,20 @@ public:
 	IParticleSystemManager* getParticleSystemManager();
 	GMAssets& getAssets();
 
+	//! 获取场景的层次包围盒树。
+	/*!
+	  裁剪方式为GMGameObjectCullOption::AABB，并且没有指定裁剪相机的对象会被加入场景BVH。renderScene()时，
+	  绘制引擎通过它裁剪主相机和每个阴影级联中不可见的对象。<BR>
+	  对象变换改变时只会被标记，场景BVH在每次renderScene()或者调用此方法时统一更新。
+	  \sa GMGameObject::setCullOption()
+	*/
+	GMSceneBVH& getSceneBVH();
+
 protected:
 	GMRenderList& getRenderList();
+
+friend_methods(GMGameObject):
+	void markObjectBoundsDirty(GMGameObject* object);
 };
 
 END_NS
@@ -7,6 +7,23 @@
 #include "gmgbuffer_p.h"
 
 BEGIN_NS
+
+namespace
+{
+	// Geometry Pass的纹理格式为R8G8B8A8_UNORM时，意味着所有的输出在着色器中范围是[0,1]，对应着UNORM的[0x00, 0xFF]
+	// 对于[-1, 1]范围的数据，需要在着色器中进行一次转换。
+	const Vector<GMFramebufferFormat> s_geometryFramebufferFormats = {
+		GMFramebufferFormat::R32G32B32A32_FLOAT,
+		GMFramebufferFormat::R32G32B32A32_FLOAT,
+		GMFramebufferFormat::R32G32B32A32_FLOAT,
+		GMFramebufferFormat::R32G32B32A32_FLOAT,
+		GMFramebufferFormat::R8G8B8A8_UNORM,
+		GMFramebufferFormat::R8G8B8A8_UNORM,
+		GMFramebufferFormat::R8G8B8A8_UNORM,
+		GMFramebufferFormat::R32G32B32A32_FLOAT,
+	};
+}
+
 GMGBuffer::GMGBuffer(const IRenderContext* context)
 {
 	GM_CREATE_DATA();
@@ -21,7 +38,8 @@ GMGBuffer::~GMGBuffer()
 {
 	D(d);
 	d->quad->destroy();
-	d->geometryFramebuffers->destroy();
+	if (d->geometryFramebuffers)
+		d->geometryFramebuffers->destroy();
 }
 
 void GMGBufferPrivate::createQuad()
@@ -42,9 +60,7 @@ void GMGBufferPrivate::createQuad()
 void GMGBuffer::init()
 {
 	D(d);
-	if (!d->geometryFramebuffers)
-		d->geometryFramebuffers = createGeometryFramebuffers();
-
+	// 几何阶段的帧缓存一般由渲染图提供，只有在需要时才自己创建
 	if (!d->quad)
 		d->createQuad();
 }
@@ -70,10 +86,27 @@ GMGameObject* GMGBuffer::getQuad()
 IFramebuffers* GMGBuffer::getGeometryFramebuffers()
 {
 	D(d);
+	if (d->externalGeometryFramebuffers)
+		return d->externalGeometryFramebuffers;
+
+	if (!d->geometryFramebuffers)
+		d->geometryFramebuffers = createGeometryFramebuffers();
 	GM_ASSERT(d->geometryFramebuffers);
 	return d->geometryFramebuffers;
 }
 
+void GMGBuffer::setGeometryFramebuffers(IFramebuffers* framebuffers)
+{
+	D(d);
+	GM_ASSERT(!framebuffers || framebuffers->count() == s_geometryFramebufferFormats.size());
+	d->externalGeometryFramebuffers = framebuffers;
+}
+
+const Vector<GMFramebufferFormat>& GMGBuffer::getGeometryFramebufferFormats()
+{
+	return s_geometryFramebufferFormats;
+}
+
 const IRenderContext* GMGBuffer::getContext()
 {
 	D(d);
@@ -25,6 +25,17 @@ public:
 public:
 	virtual const IRenderContext* getContext();
 
+	//! 设置几何阶段使用的帧缓存。
+	/*!
+	  通常由渲染图在执行几何阶段前设置，使G缓存成为一个临时渲染目标，可以与其它生命周期不重叠的渲染目标共用显存。
+	  G缓存不拥有设置的帧缓存。如果没有设置（或者设置为nullptr），G缓存会在第一次使用时自己创建帧缓存。
+	  \param framebuffers 几何阶段使用的帧缓存，其附件的格式需要与getGeometryFramebufferFormats()一致。
+	*/
+	virtual void setGeometryFramebuffers(IFramebuffers* framebuffers) override;
+
+	//! 获取几何阶段每个颜色附件的格式。
+	virtual const Vector<GMFramebufferFormat>& getGeometryFramebufferFormats() override;
+
 protected:
 	GMGameObject* getQuad();
 
@@ -8,6 +8,7 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMGBuffer)
 	GM_DECLARE_PUBLIC(GMGBuffer)
 	const IRenderContext* context = nullptr;
 	IFramebuffers* geometryFramebuffers = nullptr;
+	IFramebuffers* externalGeometryFramebuffers = nullptr;
 	GMGameObject* quad = nullptr;
 	GMGeometryPassingState state = GMGeometryPassingState::Done;
 	GMGraphicEngine* engine = nullptr;
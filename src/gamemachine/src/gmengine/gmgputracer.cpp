@@ -0,0 +1,122 @@
+﻿#include "stdafx.h"
+#include "gmgputracer.h"
+#include "foundation/gmprofile.h"
+
+BEGIN_NS
+
+namespace
+{
+	struct GPUTraceScope
+	{
+		const GMwchar* name;
+		GMint32 beginQuery;
+		GMint32 endQuery;
+	};
+
+	struct GPUTraceFrame
+	{
+		Vector<GPUTraceScope> scopes;
+		bool pending = false; // 是否有还没有读取的查询
+	};
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMGPUTracer)
+{
+	GPUTraceFrame frames[GMGPUTracer::FramesInFlight];
+	Vector<GMsize_t> openScopes;
+	Vector<GMint64> timestamps;
+	GMint32 current = 0;
+	bool recording = false;
+	GMsize_t droppedFrames = 0;
+};
+
+GMGPUTracer::GMGPUTracer()
+{
+	GM_CREATE_DATA();
+}
+
+GMGPUTracer::~GMGPUTracer()
+{
+
+}
+
+void GMGPUTracer::beginFrame()
+{
+	D(d);
+	if (d->recording)
+		endFrame();
+
+	d->current = (d->current + 1) % FramesInFlight;
+	GPUTraceFrame& frame = d->frames[d->current];
+	if (frame.pending)
+	{
+		// 这是FramesInFlight帧之前的查询，结果通常已经可用
+		frame.pending = false;
+		if (resolveQueries(d->current, d->timestamps))
+		{
+			for (const auto& scope : frame.scopes)
+			{
+				GM_ASSERT(scope.endQuery < gm_sizet_to_int(d->timestamps.size()));
+				GMTracer::gpuSpan(scope.name, d->timestamps[scope.beginQuery], d->timestamps[scope.endQuery]);
+			}
+		}
+		else
+		{
+			++d->droppedFrames;
+		}
+	}
+	frame.scopes.clear();
+
+	if (!GMTracer::isEnabled())
+		return;
+
+	d->recording = true;
+	beginQueries(d->current);
+}
+
+void GMGPUTracer::endFrame()
+{
+	D(d);
+	if (!d->recording)
+		return;
+
+	while (!d->openScopes.empty())
+	{
+		endScope();
+	}
+
+	GPUTraceFrame& frame = d->frames[d->current];
+	endQueries(d->current);
+	frame.pending = !frame.scopes.empty();
+	d->recording = false;
+}
+
+void GMGPUTracer::beginScope(const GMwchar* name)
+{
+	D(d);
+	if (!d->recording)
+		return;
+
+	GPUTraceFrame& frame = d->frames[d->current];
+	d->openScopes.push_back(frame.scopes.size());
+	frame.scopes.push_back({ name, queryTimestamp(d->current), -1 });
+}
+
+void GMGPUTracer::endScope()
+{
+	D(d);
+	if (!d->recording || d->openScopes.empty())
+		return;
+
+	GPUTraceFrame& frame = d->frames[d->current];
+	frame.scopes[d->openScopes.back()].endQuery = queryTimestamp(d->current);
+	d->openScopes.pop_back();
+}
+
+GMsize_t GMGPUTracer::getDroppedFrames() const GM_NOEXCEPT
+{
+	D(d);
+	return d->droppedFrames;
+}
+
+END_NS
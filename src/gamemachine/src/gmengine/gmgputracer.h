@@ -0,0 +1,73 @@
+﻿#ifndef __GMGPUTRACER_H__
+#define __GMGPUTRACER_H__
+#include <gmcommon.h>
+BEGIN_NS
+
+GM_PRIVATE_CLASS(GMGPUTracer);
+//! 用GPU时间戳查询测量每个作用域在GPU上的耗时，并把结果记录到GMTracer。
+/*!
+  每个作用域在开始和结束时各发出一个时间戳查询。查询的结果要等GPU执行完这一帧才可用，因此同时保留FramesInFlight帧的查询，
+  在一帧开始时读取FramesInFlight帧之前的结果。读取时不会等待GPU，如果结果仍然不可用，这一帧的结果会被丢弃。<BR>
+  具体的查询由各个图形后端实现。跟踪没有开启时，不会发出任何查询。
+*/
+class GM_EXPORT GMGPUTracer
+{
+	GM_DECLARE_PRIVATE(GMGPUTracer)
+	GM_DISABLE_COPY_ASSIGN(GMGPUTracer)
+
+public:
+	enum
+	{
+		FramesInFlight = 4, //!< 同时保留查询的帧数。
+	};
+
+	GMGPUTracer();
+	virtual ~GMGPUTracer();
+
+public:
+	//! 开始一帧。读取之前的帧中已经可用的结果，并开始记录这一帧的查询。
+	void beginFrame();
+
+	//! 结束一帧，未结束的作用域会在这里结束。
+	void endFrame();
+
+	//! 开始一个作用域。
+	/*!
+	  \param name 作用域名称，必须在整个程序运行期间有效。
+	*/
+	void beginScope(const GMwchar* name);
+
+	//! 结束最近开始的一个作用域。
+	void endScope();
+
+	//! 获取因为结果不可用而被丢弃的帧数。
+	GMsize_t getDroppedFrames() const GM_NOEXCEPT;
+
+protected:
+	//! 开始记录某一帧的查询。之前在这一帧中发出的查询都可以重新使用。
+	/*!
+	  \param frame 帧在环形队列中的位置，范围为[0, FramesInFlight)。
+	*/
+	virtual void beginQueries(GMint32 frame) = 0;
+
+	//! 结束记录某一帧的查询。
+	virtual void endQueries(GMint32 frame) = 0;
+
+	//! 在某一帧中发出一个时间戳查询。
+	/*!
+	  \param frame 帧在环形队列中的位置。
+	  \return 查询在这一帧中的序号，从0开始按发出的顺序递增。
+	*/
+	virtual GMint32 queryTimestamp(GMint32 frame) = 0;
+
+	//! 读取某一帧中所有时间戳查询的结果，不能等待GPU。
+	/*!
+	  \param frame 帧在环形队列中的位置。
+	  \param timestamps 按照查询序号排列的结果，已经换算到GMTracer::now()的时间，单位为纳秒。
+	  \return 结果是否全部可用。
+	*/
+	virtual bool resolveQueries(GMint32 frame, OUT Vector<GMint64>& timestamps) = 0;
+};
+
+END_NS
+#endif
@@ -6,6 +6,7 @@
 #include "foundation/gamemachine.h"
 #include "gmengine/gameobjects/gmgameobject.h"
 #include "foundation/gmprofile.h"
+#include "gmgputracer.h"
 #include "foundation/gmconfigs.h"
 #include "gmprimitivemanager.h"
 #include "gmcsmhelper.h"
@@ -22,9 +23,15 @@ static GMShaderVariablesDesc s_defaultShaderVariablesDesc =
 	"GM_InverseTransposeModelMatrix",
 	"GM_InverseViewMatrix",
 
-	"GM_Bones",
+	"GM_BonePalette",
+	"GM_BoneOffset",
+	"GM_SkinningMode",
 	"GM_UseAnimation",
 
+	"GM_UseInstancing",
+
+	"GM_OctahedralAttributes",
+
 	"GM_ViewPosition",
 
 	{ "OffsetX", "OffsetY", "ScaleX", "ScaleY", "Enabled", "Texture" },
@@ -165,7 +172,10 @@ void GMGraphicEnginePrivate::deleteLights()
 
 void GMGraphicEnginePrivate::dispose()
 {
+	// 先等待正在解码的请求结束，未上传的资产在图形资源之前释放
+	assetStreamer.reset();
 	deleteLights();
+	renderGraph.reset();
 	GMComputeShaderManager::instance().disposeShaderPrograms(context);
 	if (filterFramebuffers)
 		filterFramebuffers->destroy();
@@ -218,6 +228,7 @@ GMGraphicEngine::GMGraphicEngine(const IRenderContext* context)
 	d->debugConfig = d->configs.getConfig(GMConfigs::Debug).asDebugConfig();
 	d->shadow.type = GMShadowSourceDesc::NoShadow;
 	d->renderTechniqueManager.reset(new GMRenderTechniqueManager(context));
+	d->assetStreamer.reset(new GMAssetStreamer(context));
 
 	if (context->getWindow())
 	{
@@ -264,7 +275,27 @@ IFramebuffers* GMGraphicEngine::getFilterFramebuffers()
 void GMGraphicEngine::begin()
 {
 	D(d);
-	++d->begun;
+	// 新的一帧开始，之前的骨骼变换都已经过期，字形图集开始记录这一帧使用的页
+	if (++d->begun == 1)
+	{
+		d->bonePalette.clear();
+		if (d->glyphManager)
+			d->glyphManager->beginFrame();
+
+		// 调试配置中的RunProfile_Bool只在每帧开始时同步一次，作用域中不再读取配置
+		bool runProfile = d->debugConfig.get(GMDebugConfigs::RunProfile_Bool).toBool();
+		if (runProfile != d->runProfile)
+		{
+			d->runProfile = runProfile;
+			GMTracer::setEnabled(runProfile);
+		}
+
+		if (GMGPUTracer* gpuTracer = getGPUTracer())
+			gpuTracer->beginFrame();
+
+		// 在预算内上传流式加载的资产
+		d->assetStreamer->update();
+	}
 
 	// 是否使用滤镜
 	bool useFilterFramebuffer = needUseFilterFramebuffer();
@@ -284,55 +315,223 @@ void GMGraphicEngine::draw(const GMGameObjectContainer& forwardRenderingObjects,
 		gm_warning(gm_dbg_wrap("You should call IGraphicEngine::begin before call IGraphicEngine::draw."));
 	}
 
+	GMRenderGraph& graph = getRenderGraph();
+	graph.reset();
+	buildRenderGraph(graph, forwardRenderingObjects, deferredRenderingObjects);
+	graph.execute(getGPUTracer());
+}
+
+void GMGraphicEngine::buildRenderGraph(GMRenderGraph& graph, const GMGameObjectContainer& forwardRenderingObjects, const GMGameObjectContainer& deferredRenderingObjects)
+{
+	D(d);
+	bool useFilterFramebuffer = needUseFilterFramebuffer();
+	IFramebuffers* target = useFilterFramebuffer ? getFilterFramebuffers() : getDefaultFramebuffers();
+
+	// 颜色和深度模板分别作为资源，这样只有在有人读取深度的时候才需要从G缓存中复制深度
+	GMRenderGraphBuiltinResources resources;
+	resources.target = graph.importResource("Target", target);
+	resources.targetDepth = graph.importResource("TargetDepth", target);
+
+	// 如果设置了场景裁剪器，只绘制主相机能看到的对象。阴影在每个级联中单独裁剪
+	const GMGameObjectContainer* visibleForwardObjects = &forwardRenderingObjects;
+	const GMGameObjectContainer* visibleDeferredObjects = &deferredRenderingObjects;
+	if (d->sceneCuller)
+	{
+		GMFrustumPlanes planes;
+		getCamera().getFrustum().getPlanes(planes);
+		d->sceneCuller->cull(planes, forwardRenderingObjects, deferredRenderingObjects, d->visibleForwardObjects, d->visibleDeferredObjects);
+		visibleForwardObjects = &d->visibleForwardObjects;
+		visibleDeferredObjects = &d->visibleDeferredObjects;
+	}
+
 	// 如果绘制阴影，先生成阴影缓存
 	if (d->shadow.type != GMShadowSourceDesc::NoShadow)
 	{
-		generateShadowBuffer(forwardRenderingObjects, deferredRenderingObjects);
-		d->lastShadow = d->shadow;
+		resources.shadowMap = graph.importResource("ShadowMap", d->shadowDepthFramebuffers);
+		graph.addPass("Shadow", {}, { resources.shadowMap }, [this, d, &forwardRenderingObjects, &deferredRenderingObjects](GMRenderGraph&) {
+			generateShadowBuffer(forwardRenderingObjects, deferredRenderingObjects);
+			d->lastShadow = d->shadow;
+		});
 	}
 
+	// G缓存的帧缓存来自渲染图的帧缓存池，上一次绘制设置的帧缓存此时可能已经被回收
+	if (d->gBuffer)
+		d->gBuffer->setGeometryFramebuffers(nullptr);
+
 	// 绘制需要延迟渲染的对象
-	bool useFilterFramebuffer = needUseFilterFramebuffer();
 	if (!deferredRenderingObjects.empty())
 	{
-		IGBuffer* gBuffer = getGBuffer();
-		gBuffer->geometryPass(deferredRenderingObjects);
-
-		if (useFilterFramebuffer)
-			bindFilterFramebuffer();
-
-		gBuffer->lightPass();
-		if (useFilterFramebuffer)
-		{
-			unbindFilterFramebuffer();
-			gBuffer->getGeometryFramebuffers()->copyDepthStencilFramebuffer(getFilterFramebuffers());
-		}
-		else
-		{
-			gBuffer->getGeometryFramebuffers()->copyDepthStencilFramebuffer(getDefaultFramebuffers());
-		}
+		GMRenderGraphTargetDesc gBufferDesc;
+		gBufferDesc.formats = getGBuffer()->getGeometryFramebufferFormats();
+		resources.gBuffer = graph.createTransientTarget("GBuffer", gBufferDesc);
+		GMRenderGraphResource gBufferResource = resources.gBuffer;
+		graph.addPass("Geometry", {}, { resources.gBuffer }, [this, gBufferResource, visibleDeferredObjects](GMRenderGraph& g) {
+			IGBuffer* gBuffer = getGBuffer();
+			gBuffer->setGeometryFramebuffers(g.getFramebuffers(gBufferResource));
+			gBuffer->geometryPass(*visibleDeferredObjects);
+		});
+
+		graph.addPass("Lighting", { resources.gBuffer, resources.shadowMap }, { resources.target }, [this, useFilterFramebuffer](GMRenderGraph&) {
+			if (useFilterFramebuffer)
+				bindFilterFramebuffer();
+
+			getGBuffer()->lightPass();
+
+			if (useFilterFramebuffer)
+				unbindFilterFramebuffer();
+		});
+
+		graph.addPass("CopyDepthStencil", { resources.gBuffer }, { resources.targetDepth }, [this, target](GMRenderGraph&) {
+			getGBuffer()->getGeometryFramebuffers()->copyDepthStencilFramebuffer(target);
+		});
 	}
 
 	// 绘制不需要延迟渲染的对象
 	if (!forwardRenderingObjects.empty())
 	{
-		if (useFilterFramebuffer)
-			bindFilterFramebuffer();
+		graph.addPass("Forward", { resources.targetDepth, resources.shadowMap }, { resources.target }, [this, useFilterFramebuffer, visibleForwardObjects](GMRenderGraph&) {
+			if (useFilterFramebuffer)
+				bindFilterFramebuffer();
 
-		draw(forwardRenderingObjects);
+			draw(*visibleForwardObjects);
 
-		if (useFilterFramebuffer)
-			unbindFilterFramebuffer();
+			if (useFilterFramebuffer)
+				unbindFilterFramebuffer();
+		});
 	}
+
+	if (d->renderGraphCallback)
+		d->renderGraphCallback->onBuildRenderGraph(graph, resources);
+
+	graph.markOutput(resources.target);
+
+	// 在此之后的绘制（例如图元管理器、后绘制的对象）可能需要深度测试，因此默认保留深度模板缓存。
+	// 只有确定之后没有依赖深度的绘制时，才可以关闭KeepDepthAfterDraw_Bool以省去从G缓存复制深度
+	if (d->renderConfig.get(GMRenderConfigs::KeepDepthAfterDraw_Bool).toBool())
+		graph.markOutput(resources.targetDepth);
+}
+
+void GMGraphicEngine::setRenderGraphCallback(IRenderGraphCallback* cb)
+{
+	D(d);
+	d->renderGraphCallback = cb;
+}
+
+void GMGraphicEngine::setSceneCuller(ISceneCuller* culler)
+{
+	D(d);
+	d->sceneCuller = culler;
+}
+
+ISceneCuller* GMGraphicEngine::getSceneCuller()
+{
+	D(d);
+	return d->sceneCuller;
+}
+
+GMRenderGraph& GMGraphicEngine::getRenderGraph()
+{
+	D(d);
+	if (!d->renderGraph)
+		d->renderGraph.reset(new GMRenderGraph(d->context));
+	return *d->renderGraph;
+}
+
+GMBonePalette& GMGraphicEngine::getBonePalette()
+{
+	D(d);
+	return d->bonePalette;
+}
+
+GMAssetStreamer& GMGraphicEngine::getAssetStreamer()
+{
+	D(d);
+	return *d->assetStreamer;
+}
+
+GMGPUTracer* GMGraphicEngine::getGPUTracer()
+{
+	return nullptr;
 }
 
 void GMGraphicEngine::draw(const GMGameObjectContainer& objects)
 {
 	D(d);
-	for (auto object : objects)
+	// 按照渲染状态排序，减少状态切换。共享同一个场景（即共享模型和着色器）的可实例化对象排序后相邻，合并为一次绘制
+	GMRenderQueue& renderQueue = d->renderQueue;
+	renderQueue.build(objects, getCamera().getLookAt().position);
+
+	d->instancingObjects.clear();
+	const GMsize_t total = renderQueue.getCount();
+	GMsize_t first = 0;
+	while (first < total)
+	{
+		GMGameObject* object = renderQueue.getObject(first);
+		if (!object->canInstancing())
+		{
+			object->draw();
+			++first;
+			continue;
+		}
+
+		GMScene* scene = object->getScene();
+		d->instancingObjects.push_back(object);
+		GMsize_t last = first + 1;
+		while (last < total)
+		{
+			GMGameObject* next = renderQueue.getObject(last);
+			if (next->getScene() != scene || !next->canInstancing())
+				break;
+
+			d->instancingObjects.push_back(next);
+			++last;
+		}
+
+		if (d->instancingObjects.size() == 1)
+			object->draw();
+		else
+			drawInstanced(d->instancingObjects.data(), d->instancingObjects.size());
+		d->instancingObjects.clear();
+		first = last;
+	}
+}
+
+void GMGraphicEngine::drawInstanced(GMGameObject* const* objects, GMsize_t count)
+{
+	D(d);
+	GM_ASSERT(count > 0);
+	d->instanceTransforms.resize(count);
+	for (GMsize_t i = 0; i < count; ++i)
 	{
-		object->draw();
+		d->instanceTransforms[i] = objects[i]->getTransform();
 	}
+
+	// 所有实例共享模型和着色器，因此用第一个对象来设置着色器参数
+	GMGameObject* parent = objects[0];
+	GMScene* scene = parent->getScene();
+	ITechnique* currentTechnique = nullptr;
+	parent->foreachModel([&](GMModel* model) {
+		// 模型被多个对象共享，按对象进行的模型裁剪在这里没有意义，可见性由场景裁剪决定
+		if (!model->getShader().getVisible())
+			return;
+
+		ITechnique* technique = getTechnique(model->getType());
+		if (technique != currentTechnique)
+		{
+			if (currentTechnique)
+				currentTechnique->endScene();
+
+			technique->beginScene(scene);
+			currentTechnique = technique;
+		}
+
+		technique->beginModel(model, parent);
+		technique->drawInstanced(model, d->instanceTransforms.data(), count);
+		technique->endModel();
+	});
+
+	if (currentTechnique)
+		currentTechnique->endScene();
 }
 
 void GMGraphicEngine::end()
@@ -351,6 +550,9 @@ void GMGraphicEngine::end()
 		bool useFilterFramebuffer = needUseFilterFramebuffer();
 		if (useFilterFramebuffer)
 			drawFilterFramebuffer();
+
+		if (GMGPUTracer* gpuTracer = getGPUTracer())
+			gpuTracer->endFrame();
 	}
 }
 
@@ -557,8 +759,20 @@ void GMGraphicEngine::generateShadowBuffer(const GMGameObjectContainer& forwardR
 	for (auto i = csm->cascadedBegin(); i != csm->cascadedEnd(); ++i)
 	{
 		csm->applyCascadedLevel(i);
-		draw(forwardRenderingObjects);
-		draw(deferredRenderingObjects);
+		if (d->sceneCuller)
+		{
+			// 用级联的视锥体裁剪投射阴影的对象
+			GMFrustumPlanes planes;
+			getCascadeFrustumPlanes(i, planes);
+			d->sceneCuller->cull(planes, forwardRenderingObjects, deferredRenderingObjects, d->shadowForwardObjects, d->shadowDeferredObjects);
+			draw(d->shadowForwardObjects);
+			draw(d->shadowDeferredObjects);
+		}
+		else
+		{
+			draw(forwardRenderingObjects);
+			draw(deferredRenderingObjects);
+		}
 	}
 
 	d->shadowDepthFramebuffers->unbind();
@@ -603,6 +817,31 @@ const GMMat4& GMGraphicEngine::getCascadeCameraVPMatrix(GMCascadeLevel level)
 	return d->shadowCameraVPmatrices[level];
 }
 
+void GMGraphicEngine::getCascadeFrustumPlanes(GMCascadeLevel level, GMFrustumPlanes& planes)
+{
+	D(d);
+	auto& runningState = GM.getRunningStates();
+	GMVec4 f, n, left, right, top, bottom;
+	GetFrustumPlanesFromProjectionViewModelMatrix(
+		runningState.farZ,
+		runningState.nearZ,
+		d->shadowCameraVPmatrices[level],
+		f,
+		n,
+		right,
+		left,
+		top,
+		bottom
+	);
+
+	planes.rightPlane = right;
+	planes.leftPlane = left;
+	planes.topPlane = top;
+	planes.bottomPlane = bottom;
+	planes.nearPlane = n;
+	planes.farPlane = f;
+}
+
 GMFramebuffersStack& GMGraphicEngine::getFramebuffersStack()
 {
 	D(d);
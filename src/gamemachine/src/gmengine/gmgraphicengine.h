@@ -6,8 +6,14 @@
 #include <gmcamera.h>
 #include <gmrendertechnique.h>
 #include <gmthread.h>
+#include <gmrendergraph.h>
+#include <gmrenderqueue.h>
+#include <gmbonepalette.h>
+#include <gmassetstreamer.h>
 BEGIN_NS
 
+class GMGPUTracer;
+
 #define NO_ANIMATION 0
 #define SKELETAL_ANIMATION 1
 #define AFFINE_ANIMATION 2
@@ -123,9 +129,17 @@ struct GMShaderVariablesDesc_t
 	T InverseViewMatrix;
 
 	// 骨骼
-	T Bones;
+	T BonePalette;
+	T BoneOffset;
+	T SkinningMode;
 	T UseAnimation;
 
+	// 实例化
+	T UseInstancing;
+
+	// 顶点格式
+	T OctahedralAttributes;
+
 	// 位置
 	T ViewPosition;
 
@@ -225,6 +239,30 @@ public:
 	IFramebuffers* peek();
 };
 
+//! 场景裁剪接口。
+/*!
+  如果设置了场景裁剪器，绘制引擎在每次绘制前会用主相机的视锥体裁剪对象，在绘制阴影时会用每个级联的视锥体裁剪对象。
+  \sa GMGraphicEngine::setSceneCuller()
+*/
+GM_INTERFACE(ISceneCuller)
+{
+	//! 筛选出与视锥体相交的对象。
+	/*!
+	  \param planes 视锥体的平面。
+	  \param forwardRenderingObjects 正向渲染对象列表。
+	  \param deferredRenderingObjects 延迟渲染对象列表。
+	  \param visibleForwardRenderingObjects 可见的正向渲染对象，保持原来的顺序。
+	  \param visibleDeferredRenderingObjects 可见的延迟渲染对象，保持原来的顺序。
+	*/
+	virtual void cull(
+		const GMFrustumPlanes& planes,
+		const GMGameObjectContainer& forwardRenderingObjects,
+		const GMGameObjectContainer& deferredRenderingObjects,
+		REF GMGameObjectContainer& visibleForwardRenderingObjects,
+		REF GMGameObjectContainer& visibleDeferredRenderingObjects
+	) = 0;
+};
+
 GM_PRIVATE_CLASS(GMGraphicEngine);
 class GM_EXPORT GMGraphicEngine : public GMObject, public IGraphicEngine
 {
@@ -275,6 +313,7 @@ protected:
 	virtual void createFilterFramebuffer();
 	virtual void generateShadowBuffer(const GMGameObjectContainer& forwardRenderingObjects, const GMGameObjectContainer& deferredRenderingObjects);
 	virtual bool needUseFilterFramebuffer();
+	virtual void buildRenderGraph(GMRenderGraph& graph, const GMGameObjectContainer& forwardRenderingObjects, const GMGameObjectContainer& deferredRenderingObjects);
 
 protected:
 	void bindFilterFramebuffer();
@@ -289,6 +328,7 @@ public:
 	const GMFilterMode::Mode getCurrentFilterMode();
 	const GMVec3 getCurrentFilterBlendFactor();
 	void draw(const GMGameObjectContainer& objects);
+	void drawInstanced(GMGameObject* const* objects, GMsize_t count);
 	IFramebuffers* getShadowMapFramebuffers();
 	bool needGammaCorrection();
 	GMfloat getGammaValue();
@@ -297,10 +337,35 @@ public:
 	bool isWireFrameMode(GMModel* model);
 	bool isNeedDiscardTexture(GMModel* model, GMTextureType type);
 	const GMMat4& getCascadeCameraVPMatrix(GMCascadeLevel level);
+	void getCascadeFrustumPlanes(GMCascadeLevel level, GMFrustumPlanes& planes);
 	const GMShadowSourceDesc& getShadowSourceDesc();
 	bool isDrawingShadow();
 	const GMGlobalBlendStateDesc& getGlobalBlendState();
 	GMFramebuffersStack& getFramebuffersStack();
+	void setRenderGraphCallback(IRenderGraphCallback* cb);
+	void setSceneCuller(ISceneCuller* culler);
+	ISceneCuller* getSceneCuller();
+	GMRenderGraph& getRenderGraph();
+
+	//! 获取本帧所有动画模型共用的骨骼调色板。
+	/*!
+	  调色板在最外层的begin()被调用时清空。
+	*/
+	GMBonePalette& getBonePalette();
+
+	//! 获取此引擎的资产流式加载器。
+	/*!
+	  加载器的上传在最外层的begin()中，按照每帧的预算执行。
+	  \return 资产流式加载器。
+	*/
+	GMAssetStreamer& getAssetStreamer();
+
+	//! 获取此引擎的GPU跟踪器。
+	/*!
+	  GPU跟踪器在最外层的begin()和end()中开始和结束一帧，渲染图的每个渲染阶段是其中的一个作用域。
+	  \return GPU跟踪器。不支持GPU时间戳查询的引擎返回nullptr。
+	*/
+	virtual GMGPUTracer* getGPUTracer();
 
 public:
 	static constexpr const GMsize_t getMaxLightCount()
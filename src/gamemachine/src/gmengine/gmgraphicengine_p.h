@@ -20,10 +20,23 @@ GM_PRIVATE_OBJECT_ALIGNED(GMGraphicEngine)
 	GMStencilOptions stencilOptions;
 	Vector<ILight*> lights;
 	IShaderLoadCallback* shaderLoadCallback = nullptr;
+	IRenderGraphCallback* renderGraphCallback = nullptr;
+	GMOwnedPtr<GMRenderGraph> renderGraph;
+	ISceneCuller* sceneCuller = nullptr;
+	GMGameObjectContainer visibleForwardObjects;
+	GMGameObjectContainer visibleDeferredObjects;
+	GMGameObjectContainer shadowForwardObjects;
+	GMGameObjectContainer shadowDeferredObjects;
+	GMRenderQueue renderQueue;
+	GMBonePalette bonePalette;
+	GMOwnedPtr<GMAssetStreamer> assetStreamer;
+	Vector<GMGameObject*> instancingObjects;
+	AlignedVector<GMMat4> instanceTransforms;
 	GMGlobalBlendStateDesc blendState;
 	GMOwnedPtr<GMRenderTechniqueManager> renderTechniqueManager;
 	GMOwnedPtr<GMPrimitiveManager> primitiveManager;
 	GMConfigs configs;
+	bool runProfile = false;
 
 	// Shadow
 	GMShadowSourceDesc shadow;
@@ -0,0 +1,405 @@
+﻿#include "stdafx.h"
+#include "gmrendergraph.h"
+#include "foundation/gamemachine.h"
+#include "foundation/gmprofile.h"
+#include "gmgputracer.h"
+#include <algorithm>
+
+BEGIN_NS
+
+namespace
+{
+	struct GMRenderGraphResourceNode
+	{
+		GMString name;
+		IFramebuffers* framebuffers = nullptr;
+		bool transient = false;
+		GMRenderGraphTargetDesc desc;
+		GMint32 poolIndex = -1;
+		bool output = false;
+	};
+
+	struct GMRenderGraphPassNode
+	{
+		GMString name;
+		const GMwchar* traceName = nullptr; // 跟踪时使用的驻留名称
+		Vector<GMRenderGraphResource> reads;
+		Vector<GMRenderGraphResource> writes;
+		GMRenderPassFunction execute;
+		bool sideEffect = false;
+		bool culled = true;
+	};
+
+	struct GMRenderGraphPooledTarget
+	{
+		GMRenderGraphTargetDesc desc;
+		IFramebuffers* framebuffers = nullptr;
+		GMRect rect = { 0 };
+		GMint64 busyUntil = -1; // 编译时，此帧缓存被占用到第几个渲染阶段
+	};
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMRenderGraph)
+{
+	const IRenderContext* context = nullptr;
+	Vector<GMRenderGraphResourceNode> resources;
+	Vector<GMRenderGraphPassNode> passes;
+	Vector<GMRenderGraphPooledTarget> pool;
+	bool compiled = false;
+	bool executing = false;
+
+	void cullPasses();
+	void evictStaleTargets();
+	void allocateTransientTargets();
+	GMRect getTargetRect(const GMRenderGraphTargetDesc& desc);
+	IFramebuffers* createFramebuffers(const GMRect& rect, const Vector<GMFramebufferFormat>& formats);
+};
+
+void GMRenderGraphPrivate::cullPasses()
+{
+	// 从输出资源开始反向遍历，一个渲染阶段只有在它写入的资源被需要时才会执行
+	Vector<bool> needed(resources.size(), false);
+	for (GMsize_t i = 0; i < resources.size(); ++i)
+	{
+		needed[i] = resources[i].output;
+	}
+
+	for (auto iter = passes.rbegin(); iter != passes.rend(); ++iter)
+	{
+		GMRenderGraphPassNode& pass = *iter;
+		pass.culled = !pass.sideEffect;
+		for (auto write : pass.writes)
+		{
+			if (needed[write])
+			{
+				pass.culled = false;
+				break;
+			}
+		}
+
+		if (!pass.culled)
+		{
+			for (auto read : pass.reads)
+			{
+				needed[read] = true;
+			}
+		}
+	}
+}
+
+void GMRenderGraphPrivate::evictStaleTargets()
+{
+	// 帧缓存池中描述已经不再被任何临时渲染目标使用的帧缓存（例如改变了固定大小的渲染目标）需要回收，否则池会越来越大
+	auto isDeclared = [this](const GMRenderGraphTargetDesc& desc) {
+		for (const auto& resource : resources)
+		{
+			if (resource.transient && resource.desc == desc)
+				return true;
+		}
+		return false;
+	};
+
+	for (auto iter = pool.begin(); iter != pool.end();)
+	{
+		if (isDeclared(iter->desc))
+		{
+			++iter;
+			continue;
+		}
+
+		if (iter->framebuffers)
+			iter->framebuffers->destroy();
+		iter = pool.erase(iter);
+	}
+}
+
+void GMRenderGraphPrivate::allocateTransientTargets()
+{
+	// 计算每个临时渲染目标第一次和最后一次被使用的渲染阶段
+	Vector<GMint64> firstUse(resources.size(), -1);
+	Vector<GMint64> lastUse(resources.size(), -1);
+	for (GMsize_t i = 0; i < passes.size(); ++i)
+	{
+		const GMRenderGraphPassNode& pass = passes[i];
+		if (pass.culled)
+			continue;
+
+		auto touch = [&firstUse, &lastUse, i](GMRenderGraphResource r) {
+			if (firstUse[r] < 0)
+				firstUse[r] = static_cast<GMint64>(i);
+			lastUse[r] = static_cast<GMint64>(i);
+		};
+		for (auto read : pass.reads)
+		{
+			touch(read);
+		}
+		for (auto write : pass.writes)
+		{
+			touch(write);
+		}
+	}
+
+	for (auto& pooled : pool)
+	{
+		pooled.busyUntil = -1;
+	}
+
+	// 资源按照声明顺序分配，由于渲染阶段也按顺序执行，先声明的资源一般也先被使用
+	Vector<GMsize_t> order;
+	for (GMsize_t i = 0; i < resources.size(); ++i)
+	{
+		resources[i].poolIndex = -1;
+		if (resources[i].transient && firstUse[i] >= 0)
+			order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&firstUse](GMsize_t a, GMsize_t b) {
+		return firstUse[a] < firstUse[b];
+	});
+
+	for (auto index : order)
+	{
+		GMRenderGraphResourceNode& resource = resources[index];
+		for (GMsize_t i = 0; i < pool.size(); ++i)
+		{
+			if (pool[i].desc == resource.desc && pool[i].busyUntil < firstUse[index])
+			{
+				resource.poolIndex = static_cast<GMint32>(i);
+				break;
+			}
+		}
+
+		if (resource.poolIndex < 0)
+		{
+			// 帧缓存在执行时才创建
+			GMRenderGraphPooledTarget pooled;
+			pooled.desc = resource.desc;
+			pool.push_back(pooled);
+			resource.poolIndex = static_cast<GMint32>(pool.size() - 1);
+		}
+		pool[resource.poolIndex].busyUntil = lastUse[index];
+	}
+}
+
+GMRect GMRenderGraphPrivate::getTargetRect(const GMRenderGraphTargetDesc& desc)
+{
+	const GMWindowStates& windowStates = context->getWindow()->getWindowStates();
+	GMRect rect = windowStates.renderRect;
+	if (desc.width > 0)
+		rect.width = desc.width;
+	if (desc.height > 0)
+		rect.height = desc.height;
+	return rect;
+}
+
+IFramebuffers* GMRenderGraphPrivate::createFramebuffers(const GMRect& rect, const Vector<GMFramebufferFormat>& formats)
+{
+	IFactory* factory = GM.getFactory();
+	IFramebuffers* framebuffers = nullptr;
+	factory->createFramebuffers(context, &framebuffers);
+	GM_ASSERT(framebuffers);
+	GMFramebuffersDesc fbsDesc;
+	fbsDesc.rect = rect;
+	framebuffers->init(fbsDesc);
+
+	for (auto format : formats)
+	{
+		IFramebuffer* framebuffer = nullptr;
+		factory->createFramebuffer(context, &framebuffer);
+		GM_ASSERT(framebuffer);
+		GMFramebufferDesc fbDesc = { 0 };
+		fbDesc.rect = rect;
+		fbDesc.framebufferFormat = format;
+		framebuffer->init(fbDesc);
+		framebuffers->addFramebuffer(framebuffer);
+	}
+	return framebuffers;
+}
+
+GMRenderGraph::GMRenderGraph(const IRenderContext* context)
+{
+	GM_CREATE_DATA();
+	D(d);
+	d->context = context;
+}
+
+GMRenderGraph::~GMRenderGraph()
+{
+	D(d);
+	for (auto& pooled : d->pool)
+	{
+		if (pooled.framebuffers)
+			pooled.framebuffers->destroy();
+	}
+}
+
+void GMRenderGraph::reset()
+{
+	D(d);
+	GM_ASSERT(!d->executing);
+	d->resources.clear();
+	d->passes.clear();
+	d->compiled = false;
+}
+
+GMRenderGraphResource GMRenderGraph::importResource(const GMString& name, IFramebuffers* framebuffers)
+{
+	D(d);
+	GMRenderGraphResourceNode resource;
+	resource.name = name;
+	resource.framebuffers = framebuffers;
+	d->resources.push_back(resource);
+	d->compiled = false;
+	return static_cast<GMRenderGraphResource>(d->resources.size() - 1);
+}
+
+GMRenderGraphResource GMRenderGraph::createTransientTarget(const GMString& name, const GMRenderGraphTargetDesc& desc)
+{
+	D(d);
+	GMRenderGraphResourceNode resource;
+	resource.name = name;
+	resource.transient = true;
+	GM_ASSERT(!desc.formats.empty());
+	resource.desc = desc;
+	d->resources.push_back(resource);
+	d->compiled = false;
+	return static_cast<GMRenderGraphResource>(d->resources.size() - 1);
+}
+
+GMsize_t GMRenderGraph::addPass(
+	const GMString& name,
+	const Vector<GMRenderGraphResource>& reads,
+	const Vector<GMRenderGraphResource>& writes,
+	GMRenderPassFunction execute,
+	bool sideEffect
+)
+{
+	D(d);
+	GMRenderGraphPassNode pass;
+	pass.name = name;
+	for (auto read : reads)
+	{
+		// 允许传入无效资源，以便调用者不必区分可选的资源
+		if (read == GMInvalidRenderGraphResource)
+			continue;
+
+		GM_ASSERT(read < static_cast<GMRenderGraphResource>(d->resources.size()));
+		pass.reads.push_back(read);
+	}
+	for (auto write : writes)
+	{
+		if (write == GMInvalidRenderGraphResource)
+			continue;
+
+		GM_ASSERT(write < static_cast<GMRenderGraphResource>(d->resources.size()));
+		pass.writes.push_back(write);
+	}
+	pass.execute = std::move(execute);
+	pass.sideEffect = sideEffect;
+	d->passes.push_back(std::move(pass));
+	d->compiled = false;
+	return d->passes.size() - 1;
+}
+
+void GMRenderGraph::markOutput(GMRenderGraphResource resource)
+{
+	D(d);
+	if (resource == GMInvalidRenderGraphResource)
+		return;
+
+	GM_ASSERT(resource >= 0 && resource < static_cast<GMRenderGraphResource>(d->resources.size()));
+	d->resources[resource].output = true;
+	d->compiled = false;
+}
+
+void GMRenderGraph::compile()
+{
+	D(d);
+	d->cullPasses();
+	d->evictStaleTargets();
+	d->allocateTransientTargets();
+	d->compiled = true;
+}
+
+void GMRenderGraph::execute(GMGPUTracer* gpuTracer)
+{
+	D(d);
+	if (!d->compiled)
+		compile();
+
+	d->executing = true;
+	for (auto& pass : d->passes)
+	{
+		if (pass.culled || !pass.execute)
+			continue;
+
+		if (!GMTracer::isEnabled())
+		{
+			pass.execute(*this);
+			continue;
+		}
+
+		if (!pass.traceName)
+			pass.traceName = GMTracer::intern(pass.name);
+
+		GM_TRACE_SCOPE_INTERNED(pass.traceName);
+		if (gpuTracer)
+			gpuTracer->beginScope(pass.traceName);
+		pass.execute(*this);
+		if (gpuTracer)
+			gpuTracer->endScope();
+	}
+	d->executing = false;
+}
+
+IFramebuffers* GMRenderGraph::getFramebuffers(GMRenderGraphResource resource)
+{
+	D(d);
+	GM_ASSERT(resource >= 0 && resource < static_cast<GMRenderGraphResource>(d->resources.size()));
+	GMRenderGraphResourceNode& node = d->resources[resource];
+	if (!node.transient)
+		return node.framebuffers;
+
+	GM_ASSERT(d->executing);
+	if (node.poolIndex < 0)
+	{
+		gm_warning(gm_dbg_wrap("Render graph resource '{0}' is not used by any living pass."), node.name);
+		return nullptr;
+	}
+
+	// 跟随窗口大小的渲染目标，在窗口大小改变后需要重新创建
+	GMRenderGraphPooledTarget& pooled = d->pool[node.poolIndex];
+	GMRect rect = d->getTargetRect(pooled.desc);
+	if (pooled.framebuffers && (pooled.rect.width != rect.width || pooled.rect.height != rect.height))
+	{
+		pooled.framebuffers->destroy();
+		pooled.framebuffers = nullptr;
+	}
+
+	if (!pooled.framebuffers)
+	{
+		pooled.framebuffers = d->createFramebuffers(rect, pooled.desc.formats);
+		pooled.rect = rect;
+	}
+	return pooled.framebuffers;
+}
+
+bool GMRenderGraph::isPassCulled(GMsize_t passIndex)
+{
+	D(d);
+	GM_ASSERT(d->compiled && passIndex < d->passes.size());
+	return d->passes[passIndex].culled;
+}
+
+GMsize_t GMRenderGraph::getPassCount()
+{
+	D(d);
+	return d->passes.size();
+}
+
+GMsize_t GMRenderGraph::getTransientFramebuffersCount()
+{
+	D(d);
+	return d->pool.size();
+}
+
+END_NS
\ No newline at end of file
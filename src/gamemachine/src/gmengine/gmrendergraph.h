@@ -0,0 +1,134 @@
+﻿#ifndef __GMRENDERGRAPH_H__
+#define __GMRENDERGRAPH_H__
+#include <gmcommon.h>
+BEGIN_NS
+
+//! 表示渲染图中的一个虚拟资源。
+typedef GMint32 GMRenderGraphResource;
+constexpr GMRenderGraphResource GMInvalidRenderGraphResource = -1;
+
+//! 描述一个由渲染图管理的临时渲染目标。
+/*!
+  临时渲染目标只在使用它的渲染阶段之间存活。生命周期不重叠、描述相同的临时渲染目标会共用同一个帧缓存。<BR>
+  一个临时渲染目标可以有多个颜色附件（例如G缓存），每个附件的格式由formats给出。
+*/
+struct GMRenderGraphTargetDesc
+{
+	GMint32 width = 0; //!< 渲染目标的宽度。如果为0，则使用窗口渲染区域的宽度。
+	GMint32 height = 0; //!< 渲染目标的高度。如果为0，则使用窗口渲染区域的高度。
+	Vector<GMFramebufferFormat> formats = { GMFramebufferFormat::R8G8B8A8_UNORM }; //!< 每个颜色附件的格式。
+
+	bool operator==(const GMRenderGraphTargetDesc& rhs) const
+	{
+		return width == rhs.width && height == rhs.height && formats == rhs.formats;
+	}
+};
+
+class GMRenderGraph;
+class GMGPUTracer;
+typedef std::function<void(GMRenderGraph&)> GMRenderPassFunction;
+
+//! 引擎内置渲染阶段所使用的资源。
+struct GMRenderGraphBuiltinResources
+{
+	GMRenderGraphResource target = GMInvalidRenderGraphResource; //!< 最终的颜色目标（默认帧缓存或滤镜帧缓存）。
+	GMRenderGraphResource targetDepth = GMInvalidRenderGraphResource; //!< 最终目标的深度模板缓存。
+	GMRenderGraphResource gBuffer = GMInvalidRenderGraphResource; //!< 延迟渲染的G缓存。
+	GMRenderGraphResource shadowMap = GMInvalidRenderGraphResource; //!< 阴影贴图。
+};
+
+//! 渲染图构建回调。
+/*!
+  引擎每次绘制时都会重新构建渲染图。在内置渲染阶段添加完毕之后，此回调会被调用，用户可以在其中添加自定义的渲染阶段。
+  \sa GMGraphicEngine::setRenderGraphCallback()
+*/
+GM_INTERFACE(IRenderGraphCallback)
+{
+	virtual void onBuildRenderGraph(GMRenderGraph& graph, const GMRenderGraphBuiltinResources& resources) = 0;
+};
+
+GM_PRIVATE_CLASS(GMRenderGraph);
+//! 声明式的渲染阶段调度器。
+/*!
+  每个渲染阶段声明自己读取、写入的资源。编译时，渲染图从输出资源开始反向遍历，剔除结果不被任何人使用的渲染阶段，
+  并为临时渲染目标计算生命周期，使生命周期不重叠的渲染目标共用帧缓存。<BR>
+  渲染阶段按照添加的顺序执行。
+*/
+class GM_EXPORT GMRenderGraph : public GMObject
+{
+	GM_DECLARE_PRIVATE(GMRenderGraph)
+	GM_DISABLE_COPY_ASSIGN(GMRenderGraph)
+
+public:
+	GMRenderGraph(const IRenderContext* context);
+	~GMRenderGraph();
+
+public:
+	//! 清除所有渲染阶段和虚拟资源，但保留已创建的临时帧缓存以便下一帧复用。
+	void reset();
+
+	//! 导入一个由外部管理的资源。
+	/*!
+	  \param name 资源名称，用于调试。
+	  \param framebuffers 资源对应的帧缓存，可以为空（例如资源在渲染阶段执行时才会创建）。
+	  \return 虚拟资源。
+	*/
+	GMRenderGraphResource importResource(const GMString& name, IFramebuffers* framebuffers);
+
+	//! 声明一个临时渲染目标。
+	/*!
+	  临时渲染目标对应的帧缓存由渲染图创建和管理，只能在渲染阶段执行时通过getFramebuffers()获取。
+	  \param name 资源名称，用于调试。
+	  \param desc 渲染目标的描述。
+	  \return 虚拟资源。
+	*/
+	GMRenderGraphResource createTransientTarget(const GMString& name, const GMRenderGraphTargetDesc& desc);
+
+	//! 添加一个渲染阶段。
+	/*!
+	  \param name 渲染阶段名称，用于调试。
+	  \param reads 渲染阶段读取的资源。
+	  \param writes 渲染阶段写入的资源。
+	  \param execute 渲染阶段执行函数。
+	  \param sideEffect 如果为true，则此渲染阶段永远不会被剔除。
+	  \return 渲染阶段的序号。
+	*/
+	GMsize_t addPass(
+		const GMString& name,
+		const Vector<GMRenderGraphResource>& reads,
+		const Vector<GMRenderGraphResource>& writes,
+		GMRenderPassFunction execute,
+		bool sideEffect = false
+	);
+
+	//! 将一个资源标记为渲染图的输出。写入输出资源的渲染阶段不会被剔除。
+	void markOutput(GMRenderGraphResource resource);
+
+	//! 剔除无用的渲染阶段，并为临时渲染目标分配帧缓存。
+	void compile();
+
+	//! 按顺序执行所有未被剔除的渲染阶段。如果还没有编译，会先进行编译。
+	/*!
+	  跟踪开启时，每个渲染阶段以其名称记录为一个作用域。
+	  \param gpuTracer GPU跟踪器。如果不为空，每个渲染阶段也会记录为其中的一个GPU作用域。
+	*/
+	void execute(GMGPUTracer* gpuTracer = nullptr);
+
+	//! 获取资源对应的帧缓存。对于临时渲染目标，只有在渲染阶段执行时才能获取。
+	IFramebuffers* getFramebuffers(GMRenderGraphResource resource);
+
+	//! 判断一个渲染阶段是否被剔除。必须在compile()之后调用。
+	bool isPassCulled(GMsize_t passIndex);
+
+	//! 获取渲染阶段的数量。
+	GMsize_t getPassCount();
+
+	//! 获取帧缓存池中临时帧缓存的数量。
+	/*!
+	  编译时，描述与本次声明的所有临时渲染目标都不相同的帧缓存会被回收，因此这个数量不会随着渲染目标描述的变化而无限增长。
+	*/
+	GMsize_t getTransientFramebuffersCount();
+};
+
+END_NS
+#endif
\ No newline at end of file
@@ -0,0 +1,261 @@
+﻿#include "stdafx.h"
+#include "gmrenderqueue.h"
+#include "gameobjects/gmgameobject.h"
+
+BEGIN_NS
+
+namespace
+{
+	// 排序键中各个字段的宽度和偏移，详见GMRenderQueue的说明
+	constexpr GMuint32 DepthBits = 20;
+	constexpr GMuint32 TextureBits = 12;
+	constexpr GMuint32 CullBits = 2; // 剔除和正面朝向各占1位
+	constexpr GMuint32 ModelTypeBits = 3;
+	constexpr GMuint32 StateBits = 2; // 混合和深度测试各占1位
+	constexpr GMuint32 ProgramBits = 8;
+	constexpr GMuint32 SegmentBits = 16;
+	constexpr GMuint32 PriorityBits = 1;
+
+	constexpr GMuint32 DepthShift = 0;
+	constexpr GMuint32 TextureShift = DepthShift + DepthBits;
+	constexpr GMuint32 CullShift = TextureShift + TextureBits;
+	constexpr GMuint32 ModelTypeShift = CullShift + CullBits;
+	constexpr GMuint32 StateShift = ModelTypeShift + ModelTypeBits;
+	constexpr GMuint32 ProgramShift = StateShift + StateBits;
+	constexpr GMuint32 SegmentShift = ProgramShift + ProgramBits;
+	constexpr GMuint32 PriorityShift = SegmentShift + SegmentBits;
+	GM_STATIC_ASSERT(PriorityShift + PriorityBits == 64, "Render queue key must be 64 bits.");
+	GM_STATIC_ASSERT(static_cast<GMuint32>(GMModelType::Custom) < (1u << ModelTypeBits), "Too many model types for the render queue key.");
+
+	constexpr GMRenderQueueKey fieldMask(GMuint32 bits)
+	{
+		return (GMRenderQueueKey(1) << bits) - 1;
+	}
+
+	GMRenderQueueKey field(GMuint32 value, GMuint32 bits, GMuint32 shift)
+	{
+		return (static_cast<GMRenderQueueKey>(value) & fieldMask(bits)) << shift;
+	}
+
+	// 将指针散列到指定的位数
+	GMuint32 hashPointer(const void* ptr, GMuint32 bits)
+	{
+		if (!ptr)
+			return 0;
+
+		GMRenderQueueKey v = static_cast<GMRenderQueueKey>(reinterpret_cast<uintptr_t>(ptr));
+		v *= 0x9E3779B97F4A7C15ull;
+		return static_cast<GMuint32>(v >> (64 - bits));
+	}
+
+	// 一个正的浮点数的位模式与其大小的顺序一致，取其高位作为深度
+	GMuint32 depthBits(GMfloat distanceSq)
+	{
+		GM_STATIC_ASSERT_SIZE(GMfloat, 4);
+		GMuint32 bits = 0;
+		memcpy(&bits, &distanceSq, sizeof(bits));
+		return bits >> (31 - DepthBits);
+	}
+
+	// 自定义渲染技术的模型使用其渲染技术对应的着色器程序，其它模型共用引擎的着色器程序
+	GMuint32 programBits(GMModel* model)
+	{
+		if (model->getType() != GMModelType::Custom)
+			return 0;
+		return static_cast<GMuint32>(model->getTechniqueId() % fieldMask(ProgramBits)) + 1;
+	}
+
+	const void* getSortingTexture(GMModel* model)
+	{
+		GMTextureList& textureList = model->getShader().getTextureList();
+		const GMTextureType types[] = { GMTextureType::Diffuse, GMTextureType::Albedo, GMTextureType::Ambient };
+		for (auto type : types)
+		{
+			GMTextureSampler& sampler = textureList.getTextureSampler(type);
+			if (sampler.getFrameCount() > 0)
+				return sampler.getFrameByIndex(0).getAsset();
+		}
+		return nullptr;
+	}
+
+	bool isOrderDependent(GMModel* model)
+	{
+		GMModelType type = model->getType();
+		if (type != GMModelType::Model3D && type != GMModelType::CubeMap)
+			return true;
+
+		const GMShader& shader = model->getShader();
+		return shader.getBlend() || shader.getNoDepthTest();
+	}
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMRenderQueue)
+{
+	Vector<GMRenderQueueItem> items;
+	Vector<GMRenderQueueItem> buffer;
+};
+
+GMRenderQueue::GMRenderQueue()
+{
+	GM_CREATE_DATA();
+}
+
+GMRenderQueue::~GMRenderQueue()
+{
+
+}
+
+void GMRenderQueue::build(const GMGameObjectContainer& objects, const GMVec3& viewPosition)
+{
+	D(d);
+	d->items.clear();
+	d->items.reserve(objects.size());
+
+	// 与顺序有关的对象独占一个分段，两个这样的对象之间的其它对象共享一个分段，在分段内自由排序
+	GMuint32 segment = 0;
+	const GMuint32 maxSegment = static_cast<GMuint32>(fieldMask(SegmentBits));
+	for (auto object : objects)
+	{
+		GMModel* firstModel = nullptr;
+		bool orderDependent = false;
+		object->foreachModel([&firstModel, &orderDependent](GMModel* model) {
+			if (!firstModel)
+				firstModel = model;
+			if (!orderDependent)
+				orderDependent = isOrderDependent(model);
+		});
+
+		GMRenderQueueKeyFields fields;
+		fields.priority = static_cast<GMuint32>(object->getRenderPriority());
+		if (!firstModel || orderDependent)
+		{
+			if (segment + 2 > maxSegment)
+			{
+				// 分段用尽时，无法保证与顺序有关的对象的相对顺序，因此不排序，按原来的顺序绘制
+				gm_warning(gm_dbg_wrap("Too many order-dependent objects in the render queue. Objects will be drawn in their original order."));
+				d->items.clear();
+				for (auto o : objects)
+				{
+					d->items.push_back({ 0, o });
+				}
+				return;
+			}
+			fields.segment = ++segment;
+			++segment;
+		}
+		else
+		{
+			const GMShader& shader = firstModel->getShader();
+			fields.segment = segment;
+			fields.program = programBits(firstModel);
+			fields.state = (shader.getBlend() ? 1 : 0) | (shader.getNoDepthTest() ? 0 : 2);
+			fields.modelType = static_cast<GMuint32>(firstModel->getType());
+			fields.cull = static_cast<GMuint32>(shader.getCull()) | (static_cast<GMuint32>(shader.getFrontFace()) << 1);
+			fields.texture = hashPointer(getSortingTexture(firstModel), TextureBits);
+
+			if (object->canInstancing())
+			{
+				// 共享场景的实例需要相邻，才能合并为一次绘制
+				fields.depth = hashPointer(object->getScene(), DepthBits);
+			}
+			else
+			{
+				GMFloat4 translation;
+				GetTranslationFromMatrix(object->getTransform(), translation);
+				GMVec3 offset = GMVec3(translation[0], translation[1], translation[2]) - viewPosition;
+				fields.depth = depthBits(LengthSq(offset));
+			}
+		}
+		d->items.push_back({ makeKey(fields), object });
+	}
+
+	d->buffer.resize(d->items.size());
+	radixSort(d->items.data(), d->items.size(), d->buffer.data());
+}
+
+void GMRenderQueue::clear()
+{
+	D(d);
+	d->items.clear();
+}
+
+GMsize_t GMRenderQueue::getCount() const
+{
+	D(d);
+	return d->items.size();
+}
+
+GMGameObject* GMRenderQueue::getObject(GMsize_t index) const
+{
+	D(d);
+	GM_ASSERT(index < d->items.size());
+	return d->items[index].object;
+}
+
+const GMRenderQueueItem* GMRenderQueue::getItems() const
+{
+	D(d);
+	return d->items.data();
+}
+
+GMRenderQueueKey GMRenderQueue::makeKey(const GMRenderQueueKeyFields& fields)
+{
+	return field(fields.priority, PriorityBits, PriorityShift)
+		| field(fields.segment, SegmentBits, SegmentShift)
+		| field(fields.program, ProgramBits, ProgramShift)
+		| field(fields.state, StateBits, StateShift)
+		| field(fields.modelType, ModelTypeBits, ModelTypeShift)
+		| field(fields.cull, CullBits, CullShift)
+		| field(fields.texture, TextureBits, TextureShift)
+		| field(fields.depth, DepthBits, DepthShift);
+}
+
+void GMRenderQueue::radixSort(GMRenderQueueItem* items, GMsize_t count, GMRenderQueueItem* buffer)
+{
+	if (count < 2)
+		return;
+
+	// 一次统计出8个字节的直方图，之后按字节从低到高进行计数排序
+	constexpr GMsize_t Radix = 256;
+	constexpr GMsize_t Passes = sizeof(GMRenderQueueKey);
+	GMsize_t histograms[Passes][Radix] = { 0 };
+	for (GMsize_t i = 0; i < count; ++i)
+	{
+		GMRenderQueueKey key = items[i].key;
+		for (GMsize_t pass = 0; pass < Passes; ++pass)
+		{
+			++histograms[pass][(key >> (pass * 8)) & 0xFF];
+		}
+	}
+
+	GMRenderQueueItem* src = items;
+	GMRenderQueueItem* dst = buffer;
+	for (GMsize_t pass = 0; pass < Passes; ++pass)
+	{
+		GMsize_t* histogram = histograms[pass];
+		const GMuint32 shift = static_cast<GMuint32>(pass * 8);
+
+		// 所有键在这个字节上都相同，这一轮不会改变顺序
+		if (histogram[(src[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		GMsize_t offset = 0;
+		for (GMsize_t i = 0; i < Radix; ++i)
+		{
+			GMsize_t c = histogram[i];
+			histogram[i] = offset;
+			offset += c;
+		}
+
+		for (GMsize_t i = 0; i < count; ++i)
+		{
+			dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+		std::swap(src, dst);
+	}
+
+	if (src != items)
+		memcpy(items, src, sizeof(GMRenderQueueItem) * count);
+}
+
+END_NS
@@ -0,0 +1,87 @@
+﻿#ifndef __GMRENDERQUEUE_H__
+#define __GMRENDERQUEUE_H__
+#include <gmcommon.h>
+#include <linearmath.h>
+BEGIN_NS
+
+class GMGameObject;
+typedef uint64_t GMRenderQueueKey;
+
+//! 渲染队列中的一项。
+struct GMRenderQueueItem
+{
+	GMRenderQueueKey key; //!< 排序键。
+	GMGameObject* object; //!< 需要绘制的对象。
+};
+
+//! 排序键的各个字段，超出字段宽度的部分会被截断。
+struct GMRenderQueueKeyFields
+{
+	GMuint32 priority = 0; //!< 渲染优先级，0为最高。
+	GMuint32 segment = 0; //!< 分段。
+	GMuint32 program = 0; //!< 着色器程序。
+	GMuint32 state = 0; //!< 混合和深度测试状态。
+	GMuint32 modelType = 0; //!< 模型类型。
+	GMuint32 cull = 0; //!< 剔除模式和正面朝向。
+	GMuint32 texture = 0; //!< 纹理。
+	GMuint32 depth = 0; //!< 深度。
+};
+
+GM_PRIVATE_CLASS(GMRenderQueue);
+//! 按照渲染状态排序的渲染队列。
+/*!
+  每个对象被编码为一个64位的排序键，从高位到低位依次为：<BR>
+  优先级(1位) | 分段(16位) | 着色器程序(8位) | 混合和深度测试(2位) | 模型类型(3位) | 剔除模式和正面朝向(2位) | 纹理(12位) | 深度(20位)<BR>
+  排序采用基数排序。排序后，高优先级的对象先绘制，使用相同着色器程序、相同渲染状态、相同纹理的对象相邻，不透明的对象按照从近到远的顺序绘制。<BR>
+  开启了混合、关闭了深度测试或者不是3D模型的对象与绘制顺序有关，它们独占一个分段，因此它们与其它对象的相对顺序保持不变。
+  如果这样的对象太多，分段用尽，渲染队列将不排序，保持对象原来的顺序。<BR>
+  对于可以实例化的对象，深度被替换为场景的散列值，以便共享场景的对象相邻，从而合并为一次绘制。
+*/
+class GM_EXPORT GMRenderQueue
+{
+	GM_DECLARE_PRIVATE(GMRenderQueue)
+	GM_DISABLE_COPY_ASSIGN(GMRenderQueue)
+
+public:
+	GMRenderQueue();
+	~GMRenderQueue();
+
+public:
+	//! 根据对象列表构建渲染队列，并进行排序。
+	/*!
+	  \param objects 需要绘制的对象，其顺序为对象被添加到渲染列表的顺序。
+	  \param viewPosition 观察者的位置，用于计算对象的深度。
+	*/
+	void build(const GMGameObjectContainer& objects, const GMVec3& viewPosition);
+
+	//! 清除渲染队列。
+	void clear();
+
+	//! 获取渲染队列中对象的数目。
+	GMsize_t getCount() const;
+
+	//! 获取排序后的第index个对象。
+	GMGameObject* getObject(GMsize_t index) const;
+
+	//! 获取排序后的所有项。
+	const GMRenderQueueItem* getItems() const;
+
+public:
+	//! 将各个字段编码为排序键。
+	/*!
+	  \param fields 排序键的各个字段。
+	  \return 排序键。
+	*/
+	static GMRenderQueueKey makeKey(const GMRenderQueueKeyFields& fields);
+
+	//! 对渲染队列项按照排序键进行稳定的基数排序。
+	/*!
+	  \param items 需要排序的项。
+	  \param count 项的数目。
+	  \param buffer 临时缓存，至少能容纳count个项。
+	*/
+	static void radixSort(GMRenderQueueItem* items, GMsize_t count, GMRenderQueueItem* buffer);
+};
+
+END_NS
+#endif
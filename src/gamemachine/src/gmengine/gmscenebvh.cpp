@@ -0,0 +1,551 @@
+﻿#include "stdafx.h"
+#include "gmscenebvh.h"
+#include <algorithm>
+
+BEGIN_NS
+
+namespace
+{
+	enum
+	{
+		NullNode = GMSceneBVH::InvalidProxy,
+		AllPlanes = (1 << 6) - 1,
+	};
+
+	// 代理的AABB在每个方向上放大的比例，对象在此范围内移动时不需要改变树的结构
+	constexpr GMfloat BoundsMarginRatio = .1f;
+
+	// 与GMPlane::classifyPoint保持一致
+	constexpr GMfloat PlaneEpsilon = .01f;
+
+	struct GMSceneBVHBounds
+	{
+		GMfloat min[3];
+		GMfloat max[3];
+	};
+
+	struct GMSceneBVHNode
+	{
+		GMSceneBVHBounds bounds;
+		GMGameObject* object = nullptr;
+		GMint32 parent = NullNode; // 节点空闲时，表示下一个空闲节点
+		GMint32 child1 = NullNode;
+		GMint32 child2 = NullNode;
+		GMint32 height = -1; // 叶子节点为0，空闲节点为-1
+		GMuint32 visibleQuery = 0; // 最近一次可见时的查询序号
+
+		bool isLeaf() const
+		{
+			return child1 == NullNode;
+		}
+	};
+
+	struct GMSceneBVHQueryEntry
+	{
+		GMint32 node;
+		GMint32 planeMask; // 还需要测试的平面
+	};
+
+	GMSceneBVHBounds makeBounds(const GMVec3& min, const GMVec3& max)
+	{
+		GMSceneBVHBounds bounds = {
+			{ min.getX(), min.getY(), min.getZ() },
+			{ max.getX(), max.getY(), max.getZ() }
+		};
+		return bounds;
+	}
+
+	GMSceneBVHBounds enlarge(const GMSceneBVHBounds& bounds, GMfloat ratio)
+	{
+		GMSceneBVHBounds result;
+		for (GMint32 i = 0; i < 3; ++i)
+		{
+			GMfloat margin = (bounds.max[i] - bounds.min[i]) * ratio;
+			result.min[i] = bounds.min[i] - margin;
+			result.max[i] = bounds.max[i] + margin;
+		}
+		return result;
+	}
+
+	GMSceneBVHBounds combine(const GMSceneBVHBounds& a, const GMSceneBVHBounds& b)
+	{
+		GMSceneBVHBounds result;
+		for (GMint32 i = 0; i < 3; ++i)
+		{
+			result.min[i] = Min(a.min[i], b.min[i]);
+			result.max[i] = Max(a.max[i], b.max[i]);
+		}
+		return result;
+	}
+
+	bool contains(const GMSceneBVHBounds& outer, const GMSceneBVHBounds& inner)
+	{
+		for (GMint32 i = 0; i < 3; ++i)
+		{
+			if (inner.min[i] < outer.min[i] || inner.max[i] > outer.max[i])
+				return false;
+		}
+		return true;
+	}
+
+	GMfloat surfaceArea(const GMSceneBVHBounds& bounds)
+	{
+		GMfloat x = bounds.max[0] - bounds.min[0];
+		GMfloat y = bounds.max[1] - bounds.min[1];
+		GMfloat z = bounds.max[2] - bounds.min[2];
+		return 2 * (x * y + y * z + z * x);
+	}
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMSceneBVH)
+{
+	Vector<GMSceneBVHNode> nodes;
+	GMint32 root = NullNode;
+	GMint32 freeList = NullNode;
+	GMsize_t proxyCount = 0;
+	GMuint32 queryId = 0;
+	Vector<GMSceneBVHQueryEntry> stack;
+
+	GMint32 allocateNode();
+	void freeNode(GMint32 index);
+	void insertLeaf(GMint32 leaf);
+	void removeLeaf(GMint32 leaf);
+	void refit(GMint32 index);
+	GMint32 balance(GMint32 iA);
+	GMfloat descendCost(GMint32 index, const GMSceneBVHBounds& leafBounds);
+};
+
+GMint32 GMSceneBVHPrivate::allocateNode()
+{
+	if (freeList == NullNode)
+	{
+		nodes.emplace_back();
+		return static_cast<GMint32>(nodes.size() - 1);
+	}
+
+	GMint32 index = freeList;
+	freeList = nodes[index].parent;
+	nodes[index] = GMSceneBVHNode();
+	return index;
+}
+
+void GMSceneBVHPrivate::freeNode(GMint32 index)
+{
+	GMSceneBVHNode& node = nodes[index];
+	node.object = nullptr;
+	node.height = -1;
+	node.parent = freeList;
+	freeList = index;
+}
+
+GMfloat GMSceneBVHPrivate::descendCost(GMint32 index, const GMSceneBVHBounds& leafBounds)
+{
+	const GMSceneBVHNode& node = nodes[index];
+	GMfloat area = surfaceArea(combine(node.bounds, leafBounds));
+	if (node.isLeaf())
+		return area;
+	return area - surfaceArea(node.bounds);
+}
+
+void GMSceneBVHPrivate::insertLeaf(GMint32 leaf)
+{
+	if (root == NullNode)
+	{
+		root = leaf;
+		nodes[root].parent = NullNode;
+		return;
+	}
+
+	// 按照表面积启发式，寻找插入代价最小的兄弟节点
+	const GMSceneBVHBounds leafBounds = nodes[leaf].bounds;
+	GMint32 index = root;
+	while (!nodes[index].isLeaf())
+	{
+		const GMSceneBVHNode& node = nodes[index];
+		GMfloat area = surfaceArea(node.bounds);
+		GMfloat combinedArea = surfaceArea(combine(node.bounds, leafBounds));
+
+		// 为当前节点和叶子节点创建一个新的父节点的代价
+		GMfloat cost = 2 * combinedArea;
+
+		// 继续往下走时，当前节点的包围盒需要增大的代价
+		GMfloat inheritanceCost = 2 * (combinedArea - area);
+
+		GMfloat cost1 = descendCost(node.child1, leafBounds) + inheritanceCost;
+		GMfloat cost2 = descendCost(node.child2, leafBounds) + inheritanceCost;
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	GMint32 sibling = index;
+	GMint32 oldParent = nodes[sibling].parent;
+	GMint32 newParent = allocateNode();
+	GMSceneBVHNode& parent = nodes[newParent];
+	parent.parent = oldParent;
+	parent.bounds = combine(leafBounds, nodes[sibling].bounds);
+	parent.height = nodes[sibling].height + 1;
+	parent.child1 = sibling;
+	parent.child2 = leaf;
+
+	if (oldParent != NullNode)
+	{
+		if (nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		root = newParent;
+	}
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	refit(newParent);
+}
+
+void GMSceneBVHPrivate::removeLeaf(GMint32 leaf)
+{
+	if (leaf == root)
+	{
+		root = NullNode;
+		return;
+	}
+
+	GMint32 parent = nodes[leaf].parent;
+	GMint32 grandParent = nodes[parent].parent;
+	GMint32 sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	// 用兄弟节点代替父节点
+	if (grandParent != NullNode)
+	{
+		if (nodes[grandParent].child1 == parent)
+			nodes[grandParent].child1 = sibling;
+		else
+			nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refit(grandParent);
+	}
+	else
+	{
+		root = sibling;
+		nodes[sibling].parent = NullNode;
+		freeNode(parent);
+	}
+}
+
+void GMSceneBVHPrivate::refit(GMint32 index)
+{
+	// 从index开始向上平衡树，并更新包围盒和高度
+	while (index != NullNode)
+	{
+		index = balance(index);
+
+		GMSceneBVHNode& node = nodes[index];
+		const GMSceneBVHNode& child1 = nodes[node.child1];
+		const GMSceneBVHNode& child2 = nodes[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.bounds = combine(child1.bounds, child2.bounds);
+		index = node.parent;
+	}
+}
+
+GMint32 GMSceneBVHPrivate::balance(GMint32 iA)
+{
+	// 如果A的两个子树高度相差超过1，则将较高的子树旋转上来。返回旋转后子树的根
+	GMSceneBVHNode& a = nodes[iA];
+	if (a.isLeaf() || a.height < 2)
+		return iA;
+
+	GMint32 iB = a.child1;
+	GMint32 iC = a.child2;
+	GMSceneBVHNode& b = nodes[iB];
+	GMSceneBVHNode& c = nodes[iC];
+	GMint32 diff = c.height - b.height;
+
+	if (diff > 1)
+	{
+		// 将C旋转上来
+		GMint32 iF = c.child1;
+		GMint32 iG = c.child2;
+		GMSceneBVHNode& f = nodes[iF];
+		GMSceneBVHNode& g = nodes[iG];
+
+		c.child1 = iA;
+		c.parent = a.parent;
+		a.parent = iC;
+		if (c.parent != NullNode)
+		{
+			if (nodes[c.parent].child1 == iA)
+				nodes[c.parent].child1 = iC;
+			else
+				nodes[c.parent].child2 = iC;
+		}
+		else
+		{
+			root = iC;
+		}
+
+		if (f.height > g.height)
+		{
+			c.child2 = iF;
+			a.child2 = iG;
+			g.parent = iA;
+			a.bounds = combine(b.bounds, g.bounds);
+			c.bounds = combine(a.bounds, f.bounds);
+			a.height = 1 + std::max(b.height, g.height);
+			c.height = 1 + std::max(a.height, f.height);
+		}
+		else
+		{
+			c.child2 = iG;
+			a.child2 = iF;
+			f.parent = iA;
+			a.bounds = combine(b.bounds, f.bounds);
+			c.bounds = combine(a.bounds, g.bounds);
+			a.height = 1 + std::max(b.height, f.height);
+			c.height = 1 + std::max(a.height, g.height);
+		}
+		return iC;
+	}
+
+	if (diff < -1)
+	{
+		// 将B旋转上来
+		GMint32 iD = b.child1;
+		GMint32 iE = b.child2;
+		GMSceneBVHNode& d = nodes[iD];
+		GMSceneBVHNode& e = nodes[iE];
+
+		b.child1 = iA;
+		b.parent = a.parent;
+		a.parent = iB;
+		if (b.parent != NullNode)
+		{
+			if (nodes[b.parent].child1 == iA)
+				nodes[b.parent].child1 = iB;
+			else
+				nodes[b.parent].child2 = iB;
+		}
+		else
+		{
+			root = iB;
+		}
+
+		if (d.height > e.height)
+		{
+			b.child2 = iD;
+			a.child1 = iE;
+			e.parent = iA;
+			a.bounds = combine(c.bounds, e.bounds);
+			b.bounds = combine(a.bounds, d.bounds);
+			a.height = 1 + std::max(c.height, e.height);
+			b.height = 1 + std::max(a.height, d.height);
+		}
+		else
+		{
+			b.child2 = iE;
+			a.child1 = iD;
+			d.parent = iA;
+			a.bounds = combine(c.bounds, d.bounds);
+			b.bounds = combine(a.bounds, e.bounds);
+			a.height = 1 + std::max(c.height, d.height);
+			b.height = 1 + std::max(a.height, e.height);
+		}
+		return iB;
+	}
+
+	return iA;
+}
+
+GMSceneBVH::GMSceneBVH()
+{
+	GM_CREATE_DATA();
+}
+
+GMSceneBVH::~GMSceneBVH()
+{
+
+}
+
+GMint32 GMSceneBVH::createProxy(const GMVec3& min, const GMVec3& max, GMGameObject* object)
+{
+	D(d);
+	GMint32 proxy = d->allocateNode();
+	GMSceneBVHNode& node = d->nodes[proxy];
+	node.bounds = enlarge(makeBounds(min, max), BoundsMarginRatio);
+	node.object = object;
+	node.height = 0;
+	d->insertLeaf(proxy);
+	++d->proxyCount;
+	return proxy;
+}
+
+void GMSceneBVH::destroyProxy(GMint32 proxy)
+{
+	D(d);
+	GM_ASSERT(proxy >= 0 && proxy < static_cast<GMint32>(d->nodes.size()) && d->nodes[proxy].isLeaf());
+	d->removeLeaf(proxy);
+	d->freeNode(proxy);
+	--d->proxyCount;
+}
+
+bool GMSceneBVH::moveProxy(GMint32 proxy, const GMVec3& min, const GMVec3& max)
+{
+	D(d);
+	GM_ASSERT(proxy >= 0 && proxy < static_cast<GMint32>(d->nodes.size()) && d->nodes[proxy].isLeaf());
+	GMSceneBVHBounds bounds = makeBounds(min, max);
+	const GMSceneBVHBounds& fatBounds = d->nodes[proxy].bounds;
+	if (contains(fatBounds, bounds))
+	{
+		// 对象变小了很多时也需要重新插入，否则放大的包围盒会让裁剪失效
+		GMSceneBVHBounds hugeBounds = enlarge(bounds, BoundsMarginRatio * 4);
+		if (contains(hugeBounds, fatBounds))
+			return false;
+	}
+
+	d->removeLeaf(proxy);
+	d->nodes[proxy].bounds = enlarge(bounds, BoundsMarginRatio);
+	d->insertLeaf(proxy);
+	return true;
+}
+
+GMGameObject* GMSceneBVH::getObject(GMint32 proxy)
+{
+	D(d);
+	GM_ASSERT(proxy >= 0 && proxy < static_cast<GMint32>(d->nodes.size()));
+	return d->nodes[proxy].object;
+}
+
+GMsize_t GMSceneBVH::query(const GMFrustumPlanes& planes, Vector<GMGameObject*>* visibleObjects)
+{
+	D(d);
+	if (++d->queryId == 0)
+	{
+		// 查询序号溢出，清除所有节点的可见记录
+		for (auto& node : d->nodes)
+		{
+			node.visibleQuery = 0;
+		}
+		d->queryId = 1;
+	}
+
+	if (d->root == NullNode)
+		return 0;
+
+	const GMPlane* frustumPlanes[] = {
+		&planes.farPlane,
+		&planes.nearPlane,
+		&planes.topPlane,
+		&planes.bottomPlane,
+		&planes.leftPlane,
+		&planes.rightPlane
+	};
+
+	GMfloat p[6][4];
+	for (GMint32 i = 0; i < 6; ++i)
+	{
+		GMVec4 plane = frustumPlanes[i]->getPlane();
+		p[i][0] = plane.getX();
+		p[i][1] = plane.getY();
+		p[i][2] = plane.getZ();
+		p[i][3] = plane.getW();
+	}
+
+	GMsize_t count = 0;
+	d->stack.clear();
+	d->stack.push_back({ d->root, AllPlanes });
+	while (!d->stack.empty())
+	{
+		GMSceneBVHQueryEntry entry = d->stack.back();
+		d->stack.pop_back();
+
+		GMSceneBVHNode& node = d->nodes[entry.node];
+		GMint32 planeMask = entry.planeMask;
+		bool outside = false;
+		for (GMint32 i = 0; i < 6 && planeMask; ++i)
+		{
+			if (!(planeMask & (1 << i)))
+				continue;
+
+			// 沿法线方向最远的顶点在平面后方，说明整个包围盒都在平面后方；
+			// 最近的顶点也在平面前方，说明整个包围盒都在平面前方，子节点不需要再测试此平面
+			GMfloat farthest = p[i][3], nearest = p[i][3];
+			for (GMint32 axis = 0; axis < 3; ++axis)
+			{
+				if (p[i][axis] >= 0)
+				{
+					farthest += p[i][axis] * node.bounds.max[axis];
+					nearest += p[i][axis] * node.bounds.min[axis];
+				}
+				else
+				{
+					farthest += p[i][axis] * node.bounds.min[axis];
+					nearest += p[i][axis] * node.bounds.max[axis];
+				}
+			}
+
+			if (farthest < -PlaneEpsilon)
+			{
+				outside = true;
+				break;
+			}
+
+			if (nearest >= -PlaneEpsilon)
+				planeMask &= ~(1 << i);
+		}
+
+		if (outside)
+			continue;
+
+		if (node.isLeaf())
+		{
+			node.visibleQuery = d->queryId;
+			++count;
+			if (visibleObjects)
+				visibleObjects->push_back(node.object);
+		}
+		else
+		{
+			d->stack.push_back({ node.child1, planeMask });
+			d->stack.push_back({ node.child2, planeMask });
+		}
+	}
+	return count;
+}
+
+bool GMSceneBVH::isVisible(GMint32 proxy)
+{
+	D(d);
+	GM_ASSERT(proxy >= 0 && proxy < static_cast<GMint32>(d->nodes.size()));
+	return d->queryId != 0 && d->nodes[proxy].visibleQuery == d->queryId;
+}
+
+GMsize_t GMSceneBVH::getProxyCount()
+{
+	D(d);
+	return d->proxyCount;
+}
+
+GMint32 GMSceneBVH::getHeight()
+{
+	D(d);
+	if (d->root == NullNode)
+		return 0;
+	return d->nodes[d->root].height + 1;
+}
+
+void GMSceneBVH::clear()
+{
+	D(d);
+	d->nodes.clear();
+	d->stack.clear();
+	d->root = NullNode;
+	d->freeList = NullNode;
+	d->proxyCount = 0;
+}
+
+END_NS
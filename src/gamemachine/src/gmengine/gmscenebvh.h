@@ -0,0 +1,76 @@
+﻿#ifndef __GMSCENEBVH_H__
+#define __GMSCENEBVH_H__
+#include <gmcommon.h>
+#include <gmtools.h>
+BEGIN_NS
+
+class GMGameObject;
+
+GM_PRIVATE_CLASS(GMSceneBVH);
+//! 场景的动态层次包围盒树。
+/*!
+  每个GMGameObject在树中对应一个叶子节点（代理），叶子节点保存的是对象在世界坐标系下略微放大的AABB。
+  对象移动时，只要新的AABB仍然在放大后的AABB之内，就不需要改动树的结构。<BR>
+  插入节点时按照表面积启发式选择兄弟节点，并通过旋转保持树的平衡。视锥体查询时，完全位于视锥体某个平面内侧的子树不再对此平面进行测试。
+*/
+class GM_EXPORT GMSceneBVH
+{
+	GM_DECLARE_PRIVATE(GMSceneBVH)
+	GM_DISABLE_COPY_ASSIGN(GMSceneBVH)
+
+public:
+	enum
+	{
+		InvalidProxy = -1,
+	};
+
+public:
+	GMSceneBVH();
+	~GMSceneBVH();
+
+public:
+	//! 为一个对象创建代理。
+	/*!
+	  \param min 对象在世界坐标系下的AABB最小点。
+	  \param max 对象在世界坐标系下的AABB最大点。
+	  \param object 代理对应的对象。
+	  \return 代理的序号。
+	*/
+	GMint32 createProxy(const GMVec3& min, const GMVec3& max, GMGameObject* object);
+
+	//! 销毁一个代理。
+	void destroyProxy(GMint32 proxy);
+
+	//! 更新代理的AABB。
+	/*!
+	  \return 如果树的结构被改变，返回true。如果新的AABB仍在代理放大后的AABB内，返回false。
+	*/
+	bool moveProxy(GMint32 proxy, const GMVec3& min, const GMVec3& max);
+
+	//! 获取代理对应的对象。
+	GMGameObject* getObject(GMint32 proxy);
+
+	//! 查询与视锥体相交的代理。
+	/*!
+	  查询结果会被记录下来，在下一次查询之前可以通过isVisible()判断某个代理是否可见。
+	  \param planes 视锥体的平面。
+	  \param visibleObjects 如果不为空，可见的对象会被追加到其中。
+	  \return 可见代理的数目。
+	*/
+	GMsize_t query(const GMFrustumPlanes& planes, Vector<GMGameObject*>* visibleObjects = nullptr);
+
+	//! 判断代理在上一次query()中是否可见。
+	bool isVisible(GMint32 proxy);
+
+	//! 获取代理的数目。
+	GMsize_t getProxyCount();
+
+	//! 获取树的高度。空树的高度为0。
+	GMint32 getHeight();
+
+	//! 移除所有代理。
+	void clear();
+};
+
+END_NS
+#endif
@@ -439,6 +439,221 @@ void GMParticleSystem_Cocos2D::createCocos2DParticleSystem(
 	}
 }
 
+GM_PRIVATE_OBJECT_UNALIGNED(GMParticlePool_Cocos2D)
+{
+	GMsize_t size = 0;
+	Vector<GMfloat> streams[GMParticlePool_Cocos2D::StreamCount];
+	AlignedVector<GMParticle_Cocos2DData> packed;
+
+	void write(GMsize_t index, const GMParticle_Cocos2DData& data);
+	GMParticle_Cocos2DData read(GMsize_t index) const;
+};
+
+void GM_PRIVATE_NAME(GMParticlePool_Cocos2D)::write(GMsize_t index, const GMParticle_Cocos2DData& data)
+{
+	typedef GMParticlePool_Cocos2D P;
+	streams[P::PositionX][index] = data.position.getX();
+	streams[P::PositionY][index] = data.position.getY();
+	streams[P::PositionZ][index] = data.position.getZ();
+	streams[P::StartPositionX][index] = data.startPosition.getX();
+	streams[P::StartPositionY][index] = data.startPosition.getY();
+	streams[P::StartPositionZ][index] = data.startPosition.getZ();
+	streams[P::ChangePositionX][index] = data.changePosition.getX();
+	streams[P::ChangePositionY][index] = data.changePosition.getY();
+	streams[P::ChangePositionZ][index] = data.changePosition.getZ();
+	streams[P::ColorR][index] = data.color.getX();
+	streams[P::ColorG][index] = data.color.getY();
+	streams[P::ColorB][index] = data.color.getZ();
+	streams[P::ColorA][index] = data.color.getW();
+	streams[P::DeltaColorR][index] = data.deltaColor.getX();
+	streams[P::DeltaColorG][index] = data.deltaColor.getY();
+	streams[P::DeltaColorB][index] = data.deltaColor.getZ();
+	streams[P::DeltaColorA][index] = data.deltaColor.getW();
+	streams[P::Size][index] = data.size;
+	streams[P::DeltaSize][index] = data.deltaSize;
+	streams[P::Rotation][index] = data.rotation;
+	streams[P::DeltaRotation][index] = data.deltaRotation;
+	streams[P::RemainingLife][index] = data.remainingLife;
+	streams[P::InitialVelocityX][index] = data.gravityModeData.initialVelocity.getX();
+	streams[P::InitialVelocityY][index] = data.gravityModeData.initialVelocity.getY();
+	streams[P::InitialVelocityZ][index] = data.gravityModeData.initialVelocity.getZ();
+	streams[P::RadialAcceleration][index] = data.gravityModeData.radialAcceleration;
+	streams[P::TangentialAcceleration][index] = data.gravityModeData.tangentialAcceleration;
+	streams[P::Angle][index] = data.radiusModeData.angle;
+	streams[P::DegreesPerSecond][index] = data.radiusModeData.degressPerSecond;
+	streams[P::Radius][index] = data.radiusModeData.radius;
+	streams[P::DeltaRadius][index] = data.radiusModeData.deltaRadius;
+}
+
+GMParticle_Cocos2DData GM_PRIVATE_NAME(GMParticlePool_Cocos2D)::read(GMsize_t index) const
+{
+	typedef GMParticlePool_Cocos2D P;
+	GMParticle_Cocos2DData data;
+	data.position = GMVec3(streams[P::PositionX][index], streams[P::PositionY][index], streams[P::PositionZ][index]);
+	data.startPosition = GMVec3(streams[P::StartPositionX][index], streams[P::StartPositionY][index], streams[P::StartPositionZ][index]);
+	data.changePosition = GMVec3(streams[P::ChangePositionX][index], streams[P::ChangePositionY][index], streams[P::ChangePositionZ][index]);
+	data.color = GMVec4(streams[P::ColorR][index], streams[P::ColorG][index], streams[P::ColorB][index], streams[P::ColorA][index]);
+	data.deltaColor = GMVec4(streams[P::DeltaColorR][index], streams[P::DeltaColorG][index], streams[P::DeltaColorB][index], streams[P::DeltaColorA][index]);
+	data.size = streams[P::Size][index];
+	data.deltaSize = streams[P::DeltaSize][index];
+	data.rotation = streams[P::Rotation][index];
+	data.deltaRotation = streams[P::DeltaRotation][index];
+	data.remainingLife = streams[P::RemainingLife][index];
+	data.gravityModeData.initialVelocity = GMVec3(streams[P::InitialVelocityX][index], streams[P::InitialVelocityY][index], streams[P::InitialVelocityZ][index]);
+	data.gravityModeData.radialAcceleration = streams[P::RadialAcceleration][index];
+	data.gravityModeData.tangentialAcceleration = streams[P::TangentialAcceleration][index];
+	data.radiusModeData.angle = streams[P::Angle][index];
+	data.radiusModeData.degressPerSecond = streams[P::DegreesPerSecond][index];
+	data.radiusModeData.radius = streams[P::Radius][index];
+	data.radiusModeData.deltaRadius = streams[P::DeltaRadius][index];
+	return data;
+}
+
+GMParticlePool_Cocos2D::GMParticlePool_Cocos2D()
+{
+	GM_CREATE_DATA();
+}
+
+GMParticlePool_Cocos2D::~GMParticlePool_Cocos2D()
+{
+
+}
+
+GMParticlePool_Cocos2D::GMParticlePool_Cocos2D(const GMParticlePool_Cocos2D& rhs)
+{
+	*this = rhs;
+}
+
+GMParticlePool_Cocos2D::GMParticlePool_Cocos2D(GMParticlePool_Cocos2D&& rhs) GM_NOEXCEPT
+{
+	*this = std::move(rhs);
+}
+
+GMParticlePool_Cocos2D& GMParticlePool_Cocos2D::operator=(const GMParticlePool_Cocos2D& rhs)
+{
+	GM_COPY(rhs);
+	return *this;
+}
+
+GMParticlePool_Cocos2D& GMParticlePool_Cocos2D::operator=(GMParticlePool_Cocos2D&& rhs) GM_NOEXCEPT
+{
+	GM_MOVE(rhs);
+	return *this;
+}
+
+GMsize_t GMParticlePool_Cocos2D::size() const GM_NOEXCEPT
+{
+	D(d);
+	return d->size;
+}
+
+bool GMParticlePool_Cocos2D::empty() const GM_NOEXCEPT
+{
+	D(d);
+	return d->size == 0;
+}
+
+void GMParticlePool_Cocos2D::clear()
+{
+	D(d);
+	d->size = 0;
+	for (auto& stream : d->streams)
+	{
+		stream.clear();
+	}
+}
+
+void GMParticlePool_Cocos2D::reserve(GMsize_t count)
+{
+	D(d);
+	for (auto& stream : d->streams)
+	{
+		stream.reserve(count);
+	}
+}
+
+void GMParticlePool_Cocos2D::push_back(const GMParticle_Cocos2DData& particle)
+{
+	D(d);
+	for (auto& stream : d->streams)
+	{
+		stream.push_back(0);
+	}
+	d->write(d->size++, particle);
+}
+
+GMParticle_Cocos2DData GMParticlePool_Cocos2D::get(GMsize_t index) const
+{
+	D(d);
+	GM_ASSERT(index < d->size);
+	return d->read(index);
+}
+
+void GMParticlePool_Cocos2D::remove(GMsize_t index)
+{
+	D(d);
+	GM_ASSERT(index < d->size);
+	GMsize_t last = --d->size;
+	for (auto& stream : d->streams)
+	{
+		stream[index] = stream[last];
+		stream.pop_back();
+	}
+}
+
+GMsize_t GMParticlePool_Cocos2D::removeDeadParticles()
+{
+	D(d);
+	GMsize_t removed = 0;
+	const GMfloat* life = d->streams[RemainingLife].data();
+	for (GMsize_t i = 0; i < d->size;)
+	{
+		if (life[i] > 0)
+		{
+			++i;
+		}
+		else
+		{
+			// 最后一个粒子被移动到i，它还需要被检查一次
+			remove(i);
+			++removed;
+		}
+	}
+	return removed;
+}
+
+GMfloat* GMParticlePool_Cocos2D::getStream(Stream stream) GM_NOEXCEPT
+{
+	D(d);
+	return d->streams[stream].data();
+}
+
+const GMfloat* GMParticlePool_Cocos2D::getStream(Stream stream) const GM_NOEXCEPT
+{
+	D(d);
+	return d->streams[stream].data();
+}
+
+GMParticle_Cocos2DData* GMParticlePool_Cocos2D::pack()
+{
+	D(d);
+	d->packed.resize(d->size);
+	for (GMsize_t i = 0; i < d->size; ++i)
+	{
+		d->packed[i] = d->read(i);
+	}
+	return d->packed.data();
+}
+
+void GMParticlePool_Cocos2D::unpack(const GMParticle_Cocos2DData* particles)
+{
+	D(d);
+	for (GMsize_t i = 0; i < d->size; ++i)
+	{
+		d->write(i, particles[i]);
+	}
+}
+
 GM_PRIVATE_OBJECT_ALIGNED(GMParticleEmitter_Cocos2D)
 {
 	GMVec3 emitPosition = Zero<GMVec3>();
@@ -452,7 +667,7 @@ GM_PRIVATE_OBJECT_ALIGNED(GMParticleEmitter_Cocos2D)
 	GMDuration duration = 0;
 	GMVec3 rotationAxis = GMVec3(0, 0, 1);
 	AUTORELEASE GMParticleEffect_Cocos2D* effect = nullptr;
-	Vector<GMParticle_Cocos2D> particles;
+	GMParticlePool_Cocos2D particles;
 	bool canEmit = true;
 	GMParticleSystem_Cocos2D* system = nullptr;
 	GMDuration emitCounter = 0;
@@ -546,7 +761,7 @@ void GMParticleEmitter_Cocos2D::addParticle()
 	{
 		GMParticle_Cocos2D particle;
 		d->effect->initParticle(&particle);
-		d->particles.push_back(std::move(particle));
+		d->particles.push_back(particle.dataRef());
 	}
 }
 
@@ -609,7 +824,7 @@ GMParticleEffect_Cocos2D* GMParticleEmitter_Cocos2D::getEffect() GM_NOEXCEPT
 	return d->effect;
 }
 
-Vector<GMParticle_Cocos2D>& GMParticleEmitter_Cocos2D::getParticles() GM_NOEXCEPT
+GMParticlePool_Cocos2D& GMParticleEmitter_Cocos2D::getParticles() GM_NOEXCEPT
 {
 	D(d);
 	return d->particles;
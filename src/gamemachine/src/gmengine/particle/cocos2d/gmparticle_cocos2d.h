@@ -175,6 +175,110 @@ protected:
 	GMParticle_Cocos2DData data;
 };
 
+GM_PRIVATE_CLASS(GMParticlePool_Cocos2D);
+//! 以结构数组（SoA）的方式存放一个发射器中所有存活的粒子。
+/*!
+  粒子的每个标量分量存放在一个连续的数组中，称为一个数据流。更新粒子时，每个数据流被顺序访问，便于编译器生成向量化的代码。<BR>
+  移除粒子时，最后一个粒子会被移动到被移除的位置，因此粒子的顺序不会被保留。粒子以加法混合的方式绘制，顺序不影响结果。
+*/
+class GM_EXPORT GMParticlePool_Cocos2D
+{
+	GM_DECLARE_PRIVATE(GMParticlePool_Cocos2D)
+
+public:
+	//! 粒子的数据流。
+	enum Stream
+	{
+		PositionX,
+		PositionY,
+		PositionZ,
+		StartPositionX,
+		StartPositionY,
+		StartPositionZ,
+		ChangePositionX,
+		ChangePositionY,
+		ChangePositionZ,
+		ColorR,
+		ColorG,
+		ColorB,
+		ColorA,
+		DeltaColorR,
+		DeltaColorG,
+		DeltaColorB,
+		DeltaColorA,
+		Size,
+		DeltaSize,
+		Rotation,
+		DeltaRotation,
+		RemainingLife,
+		InitialVelocityX, //!< 重力模式的速度。
+		InitialVelocityY,
+		InitialVelocityZ,
+		RadialAcceleration,
+		TangentialAcceleration,
+		Angle, //!< 半径模式的角度。
+		DegreesPerSecond,
+		Radius,
+		DeltaRadius,
+		StreamCount
+	};
+
+public:
+	GMParticlePool_Cocos2D();
+	~GMParticlePool_Cocos2D();
+	GMParticlePool_Cocos2D(const GMParticlePool_Cocos2D&);
+	GMParticlePool_Cocos2D(GMParticlePool_Cocos2D&&) GM_NOEXCEPT;
+	GMParticlePool_Cocos2D& operator=(const GMParticlePool_Cocos2D& rhs);
+	GMParticlePool_Cocos2D& operator=(GMParticlePool_Cocos2D&& rhs) GM_NOEXCEPT;
+
+public:
+	//! 获取粒子的数目。
+	GMsize_t size() const GM_NOEXCEPT;
+
+	//! 判断是否没有任何粒子。
+	bool empty() const GM_NOEXCEPT;
+
+	//! 移除所有粒子。
+	void clear();
+
+	//! 为粒子预留空间。
+	void reserve(GMsize_t count);
+
+	//! 在末尾添加一个粒子。
+	void push_back(const GMParticle_Cocos2DData& particle);
+
+	//! 获取第index个粒子的数据。
+	GMParticle_Cocos2DData get(GMsize_t index) const;
+
+	//! 移除第index个粒子，最后一个粒子将被移动到此位置。
+	void remove(GMsize_t index);
+
+	//! 移除所有生命值小于等于0的粒子。
+	/*!
+	  \return 移除的粒子数目。
+	*/
+	GMsize_t removeDeadParticles();
+
+	//! 获取一个数据流的首地址，长度为size()。
+	GMfloat* getStream(Stream stream) GM_NOEXCEPT;
+
+	//! 获取一个数据流的首地址，长度为size()。
+	const GMfloat* getStream(Stream stream) const GM_NOEXCEPT;
+
+	//! 将所有粒子转换为GMParticle_Cocos2DData数组，用于上传到计算着色器。
+	/*!
+	  返回的数组在下一次调用pack()之前有效。
+	  \return 长度为size()的粒子数组。
+	*/
+	GMParticle_Cocos2DData* pack();
+
+	//! 用GMParticle_Cocos2DData数组覆盖所有粒子的数据，用于读回计算着色器的结果。
+	/*!
+	  \param particles 长度为size()的粒子数组。
+	*/
+	void unpack(const GMParticle_Cocos2DData* particles);
+};
+
 GM_PRIVATE_CLASS(GMParticleEmitter_Cocos2D);
 class GM_EXPORT GMParticleEmitter_Cocos2D : public IParticleEmitter
 {
@@ -211,7 +315,7 @@ public:
 	void setParticleEffect(GMParticleEffect_Cocos2D* effect);
 	GMParticleSystem_Cocos2D* getParticleSystem() GM_NOEXCEPT;
 	GMParticleEffect_Cocos2D* getEffect() GM_NOEXCEPT;
-	Vector<GMParticle_Cocos2D>& getParticles() GM_NOEXCEPT;
+	GMParticlePool_Cocos2D& getParticles() GM_NOEXCEPT;
 };
 
 GM_PRIVATE_CLASS(GMParticleSystem_Cocos2D);
@@ -14,10 +14,51 @@ namespace
 	static GMString s_radialCode;
 	static GMString s_radialEntry;
 
+	// 每个任务更新的粒子数目
+	enum { ParticlesPerJob = 4096 };
+
 	const GMParticleDescription_Cocos2D* toCocos2DDesc(GMParticleDescription desc)
 	{
 		return static_cast<const GMParticleDescription_Cocos2D*>(desc);
 	}
+
+	// 颜色、大小和旋转与发射模式无关
+	void updateCommonStreams(GMParticlePool_Cocos2D& particles, GMsize_t begin, GMsize_t end, GMfloat dt)
+	{
+		typedef GMParticlePool_Cocos2D P;
+		const P::Stream streams[][2] = {
+			{ P::ColorR, P::DeltaColorR },
+			{ P::ColorG, P::DeltaColorG },
+			{ P::ColorB, P::DeltaColorB },
+			{ P::ColorA, P::DeltaColorA },
+			{ P::Rotation, P::DeltaRotation },
+		};
+		for (auto& stream : streams)
+		{
+			GMfloat* value = particles.getStream(stream[0]);
+			const GMfloat* delta = particles.getStream(stream[1]);
+			for (GMsize_t i = begin; i < end; ++i)
+			{
+				value[i] += delta[i] * dt;
+			}
+		}
+
+		GMfloat* size = particles.getStream(P::Size);
+		const GMfloat* deltaSize = particles.getStream(P::DeltaSize);
+		for (GMsize_t i = begin; i < end; ++i)
+		{
+			size[i] = Max(0, size[i] + deltaSize[i] * dt);
+		}
+	}
+
+	template <typename Kernel>
+	void updateAndRemoveDead(GMParticlePool_Cocos2D& particles, const GMParticleUpdateArgs_Cocos2D& args, Kernel kernel)
+	{
+		GMAsync::parallelFor(particles.size(), ParticlesPerJob, [&particles, &args, kernel](GMsize_t begin, GMsize_t end) {
+			kernel(particles, begin, end, args);
+		});
+		particles.removeDeadParticles();
+	}
 }
 
 GM_PRIVATE_OBJECT_ALIGNED(GMParticleEffect_Cocos2D)
@@ -175,6 +216,9 @@ bool GMParticleEffect_Cocos2D::GPUUpdate(GMDuration dt)
 	if (particles.empty())
 		return true;
 
+	// 计算着色器以GMParticle_Cocos2DData数组的形式读写粒子
+	GMParticle_Cocos2DData* packedParticles = particles.pack();
+	const GMuint32 particleStride = sizeof(GMParticle_Cocos2DData);
 	auto& progParticles = d->particles;
 	auto& progParticlesSRV = d->particlesSRV;
 	auto& progParticlesResult = d->particlesResult;
@@ -185,29 +229,29 @@ bool GMParticleEffect_Cocos2D::GPUUpdate(GMDuration dt)
 	// 粒子信息
 	if (!progParticles)
 	{
-		shaderProgram->createBuffer(sizeof(particles[0].dataRef()), gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::Structured, &progParticles);
+		shaderProgram->createBuffer(particleStride, gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::Structured, &progParticles);
 		shaderProgram->createBufferShaderResourceView(progParticles, &progParticlesSRV);
 
-		shaderProgram->createBuffer(sizeof(particles[0].dataRef()), gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::UnorderedStructured, &progParticlesResult);
+		shaderProgram->createBuffer(particleStride, gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::UnorderedStructured, &progParticlesResult);
 		shaderProgram->createBufferUnorderedAccessView(progParticlesResult, &progParticlesUAV);
 	}
 	else
 	{
 		// 如果粒子数量变多了，则重新生成buffer
 		GMsize_t sz = shaderProgram->getBufferSize(GMComputeBufferType::Structured, progParticles);
-		if (sz < sizeof(particles[0].dataRef()) * (particles.size()))
+		if (sz < particleStride * particles.size())
 		{
 			shaderProgram->release(progParticles);
 			shaderProgram->release(progParticlesSRV);
 			shaderProgram->release(progParticlesResult);
 			shaderProgram->release(progParticlesUAV);
-			shaderProgram->createBuffer(sizeof(particles[0].dataRef()), gm_sizet_to_uint(particles.size()), particles.data(), GMComputeBufferType::Structured, &progParticles);
+			shaderProgram->createBuffer(particleStride, gm_sizet_to_uint(particles.size()), packedParticles, GMComputeBufferType::Structured, &progParticles);
 			shaderProgram->createBufferShaderResourceView(progParticles, &progParticlesSRV);
-			shaderProgram->createBuffer(sizeof(particles[0].dataRef()), gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::UnorderedStructured, &progParticlesResult);
+			shaderProgram->createBuffer(particleStride, gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::UnorderedStructured, &progParticlesResult);
 			shaderProgram->createBufferUnorderedAccessView(progParticlesResult, &progParticlesUAV);
 		}
 	}
-	shaderProgram->setBuffer(progParticles, GMComputeBufferType::Structured, particles.data(), sizeof(particles[0].dataRef()) * gm_sizet_to_uint(particles.size()));
+	shaderProgram->setBuffer(progParticles, GMComputeBufferType::Structured, packedParticles, particleStride * gm_sizet_to_uint(particles.size()));
 	shaderProgram->bindShaderResourceView(1, &progParticlesSRV);
 
 	// 传入时间等变量
@@ -238,26 +282,27 @@ bool GMParticleEffect_Cocos2D::GPUUpdate(GMDuration dt)
 		if (!canReadFromGPU)
 			shaderProgram->copyBuffer(resultHandle, progParticlesResult);
 		const GMParticle_Cocos2DData* resultPtr = static_cast<GMParticle_Cocos2DData*>(shaderProgram->mapBuffer(resultHandle));
-		memcpy_s(particles.data(), sizeof(GMParticle_Cocos2DData) * particles.size(), resultPtr, sizeof(particles[0].dataRef()) * particles.size());
-
-		// 将存活的粒子放入临时容器，最后交换
-		Vector<GMParticle_Cocos2D> tmp;
-		tmp.reserve(particles.size());
-		for (GMsize_t i = 0; i < particles.size(); ++i)
-		{
-			auto& particle = particles[i];
-			if (particle.getRemainingLife() > 0)
-			{
-				tmp.push_back(particle);
-			}
-		}
-		particles.swap(tmp);
-
+		particles.unpack(resultPtr);
 		shaderProgram->unmapBuffer(resultHandle);
+
+		// 移除生命值耗尽的粒子
+		particles.removeDeadParticles();
 	}
 	return true;
 }
 
+GMParticleUpdateArgs_Cocos2D GMParticleEffect_Cocos2D::getUpdateArgs(GMDuration dt)
+{
+	D(d);
+	GMParticleUpdateArgs_Cocos2D args;
+	args.dt = dt;
+	args.motionMode = getMotionMode();
+	args.emitPosition = d->emitter->getEmitPosition();
+	args.gravity = getGravityMode().getGravity();
+	args.rotationAxis = d->emitter->getRotationAxis();
+	return args;
+}
+
 void GMGravityParticleEffect_Cocos2D::initParticle(GMParticle_Cocos2D* particle)
 {
 	D(d);
@@ -275,60 +320,64 @@ void GMGravityParticleEffect_Cocos2D::initParticle(GMParticle_Cocos2D* particle)
 void GMGravityParticleEffect_Cocos2D::CPUUpdate(GMDuration dt)
 {
 	D_BASE(d, GMParticleEffect_Cocos2D);
-	auto& particles = d->emitter->getParticles();
-	for (auto iter = particles.begin(); iter != particles.end();)
+	updateAndRemoveDead(d->emitter->getParticles(), getUpdateArgs(dt), &GMGravityParticleEffect_Cocos2D::updateParticles);
+}
+
+void GMGravityParticleEffect_Cocos2D::updateParticles(GMParticlePool_Cocos2D& particles, GMsize_t begin, GMsize_t end, const GMParticleUpdateArgs_Cocos2D& args)
+{
+	typedef GMParticlePool_Cocos2D P;
+	GMfloat* life = particles.getStream(P::RemainingLife);
+	GMfloat* vx = particles.getStream(P::InitialVelocityX);
+	GMfloat* vy = particles.getStream(P::InitialVelocityY);
+	GMfloat* vz = particles.getStream(P::InitialVelocityZ);
+	GMfloat* cx = particles.getStream(P::ChangePositionX);
+	GMfloat* cy = particles.getStream(P::ChangePositionY);
+	GMfloat* cz = particles.getStream(P::ChangePositionZ);
+	GMfloat* px = particles.getStream(P::PositionX);
+	GMfloat* py = particles.getStream(P::PositionY);
+	GMfloat* pz = particles.getStream(P::PositionZ);
+	const GMfloat* sx = particles.getStream(P::StartPositionX);
+	const GMfloat* sy = particles.getStream(P::StartPositionY);
+	const GMfloat* sz = particles.getStream(P::StartPositionZ);
+	const GMfloat* radialAcceleration = particles.getStream(P::RadialAcceleration);
+	const GMfloat* tangentialAcceleration = particles.getStream(P::TangentialAcceleration);
+
+	const GMfloat dt = args.dt;
+	const GMfloat gx = args.gravity.getX(), gy = args.gravity.getY(), gz = args.gravity.getZ();
+
+	// 跟随发射器时，位置需要加上发射器的偏移，否则偏移为0
+	const bool relative = args.motionMode == GMParticleMotionMode::Relative;
+	GM_ASSERT(relative || args.motionMode == GMParticleMotionMode::Free);
+	const GMfloat ex = relative ? args.emitPosition.getX() : 0;
+	const GMfloat ey = relative ? args.emitPosition.getY() : 0;
+	const GMfloat ez = relative ? args.emitPosition.getZ() : 0;
+	const GMfloat startFactor = relative ? 1.f : 0.f;
+
+	for (GMsize_t i = begin; i < end; ++i)
 	{
-		GMParticle_Cocos2D& particle = *iter;
-		particle.setRemainingLife(particle.getRemainingLife() - dt);
-		if (particle.getRemainingLife() > 0)
-		{
-			GMVec3 offset = Zero<GMVec3>();
-			GMVec3 radial = Zero<GMVec3>();
-			GMVec3 tangential = Zero<GMVec3>();
-
-			// 径向加速度
-			if (!FuzzyCompare(particle.getChangePosition().getX(), 0)
-				|| !FuzzyCompare(particle.getChangePosition().getY(), 0)
-				|| !FuzzyCompare(particle.getChangePosition().getZ(), 0))
-			{
-				radial = Normalize(particle.getGravityModeData().initialVelocity);
-			}
-			tangential = radial;
-			radial *= particle.getGravityModeData().radialAcceleration;
-
-			GMfloat y = tangential.getX();
-			tangential.setX(-tangential.getY());
-			tangential.setY(y);
-			tangential *= particle.getGravityModeData().tangentialAcceleration;
-
-			// 计算合力
-			offset = (radial + tangential + getGravityMode().getGravity()) * dt;
-			
-			// 移动粒子
-			particle.getGravityModeData().initialVelocity += offset;
-			particle.setChangePosition(particle.getChangePosition() + particle.getGravityModeData().initialVelocity * dt);
-
-			particle.setColor(particle.getColor() + particle.getDeltaColor() * dt);
-			particle.setSize(Max(0, particle.getSize() + particle.getDeltaSize() * dt));
-			particle.setRotation(particle.getRotation() + particle.getDeltaRotation() * dt);
-
-			if (getMotionMode() == GMParticleMotionMode::Relative)
-			{
-				// 跟随发射器
-				particle.setPosition(particle.getChangePosition() + d->emitter->getEmitPosition() - particle.getStartPosition());
-			}
-			else
-			{
-				GM_ASSERT(getMotionMode() == GMParticleMotionMode::Free);
-				particle.setPosition(particle.getChangePosition());
-			}
-			++iter;
-		}
-		else
-		{
-			iter = particles.erase(iter);
-		}
+		life[i] -= dt;
+
+		// 径向加速度，粒子离开发射点之后才有方向
+		const bool moved = cx[i] != 0 || cy[i] != 0 || cz[i] != 0;
+		const GMfloat invLength = moved ? 1.f / Sqrt(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]) : 0;
+		const GMfloat nx = vx[i] * invLength, ny = vy[i] * invLength, nz = vz[i] * invLength;
+
+		// 切向加速度为径向在xy平面上旋转90度
+		const GMfloat radial = radialAcceleration[i], tangential = tangentialAcceleration[i];
+		vx[i] += (nx * radial - ny * tangential + gx) * dt;
+		vy[i] += (ny * radial + nx * tangential + gy) * dt;
+		vz[i] += (nz * radial + nz * tangential + gz) * dt;
+
+		cx[i] += vx[i] * dt;
+		cy[i] += vy[i] * dt;
+		cz[i] += vz[i] * dt;
+
+		px[i] = cx[i] + ex - sx[i] * startFactor;
+		py[i] = cy[i] + ey - sy[i] * startFactor;
+		pz[i] = cz[i] + ez - sz[i] * startFactor;
 	}
+
+	updateCommonStreams(particles, begin, end, dt);
 }
 
 GMString GMGravityParticleEffect_Cocos2D::getCode()
@@ -401,42 +450,57 @@ void GMRadialParticleEffect_Cocos2D::initParticle(GMParticle_Cocos2D* particle)
 void GMRadialParticleEffect_Cocos2D::CPUUpdate(GMDuration dt)
 {
 	D_BASE(d, GMParticleEffect_Cocos2D);
-	auto& particles = d->emitter->getParticles();
-	for (auto iter = particles.begin(); iter != particles.end();)
-	{
-		GMParticle_Cocos2D& particle = *iter;
-		particle.setRemainingLife(particle.getRemainingLife() - dt);
-		if (particle.getRemainingLife() > 0)
-		{
-			particle.getRadiusModeData().angle += particle.getRadiusModeData().degressPerSecond * dt;
-			particle.getRadiusModeData().radius += particle.getRadiusModeData().deltaRadius * dt;
-
-			GMQuat rotationQuat = Rotate(particle.getRadiusModeData().angle, d->emitter->getRotationAxis());
-			GMVec3 changePosition = particle.getChangePosition();
-			changePosition = s_rotateStartVector * rotationQuat * particle.getRadiusModeData().radius;
-			particle.setChangePosition(changePosition);
-
-			if (getMotionMode() == GMParticleMotionMode::Relative)
-			{
-				// 跟随发射器
-				particle.setPosition(particle.getChangePosition() + particle.getStartPosition());
-			}
-			else
-			{
-				GM_ASSERT(getMotionMode() == GMParticleMotionMode::Free);
-				particle.setPosition(particle.getChangePosition() + d->emitter->getEmitPosition());
-			}
+	updateAndRemoveDead(d->emitter->getParticles(), getUpdateArgs(dt), &GMRadialParticleEffect_Cocos2D::updateParticles);
+}
 
-			particle.setColor(particle.getColor() + particle.getDeltaColor() * dt);
-			particle.setSize(Max(0, particle.getSize() + particle.getDeltaSize() * dt));
-			particle.setRotation(particle.getRotation() + particle.getDeltaRotation() * dt);
-			++iter;
-		}
-		else
-		{
-			iter = particles.erase(iter);
-		}
+void GMRadialParticleEffect_Cocos2D::updateParticles(GMParticlePool_Cocos2D& particles, GMsize_t begin, GMsize_t end, const GMParticleUpdateArgs_Cocos2D& args)
+{
+	typedef GMParticlePool_Cocos2D P;
+	GMfloat* life = particles.getStream(P::RemainingLife);
+	GMfloat* angle = particles.getStream(P::Angle);
+	GMfloat* radius = particles.getStream(P::Radius);
+	GMfloat* cx = particles.getStream(P::ChangePositionX);
+	GMfloat* cy = particles.getStream(P::ChangePositionY);
+	GMfloat* cz = particles.getStream(P::ChangePositionZ);
+	GMfloat* px = particles.getStream(P::PositionX);
+	GMfloat* py = particles.getStream(P::PositionY);
+	GMfloat* pz = particles.getStream(P::PositionZ);
+	const GMfloat* sx = particles.getStream(P::StartPositionX);
+	const GMfloat* sy = particles.getStream(P::StartPositionY);
+	const GMfloat* sz = particles.getStream(P::StartPositionZ);
+	const GMfloat* degreesPerSecond = particles.getStream(P::DegreesPerSecond);
+	const GMfloat* deltaRadius = particles.getStream(P::DeltaRadius);
+
+	const GMfloat dt = args.dt;
+	const GMfloat kx = args.rotationAxis.getX(), ky = args.rotationAxis.getY(), kz = args.rotationAxis.getZ();
+
+	// 跟随发射器时，位置相对于粒子的发射点，否则相对于发射器当前的位置
+	const bool relative = args.motionMode == GMParticleMotionMode::Relative;
+	GM_ASSERT(relative || args.motionMode == GMParticleMotionMode::Free);
+	const GMfloat ex = relative ? 0 : args.emitPosition.getX();
+	const GMfloat ey = relative ? 0 : args.emitPosition.getY();
+	const GMfloat ez = relative ? 0 : args.emitPosition.getZ();
+	const GMfloat startFactor = relative ? 1.f : 0.f;
+
+	for (GMsize_t i = begin; i < end; ++i)
+	{
+		life[i] -= dt;
+		angle[i] += degreesPerSecond[i] * dt;
+		radius[i] += deltaRadius[i] * dt;
+
+		// 将(0, 1, 0)绕旋转轴旋转angle，即Rodrigues公式 v*cos + (k x v)*sin + k*(k.v)*(1-cos)
+		const GMfloat c = Cos(angle[i]), s = Sin(angle[i]);
+		const GMfloat t = ky * (1 - c);
+		cx[i] = (kx * t - kz * s) * radius[i];
+		cy[i] = (c + ky * t) * radius[i];
+		cz[i] = (kz * t + kx * s) * radius[i];
+
+		px[i] = cx[i] + ex + sx[i] * startFactor;
+		py[i] = cy[i] + ey + sy[i] * startFactor;
+		pz[i] = cz[i] + ez + sz[i] * startFactor;
 	}
+
+	updateCommonStreams(particles, begin, end, dt);
 }
 
 GMString GMRadialParticleEffect_Cocos2D::getCode()
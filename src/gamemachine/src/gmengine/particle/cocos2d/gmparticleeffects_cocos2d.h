@@ -5,6 +5,16 @@
 #include "gmparticle_cocos2d.h"
 BEGIN_NS
 
+//! 在CPU上更新粒子时，一帧中所有粒子共用的参数。
+struct GMParticleUpdateArgs_Cocos2D
+{
+	GMDuration dt = 0; //!< 距离上一帧的时间。
+	GMParticleMotionMode motionMode = GMParticleMotionMode::Free; //!< 粒子是否跟随发射器移动。
+	GMVec3 emitPosition = Zero<GMVec3>(); //!< 发射器的位置。
+	GMVec3 gravity = Zero<GMVec3>(); //!< 重力，用于重力模式。
+	GMVec3 rotationAxis = GMVec3(0, 0, 1); //!< 旋转轴，用于半径模式。
+};
+
 GM_PRIVATE_CLASS(GMParticleEffect_Cocos2D);
 class GM_EXPORT GMParticleEffect_Cocos2D : public IDestroyObject
 {
@@ -43,6 +53,7 @@ public:
 protected:
 	virtual void CPUUpdate(GMDuration dt) = 0;
 	virtual bool GPUUpdate(GMDuration dt);
+	GMParticleUpdateArgs_Cocos2D getUpdateArgs(GMDuration dt);
 	virtual GMString getCode() = 0;
 	virtual GMString getEntry() = 0;
 	virtual IComputeShaderProgram* getComputeShaderProgram(const IRenderContext* context) { return nullptr; }
@@ -66,6 +77,16 @@ protected:
 
 public:
 	static void setDefaultCodeAndEntry(const GMString& code, const GMString& entry);
+
+	//! 按照重力模式更新粒子区间[begin, end)。
+	/*!
+	  此函数只更新粒子的状态，生命值耗尽的粒子需要之后调用GMParticlePool_Cocos2D::removeDeadParticles()移除。
+	  \param particles 粒子池。
+	  \param begin 区间的起始位置。
+	  \param end 区间的结束位置。
+	  \param args 更新参数。
+	*/
+	static void updateParticles(GMParticlePool_Cocos2D& particles, GMsize_t begin, GMsize_t end, const GMParticleUpdateArgs_Cocos2D& args);
 };
 
 class GM_EXPORT GMRadialParticleEffect_Cocos2D : public GMParticleEffect_Cocos2D
@@ -84,6 +105,16 @@ protected:
 
 public:
 	static void setDefaultCodeAndEntry(const GMString& code, const GMString& entry);
+
+	//! 按照半径模式更新粒子区间[begin, end)。
+	/*!
+	  此函数只更新粒子的状态，生命值耗尽的粒子需要之后调用GMParticlePool_Cocos2D::removeDeadParticles()移除。
+	  \param particles 粒子池。
+	  \param begin 区间的起始位置。
+	  \param end 区间的结束位置。
+	  \param args 更新参数。
+	*/
+	static void updateParticles(GMParticlePool_Cocos2D& particles, GMsize_t begin, GMsize_t end, const GMParticleUpdateArgs_Cocos2D& args);
 };
 
 
@@ -26,6 +26,9 @@ namespace
 	static GMString s_code;
 
 	enum { VerticesPerParticle = 6 };
+
+	// 每个任务处理的粒子数目
+	enum { ParticlesPerJob = 256 };
 }
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMParticleModel_Cocos2D)
@@ -90,7 +93,7 @@ GMGameObject* GMParticleModel_Cocos2D::createGameObject(
 	if (context->getEngine()->isCurrentMainThread())
 		context->getEngine()->createModelDataProxy(context, d->particleModel);
 	else
-		GM.invokeInMainThread([context, d]() { context->getEngine()->createModelDataProxy(context, d->particleModel); });
+		GM.invokeInMainThread([context, d]() { context->getEngine()->createModelDataProxy(context, d->particleModel); }, GMCommandPriority::High);
 	object->setContext(context);
 	object->setAsset(gm::GMScene::createSceneFromSingleModel(GMAsset(GMAssetType::Model, d->particleModel)));
 	return object;
@@ -102,11 +105,10 @@ void GMParticleModel_Cocos2D::update6Vertices(
 	const GMVec2& halfExtents,
 	const GMVec4& color,
 	const GMQuat& quat,
-	const GMVec3& lookDirection,
+	const GMQuat* billboardRotation,
 	GMfloat z
 )
 {
-	const static GMVec3 s_normal(0, 0, -1.f);
 	constexpr GMfloat texcoord[4][2] =
 	{
 		{ 0, 1 },
@@ -131,17 +133,14 @@ void GMParticleModel_Cocos2D::update6Vertices(
 	};
 
 	// 当玩家没有直视粒子时，使用billboard效果
-	if (!normalFuzzyEquals(-lookDirection, s_normal))
+	if (billboardRotation)
 	{
-		GMQuat rot = RotationTo(s_normal, -lookDirection, Zero<GMVec3>());
-
-		GMMat4 transToOrigin = Translate(-centerPt);
-		GMMat4 transToCenterPt = Translate(centerPt);
 		// 先移回原点，旋转之后再移会原位置
-		transformed[0] = transformed[0] * transToOrigin * rot * transToCenterPt;
-		transformed[1] = transformed[1] * transToOrigin * rot * transToCenterPt;
-		transformed[2] = transformed[2] * transToOrigin * rot * transToCenterPt;
-		transformed[3] = transformed[3] * transToOrigin * rot * transToCenterPt;
+		const GMVec4 center(centerPt.getX(), centerPt.getY(), centerPt.getZ(), 0);
+		transformed[0] = (transformed[0] - center) * (*billboardRotation) + center;
+		transformed[1] = (transformed[1] - center) * (*billboardRotation) + center;
+		transformed[2] = (transformed[2] - center) * (*billboardRotation) + center;
+		transformed[3] = (transformed[3] - center) * (*billboardRotation) + center;
 	}
 
 	// 排列方式：
@@ -307,7 +306,7 @@ GMComputeBufferHandle GMParticleModel_Cocos2D::prepareBuffers(IComputeShaderProg
 	shaderProgram->setBuffer(d->constantBuffer, GMComputeBufferType::Constant, &c, sizeof(c));
 	shaderProgram->bindConstantBuffer(d->constantBuffer);
 
-	shaderProgram->setBuffer(d->particleBuffer, GMComputeBufferType::Structured, particles.data(), sizeof(particles[0]) * gm_sizet_to_uint(particles.size()));
+	shaderProgram->setBuffer(d->particleBuffer, GMComputeBufferType::Structured, particles.pack(), sizeof(GMParticle_Cocos2DData) * gm_sizet_to_uint(particles.size()));
 	shaderProgram->bindShaderResourceView(1, &d->particleView);
 
 	// 创建结果
@@ -380,7 +379,7 @@ void GMParticleModel_Cocos2D::createBuffers(IComputeShaderProgram* shaderProgram
 	auto& particles = d->system->getEmitter()->getParticles();
 	GMsize_t particleCount = d->system->getEmitter()->getParticleCount();
 	shaderProgram->createBuffer(sizeof(Constant), 1, nullptr, GMComputeBufferType::Constant, &d->constantBuffer);
-	shaderProgram->createBuffer(sizeof(particles[0]), gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::Structured, &d->particleBuffer);
+	shaderProgram->createBuffer(sizeof(GMParticle_Cocos2DData), gm_sizet_to_uint(particles.size()), nullptr, GMComputeBufferType::Structured, &d->particleBuffer);
 	shaderProgram->createBufferShaderResourceView(d->particleBuffer, &d->particleView);
 	shaderProgram->createBuffer(sizeof(GMVertex), gm_sizet_to_uint(particles.size()) * 6, nullptr, GMComputeBufferType::UnorderedStructured, &d->resultBuffer);
 	shaderProgram->createBufferUnorderedAccessView(d->resultBuffer, &d->resultView);
@@ -415,39 +414,61 @@ void GMParticleModel_Cocos2D::init()
 	initObjects();
 }
 
-void GMParticleModel_2D::CPUUpdate(void* dataPtr)
+void GMParticleModel_Cocos2D::updateVertices(void* dataPtr, bool useParticleZ)
 {
 	D(d);
 	const IRenderContext* context = d->system->getContext();
 	GM_ASSERT(context);
-	auto& particles = d->system->getEmitter()->getParticles();
-	const auto& lookDirection = context->getEngine()->getCamera().getLookAt().lookDirection;
+	const GMParticlePool_Cocos2D& particles = d->system->getEmitter()->getParticles();
+
+	// 所有粒子的billboard旋转相同，每一帧只计算一次
+	GMQuat billboardRotation;
+	const GMQuat* billboardRotationPtr = getBillboardRotation(context->getEngine()->getCamera().getLookAt().lookDirection, billboardRotation) ? &billboardRotation : nullptr;
+
+	typedef GMParticlePool_Cocos2D P;
+	const GMfloat* px = particles.getStream(P::PositionX);
+	const GMfloat* py = particles.getStream(P::PositionY);
+	const GMfloat* pz = particles.getStream(P::PositionZ);
+	const GMfloat* r = particles.getStream(P::ColorR);
+	const GMfloat* g = particles.getStream(P::ColorG);
+	const GMfloat* b = particles.getStream(P::ColorB);
+	const GMfloat* a = particles.getStream(P::ColorA);
+	const GMfloat* size = particles.getStream(P::Size);
+	const GMfloat* rotation = particles.getStream(P::Rotation);
 
 	// 一个粒子有6个顶点，2个三角形，放入并行计算
-	GMAsync::blockedAsync(
-		GMAsync::Async,
-		GM.getRunningStates().systemInfo.numberOfProcessors,
-		particles.begin(),
-		particles.end(),
-		[&particles, dataPtr, this, &lookDirection](auto begin, auto end) {
-		// 计算一下数据偏移
-		GMVertex* dataOffset = reinterpret_cast<GMVertex*>(dataPtr) + (begin - particles.begin()) * VerticesPerParticle;
-		for (auto iter = begin; iter != end; ++iter)
+	// 粒子本身若带有旋转，则会在正对用户视觉后再来应用此旋转
+	GMAsync::parallelFor(particles.size(), ParticlesPerJob, [=](GMsize_t begin, GMsize_t end) {
+		GMVertex* dataOffset = reinterpret_cast<GMVertex*>(dataPtr) + begin * VerticesPerParticle;
+		for (GMsize_t i = begin; i < end; ++i)
 		{
-			GMParticle_Cocos2D& particle = *iter;
-			GMfloat he = particle.getSize() / 2.f;
 			update6Vertices(
 				dataOffset,
-				particle.getPosition(),
-				he,
-				particle.getColor(),
-				Rotate(particle.getRotation(), GMVec3(0, 0, 1)),
-				lookDirection
+				GMVec3(px[i], py[i], pz[i]),
+				size[i] / 2.f,
+				GMVec4(r[i], g[i], b[i], a[i]),
+				Rotate(rotation[i], GMVec3(0, 0, 1)),
+				billboardRotationPtr,
+				useParticleZ ? pz[i] : 0
 			);
 			dataOffset += VerticesPerParticle;
 		}
-	}
-	);
+	});
+}
+
+bool GMParticleModel_Cocos2D::getBillboardRotation(const GMVec3& lookDirection, OUT GMQuat& rotation)
+{
+	const static GMVec3 s_normal(0, 0, -1.f);
+	if (normalFuzzyEquals(-lookDirection, s_normal))
+		return false;
+
+	rotation = RotationTo(s_normal, -lookDirection, Zero<GMVec3>());
+	return true;
+}
+
+void GMParticleModel_2D::CPUUpdate(void* dataPtr)
+{
+	updateVertices(dataPtr, false);
 }
 
 GMString GMParticleModel_2D::getCode()
@@ -457,41 +478,7 @@ GMString GMParticleModel_2D::getCode()
 
 void GMParticleModel_3D::CPUUpdate(void* dataPtr)
 {
-	D(d);
-	const IRenderContext* context = d->system->getContext();
-	GM_ASSERT(context);
-	auto& particles = d->system->getEmitter()->getParticles();
-	const auto& lookDirection = context->getEngine()->getCamera().getLookAt().lookDirection;
-
-	// 粒子本身若带有旋转，则会在正对用户视觉后再来应用此旋转
-	// 一个粒子有6个顶点，2个三角形，放入并行计算
-	enum { VerticesPerParticle = 6 };
-	GMAsync::blockedAsync(
-		GMAsync::Async,
-		GM.getRunningStates().systemInfo.numberOfProcessors,
-		particles.begin(),
-		particles.end(),
-		[&particles, dataPtr, this, &lookDirection](auto begin, auto end) {
-		// 计算一下数据偏移
-		GMVertex* dataOffset = reinterpret_cast<GMVertex*>(dataPtr) + (begin - particles.begin()) * VerticesPerParticle;
-		for (auto iter = begin; iter != end; ++iter)
-		{
-			GMParticle_Cocos2D& particle = *iter;
-			GMfloat he = particle.getSize() / 2.f;
-
-			update6Vertices(
-				dataOffset,
-				particle.getPosition(),
-				he,
-				particle.getColor(),
-				Rotate(particle.getRotation(), GMVec3(0, 0, 1)),
-				lookDirection,
-				particle.getPosition().getZ()
-			);
-			dataOffset += VerticesPerParticle;
-		}
-	}
-	);
+	updateVertices(dataPtr, true);
 }
 
 GMString GMParticleModel_3D::getCode()
@@ -40,10 +40,20 @@ protected:
 		const GMVec2& halfExtents,
 		const GMVec4& color,
 		const GMQuat& quat,
-		const GMVec3& lookDirection,
+		const GMQuat* billboardRotation,
 		GMfloat z = 0
 	);
 
+	void updateVertices(void* dataPtr, bool useParticleZ);
+
+	//! 获取使粒子正对观察者的旋转。
+	/*!
+	  \param lookDirection 观察方向。
+	  \param rotation 粒子需要进行的旋转。
+	  \return 如果观察者已经直视粒子，不需要旋转，返回false。
+	*/
+	static bool getBillboardRotation(const GMVec3& lookDirection, OUT GMQuat& rotation);
+
 protected:
 	virtual void updateData(void* dataPtr);
 	virtual void CPUUpdate(void* dataPtr) = 0;
@@ -0,0 +1,94 @@
+﻿#include "stdafx.h"
+#include <GL/glew.h>
+#include "gmglbonepalette.h"
+#include "gmglhelper.h"
+#include "gmengine/gmbonepalette.h"
+
+BEGIN_NS
+
+namespace
+{
+	constexpr GMsize_t InitialCapacity = 1024;
+	constexpr GMsize_t TexelSize = sizeof(GMfloat) * 4;
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMGLBonePaletteBuffer)
+{
+	GLuint buffer = 0;
+	GLuint texture = 0;
+	GMsize_t capacity = 0;
+	GMsize_t uploaded = 0;
+	GMuint32 generation = 0;
+};
+
+GMGLBonePaletteBuffer::GMGLBonePaletteBuffer()
+{
+	GM_CREATE_DATA();
+}
+
+GMGLBonePaletteBuffer::~GMGLBonePaletteBuffer()
+{
+	D(d);
+	if (d->texture)
+		GMGLStateCache::deleteTexture(d->texture);
+	if (d->buffer)
+		glDeleteBuffers(1, &d->buffer);
+}
+
+void GMGLBonePaletteBuffer::init()
+{
+	D(d);
+	GM_ASSERT(!d->buffer);
+	d->capacity = InitialCapacity;
+	glGenBuffers(1, &d->buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, d->buffer);
+	glBufferData(GL_TEXTURE_BUFFER, d->capacity * TexelSize, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &d->texture);
+	GMGLStateCache::bindTexture(TextureUnit, GL_TEXTURE_BUFFER, d->texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, d->buffer);
+}
+
+void GMGLBonePaletteBuffer::commit(const GMBonePalette& palette)
+{
+	D(d);
+	GM_ASSERT(d->buffer);
+	const GMsize_t size = palette.getSize();
+	bool reallocate = false;
+	if (d->generation != palette.getGeneration())
+	{
+		// 新的一帧，重新分配存储，上一帧的数据可能仍在被GPU使用
+		d->generation = palette.getGeneration();
+		d->uploaded = 0;
+		reallocate = true;
+	}
+
+	if (size > d->capacity)
+	{
+		while (d->capacity < size)
+		{
+			d->capacity *= 2;
+		}
+		d->uploaded = 0;
+		reallocate = true;
+	}
+
+	if (reallocate || size > d->uploaded)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, d->buffer);
+		if (reallocate)
+			glBufferData(GL_TEXTURE_BUFFER, d->capacity * TexelSize, nullptr, GL_DYNAMIC_DRAW);
+
+		if (size > d->uploaded)
+		{
+			glBufferSubData(GL_TEXTURE_BUFFER, d->uploaded * TexelSize, (size - d->uploaded) * TexelSize, palette.getData() + d->uploaded * 4);
+			d->uploaded = size;
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	GMGLStateCache::bindTexture(TextureUnit, GL_TEXTURE_BUFFER, d->texture);
+}
+
+END_NS
@@ -0,0 +1,45 @@
+﻿#ifndef __GMGLBONEPALETTE_H__
+#define __GMGLBONEPALETTE_H__
+#include <gmcommon.h>
+#include <gmshader.h>
+BEGIN_NS
+
+class GMBonePalette;
+
+GM_PRIVATE_CLASS(GMGLBonePaletteBuffer);
+//! 将骨骼调色板上传到OpenGL纹理缓存(Texture Buffer)。
+/*!
+  着色器中的GM_BonePalette是一个samplerBuffer，每个纹素为4个32位浮点数。<BR>
+  调色板在一帧中只会不断追加，因此每次提交只上传新追加的部分。调色板被清空后，缓存的存储会被重新分配，避免等待GPU使用完上一帧的数据。
+*/
+class GMGLBonePaletteBuffer
+{
+	GM_DECLARE_PRIVATE(GMGLBonePaletteBuffer)
+	GM_DISABLE_COPY_ASSIGN(GMGLBonePaletteBuffer)
+
+public:
+	enum
+	{
+		//! 调色板使用的纹理单元。延迟渲染的光照阶段会在所有纹理之后再使用一个纹理单元绑定立方体贴图，因此调色板放在它之后。
+		TextureUnit = GMTextureRegisterQuery<GMTextureType::EndOfEnum>::Value + 2,
+	};
+
+	GMGLBonePaletteBuffer();
+	~GMGLBonePaletteBuffer();
+
+public:
+	//! 创建纹理缓存。
+	/*!
+	  需要在OpenGL上下文为当前上下文时调用。
+	*/
+	void init();
+
+	//! 上传调色板中还没有上传的部分，并将纹理缓存绑定到TextureUnit。
+	/*!
+	  \param palette 本帧的骨骼调色板。
+	*/
+	void commit(const GMBonePalette& palette);
+};
+
+END_NS
+#endif
@@ -10,6 +10,8 @@
 #include "gmgllight.h"
 #include "gmengine/ui/gmwindow.h"
 #include "gmglhelper.h"
+#include "gmengine/gmassetstreamer.h"
+#include "gmdata/gmimage.h"
 #include <GL/glew.h>
 
 BEGIN_NS
@@ -22,6 +24,25 @@ void GMGLFactory::createWindow(GMInstance instance, IWindow* parent, OUT IWindow
 
 void GMGLFactory::createTexture(const IRenderContext* context, GMImage* image, REF GMTextureAsset& texture)
 {
+	if (GMAssetStreamer::isDecodingThread())
+	{
+		// 流式加载的工作线程中没有GL上下文，纹理在主线程中上传。
+		// 调用者在创建纹理后只会读取图片的尺寸或者销毁图片，因此直接接管图片的像素数据，不做复制
+		GMSharedPtr<GMImage> owned(new GMImage(), [](GMImage* p) { p->destroy(); });
+		owned->getData() = image->getData();
+		image->getData().mip[0].data = nullptr;
+
+		GMsize_t bytes = owned->getData().size;
+		if (!bytes)
+			bytes = owned->getWidth() * owned->getHeight() * owned->getData().channels;
+
+		texture = GMAsset(GMAssetType::Texture, new GMGLTexture(owned.get()));
+		GMAssetStreamer::deferUpload([texture, owned]() mutable {
+			texture.getTexture()->init();
+		}, bytes);
+		return;
+	}
+
 	GMGLTexture* t = new GMGLTexture(image);
 	t->init();
 	texture = GMAsset(GMAssetType::Texture, t);
@@ -7,6 +7,7 @@
 #include "gmengine/gmcsmhelper.h"
 #include "gmglgraphic_engine.h"
 #include "gmgltexture_p.h"
+#include "gmglhelper.h"
 
 BEGIN_NS
 
@@ -65,7 +66,7 @@ public:
 		db->target = GL_TEXTURE_2D;
 
 		glGenTextures(1, &db->id);
-		glBindTexture(GL_TEXTURE_2D, db->id);
+		GMGLStateCache::bindTexture(GL_TEXTURE_2D, db->id);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, d->desc.rect.width, d->desc.rect.height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -419,14 +420,13 @@ GMGLShadowMapTexture::GMGLShadowMapTexture(GMuint32 textureId)
 GMGLShadowMapTexture::~GMGLShadowMapTexture()
 {
 	D(d);
-	glDeleteTextures(1, &d->textureId);
+	GMGLStateCache::deleteTexture(d->textureId);
 }
 
 void GMGLShadowMapTexture::useTexture(GMint32)
 {
 	D(d);
-	glActiveTexture(GL_TEXTURE0 + GMTextureRegisterQuery<GMTextureType::ShadowMap>::Value);
-	glBindTexture(GL_TEXTURE_2D, d->textureId);
+	GMGLStateCache::bindTexture(GMTextureRegisterQuery<GMTextureType::ShadowMap>::Value, GL_TEXTURE_2D, d->textureId);
 }
 
 void GMGLShadowMapTexture::init()
@@ -507,7 +507,7 @@ void GMGLShadowFramebuffers::createDepthStencilBuffer(const GMFramebufferDesc& d
 	D_BASE(db, Base);
 	GLuint shadowMapTextureId = 0;
 	glGenTextures(1, &shadowMapTextureId);
-	glBindTexture(GL_TEXTURE_2D, shadowMapTextureId);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, shadowMapTextureId);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, desc.rect.width, desc.rect.height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -41,19 +41,7 @@ IFramebuffers* GMGLGBuffer::createGeometryFramebuffers()
 	const GMWindowStates& windowStates = d->context->getWindow()->getWindowStates();
 	GMFramebufferDesc desc = { 0 };
 	desc.rect = windowStates.renderRect;
-
-	// Geometry Pass的纹理格式为R8G8B8A8_UNORM，意味着所有的输出在着色器中范围是[0,1]，对应着UNORM的[0x00, 0xFF]
-	// 对于[-1, 1]范围的数据，需要在着色器中进行一次转换。
-	GMFramebufferFormat formats[] = {
-		GMFramebufferFormat::R32G32B32A32_FLOAT,
-		GMFramebufferFormat::R32G32B32A32_FLOAT,
-		GMFramebufferFormat::R32G32B32A32_FLOAT,
-		GMFramebufferFormat::R32G32B32A32_FLOAT,
-		GMFramebufferFormat::R8G8B8A8_UNORM,
-		GMFramebufferFormat::R8G8B8A8_UNORM,
-		GMFramebufferFormat::R8G8B8A8_UNORM,
-		GMFramebufferFormat::R32G32B32A32_FLOAT,
-	};
+	const Vector<GMFramebufferFormat>& formats = getGeometryFramebufferFormats();
 
 	GM.getFactory()->createFramebuffers(d->context, &framebuffers);
 	GM_ASSERT(framebuffers);
@@ -68,7 +56,8 @@ IFramebuffers* GMGLGBuffer::createGeometryFramebuffers()
 	}
 
 	constexpr GMuint32 framebufferCount = GM_array_size(s_GBufferGeometryUniformNames);
-	GM_STATIC_ASSERT(framebufferCount <= 8, "Too many targets.");
+	GM_STATIC_ASSERT(framebufferCount <= 8, "Too many targets.");
+	GM_ASSERT(formats.size() == framebufferCount);
 	for (GMint32 i = 0; i < framebufferCount; ++i)
 	{
 		IFramebuffer* framebuffer = nullptr;
@@ -2,44 +2,49 @@
 #include <GL/glew.h>
 #include "gmglglyphmanager.h"
 #include "gmgltexture.h"
-#include "freetype/ftglyph.h"
+#include "gmglhelper.h"
 
 BEGIN_NS
 class GMGLGlyphTexture : public ITexture
 {
 public:
-	GMGLGlyphTexture() = default;
+	GMGLGlyphTexture(GMGlyphManager* glyphManager)
+		: m_glyphManager(glyphManager)
+	{
+	}
+
 	~GMGLGlyphTexture()
 	{
-		glDeleteTextures(1, &m_id);
+		GMGLStateCache::deleteTexture(m_id);
 	}
 
 public:
 	virtual void init() override
 	{
 		glGenTextures(1, &m_id);
-		glBindTexture(GL_TEXTURE_2D, m_id);
+		GMGLStateCache::bindTexture(GL_TEXTURE_2D, m_id);
 		glTexStorage2D(GL_TEXTURE_2D,
 			1,
 			GL_R8,
 			GMGLGlyphManager::CANVAS_WIDTH,
 			GMGLGlyphManager::CANVAS_HEIGHT
 		);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GMGLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 	}
 
 	virtual void bindSampler(GMTextureSampler* sampler) override
 	{
-		glBindTexture(GL_TEXTURE_2D, m_id);
+		GMGLStateCache::bindTexture(GL_TEXTURE_2D, m_id);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GMGLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 	}
 
 	virtual void useTexture(GMint32 textureIndex) override
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, m_id);
+		// 使用纹理之前，上传新光栅化的字形
+		m_glyphManager->flush();
+		GMGLStateCache::bindTexture(0, GL_TEXTURE_2D, m_id);
 	}
 
 	GMuint32 getTextureId()
@@ -48,13 +53,12 @@ public:
 	}
 
 private:
+	GMGlyphManager* m_glyphManager;
 	GMuint32 m_id;
 };
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMGLGlyphManager)
 {
-	GMint32 cursor_u, cursor_v;
-	GMfloat maxHeight;
 	GMTextureAsset texture;
 };
 
@@ -63,9 +67,7 @@ GMGLGlyphManager::GMGLGlyphManager(const IRenderContext* context)
 {
 	GM_CREATE_DATA();
 	D(d);
-	d->cursor_u = d->cursor_v = 0;
-	d->maxHeight = 0;
-	d->texture = GMAsset(GMAssetType::Texture, new GMGLGlyphTexture());
+	d->texture = GMAsset(GMAssetType::Texture, new GMGLGlyphTexture(this));
 	d->texture.getTexture()->init();
 }
 
@@ -79,23 +81,25 @@ GMTextureAsset GMGLGlyphManager::glyphTexture()
 	return d->texture;
 }
 
-void GMGLGlyphManager::updateTexture(const GMGlyphBitmap& bitmapGlyph, const GMGlyphInfo& glyphInfo)
+void GMGLGlyphManager::updateTexture(const GMGlyphBitmap& bitmap, GMint32 x, GMint32 y)
 {
 	D(d);
-	// 创建纹理
-	glBindTexture(GL_TEXTURE_2D, d->texture.get<GMGLGlyphTexture*>()->getTextureId());
+	// 更新纹理
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, d->texture.get<GMGLGlyphTexture*>()->getTextureId());
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // 使用一个字节保存，必须设置对齐为1
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap.pitch);
 	glTexSubImage2D(GL_TEXTURE_2D,
 		0,
-		glyphInfo.x,
-		glyphInfo.y,
-		glyphInfo.width,
-		glyphInfo.height,
+		x,
+		y,
+		bitmap.width,
+		bitmap.rows,
 		GL_RED,
 		GL_UNSIGNED_BYTE,
-		bitmapGlyph.buffer);
+		bitmap.buffer);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 END_NS
\ No newline at end of file
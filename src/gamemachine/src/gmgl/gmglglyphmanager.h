@@ -18,7 +18,7 @@ public:
 	virtual GMTextureAsset glyphTexture() override;
 
 protected:
-	void updateTexture(const GMGlyphBitmap& bitmapGlyph, const GMGlyphInfo& glyphInfo) override;
+	void updateTexture(const GMGlyphBitmap& bitmap, GMint32 x, GMint32 y) override;
 };
 
 END_NS
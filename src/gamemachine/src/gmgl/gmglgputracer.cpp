@@ -0,0 +1,91 @@
+﻿#include "stdafx.h"
+#include <GL/glew.h>
+#include "gmglgputracer.h"
+#include "foundation/gmprofile.h"
+
+BEGIN_NS
+
+namespace
+{
+	struct GLTraceQueries
+	{
+		Vector<GLuint> queries;
+		GMint32 used = 0;
+		GMint64 offset = 0; // CPU时间与GPU时间的差值
+	};
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMGLGPUTracer)
+{
+	GLTraceQueries frames[GMGPUTracer::FramesInFlight];
+};
+
+GMGLGPUTracer::GMGLGPUTracer()
+{
+	GM_CREATE_DATA();
+}
+
+GMGLGPUTracer::~GMGLGPUTracer()
+{
+	D(d);
+	for (auto& frame : d->frames)
+	{
+		if (!frame.queries.empty())
+			glDeleteQueries(gm_sizet_to_int(frame.queries.size()), frame.queries.data());
+	}
+}
+
+void GMGLGPUTracer::beginQueries(GMint32 frame)
+{
+	D(d);
+	GLTraceQueries& f = d->frames[frame];
+	f.used = 0;
+
+	// GL_TIMESTAMP返回的是GPU执行到之前所有命令时的时间，不会等待这些命令执行完
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	f.offset = GMTracer::now() - gpuTime;
+}
+
+void GMGLGPUTracer::endQueries(GMint32 frame)
+{
+}
+
+GMint32 GMGLGPUTracer::queryTimestamp(GMint32 frame)
+{
+	D(d);
+	GLTraceQueries& f = d->frames[frame];
+	if (f.used == gm_sizet_to_int(f.queries.size()))
+	{
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		f.queries.push_back(query);
+	}
+	glQueryCounter(f.queries[f.used], GL_TIMESTAMP);
+	return f.used++;
+}
+
+bool GMGLGPUTracer::resolveQueries(GMint32 frame, OUT Vector<GMint64>& timestamps)
+{
+	D(d);
+	GLTraceQueries& f = d->frames[frame];
+	timestamps.resize(f.used);
+	if (f.used == 0)
+		return true;
+
+	// 查询按顺序完成，最后一个可用时，之前的都已经可用
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(f.queries[f.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+
+	for (GMint32 i = 0; i < f.used; ++i)
+	{
+		GLuint64 result = 0;
+		glGetQueryObjectui64v(f.queries[i], GL_QUERY_RESULT, &result);
+		timestamps[i] = static_cast<GMint64>(result) + f.offset;
+	}
+	return true;
+}
+
+END_NS
@@ -0,0 +1,30 @@
+﻿#ifndef __GMGLGPUTRACER_H__
+#define __GMGLGPUTRACER_H__
+#include <gmcommon.h>
+#include <gmgputracer.h>
+BEGIN_NS
+
+GM_PRIVATE_CLASS(GMGLGPUTracer);
+//! 使用OpenGL时间戳查询(GL_TIMESTAMP)实现的GPU跟踪。
+/*!
+  每一帧开始时读取一次GPU的当前时间，用它与GMTracer::now()的差值把这一帧的查询结果换算到CPU的时间。<BR>
+  所有的方法都需要在OpenGL上下文为当前上下文时调用。
+*/
+class GMGLGPUTracer : public GMGPUTracer
+{
+	GM_DECLARE_PRIVATE(GMGLGPUTracer)
+	GM_DECLARE_BASE(GMGPUTracer)
+
+public:
+	GMGLGPUTracer();
+	~GMGLGPUTracer();
+
+protected:
+	virtual void beginQueries(GMint32 frame) override;
+	virtual void endQueries(GMint32 frame) override;
+	virtual GMint32 queryTimestamp(GMint32 frame) override;
+	virtual bool resolveQueries(GMint32 frame, OUT Vector<GMint64>& timestamps) override;
+};
+
+END_NS
+#endif
@@ -12,6 +12,10 @@
 #include "foundation/gmprofile.h"
 #include "gmglframebuffer.h"
 #include "gmglglyphmanager.h"
+#include "gmglhelper.h"
+#include "gmgluniformbuffers.h"
+#include "gmglbonepalette.h"
+#include "gmglgputracer.h"
 #include "gmengine/gmcsmhelper.h"
 #include <gmwindow.h>
 #include "../gmengine/gmgraphicengine_p.h"
@@ -54,6 +58,18 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMGLGraphicEngine)
 	bool inited = false;
 	bool engineReady = false;
 
+	// 状态缓存最后析构，以便其它OpenGL对象析构时仍然可以更新它
+	GMGLStateCache stateCache;
+
+	// 统一变量缓存
+	GMGLUniformBuffers uniformBuffers;
+
+	// 骨骼调色板
+	GMGLBonePaletteBuffer bonePaletteBuffer;
+
+	// GPU时间戳查询
+	GMGLGPUTracer gpuTracer;
+
 	// 著色器程序
 	GMOwnedPtr<GMGLShaderProgram> forwardShaderProgram;
 	GMOwnedPtr<GMGLShaderProgram> deferredShaderPrograms[2];
@@ -94,6 +110,10 @@ void GMGLGraphicEngine::init()
 	D(d);
 	if (!d->inited)
 	{
+		// 初始化时上下文已经是当前上下文
+		d->stateCache.makeCurrent();
+		d->uniformBuffers.init();
+		d->bonePaletteBuffer.init();
 		Base::init();
 		d->installShaders();
 		glEnable(GL_MULTISAMPLE);
@@ -191,25 +211,27 @@ void GMGLGraphicEngine::activateLights(ITechnique* technique)
 {
 	D(d);
 	D_BASE(db, Base);
-	// 有2种情况，需要更新着色器。
-	// 1. 使用中的着色器更换时
-	// 2. 使用中的着色器未更换，但是光照信息改变
-	GMGLTechnique* glTechnique = gm_cast<GMGLTechnique*>(technique);
-	IShaderProgram* shaderProgram = glTechnique->getShaderProgram();
-	if (shaderProgram != d->lightContext.shaderProgram || d->lightContext.lightDirty)
-	{
-		const Vector<ILight*>& lights = db->lights;
-		GMsize_t lightCount = lights.size();
-		GM_ASSERT(lightCount <= getMaxLightCount());
-		shaderProgram->setInt(getVariableIndex(shaderProgram, d->lightCountIndices[verifyIndicesContainer(d->lightCountIndices, shaderProgram)], GM_VariablesDesc.LightCount) , gm_sizet_to_uint(lightCount));
+	const Vector<ILight*>& lights = db->lights;
+	GMsize_t lightCount = lights.size();
+	GM_ASSERT(lightCount <= getMaxLightCount());
 
+	// 光照信息存放在统一变量缓存中，所有着色器程序共享，因此只有光照信息改变时才需要更新
+	if (d->lightContext.lightDirty)
+	{
+		d->uniformBuffers.editLights().lightCount = static_cast<GMint32>(lightCount);
 		for (GMuint32 i = 0; i < gm_sizet_to_uint(lightCount); ++i)
 		{
 			lights[i]->activateLight(i, technique);
 		}
-		d->lightContext.shaderProgram = shaderProgram;
 		d->lightContext.lightDirty = false;
 	}
+
+	// 自定义着色器可能没有使用变量块，而是直接声明了GM_LightCount
+	GMGLTechnique* glTechnique = gm_cast<GMGLTechnique*>(technique);
+	IShaderProgram* shaderProgram = glTechnique->getShaderProgram();
+	GMint32 lightCountIndex = getVariableIndex(shaderProgram, d->lightCountIndices[verifyIndicesContainer(d->lightCountIndices, shaderProgram)], GM_VariablesDesc.LightCount);
+	if (lightCountIndex != -1)
+		shaderProgram->setInt(lightCountIndex, gm_sizet_to_uint(lightCount));
 }
 
 void GMGLGraphicEngine::shaderProgramChanged(IShaderProgram* program)
@@ -217,6 +239,33 @@ void GMGLGraphicEngine::shaderProgramChanged(IShaderProgram* program)
 	emitSignal(GM_SIGNAL(GMGLGraphicEngine, shaderProgramChanged));
 }
 
+GMGLStateCache& GMGLGraphicEngine::getStateCache()
+{
+	D(d);
+	return d->stateCache;
+}
+
+GMGLUniformBuffers& GMGLGraphicEngine::getUniformBuffers()
+{
+	D(d);
+	return d->uniformBuffers;
+}
+
+GMGLBonePaletteBuffer& GMGLGraphicEngine::getBonePaletteBuffer()
+{
+	D(d);
+	return d->bonePaletteBuffer;
+}
+
+GMGPUTracer* GMGLGraphicEngine::getGPUTracer()
+{
+	D(d);
+	// OpenGL ES没有时间戳查询
+	if (GMGLHelper::isOpenGLShaderLanguageES())
+		return nullptr;
+	return &d->gpuTracer;
+}
+
 void GMGLGraphicEngine::update(GMUpdateDataType type)
 {
 	D(d);
@@ -227,8 +276,7 @@ void GMGLGraphicEngine::update(GMUpdateDataType type)
 		break;
 	case GMUpdateDataType::TurnOffCubeMap:
 	{
-		glActiveTexture(GL_TEXTURE0 + GMTextureRegisterQuery<GMTextureType::CubeMap>::Value);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+		GMGLStateCache::bindTexture(GMTextureRegisterQuery<GMTextureType::CubeMap>::Value, GL_TEXTURE_CUBE_MAP, 0);
 		d->cubeMap = GMAsset::invalidAsset();
 		break;
 	}
@@ -373,7 +421,7 @@ void GMGLUtility::blendFunc(
 			break;
 		}
 	}
-	glBlendFuncSeparate(factors[0], factors[1], factors[2], factors[3]);
+	GMGLStateCache::blendFuncSeparate(factors[0], factors[1], factors[2], factors[3]);
 
 	GLenum ops[2];
 	for (GMint32 i = 0; i < GM_array_size(gms_ops); i++)
@@ -394,7 +442,7 @@ void GMGLUtility::blendFunc(
 			gm_error(gm_dbg_wrap("Invalid blend op."));
 		}
 	}
-	glBlendEquationSeparate(ops[0], ops[1]);
+	GMGLStateCache::blendEquationSeparate(ops[0], ops[1]);
 }
 
 void GMGLGraphicEngine::clearGLErrors()
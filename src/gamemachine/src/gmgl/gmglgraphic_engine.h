@@ -11,6 +11,9 @@
 BEGIN_NS
 
 class Camera;
+class GMGLStateCache;
+class GMGLUniformBuffers;
+class GMGLBonePaletteBuffer;
 class GMGameWorld;
 class GameLight;
 struct ITechnique;
@@ -49,7 +52,6 @@ enum
 struct GMGLLightContext
 {
 	bool lightDirty = true;
-	IShaderProgram* shaderProgram = nullptr;
 };
 
 GM_PRIVATE_CLASS(GMGLGraphicEngine);
@@ -71,6 +73,7 @@ public:
 	virtual IFramebuffers* getDefaultFramebuffers() override;
 	virtual ITechnique* getTechnique(GMModelType objectType) override;
 	virtual GMGlyphManager* getGlyphManager() override;
+	virtual GMGPUTracer* getGPUTracer() override;
 	virtual bool getInterface(GameMachineInterfaceID, void**);
 	virtual bool setInterface(GameMachineInterfaceID, void*);
 
@@ -80,6 +83,24 @@ public:
 	void activateLights(ITechnique* technique);
 	void shaderProgramChanged(IShaderProgram* program);
 
+	//! 获取此引擎的OpenGL状态缓存。
+	/*!
+	  OpenGL上下文被设置为当前上下文之后，应该调用其makeCurrent()。
+	*/
+	GMGLStateCache& getStateCache();
+
+	//! 获取此引擎的统一变量缓存。
+	/*!
+	  相机、光源、阴影和Gamma/HDR等数据通过它传递给所有的着色器程序。
+	*/
+	GMGLUniformBuffers& getUniformBuffers();
+
+	//! 获取此引擎的骨骼调色板缓存。
+	/*!
+	  绘制动画模型之前，需要将GMGraphicEngine::getBonePalette()提交到此缓存。
+	*/
+	GMGLBonePaletteBuffer& getBonePaletteBuffer();
+
 public:
 	enum
 	{
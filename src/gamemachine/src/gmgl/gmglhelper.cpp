@@ -13,6 +13,32 @@ namespace
 	Vector<GMGLShaderInfo> s_defaultShaders;
 	Vector<GMGLShaderInfo> s_defaultIncludes;
 
+	// OpenGL状态缓存，UnknownState表示状态未知
+	constexpr GMuint32 UnknownState = ~0u;
+	constexpr GMuint32 MaxCachedTextureUnits = 32;
+	enum
+	{
+		CachedTexture2D,
+		CachedTextureCubeMap,
+		CachedTextureTargetCount,
+	};
+
+	// 上下文只能在一个线程中成为当前上下文，因此每个线程记录自己的当前缓存
+	thread_local GMGLStateCache* t_currentStateCache = nullptr;
+
+	GMint32 getCachedTextureTarget(GMuint32 target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_2D:
+			return CachedTexture2D;
+		case GL_TEXTURE_CUBE_MAP:
+			return CachedTextureCubeMap;
+		default:
+			return -1;
+		}
+	}
+
 	bool parseShaderType(const char* type, GMShaderType st, GMXMLElement* e, Vector<GMGLShaderInfo>& infos, DefinesMap& definesMap)
 	{
 		e = e->FirstChildElement(type);
@@ -235,4 +261,207 @@ bool GMGLHelper::isSupportGeometryShader()
 #endif
 }
 
+GM_PRIVATE_OBJECT_UNALIGNED(GMGLStateCache)
+{
+	GMuint32 program;
+	GMuint32 blend;
+	GMuint32 blendFunc[4];
+	GMuint32 blendEquation[2];
+	GMuint32 depthTest;
+	GMuint32 activeTextureUnit;
+	GMuint32 textures[MaxCachedTextureUnits][CachedTextureTargetCount];
+
+	void invalidate();
+};
+
+void GMGLStateCachePrivate::invalidate()
+{
+	program = UnknownState;
+	blend = UnknownState;
+	depthTest = UnknownState;
+	activeTextureUnit = UnknownState;
+	std::fill(std::begin(blendFunc), std::end(blendFunc), UnknownState);
+	std::fill(std::begin(blendEquation), std::end(blendEquation), UnknownState);
+	std::fill(&textures[0][0], &textures[0][0] + MaxCachedTextureUnits * CachedTextureTargetCount, UnknownState);
+}
+
+GMGLStateCache::GMGLStateCache()
+{
+	GM_CREATE_DATA();
+	D(d);
+	d->invalidate();
+}
+
+GMGLStateCache::~GMGLStateCache()
+{
+	if (t_currentStateCache == this)
+		t_currentStateCache = nullptr;
+}
+
+void GMGLStateCache::makeCurrent()
+{
+	D(d);
+	// 切换上下文之前，其它上下文或者其它库可能已经修改了这个上下文的状态
+	d->invalidate();
+	t_currentStateCache = this;
+}
+
+GMGLStateCache* GMGLStateCache::current()
+{
+	return t_currentStateCache;
+}
+
+void GMGLStateCache::invalidate()
+{
+	GMGLStateCachePrivate* d = currentData();
+	if (d)
+		d->invalidate();
+}
+
+GMGLStateCachePrivate* GMGLStateCache::currentData()
+{
+	return t_currentStateCache ? t_currentStateCache->data() : nullptr;
+}
+
+void GMGLStateCache::useProgram(GMuint32 program)
+{
+	GMGLStateCachePrivate* d = currentData();
+	if (d && d->program == program)
+		return;
+
+	glUseProgram(program);
+	if (d)
+		d->program = program;
+}
+
+void GMGLStateCache::deleteProgram(GMuint32 program)
+{
+	// 程序名称可能被复用，删除后不能再认为它仍在使用
+	GMGLStateCachePrivate* d = currentData();
+	if (d && d->program == program)
+		d->program = UnknownState;
+	glDeleteProgram(program);
+}
+
+void GMGLStateCache::setBlend(bool enabled)
+{
+	GMGLStateCachePrivate* d = currentData();
+	GMuint32 state = enabled ? 1 : 0;
+	if (d && d->blend == state)
+		return;
+
+	if (enabled)
+		glEnable(GL_BLEND);
+	else
+		glDisable(GL_BLEND);
+	if (d)
+		d->blend = state;
+}
+
+void GMGLStateCache::blendFuncSeparate(GMuint32 srcRGB, GMuint32 dstRGB, GMuint32 srcAlpha, GMuint32 dstAlpha)
+{
+	GMGLStateCachePrivate* d = currentData();
+	if (!d)
+	{
+		glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+		return;
+	}
+
+	GMuint32* cache = d->blendFunc;
+	if (cache[0] == srcRGB && cache[1] == dstRGB && cache[2] == srcAlpha && cache[3] == dstAlpha)
+		return;
+
+	glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+	cache[0] = srcRGB;
+	cache[1] = dstRGB;
+	cache[2] = srcAlpha;
+	cache[3] = dstAlpha;
+}
+
+void GMGLStateCache::blendEquationSeparate(GMuint32 modeRGB, GMuint32 modeAlpha)
+{
+	GMGLStateCachePrivate* d = currentData();
+	if (!d)
+	{
+		glBlendEquationSeparate(modeRGB, modeAlpha);
+		return;
+	}
+
+	GMuint32* cache = d->blendEquation;
+	if (cache[0] == modeRGB && cache[1] == modeAlpha)
+		return;
+
+	glBlendEquationSeparate(modeRGB, modeAlpha);
+	cache[0] = modeRGB;
+	cache[1] = modeAlpha;
+}
+
+void GMGLStateCache::setDepthTest(bool enabled)
+{
+	GMGLStateCachePrivate* d = currentData();
+	GMuint32 state = enabled ? 1 : 0;
+	if (d && d->depthTest == state)
+		return;
+
+	if (enabled)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+	if (d)
+		d->depthTest = state;
+}
+
+void GMGLStateCache::activeTexture(GMuint32 unit)
+{
+	GMGLStateCachePrivate* d = currentData();
+	if (d && d->activeTextureUnit == unit)
+		return;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	if (d)
+		d->activeTextureUnit = unit;
+}
+
+void GMGLStateCache::bindTexture(GMuint32 target, GMuint32 texture)
+{
+	GMGLStateCachePrivate* d = currentData();
+	GMint32 cachedTarget = getCachedTextureTarget(target);
+	if (!d || d->activeTextureUnit >= MaxCachedTextureUnits || cachedTarget < 0)
+	{
+		glBindTexture(target, texture);
+		return;
+	}
+
+	GMuint32& cache = d->textures[d->activeTextureUnit][cachedTarget];
+	if (cache == texture)
+		return;
+
+	glBindTexture(target, texture);
+	cache = texture;
+}
+
+void GMGLStateCache::bindTexture(GMuint32 unit, GMuint32 target, GMuint32 texture)
+{
+	activeTexture(unit);
+	bindTexture(target, texture);
+}
+
+void GMGLStateCache::deleteTexture(GMuint32 texture)
+{
+	// 删除纹理时，OpenGL会把绑定了此纹理的纹理单元重置为0
+	GMGLStateCachePrivate* d = currentData();
+	if (d)
+	{
+		for (auto& unit : d->textures)
+		{
+			for (auto& cache : unit)
+			{
+				if (cache == texture)
+					cache = 0;
+			}
+		}
+	}
+	glDeleteTextures(1, &texture);
+}
+
 END_NS
@@ -37,5 +37,75 @@ struct GM_EXPORT GMGLHelper
 	static bool isSupportGeometryShader();
 };
 
+GM_PRIVATE_CLASS(GMGLStateCache);
+//! OpenGL状态缓存。
+/*!
+  记录最近一次设置的着色器程序、混合、深度测试和纹理绑定状态。如果要设置的状态与缓存中的状态相同，则不再调用OpenGL。<BR>
+  OpenGL的状态属于上下文，因此每个OpenGL图形引擎拥有一个状态缓存。上下文被设置为当前线程的上下文时，它的状态缓存通过makeCurrent()成为当前线程的缓存，并且失效。<BR>
+  引擎中这些状态都应该通过静态方法来设置，它们作用于当前线程的缓存。当前线程没有缓存时，它们直接调用OpenGL。
+  如果在引擎之外直接修改了这些状态，需要调用invalidate()使缓存失效。
+*/
+class GM_EXPORT GMGLStateCache
+{
+	GM_DECLARE_PRIVATE(GMGLStateCache)
+	GM_DISABLE_COPY_ASSIGN(GMGLStateCache)
+
+public:
+	GMGLStateCache();
+	~GMGLStateCache();
+
+public:
+	//! 将此缓存设置为当前线程的缓存，并使其失效。
+	/*!
+	  应该在此缓存对应的OpenGL上下文被设置为当前上下文之后调用。
+	*/
+	void makeCurrent();
+
+	//! 获取当前线程的缓存。
+	/*!
+	  \return 当前线程的缓存。如果没有，返回nullptr。
+	*/
+	static GMGLStateCache* current();
+
+	//! 使当前线程缓存的所有状态失效，下一次设置状态时一定会调用OpenGL。
+	static void invalidate();
+
+	//! 使用着色器程序。
+	static void useProgram(GMuint32 program);
+
+	//! 删除着色器程序。如果它是当前缓存的程序，缓存将失效。
+	static void deleteProgram(GMuint32 program);
+
+	//! 开启或关闭混合。
+	static void setBlend(bool enabled);
+
+	//! 设置混合因子，参数为OpenGL枚举值。
+	static void blendFuncSeparate(GMuint32 srcRGB, GMuint32 dstRGB, GMuint32 srcAlpha, GMuint32 dstAlpha);
+
+	//! 设置混合方程，参数为OpenGL枚举值。
+	static void blendEquationSeparate(GMuint32 modeRGB, GMuint32 modeAlpha);
+
+	//! 开启或关闭深度测试。
+	static void setDepthTest(bool enabled);
+
+	//! 激活纹理单元。
+	/*!
+	  \param unit 纹理单元的序号，从0开始，而不是GL_TEXTURE0等枚举值。
+	*/
+	static void activeTexture(GMuint32 unit);
+
+	//! 将纹理绑定到当前激活的纹理单元。
+	static void bindTexture(GMuint32 target, GMuint32 texture);
+
+	//! 激活纹理单元，并将纹理绑定到此纹理单元。
+	static void bindTexture(GMuint32 unit, GMuint32 target, GMuint32 texture);
+
+	//! 删除纹理。所有绑定了此纹理的纹理单元都会被视为没有绑定纹理。
+	static void deleteTexture(GMuint32 texture);
+
+private:
+	static Data* currentData();
+};
+
 END_NS
 #endif
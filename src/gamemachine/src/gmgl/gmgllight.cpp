@@ -1,26 +1,24 @@
 ﻿#include "stdafx.h"
 #include "gmgllight.h"
 #include "gmgltechniques.h"
-#include "shader_constants.h"
+#include "gmgluniformbuffers.h"
 #include "gmengine/gmlight_p.h"
 
 BEGIN_NS
 
-GM_PRIVATE_OBJECT_UNALIGNED(GMGLLight)
+namespace
 {
-	struct LightIndices
+	// 光源数据写入引擎的统一变量缓存，由引擎统一上传
+	GMGLLightBlockData& getLightBlockData(GMuint32 index, ITechnique* technique)
 	{
-		GMint32 Color;
-		GMint32 Position;
-		GMint32 Type;
-		GMint32 AttenuationConstant;
-		GMint32 AttenuationLinear;
-		GMint32 AttenuationExp;
-		GMint32 AmbientIntensity;
-		GMint32 DiffuseIntensity;
-		GMint32 SpecularIntensity;
-	};
-	Vector<Vector<LightIndices>> lightIndices;
+		GM_ASSERT(index < GMGraphicEngine::getMaxLightCount());
+		GMGLTechnique* glTechnique = gm_cast<GMGLTechnique*>(technique);
+		return glTechnique->getEngine()->getUniformBuffers().editLights().lights[index];
+	}
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMGLLight)
+{
 };
 
 GMGLLight::GMGLLight()
@@ -35,63 +33,21 @@ GMGLLight::~GMGLLight()
 
 void GMGLLight::activateLight(GMuint32 index, ITechnique* technique)
 {
-	D(d);
 	D_BASE(db, Base);
-
-	GMGLTechnique* glTechnique = gm_cast<GMGLTechnique*>(technique);
-	IShaderProgram* shaderProgram = glTechnique->getShaderProgram();
-	GMString strIndex = GMString((GMint32)index);
-
-	GMsize_t shaderLightIdx = verifyIndicesContainer(d->lightIndices, shaderProgram);
-	static const Data::LightIndices s_empty = { 0 };
-	if (d->lightIndices[shaderLightIdx].size() <= index)
-		d->lightIndices[shaderLightIdx].resize(index + 1, s_empty);
-
-	shaderProgram->setVec3(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].Color, L"GM_lights[" + strIndex + L"].Color"),
-		db->color);
-
-	shaderProgram->setVec3(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].Position, L"GM_lights[" + strIndex + L"].Position"),
-		db->position);
-
-	shaderProgram->setInt(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].Type, L"GM_lights[" + strIndex + L"].Type"),
-		getLightType());
-
-	shaderProgram->setVec3(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].AmbientIntensity, L"GM_lights[" + strIndex + L"].AmbientIntensity"),
-		db->ambientIntensity);
-
-	shaderProgram->setVec3(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].DiffuseIntensity, L"GM_lights[" + strIndex + L"].DiffuseIntensity"),
-		db->diffuseIntensity);
-
-	shaderProgram->setFloat(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].SpecularIntensity, L"GM_lights[" + strIndex + L"].SpecularIntensity"),
-		db->specularIntensity);
-
-	shaderProgram->setFloat(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].AttenuationConstant, L"GM_lights[" + strIndex + L"].Attenuation.Constant"),
-		db->attenuation.constant);
-
-	shaderProgram->setFloat(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].AttenuationLinear, L"GM_lights[" + strIndex + L"].Attenuation.Linear"),
-		db->attenuation.linear);
-
-	shaderProgram->setFloat(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].AttenuationExp, L"GM_lights[" + strIndex + L"].Attenuation.Exp"),
-		db->attenuation.exp);
+	GMGLLightBlockData& light = getLightBlockData(index, technique);
+	memcpy(light.color, db->color, sizeof(light.color));
+	memcpy(light.position, db->position, sizeof(light.position));
+	memcpy(light.ambientIntensity, db->ambientIntensity, sizeof(light.ambientIntensity));
+	memcpy(light.diffuseIntensity, db->diffuseIntensity, sizeof(light.diffuseIntensity));
+	light.specularIntensity = db->specularIntensity;
+	light.attenuationConstant = db->attenuation.constant;
+	light.attenuationLinear = db->attenuation.linear;
+	light.attenuationExp = db->attenuation.exp;
+	light.type = getLightType();
 }
 
 GM_PRIVATE_OBJECT_UNALIGNED_FROM(GMGLDirectionalLight, GMDirectionalLight_t)
 {
-	struct LightIndices
-	{
-		GMint32 Direction;
-	};
-
-	Vector<Vector<LightIndices>> lightIndices;
 };
 
 GMGLDirectionalLight::GMGLDirectionalLight()
@@ -126,28 +82,12 @@ void GMGLDirectionalLight::activateLight(GMuint32 index, ITechnique* technique)
 	Base::activateLight(index, technique);
 
 	D(d);
-	GMGLTechnique* glTechnique = gm_cast<GMGLTechnique*>(technique);
-	IShaderProgram* shaderProgram = glTechnique->getShaderProgram();
-	GMString strIndex = GMString((GMint32)index);
-
-	GMsize_t shaderLightIdx = verifyIndicesContainer(d->lightIndices, shaderProgram);
-	static const Data::LightIndices s_empty = { 0 };
-	if (d->lightIndices[shaderLightIdx].size() <= index)
-		d->lightIndices[shaderLightIdx].resize(index + 1, s_empty);
-
-	shaderProgram->setVec3(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].Direction, L"GM_lights[" + strIndex + L"].Direction"),
-		d->direction);
+	GMGLLightBlockData& light = getLightBlockData(index, technique);
+	memcpy(light.direction, d->direction, sizeof(light.direction));
 }
 
 GM_PRIVATE_OBJECT_UNALIGNED_FROM(GMGLSpotlight, GMSpotlight_t)
 {
-	struct LightIndices
-	{
-		GMint32 CutOff;
-	};
-
-	Vector<Vector<LightIndices>> lightIndices;
 };
 
 GMGLSpotlight::GMGLSpotlight()
@@ -179,18 +119,8 @@ void GMGLSpotlight::activateLight(GMuint32 index, ITechnique* technique)
 	Base::activateLight(index, technique);
 	
 	D(d);
-	GMGLTechnique* glTechnique = gm_cast<GMGLTechnique*>(technique);
-	IShaderProgram* shaderProgram = glTechnique->getShaderProgram();
-	GMString strIndex = GMString((GMint32)index);
-
-	GMsize_t shaderLightIdx = verifyIndicesContainer(d->lightIndices, shaderProgram);
-	static const Data::LightIndices s_empty = { 0 };
-	if (d->lightIndices[shaderLightIdx].size() <= index)
-		d->lightIndices[shaderLightIdx].resize(index + 1, s_empty);
-
-	shaderProgram->setFloat(
-		getVariableIndex(shaderProgram, d->lightIndices[shaderLightIdx][index].CutOff, L"GM_lights[" + strIndex + L"].CutOff"),
-		Cos(Radians(d->cutOff)));
+	GMGLLightBlockData& light = getLightBlockData(index, technique);
+	light.cutOff = Cos(Radians(d->cutOff));
 }
 
-END_NS
\ No newline at end of file
+END_NS
@@ -9,8 +9,58 @@
 
 BEGIN_NS
 
-GM_STATIC_ASSERT(sizeof(gm::GMfloat) == sizeof(gm::GMint32), "Wrong type size.");
-#define BIT32_OFFSET(i) ((void*)(sizeof(gm::GMfloat) * i))
+namespace
+{
+	// 按照顶点布局设置一个顶点属性
+	void setVertexAttribute(const GMVertexLayout& layout, GMVertexDataType type)
+	{
+		GMuint32 index = gmVertexIndex(type);
+		GMVertexAttributeFormat format = layout.getFormat(type);
+		if (format == GMVertexAttributeFormat::Unused)
+		{
+			// 着色器将读到默认值(0, 0, 0, 1)
+			glDisableVertexAttribArray(index);
+			return;
+		}
+
+		GLint size = static_cast<GLint>(layout.getComponentCount(type));
+		GLsizei stride = static_cast<GLsizei>(layout.getStride());
+		const void* offset = reinterpret_cast<const void*>(static_cast<GMsize_t>(layout.getOffset(type)));
+		if (type == GMVertexDataType::BoneIds)
+		{
+			GLenum glType = format == GMVertexAttributeFormat::UInt8 ? GL_UNSIGNED_BYTE : GL_INT;
+			if (glVertexAttribIPointer)
+				glVertexAttribIPointer(index, size, glType, stride, offset);
+			else // 可能某些ES版本不支持
+				glVertexAttribPointer(index, size, glType, GL_FALSE, stride, offset);
+		}
+		else
+		{
+			switch (format)
+			{
+			case GMVertexAttributeFormat::Float:
+				glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, stride, offset);
+				break;
+			case GMVertexAttributeFormat::HalfFloat:
+				glVertexAttribPointer(index, size, GL_HALF_FLOAT, GL_FALSE, stride, offset);
+				break;
+			case GMVertexAttributeFormat::Octahedral:
+				glVertexAttribPointer(index, size, GL_SHORT, GL_TRUE, stride, offset);
+				break;
+			case GMVertexAttributeFormat::UNorm8:
+				glVertexAttribPointer(index, size, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset);
+				break;
+			case GMVertexAttributeFormat::UNorm16:
+				glVertexAttribPointer(index, size, GL_UNSIGNED_SHORT, GL_TRUE, stride, offset);
+				break;
+			default:
+				GM_ASSERT(false);
+				break;
+			}
+		}
+		glEnableVertexAttribArray(index);
+	}
+}
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMGLModelDataProxy)
 {
@@ -44,9 +94,11 @@ void GMGLModelDataProxy::transfer()
 	prepareTangentSpace();
 
 	GMModelBufferData bufferData;
-	Vector<GMVertex> packedVertices;
-	// 把数据打入顶点数组
-	packVertices(packedVertices);
+	const GMVertexLayout& layout = model->getVertexLayout();
+	GM_ASSERT(layout.isDefault() || model->getUsageHint() == GMUsageHint::StaticDraw);
+	Vector<GMbyte> packedVertices;
+	// 按照模型的顶点布局把数据打入顶点数组
+	packVertices(layout, packedVertices);
 
 	GMsize_t verticeCount = 0;
 
@@ -63,24 +115,11 @@ void GMGLModelDataProxy::transfer()
 
 	GLenum usage = model->getUsageHint() == GMUsageHint::StaticDraw ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
 	glBindBuffer(GL_ARRAY_BUFFER, bufferData.vertexBufferId);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GMVertex) * packedVertices.size(), packedVertices.data(), usage);
-
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Position),	GMVertex::PositionDimension,	GL_FLOAT, GL_FALSE, sizeof(GMVertex), 0);
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Normal),		GMVertex::NormalDimension,		GL_FLOAT, GL_FALSE, sizeof(GMVertex), BIT32_OFFSET(3));
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Texcoord),	GMVertex::TexcoordDimension,	GL_FLOAT, GL_FALSE, sizeof(GMVertex), BIT32_OFFSET(6));
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Tangent),		GMVertex::TangentDimension,		GL_FLOAT, GL_FALSE, sizeof(GMVertex), BIT32_OFFSET(8));
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Bitangent),	GMVertex::BitangentDimension,	GL_FLOAT, GL_FALSE, sizeof(GMVertex), BIT32_OFFSET(11));
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Lightmap),	GMVertex::LightmapDimension,	GL_FLOAT, GL_FALSE, sizeof(GMVertex), BIT32_OFFSET(14));
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Color),		GMVertex::ColorDimension,		GL_FLOAT, GL_FALSE, sizeof(GMVertex), BIT32_OFFSET(16));
-	if (glVertexAttribIPointer)
-		glVertexAttribIPointer(gmVertexIndex(GMVertexDataType::BoneIds),GMVertex::BoneIDsDimension,		GL_INT,				sizeof(GMVertex), BIT32_OFFSET(20));
-	else // 可能某些ES版本不支持
-		glVertexAttribPointer(gmVertexIndex(GMVertexDataType::BoneIds),	GMVertex::BoneIDsDimension,		GL_INT,   GL_FALSE,	sizeof(GMVertex), BIT32_OFFSET(20));
-	glVertexAttribPointer(gmVertexIndex(GMVertexDataType::Weights),		GMVertex::WeightsDimension,		GL_FLOAT, GL_FALSE, sizeof(GMVertex), BIT32_OFFSET(24));
+	glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), usage);
 
 	GM_FOREACH_ENUM_CLASS(type, GMVertexDataType::Position, GMVertexDataType::EndOfVertexDataType)
 	{
-		glEnableVertexAttribArray(gmVertexIndex(type));
+		setVertexAttribute(layout, type);
 	}
 
 	if (model->getDrawMode() == GMModelDrawMode::Index)
@@ -97,7 +136,7 @@ void GMGLModelDataProxy::transfer()
 	}
 	else
 	{
-		verticeCount = packedVertices.size();
+		verticeCount = packedVertices.size() / layout.getStride();
 	}
 
 	glBindVertexArray(0);
@@ -134,6 +173,8 @@ void GMGLModelDataProxy::beginUpdateBuffer(GMModelBufferType type)
 	D(d);
 	GMModel* model = getModel();
 	GM_ASSERT(model);
+	// 直接修改顶点缓存时，调用者按照GMVertex写入数据
+	GM_ASSERT(type != GMModelBufferType::VertexBuffer || model->getVertexLayout().isDefault());
 	d->lastType = type;
 	GMGLBeginGetErrorsAndCheck();
 	glBindVertexArray(model->getModelBuffer()->getMeshBuffer().arrayId);
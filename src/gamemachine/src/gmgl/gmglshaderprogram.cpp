@@ -7,6 +7,7 @@
 #include "foundation/gamemachine.h"
 #include <linearmath.h>
 #include "gmglhelper.h"
+#include "gmgluniformbuffers.h"
 
 #pragma warning (disable: 4302)
 #pragma warning (disable: 4311)
@@ -183,14 +184,15 @@ GMGLShaderProgram::GMGLShaderProgram(const IRenderContext* context)
 GMGLShaderProgram::~GMGLShaderProgram()
 {
 	D(d);
-	glDeleteProgram(d->shaderProgram);
+	GMGLStateCache::deleteProgram(d->shaderProgram);
 }
 
 void GMGLShaderProgram::useProgram()
 {
 	D(d);
-	glUseProgram(d->shaderProgram);
+	GMGLStateCache::useProgram(d->shaderProgram);
 
+	// 即使程序没有改变，也需要通知引擎，因为其它渲染技术可能修改了此程序的阴影等参数
 	GMGLGraphicEngine* engine = gm_cast<GMGLGraphicEngine*>(d->context->getEngine());
 	engine->shaderProgramChanged(this);
 }
@@ -399,6 +401,8 @@ bool GMGLShaderProgram::load()
 		return false;
 	}
 
+	// 将变量块关联到引擎的统一变量缓存
+	GMGLUniformBuffers::bindUniformBlocks(program);
 	return true;
 }
 
@@ -442,7 +446,7 @@ GMGLComputeShaderProgram::~GMGLComputeShaderProgram()
 void GMGLComputeShaderProgram::dispatch(GMint32 threadGroupCountX, GMint32 threadGroupCountY, GMint32 threadGroupCountZ)
 {
 	D(d);
-	glUseProgram(d->shaderProgram);
+	GMGLStateCache::useProgram(d->shaderProgram);
 	glDispatchCompute(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
 	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 	cleanUp();
@@ -690,7 +694,7 @@ void GMGLComputeShaderProgram::dispose()
 {
 	D(d);
 	glDeleteShader(d->shaderId);
-	glDeleteProgram(d->shaderProgram);
+	GMGLStateCache::deleteProgram(d->shaderProgram);
 }
 
 void GMGLComputeShaderProgram::cleanUp()
@@ -10,6 +10,9 @@
 #include "foundation/utilities/utilities.h"
 #include "gmglgbuffer.h"
 #include "gmglframebuffer.h"
+#include "gmglhelper.h"
+#include "gmgluniformbuffers.h"
+#include "gmglbonepalette.h"
 
 BEGIN_NS
 
@@ -30,12 +33,6 @@ namespace
 #define VI_N(name, str) VI_C(d, name, str)
 #define VI_NB(name, str) VI_C(db, name, str)
 
-	// global variables
-	struct
-	{
-		IShaderProgram* lastShaderProgram_camera = nullptr;
-	} s_shaderCaches;
-
 	inline GLenum toStencilOp(GMStencilOptions::GMStencilOp stencilOptions)
 	{
 		switch (stencilOptions)
@@ -137,36 +134,6 @@ namespace
 		}
 	}
 
-	const GMString& getShadowMapEndClipNames(GMsize_t level)
-	{
-		static Vector<GMString> s_shadowMapNames;
-		if (s_shadowMapNames.empty())
-		{
-			static const GMString s_shadowInfo = GMString(GM_VariablesDesc.ShadowInfo.ShadowInfo) + L"." + GM_VariablesDesc.ShadowInfo.EndClip;
-			s_shadowMapNames.resize(GMGraphicEngine::getMaxCascades());
-			for (GMCascadeLevel i = 0; i < GMGraphicEngine::getMaxCascades(); ++i)
-			{
-				s_shadowMapNames[i] = s_shadowInfo + L"[" + GMString(i) + L"]";
-			}
-		}
-		return s_shadowMapNames[level];
-	}
-
-	const GMString& getShadowMapShadowMatrixNames(GMsize_t level)
-	{
-		static Vector<GMString> s_shadowMapNames;
-		if (s_shadowMapNames.empty())
-		{
-			static const GMString s_shadowInfo = GMString(GM_VariablesDesc.ShadowInfo.ShadowInfo) + L"." + GM_VariablesDesc.ShadowInfo.ShadowMatrix;
-			s_shadowMapNames.resize(GMGraphicEngine::getMaxCascades());
-			for (GMCascadeLevel i = 0; i < GMGraphicEngine::getMaxCascades(); ++i)
-			{
-				s_shadowMapNames[i] = s_shadowInfo + L"[" + GMString(i) + L"]";
-			}
-		}
-		return s_shadowMapNames[level];
-	}
-
 	GMTextureAsset createWhiteTexture(const IRenderContext* context)
 	{
 		GMTextureAsset texture;
@@ -183,18 +150,12 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMGLTechnique)
 		GMScene* currentScene = nullptr;
 	};
 
-	struct ShadowContext
-	{
-		GMint64 lastShadowVersion = 0;
-	};
-
 	const IRenderContext* context = nullptr;
 	GMGLGraphicEngine* engine = nullptr;
 	const GMShaderVariablesDesc* variablesDesc = nullptr;
 	GMDebugConfig debugConfig;
 	GMGammaHelper gammaHelper;
 	TechniqueContext techContext;
-	ShadowContext shadowContext;
 
 	Vector<GMShaderVariablesIndices> indexBank;
 
@@ -221,23 +182,20 @@ GM_PRIVATE_OBJECT_UNALIGNED(GMGLTechnique)
 		GMint32 ScreenHeight;
 	};
 	Vector<ScreenInfoIndices> screenInfoIndices;
-	Array<GMint32, GMScene::MaxBoneCount> boneVariableIndices = { 0 };
-	Array<GMint32, GMGraphicEngine::getMaxCascades()> cascadeEndClipVariableIndices = { 0 };
-	Array<GMint32, GMGraphicEngine::getMaxCascades()> cascadeShadowMatrixVariableIndices = { 0 };
 	bool isShadowDirty = true;
+
+	// 实例化绘制
+	GLuint instanceBuffer = 0;
+	GMsize_t instanceCount = 0;
 };
 
 void GMGammaHelper::setGamma(GMGLTechnique* tech, GMGraphicEngine* engine, IShaderProgram* shaderProgram)
 {
 	D_OF(d, tech);
-	shaderProgram->setBool(VI(GammaCorrection.GammaCorrection), engine->needGammaCorrection());
-	GMfloat gamma = engine->getGammaValue();
-	if (gamma != m_gamma)
-	{
-		shaderProgram->setFloat(VI(GammaCorrection.GammaValue), gamma);
-		shaderProgram->setFloat(VI(GammaCorrection.GammaInvValue), 1.f / gamma);
-		m_gamma = gamma;
-	}
+	GMGLFrameBlock& frame = d->engine->getUniformBuffers().editFrame();
+	frame.gammaCorrection = engine->needGammaCorrection() ? 1 : 0;
+	frame.gamma = engine->getGammaValue();
+	frame.gammaInv = 1.f / frame.gamma;
 }
 
 GMGLTechnique::GMGLTechnique(const IRenderContext* context)
@@ -249,7 +207,7 @@ GMGLTechnique::GMGLTechnique(const IRenderContext* context)
 	d->engine = gm_cast<GMGLGraphicEngine*>(d->context->getEngine());
 	d->debugConfig = context->getEngine()->getConfigs().getConfig(GMConfigs::Debug).asDebugConfig();
 
-	// 绑定着色器变化状态。着色器变化后，将isShadowDirty标记为true，准备为着色器更新阴影参数。
+	// 绑定着色器变化状态。着色器变化后，将isShadowDirty标记为true，准备为着色器更新阴影纹理。
 	connect(*d->engine, GM_SIGNAL(GMGLGraphicEngine, shaderProgramChanged), [d](GMObject*, GMObject*) {
 		d->isShadowDirty = true;
 	});
@@ -257,7 +215,15 @@ GMGLTechnique::GMGLTechnique(const IRenderContext* context)
 
 GMGLTechnique::~GMGLTechnique()
 {
+	D(d);
+	if (d->instanceBuffer)
+		glDeleteBuffers(1, &d->instanceBuffer);
+}
 
+GMGLGraphicEngine* GMGLTechnique::getEngine()
+{
+	D(d);
+	return d->engine;
 }
 
 void GMGLTechnique::draw(GMModel* model)
@@ -276,6 +242,48 @@ void GMGLTechnique::draw(GMModel* model)
 	GMGLEndGetErrorsAndCheck();
 }
 
+void GMGLTechnique::drawInstanced(GMModel* model, const GMMat4* transforms, GMsize_t count)
+{
+	D(d);
+	if (!count)
+		return;
+
+	IShaderProgram* shaderProgram = getShaderProgram();
+	if (VI(UseInstancing) == -1)
+	{
+		// 着色器不支持实例化（例如旧的着色器包或者自定义的着色器），逐个绘制每个实例
+		for (GMsize_t i = 0; i < count; ++i)
+		{
+			shaderProgram->setMatrix4(VI(ModelMatrix), transforms[i]);
+			shaderProgram->setMatrix4(VI(InverseTransposeModelMatrix), InverseTranspose(transforms[i]));
+			draw(model);
+		}
+		return;
+	}
+
+	GMGLBeginGetErrorsAndCheck();
+	glBindVertexArray(model->getModelBuffer()->getMeshBuffer().arrayId);
+	bindInstanceBuffer(transforms, count);
+
+	// 世界矩阵由顶点属性给出，法线在顶点着色器中变换到世界坐标系
+	shaderProgram->setMatrix4(VI(ModelMatrix), Identity<GMMat4>());
+	shaderProgram->setMatrix4(VI(InverseTransposeModelMatrix), Identity<GMMat4>());
+	shaderProgram->setInt(VI(UseInstancing), 1);
+	d->instanceCount = count;
+
+	prepareStencil(*d->engine);
+	prepareScreenInfo(shaderProgram);
+	beforeDraw(model);
+	startDraw(model);
+	afterDraw(model);
+
+	d->instanceCount = 0;
+	shaderProgram->setInt(VI(UseInstancing), 0);
+	unbindInstanceBuffer();
+	glBindVertexArray(0);
+	GMGLEndGetErrorsAndCheck();
+}
+
 void GMGLTechnique::beginScene(GMScene* scene)
 {
 	D(d);
@@ -302,6 +310,9 @@ void GMGLTechnique::beginModel(GMModel* model, const GMGameObject* parent)
 	// 设置顶点颜色运算方式
 	shaderProgram->setInt(VI(ColorVertexOp), static_cast<GMint32>(model->getShader().getVertexColorOp()));
 
+	// 顶点布局中使用八面体编码的属性，需要在着色器中解码
+	shaderProgram->setInt(VI(OctahedralAttributes), model->getVertexLayout().getOctahedralMask());
+
 	// 骨骼动画
 	GMAnimationType at = parent->getAnimationType();
 	shaderProgram->setInt(VI(UseAnimation), static_cast<GMint32>(at));
@@ -474,40 +485,40 @@ GMTextureAsset GMGLTechnique::getTexture(GMTextureSampler& frames)
 void GMGLTechnique::updateCameraMatrices(IShaderProgram* shaderProgram)
 {
 	D(d);
+	// 相机矩阵存放在统一变量缓存中，所有着色器程序共享，只有内容变化时才会被上传
 	GMCamera& camera = d->engine->getCamera();
-	if (s_shaderCaches.lastShaderProgram_camera != shaderProgram || camera.isDirty())
+	GMGLCameraBlock& block = d->engine->getUniformBuffers().editCamera();
+	memcpy(block.viewMatrix, ValuePointer(camera.getViewMatrix()), sizeof(block.viewMatrix));
+	memcpy(block.inverseViewMatrix, ValuePointer(camera.getInverseViewMatrix()), sizeof(block.inverseViewMatrix));
+	memcpy(block.projectionMatrix, ValuePointer(camera.getProjectionMatrix()), sizeof(block.projectionMatrix));
+
+	GMFloat4 viewPosition;
+	camera.getLookAt().position.loadFloat4(viewPosition);
+	memcpy(block.viewPosition, ValuePointer(viewPosition), sizeof(block.viewPosition));
+
+	// 自定义着色器可能没有使用变量块，而是直接声明了这些统一变量
+	GMint32 viewMatrixIndex = VI(ViewMatrix);
+	if (viewMatrixIndex != -1)
 	{
-		const GMMat4& viewMatrix = camera.getViewMatrix();
-		const GMCameraLookAt& lookAt = camera.getLookAt();
-		GMFloat4 viewPosition;
-		lookAt.position.loadFloat4(viewPosition);
-
-		GMGraphicEngine::getDefaultShaderVariablesDesc();
-		shaderProgram->setVec4(VI(ViewPosition), viewPosition);
-		shaderProgram->setMatrix4(VI(ViewMatrix), camera.getViewMatrix());
+		shaderProgram->setMatrix4(viewMatrixIndex, camera.getViewMatrix());
 		shaderProgram->setMatrix4(VI(InverseViewMatrix), camera.getInverseViewMatrix());
 		shaderProgram->setMatrix4(VI(ProjectionMatrix), camera.getProjectionMatrix());
-		s_shaderCaches.lastShaderProgram_camera = shaderProgram;
-		camera.cleanDirty();
+		shaderProgram->setVec4(VI(ViewPosition), viewPosition);
 	}
+	camera.cleanDirty();
 }
 
 void GMGLTechnique::setCascadeEndClip(GMCascadeLevel level, GMfloat endClip)
 {
 	D(d);
-	IShaderProgram* shaderProgram = getShaderProgram();
-	shaderProgram->useProgram();
-	shaderProgram->setFloat(getVariableIndex(shaderProgram, d->cascadeEndClipVariableIndices[level], getShadowMapEndClipNames(level)), endClip);
+	d->engine->getUniformBuffers().editShadow().endClip[level][0] = endClip;
 }
 
 void GMGLTechnique::setCascadeCameraVPMatrices(GMCascadeLevel level)
 {
 	D(d);
-	IShaderProgram* shaderProgram = getShaderProgram();
-	shaderProgram->useProgram();
-	shaderProgram->setMatrix4(getVariableIndex(shaderProgram, d->cascadeShadowMatrixVariableIndices[level], getShadowMapShadowMatrixNames(level)),
-		d->engine->getCascadeCameraVPMatrix(level)
-	);
+	GMGLShadowBlock& block = d->engine->getUniformBuffers().editShadow();
+	memcpy(block.shadowMatrix[level], ValuePointer(d->engine->getCascadeCameraVPMatrix(level)), sizeof(block.shadowMatrix[level]));
 }
 
 void GMGLTechnique::prepareScreenInfo(IShaderProgram* shaderProgram)
@@ -561,7 +572,7 @@ void GMGLTechnique::prepareBlend(GMModel* model)
 		if (shader.getBlend())
 		{
 			blend = true;
-			glEnable(GL_BLEND);
+			GMGLStateCache::setBlend(true);
 			GMGLUtility::blendFunc(
 				shader.getBlendFactorSourceRGB(),
 				shader.getBlendFactorDestRGB(),
@@ -573,7 +584,7 @@ void GMGLTechnique::prepareBlend(GMModel* model)
 		}
 		else
 		{
-			glDisable(GL_BLEND);
+			GMGLStateCache::setBlend(false);
 		}
 	}
 	else
@@ -581,7 +592,7 @@ void GMGLTechnique::prepareBlend(GMModel* model)
 		if (shader.getBlend())
 		{
 			blend = true;
-			glEnable(GL_BLEND);
+			GMGLStateCache::setBlend(true);
 			GMGLUtility::blendFunc(
 				shader.getBlendFactorSourceRGB(),
 				shader.getBlendFactorDestRGB(),
@@ -593,7 +604,7 @@ void GMGLTechnique::prepareBlend(GMModel* model)
 		}
 		else
 		{
-			glDisable(GL_BLEND);
+			GMGLStateCache::setBlend(false);
 		}
 	}
 }
@@ -602,9 +613,9 @@ void GMGLTechnique::prepareDepth(GMModel* model)
 {
 	const GMShader& shader = model->getShader();
 	if (shader.getNoDepthTest())
-		glDisable(GL_DEPTH_TEST); // glDepthMask(GL_FALSE);
+		GMGLStateCache::setDepthTest(false); // glDepthMask(GL_FALSE);
 	else
-		glEnable(GL_DEPTH_TEST); // glDepthMask(GL_TRUE);
+		GMGLStateCache::setDepthTest(true); // glDepthMask(GL_TRUE);
 }
 
 void GMGLTechnique::prepareDebug(GMModel* model)
@@ -644,57 +655,38 @@ void GMGLTechnique::initShadow()
 void GMGLTechnique::prepareShadow(const GMShadowSourceDesc* shadowSourceDesc, GMGLShadowFramebuffers* shadowFramebuffers, bool hasShadow)
 {
 	D(d);
-	static const GMString s_shadowInfo = GMString(GM_VariablesDesc.ShadowInfo.ShadowInfo) + L".";
-	static const GMString s_position = s_shadowInfo + GM_VariablesDesc.ShadowInfo.Position;
-	static const GMString s_width = s_shadowInfo + GM_VariablesDesc.ShadowInfo.ShadowMapWidth;
-	static const GMString s_height = s_shadowInfo + GM_VariablesDesc.ShadowInfo.ShadowMapHeight;
-	static const GMString s_biasMin = s_shadowInfo + GM_VariablesDesc.ShadowInfo.BiasMin;
-	static const GMString s_biasMax = s_shadowInfo + GM_VariablesDesc.ShadowInfo.BiasMax;
-	static const GMString s_hasShadow = s_shadowInfo + GM_VariablesDesc.ShadowInfo.HasShadow;
-	static const GMString s_shadowMap = s_shadowInfo + GM_VariablesDesc.ShadowInfo.ShadowMap;
-	static const GMString s_cascadedShadowLevel = s_shadowInfo + GM_VariablesDesc.ShadowInfo.CascadedShadowLevel;
-	static const GMString s_viewCascade = s_shadowInfo + GM_VariablesDesc.ShadowInfo.ViewCascade;
-	static const GMString s_currentCascadeLevel = s_shadowInfo + GM_VariablesDesc.ShadowInfo.CurrentCascadeLevel;
-	static const GMString s_pcfRows = s_shadowInfo + GM_VariablesDesc.ShadowInfo.PCFRows;
-
+	// 阴影参数存放在统一变量缓存中，只有阴影纹理的位置需要为每个着色器程序设置
+	GMGLShadowBlock& block = d->engine->getUniformBuffers().editShadow();
 	IShaderProgram* shaderProgram = getShaderProgram();
 	if (hasShadow)
 	{
-		if (d->isShadowDirty || d->shadowContext.lastShadowVersion != shadowSourceDesc->version)
+		if (d->isShadowDirty)
 		{
-			d->shadowContext.lastShadowVersion = shadowSourceDesc->version;
-
-			shaderProgram->setBool(VI_N(ShadowInfo.HasShadow, s_hasShadow), 1);
-			const GMCamera& camera = shadowSourceDesc->camera;
-			GMFloat4 viewPosition;
-			shadowSourceDesc->position.loadFloat4(viewPosition);
-			shaderProgram->setVec4(VI_N(ShadowInfo.Position, s_position), viewPosition);
-			shaderProgram->setFloat(VI_N(ShadowInfo.BiasMin, s_biasMin), shadowSourceDesc->biasMin);
-			shaderProgram->setFloat(VI_N(ShadowInfo.BiasMax, s_biasMax), shadowSourceDesc->biasMax);
-			shaderProgram->setInt(VI_N(ShadowInfo.PCFRows, s_pcfRows), shadowSourceDesc->pcfRowCount);
-
-			shaderProgram->setInt(VI_N(ShadowInfo.ShadowMapWidth, s_width), shadowFramebuffers->getShadowMapWidth());
-			shaderProgram->setInt(VI_N(ShadowInfo.ShadowMapHeight, s_height), shadowFramebuffers->getShadowMapHeight());
-			shaderProgram->setInt(VI_N(ShadowInfo.ShadowMap, s_shadowMap), GMTextureRegisterQuery<GMTextureType::ShadowMap>::Value);
-
+			shaderProgram->setInt(VI(ShadowInfo.ShadowMap), GMTextureRegisterQuery<GMTextureType::ShadowMap>::Value);
 			d->isShadowDirty = false;
 		}
 
+		block.hasShadow = 1;
+		GMFloat4 position;
+		shadowSourceDesc->position.loadFloat4(position);
+		memcpy(block.position, ValuePointer(position), sizeof(block.position));
+		block.biasMin = shadowSourceDesc->biasMin;
+		block.biasMax = shadowSourceDesc->biasMax;
+		block.pcfRows = shadowSourceDesc->pcfRowCount;
+		block.shadowMapWidth = shadowFramebuffers->getShadowMapWidth();
+		block.shadowMapHeight = shadowFramebuffers->getShadowMapHeight();
+
 		// 是否显示CSM范围
 		GMRenderConfig config = d->context->getEngine()->getConfigs().getConfig(GMConfigs::Render).asRenderConfig();
-		bool vc = config.get(GMRenderConfigs::ViewCascade_Bool).toBool();
-		shaderProgram->setInt(VI_N(ShadowInfo.ViewCascade, s_viewCascade), vc ? 1 : 0);
-
-		// 设置当前的Cascade层级和Shadow Map矩阵
-		shaderProgram->setInt(VI_N(ShadowInfo.CascadedShadowLevel, s_cascadedShadowLevel), shadowSourceDesc->cascades);
+		block.viewCascade = config.get(GMRenderConfigs::ViewCascade_Bool).toBool() ? 1 : 0;
 
-		ICSMFramebuffers* csm = d->engine->getCSMFramebuffers();
-		GMCascadeLevel currentLevel = csm->currentLevel();
-		shaderProgram->setInt(VI_N(ShadowInfo.CurrentCascadeLevel, s_currentCascadeLevel), currentLevel);
+		// 设置当前的Cascade层级
+		block.cascadedShadowLevel = shadowSourceDesc->cascades;
+		block.currentCascadeLevel = d->engine->getCSMFramebuffers()->currentLevel();
 	}
 	else
 	{
-		shaderProgram->setBool(VI_N(ShadowInfo.HasShadow, s_hasShadow), 0);
+		block.hasShadow = 0;
 	}
 }
 
@@ -710,48 +702,80 @@ GMIlluminationModel GMGLTechnique::prepareIlluminationModel(GMModel* model)
 
 void GMGLTechnique::updateBoneTransforms(IShaderProgram* shaderProgram, GMModel* model)
 {
-	D(d);
-	static Vector<GMString> boneVarNames;
-	if (boneVarNames.empty())
-	{
-		boneVarNames.resize(GMScene::MaxBoneCount);
-		for (GMint32 i = 0; i < GMScene::MaxBoneCount; ++i)
-		{
-			boneVarNames[i] = (GMString(GM_VariablesDesc.Bones) + L"[" + GMString(i) + L"]");
-		}
-	}
-
-	const auto& transforms = model->getBoneTransformations();
-	for (GMsize_t i = 0; i < transforms.size(); ++i)
-	{
-		const auto& transform = transforms[i];
-		shaderProgram->setMatrix4(getVariableIndex(shaderProgram, d->boneVariableIndices[i], boneVarNames[i]), transform);
-	}
+	setBonePalette(shaderProgram, model, model->getSkinningMode());
 }
 
 void GMGLTechnique::updateNodeTransforms(IShaderProgram* shaderProgram, GMModel* model)
+{
+	// 仿射变换动画只使用第1个矩阵
+	if (!model->getBoneTransformations().empty())
+		setBonePalette(shaderProgram, model, GMSkinningMode::Linear);
+}
+
+void GMGLTechnique::setBonePalette(IShaderProgram* shaderProgram, GMModel* model, GMSkinningMode mode)
 {
 	D(d);
-	static GMString boneVarNames0;
-	boneVarNames0 = (GMString(GM_VariablesDesc.Bones) + L"[0]");
+	// 骨骼变换追加到本帧的骨骼调色板中，着色器只需要知道它们在调色板中的位置
+	GMBonePalette& palette = d->engine->getBonePalette();
+	GMsize_t offset = palette.add(model, mode);
+	d->engine->getBonePaletteBuffer().commit(palette);
 
-	const auto& transforms = model->getBoneTransformations();
-	if (!transforms.empty())
-	{
-		shaderProgram->setMatrix4(getVariableIndex(shaderProgram, d->boneVariableIndices[0], boneVarNames0), transforms[0]);
-	}
+	shaderProgram->setInt(VI(BonePalette), GMGLBonePaletteBuffer::TextureUnit);
+	shaderProgram->setInt(VI(BoneOffset), gm_sizet_to<GMint32>(offset));
+	shaderProgram->setInt(VI(SkinningMode), static_cast<GMint32>(mode));
 }
 
 void GMGLTechnique::startDraw(GMModel* model)
 {
 	D(d);
+	d->engine->getUniformBuffers().commit();
 	GLenum mode = (d->engine->isWireFrameMode(model)) ? GL_LINE_LOOP : getMode(model->getPrimitiveTopologyMode());
+	if (d->instanceCount > 0)
+	{
+		if (model->getDrawMode() == GMModelDrawMode::Vertex)
+			glDrawArraysInstanced(mode, 0, gm_sizet_to<GLsizei>(model->getVerticesCount()), gm_sizet_to<GLsizei>(d->instanceCount));
+		else
+			glDrawElementsInstanced(mode, gm_sizet_to<GLsizei>(model->getVerticesCount()), GL_UNSIGNED_INT, 0, gm_sizet_to<GLsizei>(d->instanceCount));
+		return;
+	}
+
 	if (model->getDrawMode() == GMModelDrawMode::Vertex)
 		glDrawArrays(mode, 0, gm_sizet_to<GLsizei>(model->getVerticesCount()));
 	else
 		glDrawElements(mode, gm_sizet_to<GLsizei>(model->getVerticesCount()), GL_UNSIGNED_INT, 0);
 }
 
+void GMGLTechnique::bindInstanceBuffer(const GMMat4* transforms, GMsize_t count)
+{
+	D(d);
+	if (!d->instanceBuffer)
+		glGenBuffers(1, &d->instanceBuffer);
+
+	// 每帧的实例数据都不一样，每次重新分配存储，避免等待GPU使用完上一次的数据
+	glBindBuffer(GL_ARRAY_BUFFER, d->instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GMMat4) * count, transforms, GL_STREAM_DRAW);
+
+	// 一个矩阵占用4个连续的顶点属性，每个属性为矩阵的一列
+	for (GMuint32 i = 0; i < 4; ++i)
+	{
+		GMuint32 index = gmVertexIndex(GMVertexDataType::EndOfVertexDataType) + i;
+		glEnableVertexAttribArray(index);
+		glVertexAttribPointer(index, 4, GL_FLOAT, GL_FALSE, sizeof(GMMat4), (void*)(sizeof(GMVec4) * i));
+		glVertexAttribDivisor(index, 1);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GMGLTechnique::unbindInstanceBuffer()
+{
+	for (GMuint32 i = 0; i < 4; ++i)
+	{
+		GMuint32 index = gmVertexIndex(GMVertexDataType::EndOfVertexDataType) + i;
+		glVertexAttribDivisor(index, 0);
+		glDisableVertexAttribArray(index);
+	}
+}
+
 GM_PRIVATE_OBJECT_UNALIGNED(GMGLTechnique_3D)
 {
 	GMRenderMode renderMode = GMRenderMode::Forward;
@@ -989,12 +1013,6 @@ void GMGLTechnique_CubeMap::prepareTextures(GMModel* model)
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMGLTechnique_Filter)
 {
-	struct HDRState
-	{
-		GMToneMapping::Mode toneMapping = GMToneMapping::Reinhard;
-		bool HDR = false;
-	};
-	HDRState state;
 	GMint32 framebufferIndex = 0;
 };
 
@@ -1024,31 +1042,18 @@ void GMGLTechnique_Filter::beginModel(GMModel* model, const GMGameObject* parent
 {
 	Base::beginModel(model, parent);
 
-	D(d);
 	D_BASE(db, Base);
-	IShaderProgram* shaderProgram = getShaderProgram();
-	if (d->state.HDR != db->engine->needHDR() || d->state.toneMapping != db->engine->getToneMapping())
-	{
-		d->state.HDR = db->engine->needHDR();
-		d->state.toneMapping = db->engine->getToneMapping();
-		if (d->state.HDR)
-		{
-			db->gammaHelper.setGamma(this, db->engine, shaderProgram);
-			setHDR(shaderProgram);
-		}
-		else
-		{
-			shaderProgram->setBool(VI_B(HDR.HDR), false);
-		}
-	}
+	if (db->engine->needHDR())
+		db->gammaHelper.setGamma(this, db->engine, getShaderProgram());
+	setHDR();
 }
 
-void GMGLTechnique_Filter::setHDR(IShaderProgram* shaderProgram)
+void GMGLTechnique_Filter::setHDR()
 {
-	D(d);
 	D_BASE(db, Base);
-	shaderProgram->setBool(VI_B(HDR.HDR), true);
-	shaderProgram->setInt(VI_B(HDR.ToneMapping), d->state.toneMapping);
+	GMGLFrameBlock& frame = db->engine->getUniformBuffers().editFrame();
+	frame.hdr = db->engine->needHDR() ? 1 : 0;
+	frame.toneMapping = db->engine->getToneMapping();
 }
 
 IShaderProgram* GMGLTechnique_Filter::getShaderProgram()
@@ -12,9 +12,6 @@ class GMGammaHelper
 {
 public:
 	void setGamma(GMGLTechnique* tech, GMGraphicEngine* engine, IShaderProgram* shaderProgram);
-
-private:
-	GMfloat m_gamma = 0.f;
 };
 
 GM_PRIVATE_CLASS(GMGLTechnique);
@@ -29,8 +26,12 @@ public:
 	~GMGLTechnique();
 
 	virtual void draw(GMModel* model) override;
+	virtual void drawInstanced(GMModel* model, const GMMat4* transforms, GMsize_t count) override;
 	virtual IShaderProgram* getShaderProgram() = 0;
 
+	//! 获取此渲染技术所属的图形引擎。
+	GMGLGraphicEngine* getEngine();
+
 protected:
 	virtual void beforeDraw(GMModel* model) = 0;
 	virtual void afterDraw(GMModel* model) = 0;
@@ -64,9 +65,12 @@ protected:
 	GMIlluminationModel prepareIlluminationModel(GMModel* model);
 	void updateBoneTransforms(IShaderProgram* shaderProgram, GMModel* model);
 	void updateNodeTransforms(IShaderProgram* shaderProgram, GMModel* model);
+	void setBonePalette(IShaderProgram* shaderProgram, GMModel* model, GMSkinningMode mode);
 
 private:
 	void startDraw(GMModel* model);
+	void bindInstanceBuffer(const GMMat4* transforms, GMsize_t count);
+	void unbindInstanceBuffer();
 };
 
 GM_PRIVATE_CLASS(GMGLTechnique_3D);
@@ -146,7 +150,7 @@ protected:
 	void prepareTextures(GMModel* model);
 
 private:
-	void setHDR(IShaderProgram* shaderProgram);
+	void setHDR();
 };
 
 GM_PRIVATE_CLASS(GMGLTechnique_LightPass);
@@ -7,6 +7,7 @@
 #include "gmglgraphic_engine.h"
 #include "gmdata/gmimage_p.h"
 #include "gmgltexture_p.h"
+#include "gmglhelper.h"
 
 BEGIN_NS
 
@@ -103,7 +104,7 @@ GMGLTexture::GMGLTexture(const GMImage* image)
 GMGLTexture::~GMGLTexture()
 {
 	D(d);
-	glDeleteTextures(1, &d->id);
+	GMGLStateCache::deleteTexture(d->id);
 	d->inited = false;
 }
 
@@ -124,7 +125,7 @@ void GMGLTexture::init()
 
 	GMGLBeginGetErrorsAndCheck();
 	glGenTextures(1, &d->id);
-	glBindTexture(d->target, d->id);
+	GMGLStateCache::bindTexture(d->target, d->id);
 
 	switch (d->target)
 	{
@@ -170,7 +171,7 @@ void GMGLTexture::init()
 		break;
 	}
 
-	glBindTexture(d->target, 0);
+	GMGLStateCache::bindTexture(d->target, 0);
 	d->inited = true;
 
 	GMGLEndGetErrorsAndCheck();
@@ -181,7 +182,7 @@ void GMGLTexture::bindSampler(GMTextureSampler* sampler)
 	D(d);
 	if (!d->texParamsSet)
 	{
-		glBindTexture(d->target, d->id);
+		GMGLStateCache::bindTexture(d->target, d->id);
 
 		// Apply params
 		glTexParameteri(d->target, GL_TEXTURE_MIN_FILTER,
@@ -222,15 +223,14 @@ void GMGLTexture::bindSampler(GMTextureSampler* sampler)
 			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 		}
 		d->texParamsSet = true;
-		glBindTexture(d->target, 0);
+		GMGLStateCache::bindTexture(d->target, 0);
 	}
 }
 
 void GMGLTexture::useTexture(GMint32 textureIndex)
 {
 	D(d);
-	glActiveTexture(GL_TEXTURE0 + textureIndex);
-	glBindTexture(d->target, d->id);
+	GMGLStateCache::bindTexture(textureIndex, d->target, d->id);
 }
 
 GM_PRIVATE_OBJECT_UNALIGNED(GMGLWhiteTexture)
@@ -250,7 +250,7 @@ GMGLWhiteTexture::GMGLWhiteTexture(const IRenderContext* context)
 GMGLWhiteTexture::~GMGLWhiteTexture()
 {
 	D(d);
-	glDeleteTextures(1, &d->textureId);
+	GMGLStateCache::deleteTexture(d->textureId);
 }
 
 void GMGLWhiteTexture::init()
@@ -258,27 +258,26 @@ void GMGLWhiteTexture::init()
 	D(d);
 	static GMbyte texData[] = { 0xFF, 0xFF, 0xFF, 0xFF };
 	glGenTextures(1, &d->textureId);
-	glBindTexture(GL_TEXTURE_2D, d->textureId);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, d->textureId);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void GMGLWhiteTexture::bindSampler(GMTextureSampler* sampler)
 {
 	D(d);
-	glBindTexture(GL_TEXTURE_2D, d->textureId);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, d->textureId);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void GMGLWhiteTexture::useTexture(GMint32 textureIndex)
 {
 	D(d);
-	glActiveTexture(GL_TEXTURE0 + textureIndex);
-	glBindTexture(GL_TEXTURE_2D, d->textureId);
+	GMGLStateCache::bindTexture(textureIndex, GL_TEXTURE_2D, d->textureId);
 }
 
 void GMGLEmptyTexture::init()
@@ -286,9 +285,9 @@ void GMGLEmptyTexture::init()
 	D(d);
 	static GMbyte texData[] = { 0 };
 	glGenTextures(1, &d->textureId);
-	glBindTexture(GL_TEXTURE_2D, d->textureId);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, d->textureId);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GMGLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 END_NS
@@ -0,0 +1,146 @@
+﻿#include "stdafx.h"
+#include <GL/glew.h>
+#include "gmgluniformbuffers.h"
+
+BEGIN_NS
+
+GM_STATIC_ASSERT(sizeof(GMGLCameraBlock) == 208, "GMGLCameraBlock must match the std140 layout of GM_CameraBlock.");
+GM_STATIC_ASSERT(sizeof(GMGLLightBlockData) == 112, "GMGLLightBlockData must match the std140 layout of GM_light_t.");
+GM_STATIC_ASSERT(sizeof(GMGLShadowBlock) == 720, "GMGLShadowBlock must match the std140 layout of GM_ShadowBlock.");
+
+namespace
+{
+	const char* s_blockNames[] = {
+		"GM_CameraBlock",
+		"GM_LightBlock",
+		"GM_ShadowBlock",
+		"GM_FrameBlock",
+	};
+	GM_STATIC_ASSERT(GM_array_size(s_blockNames) == static_cast<GMsize_t>(GMGLUniformBlock::EndOfEnum), "Every uniform block must have a name.");
+}
+
+GM_PRIVATE_OBJECT_UNALIGNED(GMGLUniformBuffers)
+{
+	struct Block
+	{
+		GLuint buffer = 0;
+		const void* data = nullptr;
+		GMsize_t size = 0;
+		Vector<GMbyte> uploaded;
+		bool dirty = true;
+	};
+
+	GMGLCameraBlock camera = { 0 };
+	GMGLLightsBlock lights = { 0 };
+	GMGLShadowBlock shadow = { 0 };
+	GMGLFrameBlock frame = { 0 };
+	Array<Block, static_cast<GMsize_t>(GMGLUniformBlock::EndOfEnum)> blocks;
+
+	template <typename T>
+	T& edit(GMGLUniformBlock block, T& data)
+	{
+		blocks[static_cast<GMsize_t>(block)].dirty = true;
+		return data;
+	}
+};
+
+GMGLUniformBuffers::GMGLUniformBuffers()
+{
+	GM_CREATE_DATA();
+
+	D(d);
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Camera)].data = &d->camera;
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Camera)].size = sizeof(d->camera);
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Lights)].data = &d->lights;
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Lights)].size = sizeof(d->lights);
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Shadow)].data = &d->shadow;
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Shadow)].size = sizeof(d->shadow);
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Frame)].data = &d->frame;
+	d->blocks[static_cast<GMsize_t>(GMGLUniformBlock::Frame)].size = sizeof(d->frame);
+}
+
+GMGLUniformBuffers::~GMGLUniformBuffers()
+{
+	D(d);
+	for (auto& block : d->blocks)
+	{
+		if (block.buffer)
+			glDeleteBuffers(1, &block.buffer);
+	}
+}
+
+void GMGLUniformBuffers::init()
+{
+	D(d);
+	for (GMsize_t i = 0; i < d->blocks.size(); ++i)
+	{
+		auto& block = d->blocks[i];
+		GM_ASSERT(!block.buffer);
+		glGenBuffers(1, &block.buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+		glBufferData(GL_UNIFORM_BUFFER, block.size, block.data, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(i), block.buffer);
+		block.uploaded.assign(static_cast<const GMbyte*>(block.data), static_cast<const GMbyte*>(block.data) + block.size);
+		block.dirty = false;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+GMGLCameraBlock& GMGLUniformBuffers::editCamera()
+{
+	D(d);
+	return d->edit(GMGLUniformBlock::Camera, d->camera);
+}
+
+GMGLLightsBlock& GMGLUniformBuffers::editLights()
+{
+	D(d);
+	return d->edit(GMGLUniformBlock::Lights, d->lights);
+}
+
+GMGLShadowBlock& GMGLUniformBuffers::editShadow()
+{
+	D(d);
+	return d->edit(GMGLUniformBlock::Shadow, d->shadow);
+}
+
+GMGLFrameBlock& GMGLUniformBuffers::editFrame()
+{
+	D(d);
+	return d->edit(GMGLUniformBlock::Frame, d->frame);
+}
+
+void GMGLUniformBuffers::commit()
+{
+	D(d);
+	bool bound = false;
+	for (auto& block : d->blocks)
+	{
+		if (!block.dirty)
+			continue;
+
+		block.dirty = false;
+		if (!block.buffer || memcmp(block.uploaded.data(), block.data, block.size) == 0)
+			continue;
+
+		glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, block.size, block.data);
+		memcpy(block.uploaded.data(), block.data, block.size);
+		bound = true;
+	}
+
+	if (bound)
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void GMGLUniformBuffers::bindUniformBlocks(GMuint32 program)
+{
+	for (GMsize_t i = 0; i < GM_array_size(s_blockNames); ++i)
+	{
+		GLuint index = glGetUniformBlockIndex(program, s_blockNames[i]);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, static_cast<GLuint>(i));
+	}
+}
+
+END_NS
@@ -0,0 +1,131 @@
+﻿#ifndef __GMGLUNIFORMBUFFERS_H__
+#define __GMGLUNIFORMBUFFERS_H__
+#include <gmcommon.h>
+#include <gmgraphicengine.h>
+BEGIN_NS
+
+//! OpenGL统一变量块。枚举值即为变量块的绑定点。
+enum class GMGLUniformBlock
+{
+	Camera, //!< 相机，对应着色器中的GM_CameraBlock。
+	Lights, //!< 光源，对应着色器中的GM_LightBlock。
+	Shadow, //!< 阴影，对应着色器中的GM_ShadowBlock。
+	Frame, //!< Gamma校正和HDR，对应着色器中的GM_FrameBlock。
+	EndOfEnum,
+};
+
+// 以下结构按照std140布局排列，必须与着色器中的变量块一一对应
+struct GMGLCameraBlock
+{
+	GMfloat viewMatrix[16];
+	GMfloat inverseViewMatrix[16];
+	GMfloat projectionMatrix[16];
+	GMfloat viewPosition[4];
+};
+
+struct GMGLLightBlockData
+{
+	GMfloat color[3];
+	GMfloat _pad0;
+	GMfloat position[3];
+	GMfloat _pad1;
+	GMfloat ambientIntensity[3];
+	GMfloat _pad2;
+	GMfloat diffuseIntensity[3];
+	GMfloat specularIntensity;
+	GMfloat attenuationConstant;
+	GMfloat attenuationLinear;
+	GMfloat attenuationExp;
+	GMfloat _pad3;
+	GMint32 type;
+	GMint32 _pad4[3];
+	GMfloat direction[3];
+	GMfloat cutOff;
+};
+
+struct GMGLLightsBlock
+{
+	GMGLLightBlockData lights[GMGraphicEngine::getMaxLightCount()];
+	GMint32 lightCount;
+	GMint32 _pad[3];
+};
+
+struct GMGLShadowBlock
+{
+	GMint32 hasShadow;
+	GMint32 _pad0[3];
+	GMfloat shadowMatrix[GMMaxCascades][16];
+	GMfloat endClip[GMMaxCascades][4]; // std140中数组每个元素占16字节
+	GMint32 currentCascadeLevel;
+	GMint32 _pad1[3];
+	GMfloat position[4];
+	GMint32 shadowMapWidth;
+	GMint32 shadowMapHeight;
+	GMfloat biasMin;
+	GMfloat biasMax;
+	GMint32 cascadedShadowLevel;
+	GMint32 viewCascade;
+	GMint32 pcfRows;
+	GMint32 _pad2;
+};
+
+struct GMGLFrameBlock
+{
+	GMint32 gammaCorrection;
+	GMfloat gamma;
+	GMfloat gammaInv;
+	GMint32 hdr;
+	GMint32 toneMapping;
+	GMint32 _pad[3];
+};
+
+GM_PRIVATE_CLASS(GMGLUniformBuffers);
+//! 管理OpenGL图形引擎的统一变量缓存(UBO)。
+/*!
+  相机、光源、阴影和Gamma/HDR这些每帧只变化几次的数据存放在统一变量缓存中，所有着色器程序共享，不必在每次绘制、每次切换着色器程序时逐个上传统一变量。<BR>
+  修改变量块时先修改CPU中的副本，commit()时只上传内容确实发生变化的变量块。着色器程序链接后，需要调用bindUniformBlocks()将变量块关联到对应的绑定点。
+*/
+class GMGLUniformBuffers
+{
+	GM_DECLARE_PRIVATE(GMGLUniformBuffers)
+	GM_DISABLE_COPY_ASSIGN(GMGLUniformBuffers)
+
+public:
+	GMGLUniformBuffers();
+	~GMGLUniformBuffers();
+
+public:
+	//! 创建所有的统一变量缓存，并将它们绑定到各自的绑定点。
+	/*!
+	  需要在OpenGL上下文为当前上下文时调用。
+	*/
+	void init();
+
+	//! 获取相机变量块，并将其标记为已修改。
+	GMGLCameraBlock& editCamera();
+
+	//! 获取光源变量块，并将其标记为已修改。
+	GMGLLightsBlock& editLights();
+
+	//! 获取阴影变量块，并将其标记为已修改。
+	GMGLShadowBlock& editShadow();
+
+	//! 获取Gamma/HDR变量块，并将其标记为已修改。
+	GMGLFrameBlock& editFrame();
+
+	//! 上传已修改并且内容发生变化的变量块。
+	/*!
+	  应该在每次绘制之前调用。
+	*/
+	void commit();
+
+public:
+	//! 将着色器程序中的变量块关联到对应的绑定点。着色器程序中没有用到的变量块将被忽略。
+	/*!
+	  \param program 已经链接的着色器程序。
+	*/
+	static void bindUniformBlocks(GMuint32 program);
+};
+
+END_NS
+#endif
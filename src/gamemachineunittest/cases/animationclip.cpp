@@ -0,0 +1,193 @@
+﻿#include "stdafx.h"
+#include "animationclip.h"
+#include <gmanimationclip.h>
+
+namespace
+{
+	// 与预先编译之前的计算方式相同：按名字查找通道，从头查找关键帧，结果写入骨骼
+	struct ReferenceEvaluator
+	{
+		const gm::GMNodeAnimation* animation;
+		gm::GMSkeleton* skeleton;
+		GMMat4 globalInverseTransform;
+
+		template <typename T>
+		static gm::GMsize_t findIndex(gm::GMDuration animationTime, const gm::AlignedVector<gm::GMNodeAnimationKeyframe<T>>& frames)
+		{
+			for (gm::GMsize_t i = 0; i < frames.size() - 1; ++i)
+			{
+				if (animationTime < frames[i + 1].time)
+					return i;
+			}
+			return 0;
+		}
+
+		template <typename T>
+		static T sample(gm::GMDuration animationTime, const gm::AlignedVector<gm::GMNodeAnimationKeyframe<T>>& frames)
+		{
+			if (frames.empty())
+				return T();
+			if (frames.size() == 1)
+				return frames[0].value;
+			gm::GMsize_t i = findIndex(animationTime, frames);
+			gm::GMfloat factor = (animationTime - frames[i].time) / (frames[i + 1].time - frames[i].time);
+			return Lerp(frames[i].value, frames[i + 1].value, factor);
+		}
+
+		void updateNode(gm::GMDuration animationTime, gm::GMNode* node, const GMMat4& parentTransformation)
+		{
+			const gm::GMNodeAnimationNode* animationNode = nullptr;
+			for (auto& n : animation->nodes)
+			{
+				if (n.name == node->getName())
+				{
+					animationNode = &n;
+					break;
+				}
+			}
+
+			GMMat4 nodeTransformation = node->getTransformToParent();
+			if (animationNode)
+			{
+				nodeTransformation = Scale(sample(animationTime, animationNode->scalings))
+					* QuatToMatrix(sample(animationTime, animationNode->rotations))
+					* Translate(sample(animationTime, animationNode->positions));
+			}
+
+			GMMat4 globalTransformation = nodeTransformation * parentTransformation;
+			auto& boneMapping = skeleton->getBones().getBoneNameIndexMap();
+			auto iter = boneMapping.find(node->getName());
+			if (iter != boneMapping.end())
+			{
+				auto& bone = skeleton->getBones().getBones()[iter->second];
+				bone.finalTransformation = bone.offsetMatrix * globalTransformation * globalInverseTransform;
+			}
+
+			for (auto child : node->getChildren())
+			{
+				updateNode(animationTime, child, globalTransformation);
+			}
+		}
+	};
+
+	gm::GMNode* createNode(const gm::GMString& name, gm::GMNode* parent, const GMMat4& transform)
+	{
+		gm::GMNode* node = new gm::GMNode();
+		node->setName(name);
+		node->setParent(parent);
+		node->setTransformToParent(transform);
+		if (parent)
+			parent->getChildren().push_back(node);
+		return node;
+	}
+
+	void addBone(gm::GMSkeleton* skeleton, const gm::GMString& name, const GMMat4& offset)
+	{
+		auto& bones = skeleton->getBones();
+		gm::GMSkeletalBone bone;
+		bone.name = name;
+		bone.offsetMatrix = offset;
+		bones.getBoneNameIndexMap()[name] = bones.getBones().size();
+		bones.getBones().push_back(bone);
+	}
+
+	gm::GMNodeAnimationNode createChannel(const gm::GMString& name, gm::GMsize_t keyCount, gm::GMfloat seed)
+	{
+		gm::GMNodeAnimationNode channel;
+		channel.name = name;
+		for (gm::GMsize_t i = 0; i < keyCount; ++i)
+		{
+			gm::GMDuration time = static_cast<gm::GMDuration>(i) * 10.f / (keyCount - 1);
+			gm::GMfloat v = seed + i;
+			channel.positions.emplace_back(time, GMVec3(v, -v, v * .5f));
+			channel.scalings.emplace_back(time, GMVec3(1 + v * .1f, 1, 1 - v * .05f));
+		}
+		// 旋转的关键帧数目与位置不同
+		channel.rotations.emplace_back(0.f, Rotate(seed, Normalize(GMVec3(1, 1, 0))));
+		channel.rotations.emplace_back(4.f, Rotate(seed + 1, Normalize(GMVec3(0, 1, 1))));
+		channel.rotations.emplace_back(10.f, Rotate(seed + 2, Normalize(GMVec3(1, 0, 1))));
+		return channel;
+	}
+
+	bool matrixEquals(const GMMat4& a, const GMMat4& b)
+	{
+		GMFloat16 fa, fb;
+		a.loadFloat16(fa);
+		b.loadFloat16(fb);
+		for (gm::GMint32 i = 0; i < 4; ++i)
+		{
+			for (gm::GMint32 j = 0; j < 4; ++j)
+			{
+				if (Fabs(fa[i][j] - fb[i][j]) > 1e-4f)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+void cases::AnimationClip::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMAnimationClip matches per-node evaluation", []() {
+		gm::GMScene scene;
+		scene.setAnimationType(gm::GMAnimationType::SkeletalAnimation);
+
+		gm::GMNode* root = createNode(L"root", nullptr, Translate(GMVec3(0, 1, 0)));
+		gm::GMNode* hip = createNode(L"hip", root, Identity<GMMat4>());
+		createNode(L"leg", hip, Translate(GMVec3(0, -1, 0)));
+		createNode(L"prop", hip, Scale(GMVec3(2, 2, 2)));
+		scene.setRootNode(root);
+
+		gm::GMModel* model = new gm::GMModel();
+		gm::GMSkeleton* skeleton = new gm::GMSkeleton();
+		addBone(skeleton, L"hip", Translate(GMVec3(0, -1, 0)));
+		addBone(skeleton, L"leg", Translate(GMVec3(0, 1, 0)));
+		addBone(skeleton, L"prop", Identity<GMMat4>());
+		// 场景中没有对应节点的骨骼
+		addBone(skeleton, L"missing", Identity<GMMat4>());
+		model->setSkeleton(skeleton);
+		scene.addModelAsset(gm::GMAsset(gm::GMAssetType::Model, model));
+
+		gm::GMSkeletalAnimations* animations = new gm::GMSkeletalAnimations();
+		gm::GMNodeAnimation animation;
+		animation.frameRate = 25;
+		animation.duration = 10;
+		animation.nodes.push_back(createChannel(L"hip", 5, 0));
+		animation.nodes.push_back(createChannel(L"leg", 3, 1));
+		// 同名的通道以第一个为准
+		animation.nodes.push_back(createChannel(L"hip", 2, 7));
+		animations->getAnimations().push_back(std::move(animation));
+		scene.setAnimations(animations);
+
+		const gm::GMAnimationClip* clip = scene.getAnimationClip(0);
+		if (!clip || clip->getNodeCount() != 4 || scene.getAnimationClip(0) != clip)
+			return false;
+
+		ReferenceEvaluator reference = { animations->getAnimation(0), skeleton, Inverse(root->getTransformToParent()) };
+		Vector<gm::GMuint32> cursors(clip->getCursorCount(), 0);
+		gm::AlignedVector<GMMat4> globalTransforms;
+		gm::AlignedVector<GMMat4> transforms;
+
+		// 时间向前推进并循环若干次，中间有一次倒退
+		gm::GMDuration elapsed = 0;
+		const gm::GMDuration steps[] = { 0, .013f, .1f, .05f, .2f, .17f, -.3f, .09f, .33f, .01f, .25f, .31f };
+		for (auto step : steps)
+		{
+			elapsed += step;
+			gm::GMDuration animationTime = clip->getAnimationTime(elapsed);
+			clip->evaluate(animationTime, cursors, globalTransforms);
+			clip->computeModelTransforms(0, globalTransforms, transforms);
+			reference.updateNode(animationTime, root, Identity<GMMat4>());
+
+			auto& bones = skeleton->getBones().getBones();
+			if (transforms.size() != bones.size())
+				return false;
+			for (gm::GMsize_t i = 0; i < bones.size(); ++i)
+			{
+				if (!matrixEquals(transforms[i], bones[i].finalTransformation))
+					return false;
+			}
+		}
+		return true;
+	});
+}
@@ -0,0 +1,181 @@
+﻿#include "stdafx.h"
+#include "assetstreamer.h"
+#include <gmassetstreamer.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	gm::GMAsset createAsset()
+	{
+		return gm::GMAsset(gm::GMAssetType::Model, new gm::GMModel());
+	}
+
+	// 解码时提交若干个上传，每个上传记录自己被执行
+	gm::GMAssetDecodeFunction decodeWithUploads(gm::GMint32 count, gm::GMsize_t bytes, std::atomic<gm::GMint32>* uploaded)
+	{
+		return [count, bytes, uploaded](REF gm::GMAsset& asset) {
+			for (gm::GMint32 i = 0; i < count; ++i)
+			{
+				gm::GMAssetStreamer::deferUpload([uploaded]() { ++(*uploaded); }, bytes);
+			}
+			asset = createAsset();
+			return true;
+		};
+	}
+}
+
+void cases::AssetStreamer::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMAssetStreamer decodes requests by priority", []() {
+		gm::GMJobSystem jobSystem(1);
+		std::mutex lock;
+		Vector<gm::GMint32> order;
+		std::atomic<bool> blocked { true };
+		{
+			gm::GMAssetStreamer streamer(nullptr, &jobSystem);
+
+			// 第一个请求占住唯一的工作线程，之后的请求都在等待
+			gm::GMAssetStreamHandle blocker = streamer.request([&](REF gm::GMAsset&) {
+				while (blocked)
+				{
+					std::this_thread::yield();
+				}
+				return true;
+			}, 100);
+			while (streamer.getState(blocker) == gm::GMAssetStreamState::Pending)
+			{
+				std::this_thread::yield();
+			}
+
+			Vector<gm::GMAssetStreamHandle> handles;
+			for (gm::GMint32 priority : { 1, 3, 2, 3 })
+			{
+				handles.push_back(streamer.request([&, priority](REF gm::GMAsset&) {
+					std::lock_guard<std::mutex> guard(lock);
+					order.push_back(priority);
+					return true;
+				}, priority));
+			}
+			blocked = false;
+
+			// 只等待工作线程解码，不在当前线程中解码
+			for (const auto& handle : handles)
+			{
+				while (streamer.getState(handle) != gm::GMAssetStreamState::Uploading)
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+		return order == Vector<gm::GMint32>({ 3, 3, 2, 1 });
+	});
+
+	ut.addTestCase("GMAssetStreamer uploads within the byte budget", []() {
+		gm::GMAssetStreamer streamer(nullptr);
+		streamer.setUploadBudget(1000 * 1000, 250);
+
+		std::atomic<gm::GMint32> uploaded { 0 };
+		bool called = false;
+		gm::GMAsset placeholder = createAsset();
+		gm::GMAssetStreamHandle handle = streamer.request(decodeWithUploads(5, 100, &uploaded), 0, placeholder, [&](gm::GMAsset asset) {
+			called = !asset.isEmpty() && asset != placeholder;
+		});
+
+		// 100+100+100超过了250字节，第一帧执行3个上传，资产仍然是占位资产
+		streamer.update();
+		if (uploaded != 3 || called || streamer.getAsset(handle) != placeholder)
+			return false;
+		if (streamer.getState(handle) != gm::GMAssetStreamState::Uploading)
+			return false;
+
+		streamer.update();
+		return uploaded == 5
+			&& called
+			&& streamer.getState(handle) == gm::GMAssetStreamState::Ready
+			&& streamer.getAsset(handle) != placeholder
+			&& streamer.getPendingCount() == 0;
+	});
+
+	ut.addTestCase("GMAssetStreamer performs at least one upload per update", []() {
+		gm::GMAssetStreamer streamer(nullptr);
+		streamer.setUploadBudget(0, 0);
+
+		std::atomic<gm::GMint32> uploaded { 0 };
+		gm::GMAssetStreamHandle handle = streamer.request(decodeWithUploads(2, 1000, &uploaded));
+		streamer.update();
+		if (uploaded != 1)
+			return false;
+
+		// 最后一个上传完成后，请求在同一次更新中就绪
+		streamer.update();
+		return uploaded == 2 && streamer.getState(handle) == gm::GMAssetStreamState::Ready;
+	});
+
+	ut.addTestCase("GMAssetStreamer finish ignores the budget", []() {
+		gm::GMAssetStreamer streamer(nullptr);
+		streamer.setUploadBudget(0, 0);
+
+		std::atomic<gm::GMint32> uploaded { 0 };
+		gm::GMint32 calls = 0;
+		gm::GMAssetStreamHandle handle = streamer.request(decodeWithUploads(4, 1000, &uploaded), 0, gm::GMAsset(), [&](gm::GMAsset) { ++calls; });
+		if (streamer.finish(handle) != gm::GMAssetStreamState::Ready || uploaded != 4 || calls != 1)
+			return false;
+
+		// 回调只调用一次
+		streamer.update();
+		return calls == 1 && !streamer.getAsset(handle).isEmpty();
+	});
+
+	ut.addTestCase("GMAssetStreamer reports failed and cancelled requests", []() {
+		gm::GMJobSystem jobSystem(1);
+		gm::GMAssetStreamer streamer(nullptr, &jobSystem);
+		std::atomic<bool> blocked { true };
+		bool failedCalled = false;
+		gm::GMAssetStreamHandle blocker = streamer.request([&](REF gm::GMAsset&) {
+			while (blocked)
+			{
+				std::this_thread::yield();
+			}
+			return false;
+		}, 0, gm::GMAsset(), [&](gm::GMAsset asset) { failedCalled = asset.isEmpty(); });
+
+		gm::GMint32 cancelledCalls = 0;
+		gm::GMAssetStreamHandle cancelled = streamer.request([](REF gm::GMAsset&) { return true; }, 0, gm::GMAsset(), [&](gm::GMAsset) { ++cancelledCalls; });
+		streamer.cancel(cancelled);
+		blocked = false;
+
+		while (streamer.getState(blocker) != gm::GMAssetStreamState::Failed)
+		{
+			std::this_thread::yield();
+		}
+		streamer.update();
+		return failedCalled
+			&& streamer.getState(cancelled) == gm::GMAssetStreamState::Cancelled
+			&& cancelledCalls == 0
+			&& streamer.getPendingCount() == 0;
+	});
+
+	ut.addTestCase("GMAssetStreamer defers uploads only while decoding", []() {
+		bool executed = false;
+		gm::GMAssetStreamer::deferUpload([&]() { executed = true; }, 0);
+		if (!executed || gm::GMAssetStreamer::isDecodingThread())
+			return false;
+
+		gm::GMAssetStreamer streamer(nullptr);
+		bool decoding = false;
+		executed = false;
+		gm::GMAssetStreamHandle handle = streamer.request([&](REF gm::GMAsset& asset) {
+			decoding = gm::GMAssetStreamer::isDecodingThread();
+			gm::GMAssetStreamer::deferUpload([&]() { executed = true; }, 0);
+			asset = createAsset();
+			return !executed;
+		});
+		if (!decoding || executed)
+			return false;
+
+		streamer.update();
+		return executed && streamer.getState(handle) == gm::GMAssetStreamState::Ready;
+	});
+}
@@ -0,0 +1,16 @@
+﻿#ifndef __CASES_ASSETSTREAMER_H__
+#define __CASES_ASSETSTREAMER_H__
+#include "unittest_def.h"
+#include <gamemachine.h>
+#include "unittestcase.h"
+
+namespace cases
+{
+	struct AssetStreamer : public UnitTestCase
+	{
+	public:
+		virtual void addToUnitTest(UnitTest& ut) override;
+	};
+}
+
+#endif
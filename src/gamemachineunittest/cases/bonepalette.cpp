@@ -0,0 +1,77 @@
+﻿#include "stdafx.h"
+#include "bonepalette.h"
+#include <gmbonepalette.h>
+
+namespace
+{
+	bool fuzzyEqual(const GMMat4& a, const GMMat4& b)
+	{
+		const gm::GMfloat* pa = ValuePointer(a);
+		const gm::GMfloat* pb = ValuePointer(b);
+		for (gm::GMint32 i = 0; i < 16; ++i)
+		{
+			if (fabs(pa[i] - pb[i]) > .0001f)
+				return false;
+		}
+		return true;
+	}
+}
+
+void cases::BonePalette::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMBonePalette dual quaternion round trip", []() {
+		const GMVec3 axes[] = { GMVec3(1, 0, 0), GMVec3(0, 1, 0), GMVec3(0, 0, 1), Normalize(GMVec3(1, 2, 3)), Normalize(GMVec3(-1, 1, -1)) };
+		const gm::GMfloat angles[] = { 0.f, .3f, 1.7f, 3.1f, 4.5f };
+		for (auto& axis : axes)
+		{
+			for (auto angle : angles)
+			{
+				GMMat4 transform = QuatToMatrix(Rotate(angle, axis)) * Translate(GMVec3(1.5f, -2, 3));
+				GMVec4 real, dual;
+				gm::GMBonePalette::toDualQuaternion(transform, real, dual);
+				if (!fuzzyEqual(transform, gm::GMBonePalette::fromDualQuaternion(real, dual)))
+					return false;
+
+				// 实部不是单位四元数（例如混合之后）时，结果不变
+				if (!fuzzyEqual(transform, gm::GMBonePalette::fromDualQuaternion(real * 2.f, dual * 2.f)))
+					return false;
+			}
+		}
+		return true;
+	});
+
+	ut.addTestCase("GMBonePalette stores linear bones as matrix rows", []() {
+		gm::GMBonePalette palette;
+		GMMat4 transforms[] = { Translate(GMVec3(1, 2, 3)), QuatToMatrix(Rotate(.5f, GMVec3(0, 1, 0))) };
+		gm::GMsize_t offset = palette.add(transforms, 2, gm::GMSkinningMode::Linear);
+		if (offset != 0 || palette.getSize() != 8)
+			return false;
+		return memcmp(palette.getData(), ValuePointer(transforms[0]), sizeof(GMMat4)) == 0
+			&& memcmp(palette.getData() + 16, ValuePointer(transforms[1]), sizeof(GMMat4)) == 0;
+	});
+
+	ut.addTestCase("GMBonePalette offsets", []() {
+		gm::GMBonePalette palette;
+		gm::GMModel linearModel, dqModel;
+		linearModel.getBoneTransformations().resize(3, Identity<GMMat4>());
+		dqModel.getBoneTransformations().resize(5, Identity<GMMat4>());
+
+		gm::GMsize_t linearOffset = palette.add(&linearModel, gm::GMSkinningMode::Linear);
+		gm::GMsize_t dqOffset = palette.add(&dqModel, gm::GMSkinningMode::DualQuaternion);
+		GMMat4 node = Identity<GMMat4>();
+		gm::GMsize_t nodeOffset = palette.add(&node, 1, gm::GMSkinningMode::Linear);
+		if (linearOffset != 0 || dqOffset != 12 || nodeOffset != 22 || palette.getSize() != 26)
+			return false;
+
+		// 同一帧中再次绘制同一个模型，不会重复追加
+		if (palette.add(&linearModel, gm::GMSkinningMode::Linear) != linearOffset || palette.getSize() != 26)
+			return false;
+
+		// 清空之后，偏移从0开始，并且代数增加
+		gm::GMuint32 generation = palette.getGeneration();
+		palette.clear();
+		return palette.getGeneration() != generation
+			&& palette.getSize() == 0
+			&& palette.add(&dqModel, gm::GMSkinningMode::DualQuaternion) == 0;
+	});
+}
@@ -0,0 +1,162 @@
+﻿#include "stdafx.h"
+#include "commandqueue.h"
+#include <gmcommandqueue.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	void spin(gm::GMint64 microseconds)
+	{
+		auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+		while (std::chrono::steady_clock::now() < until)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void cases::CommandQueue::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMMPSCQueue keeps each producer in order", []() {
+		enum { Producers = 4, Count = 20000 };
+		gm::GMMPSCQueue<gm::GMint32> queue;
+		Vector<std::thread> producers;
+		for (gm::GMint32 p = 0; p < Producers; ++p)
+		{
+			producers.emplace_back([&queue, p]() {
+				for (gm::GMint32 i = 0; i < Count; ++i)
+				{
+					queue.push(p * Count + i);
+				}
+			});
+		}
+
+		// 消费者和生产者同时运行，每个生产者的元素必须按照提交的顺序取出
+		gm::GMint32 next[Producers] = { 0 };
+		gm::GMint32 received = 0;
+		bool ordered = true;
+		while (received < Producers * Count)
+		{
+			gm::GMint32 value;
+			if (!queue.pop(value))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			gm::GMint32 p = value / Count;
+			ordered = ordered && value % Count == next[p];
+			++next[p];
+			++received;
+		}
+
+		for (auto& producer : producers)
+		{
+			producer.join();
+		}
+
+		gm::GMint32 value;
+		return ordered && !queue.pop(value) && queue.size() == 0;
+	});
+
+	ut.addTestCase("GMCommandQueue executes by priority", []() {
+		gm::GMCommandQueue queue;
+		Vector<gm::GMint32> order;
+		queue.push([&]() { order.push_back(3); }, gm::GMCommandPriority::Low);
+		queue.push([&]() { order.push_back(2); });
+		queue.push([&]() { order.push_back(1); }, gm::GMCommandPriority::High);
+		queue.push([&]() { order.push_back(4); }, gm::GMCommandPriority::Low);
+		queue.push([&]() { order.push_back(5); }, gm::GMCommandPriority::High);
+
+		return queue.execute() == 5
+			&& order == Vector<gm::GMint32>({ 1, 5, 2, 3, 4 })
+			&& queue.getPendingCount() == 0
+			&& queue.getStats().depth == 0;
+	});
+
+	ut.addTestCase("GMCommandQueue carries over work beyond the budget", []() {
+		gm::GMCommandQueue queue;
+		queue.setBudget(1);
+
+		Vector<gm::GMint32> order;
+		for (gm::GMint32 i = 0; i < 3; ++i)
+		{
+			queue.push([&order, i]() { spin(100); order.push_back(i); });
+		}
+		queue.push([&]() { order.push_back(100); }, gm::GMCommandPriority::High);
+		queue.push([&]() { order.push_back(101); }, gm::GMCommandPriority::High);
+
+		// 高优先级的全部执行，普通优先级至少执行一个
+		queue.execute();
+		if (order != Vector<gm::GMint32>({ 100, 101, 0 }))
+			return false;
+		if (queue.getStats().carriedOver != 2 || queue.getStats().depth != 2 || queue.getPendingCount() != 2)
+			return false;
+
+		// 推迟的对象排在之后提交的同一优先级对象的前面
+		queue.push([&]() { order.push_back(3); });
+		queue.setBudget(0);
+		queue.execute();
+		return order == Vector<gm::GMint32>({ 100, 101, 0, 1, 2, 3 })
+			&& queue.getStats().executed == 3
+			&& queue.getStats().carriedOver == 0
+			&& queue.getPendingCount() == 0;
+	});
+
+	ut.addTestCase("GMCommandQueue defers callables pushed while executing", []() {
+		gm::GMCommandQueue queue;
+		bool nested = false;
+		queue.push([&]() {
+			queue.push([&]() { nested = true; });
+		});
+
+		queue.execute();
+		if (nested || queue.getPendingCount() != 1)
+			return false;
+
+		queue.execute();
+		return nested && queue.getPendingCount() == 0;
+	});
+
+	ut.addTestCase("GMCommandQueue measures latency", []() {
+		gm::GMCommandQueue queue;
+		queue.push([]() {});
+		queue.push([]() {});
+		spin(2000);
+		queue.execute();
+
+		const gm::GMCommandQueueStats& stats = queue.getStats();
+		return stats.executed == 2
+			&& stats.maxLatency >= 2000 * 1000
+			&& stats.averageLatency >= 2000 * 1000
+			&& stats.averageLatency <= stats.maxLatency;
+	});
+
+	ut.addTestCase("GMCommandQueue accepts callables from many threads", []() {
+		enum { Producers = 4, Count = 1000 };
+		gm::GMCommandQueue queue;
+		std::atomic<gm::GMint32> executed { 0 };
+		Vector<std::thread> producers;
+		for (gm::GMint32 p = 0; p < Producers; ++p)
+		{
+			producers.emplace_back([&]() {
+				for (gm::GMint32 i = 0; i < Count; ++i)
+				{
+					queue.push([&]() { ++executed; });
+				}
+			});
+		}
+
+		while (executed < Producers * Count)
+		{
+			queue.execute();
+		}
+
+		for (auto& producer : producers)
+		{
+			producer.join();
+		}
+		return queue.execute() == 0 && queue.getPendingCount() == 0;
+	});
+}
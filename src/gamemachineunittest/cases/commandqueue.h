@@ -0,0 +1,16 @@
+﻿#ifndef __CASES_COMMANDQUEUE_H__
+#define __CASES_COMMANDQUEUE_H__
+#include "unittest_def.h"
+#include <gamemachine.h>
+#include "unittestcase.h"
+
+namespace cases
+{
+	struct CommandQueue : public UnitTestCase
+	{
+	public:
+		virtual void addToUnitTest(UnitTest& ut) override;
+	};
+}
+
+#endif
@@ -0,0 +1,149 @@
+﻿#include "stdafx.h"
+#include "debugger.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	// 记录后台线程输出的日志，可以让后台线程阻塞在输出中
+	class RecordingOutput : public gm::IDebugOutput
+	{
+	public:
+		virtual void info(const gm::GMString& msg) override { record(msg); }
+		virtual void warning(const gm::GMString& msg) override { record(msg); }
+		virtual void error(const gm::GMString& msg) override { record(msg); }
+		virtual void debug(const gm::GMString& msg) override { record(msg); }
+
+	public:
+		Vector<std::string> getMessages(const char* marker)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			Vector<std::string> result;
+			for (const auto& message : m_messages)
+			{
+				if (message.find(marker) != std::string::npos)
+					result.push_back(message);
+			}
+			return result;
+		}
+
+		void block() { m_blocking = true; }
+		void release() { m_blocking = false; }
+		bool isWriting() const { return m_writing; }
+
+	private:
+		void record(const gm::GMString& msg)
+		{
+			m_writing = true;
+			while (m_blocking)
+			{
+				std::this_thread::yield();
+			}
+
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_messages.push_back(msg.toStdString());
+		}
+
+	private:
+		std::mutex m_lock;
+		Vector<std::string> m_messages;
+		std::atomic<bool> m_blocking { false };
+		std::atomic<bool> m_writing { false };
+	};
+
+	// 在测试期间替换日志输出和日志级别
+	struct ScopedDebugOutput
+	{
+		ScopedDebugOutput(gm::IDebugOutput* output)
+			: previousOutput(gm::GMDebugger::getDebugOutput())
+			, previousLevel(gm::GMDebugger::getLevel())
+		{
+			gm::GMDebugger::flush();
+			gm::GMDebugger::setDebugOutput(output);
+		}
+
+		~ScopedDebugOutput()
+		{
+			gm::GMDebugger::flush();
+			gm::GMDebugger::setDebugOutput(previousOutput);
+			gm::GMDebugger::setLevel(previousLevel);
+		}
+
+		gm::IDebugOutput* previousOutput;
+		gm::GMDebugLevel previousLevel;
+	};
+}
+
+void cases::Debugger::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMDebugger writes messages in order after flush", []() {
+		RecordingOutput output;
+		ScopedDebugOutput scope(&output);
+		gm::GMDebugger::setLevel(gm::GMDebugLevel::Info);
+
+		constexpr gm::GMint32 count = 100;
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			gm_info(L"ordered message {0}.", gm::GMString(i));
+		}
+		gm::GMDebugger::flush();
+
+		Vector<std::string> messages = output.getMessages("ordered message");
+		if (messages.size() != count)
+			return false;
+
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			std::string expected = "ordered message " + std::to_string(i) + ".";
+			if (messages[i].find(expected) == std::string::npos)
+				return false;
+		}
+		return true;
+	});
+
+	ut.addTestCase("GMDebugger filters messages below the runtime level", []() {
+		RecordingOutput output;
+		ScopedDebugOutput scope(&output);
+		gm::GMDebugger::setLevel(gm::GMDebugLevel::Warning);
+
+		gm_info(L"filtered info");
+		gm_warning(L"filtered warning");
+		gm_error(L"filtered error");
+		gm::GMDebugger::flush();
+
+		Vector<std::string> messages = output.getMessages("filtered");
+		return messages.size() == 2
+			&& messages[0].find("[warning] filtered warning") != std::string::npos
+			&& messages[1].find("[error] filtered error") != std::string::npos;
+	});
+
+	ut.addTestCase("GMDebugger drops messages instead of blocking when the buffer is full", []() {
+		RecordingOutput output;
+		ScopedDebugOutput scope(&output);
+		gm::GMDebugger::setLevel(gm::GMDebugLevel::Info);
+
+		// 让后台线程阻塞在第一条日志的输出中，之后的日志只能留在缓冲区里
+		output.block();
+		gm_info(L"blocking message");
+		while (!output.isWriting())
+		{
+			std::this_thread::yield();
+		}
+
+		gm::GMsize_t droppedBefore = gm::GMDebugger::getDroppedCount();
+		constexpr gm::GMint32 count = 2000;
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			gm_info(L"overflowing message {0}", gm::GMString(i));
+		}
+		gm::GMsize_t dropped = gm::GMDebugger::getDroppedCount() - droppedBefore;
+
+		output.release();
+		gm::GMDebugger::flush();
+
+		// 没有被丢弃的日志都被输出了
+		Vector<std::string> messages = output.getMessages("overflowing message");
+		return dropped > 0 && messages.size() + dropped == count;
+	});
+}
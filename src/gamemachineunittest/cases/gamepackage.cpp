@@ -0,0 +1,287 @@
+﻿#include "stdafx.h"
+#include "gamepackage.h"
+#include <gmgamepackagehandler.h>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+	const char* PackagePath = "gamepackage_test.pk0";
+
+	struct ZipFile
+	{
+		std::string name;
+		std::string content;
+		bool deflated;
+	};
+
+	void writeU16(std::string& out, gm::GMuint32 v)
+	{
+		out += static_cast<char>(v & 0xFF);
+		out += static_cast<char>((v >> 8) & 0xFF);
+	}
+
+	void writeU32(std::string& out, gm::GMuint32 v)
+	{
+		writeU16(out, v & 0xFFFF);
+		writeU16(out, v >> 16);
+	}
+
+	gm::GMuint32 crc32(const std::string& s)
+	{
+		gm::GMuint32 crc = 0xFFFFFFFF;
+		for (unsigned char c : s)
+		{
+			crc ^= c;
+			for (gm::GMint32 i = 0; i < 8; ++i)
+			{
+				crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+			}
+		}
+		return ~crc;
+	}
+
+	// 用一个不压缩的deflate块表示压缩的数据，解压的过程与真正压缩的数据相同
+	std::string deflateStored(const std::string& s)
+	{
+		std::string out;
+		out += static_cast<char>(0x01);
+		writeU16(out, static_cast<gm::GMuint32>(s.size()));
+		writeU16(out, static_cast<gm::GMuint32>(~s.size() & 0xFFFF));
+		return out + s;
+	}
+
+	// 写入一个zip文件，文件名以/结尾的表示目录
+	bool writeZip(const char* path, const Vector<ZipFile>& files)
+	{
+		std::string zip, directory;
+		for (const auto& file : files)
+		{
+			const std::string payload = file.deflated ? deflateStored(file.content) : file.content;
+			const gm::GMuint32 method = file.deflated ? 8 : 0;
+			const gm::GMuint32 crc = crc32(file.content);
+			const gm::GMuint32 offset = static_cast<gm::GMuint32>(zip.size());
+
+			writeU32(zip, 0x04034b50);
+			writeU16(zip, 20);
+			writeU16(zip, 0);
+			writeU16(zip, method);
+			writeU32(zip, 0);
+			writeU32(zip, crc);
+			writeU32(zip, static_cast<gm::GMuint32>(payload.size()));
+			writeU32(zip, static_cast<gm::GMuint32>(file.content.size()));
+			writeU16(zip, static_cast<gm::GMuint32>(file.name.size()));
+			writeU16(zip, 0);
+			zip += file.name;
+			zip += payload;
+
+			writeU32(directory, 0x02014b50);
+			writeU16(directory, 20);
+			writeU16(directory, 20);
+			writeU16(directory, 0);
+			writeU16(directory, method);
+			writeU32(directory, 0);
+			writeU32(directory, crc);
+			writeU32(directory, static_cast<gm::GMuint32>(payload.size()));
+			writeU32(directory, static_cast<gm::GMuint32>(file.content.size()));
+			writeU16(directory, static_cast<gm::GMuint32>(file.name.size()));
+			writeU16(directory, 0);
+			writeU16(directory, 0);
+			writeU16(directory, 0);
+			writeU16(directory, 0);
+			writeU32(directory, 0);
+			writeU32(directory, offset);
+			directory += file.name;
+		}
+
+		const gm::GMuint32 directoryOffset = static_cast<gm::GMuint32>(zip.size());
+		zip += directory;
+		writeU32(zip, 0x06054b50);
+		writeU16(zip, 0);
+		writeU16(zip, 0);
+		writeU16(zip, static_cast<gm::GMuint32>(files.size()));
+		writeU16(zip, static_cast<gm::GMuint32>(files.size()));
+		writeU32(zip, static_cast<gm::GMuint32>(directory.size()));
+		writeU32(zip, directoryOffset);
+		writeU16(zip, 0);
+
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		out.write(zip.data(), zip.size());
+		return out.good();
+	}
+
+	// 记录创建的zip处理器，以便测试缓存
+	class TestGamePackage : public gm::GMGamePackage
+	{
+	public:
+		gm::GMZipGamePackageHandler* getZipHandler() { return m_zipHandler; }
+
+	protected:
+		virtual void createGamePackage(gm::GMGamePackage* pk, gm::GMGamePackageType t, OUT gm::IGamePackageHandler** handler) override
+		{
+			gm::GMGamePackage::createGamePackage(pk, t, handler);
+			m_zipHandler = dynamic_cast<gm::GMZipGamePackageHandler*>(*handler);
+		}
+
+	private:
+		gm::GMZipGamePackageHandler* m_zipHandler = nullptr;
+	};
+
+	// 在测试期间创建资源包文件，结束时删除
+	struct ScopedPackage
+	{
+		ScopedPackage(const Vector<ZipFile>& files)
+		{
+			valid = writeZip(PackagePath, files);
+			if (valid)
+				package.loadPackage(PackagePath);
+		}
+
+		~ScopedPackage()
+		{
+			package.loadPackage(".");
+			std::remove(PackagePath);
+		}
+
+		bool read(const char* path, gm::GMBuffer& buffer)
+		{
+			return package.readFileFromPath(path, &buffer);
+		}
+
+		static bool equals(const gm::GMBuffer& buffer, const std::string& content)
+		{
+			return buffer.getSize() == content.size()
+				&& memcmp(buffer.getData(), content.data(), content.size()) == 0;
+		}
+
+		TestGamePackage package;
+		bool valid;
+	};
+
+	std::string makeContent(gm::GMint32 seed, gm::GMsize_t size)
+	{
+		std::string content(size, '\0');
+		for (gm::GMsize_t i = 0; i < size; ++i)
+		{
+			content[i] = static_cast<char>('a' + (seed + i) % 26);
+		}
+		return content;
+	}
+}
+
+void cases::GamePackage::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMZipGamePackageHandler returns stored files as views", []() {
+		const std::string content = makeContent(0, 1000);
+		ScopedPackage pk({ { "textures/Stored.txt", content, false } });
+		gm::GMBuffer first, second;
+		if (!pk.valid || !pk.read("textures/stored.txt", first) || !pk.read("TEXTURES\\STORED.TXT", second))
+			return false;
+
+		return !first.isOwnedBuffer()
+			&& first.getData() == second.getData()
+			&& ScopedPackage::equals(first, content);
+	});
+
+	ut.addTestCase("GMZipGamePackageHandler inflates deflated files", []() {
+		const std::string content = makeContent(1, 3000);
+		ScopedPackage pk({ { "scripts/deflated.lua", content, true } });
+		gm::GMBuffer buffer;
+		if (!pk.valid || !pk.read("scripts/deflated.lua", buffer))
+			return false;
+
+		// 转换为字符串时，视图和缓存中的数据都不能被破坏
+		gm::GMBuffer copy = buffer;
+		copy.convertToStringBuffer();
+		return buffer.isOwnedBuffer()
+			&& ScopedPackage::equals(buffer, content)
+			&& reinterpret_cast<const char*>(copy.getData())[content.size()] == 0;
+	});
+
+	ut.addTestCase("GMZipGamePackageHandler copies views before converting to strings", []() {
+		const std::string content = makeContent(2, 100);
+		ScopedPackage pk({ { "stored.txt", content, false }, { "next.txt", "next", false } });
+		gm::GMBuffer buffer;
+		if (!pk.valid || !pk.read("stored.txt", buffer))
+			return false;
+
+		buffer.convertToStringBuffer();
+		gm::GMBuffer view, next;
+		return buffer.isOwnedBuffer()
+			&& pk.read("stored.txt", view)
+			&& pk.read("next.txt", next)
+			&& ScopedPackage::equals(view, content)
+			&& ScopedPackage::equals(next, "next");
+	});
+
+	ut.addTestCase("GMZipGamePackageHandler keeps the cache within the budget", []() {
+		constexpr gm::GMint32 count = 8;
+		constexpr gm::GMsize_t size = 1000;
+		Vector<ZipFile> files;
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			files.push_back({ "file" + std::to_string(i), makeContent(i, size), true });
+		}
+
+		ScopedPackage pk(files);
+		gm::GMZipGamePackageHandler* handler = pk.package.getZipHandler();
+		if (!pk.valid || !handler)
+			return false;
+
+		handler->setCacheBudget(size * 3);
+		gm::GMBuffer oldest;
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			gm::GMBuffer buffer;
+			if (!pk.read(files[i].name.c_str(), buffer) || !ScopedPackage::equals(buffer, files[i].content))
+				return false;
+			if (handler->getCacheSize() > handler->getCacheBudget())
+				return false;
+			if (i == 0)
+				oldest = buffer;
+		}
+
+		// 被淘汰的数据仍然被调用者持有；再次读取时重新解压
+		gm::GMBuffer reread;
+		if (handler->getCacheSize() != size * 3 || !ScopedPackage::equals(oldest, files[0].content))
+			return false;
+		if (!pk.read(files[0].name.c_str(), reread) || reread.getData() == oldest.getData())
+			return false;
+
+		handler->setCacheBudget(0);
+		return handler->getCacheSize() == 0;
+	});
+
+	ut.addTestCase("GMGamePackage reads files in parallel", []() {
+		constexpr gm::GMint32 count = 32;
+		Vector<ZipFile> files;
+		Vector<gm::GMString> paths;
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			files.push_back({ "models/" + std::to_string(i) + ".bin", makeContent(i, 500 + i), i % 2 == 0 });
+			paths.push_back(files.back().name);
+		}
+
+		ScopedPackage pk(files);
+		Vector<gm::GMBuffer> buffers;
+		if (!pk.valid || !pk.package.readFilesFromPath(paths, buffers) || buffers.size() != files.size())
+			return false;
+
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			if (!ScopedPackage::equals(buffers[i], files[i].content))
+				return false;
+		}
+
+		paths.push_back("models/missing.bin");
+		return !pk.package.readFilesFromPath(paths, buffers) && buffers.size() == paths.size();
+	});
+
+	ut.addTestCase("GMZipGamePackageHandler finds files and directories", []() {
+		ScopedPackage pk({ { "maps/", "", false }, { "maps/level.map", "level", false } });
+		return pk.valid
+			&& pk.package.exists(gm::GMPackageIndex::Maps, "level.map")
+			&& pk.package.exists(gm::GMPackageIndex::Root, "maps")
+			&& !pk.package.exists(gm::GMPackageIndex::Maps, "missing.map");
+	});
+}
@@ -0,0 +1,124 @@
+﻿#include "stdafx.h"
+#include "glyphatlas.h"
+#include <gmglyphatlas.h>
+
+namespace
+{
+	bool overlaps(const gm::GMGlyphAtlasRegion& a, const gm::GMGlyphAtlasRegion& b)
+	{
+		return a.page == b.page
+			&& a.x < b.x + b.width && b.x < a.x + a.width
+			&& a.y < b.y + b.height && b.y < a.y + a.height;
+	}
+
+	// 分配若干个区域，直到图集需要清空一页
+	bool fillAtlas(gm::GMGlyphAtlas& atlas, Vector<gm::GMGlyphAtlasRegion>& regions)
+	{
+		for (gm::GMint32 i = 0; ; ++i)
+		{
+			gm::GMGlyphAtlasRegion region;
+			gm::GMint32 evictedPage = -1;
+			if (!atlas.allocate(5 + i % 7, 6 + (i * 3) % 11, region, evictedPage))
+				return false;
+			if (evictedPage >= 0)
+				return true;
+			regions.push_back(region);
+		}
+	}
+}
+
+void cases::GlyphAtlas::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMGlyphAtlas packs regions without overlapping", []() {
+		gm::GMGlyphAtlas atlas(64, 64, 3);
+		Vector<gm::GMGlyphAtlasRegion> regions;
+		if (!fillAtlas(atlas, regions))
+			return false;
+
+		if (atlas.getPageCount() != 3)
+			return false;
+
+		for (gm::GMsize_t i = 0; i < regions.size(); ++i)
+		{
+			const gm::GMGlyphAtlasRegion& r = regions[i];
+			if (r.page < 0 || r.x < 0 || r.y < 0 || r.x + r.width > 64 || r.y + r.height > 64)
+				return false;
+
+			for (gm::GMsize_t j = i + 1; j < regions.size(); ++j)
+			{
+				if (overlaps(r, regions[j]))
+					return false;
+			}
+		}
+
+		// 3页中至少要放下大部分的面积
+		gm::GMint32 area = 0;
+		for (const auto& r : regions)
+		{
+			area += (r.width + 1) * (r.height + 1);
+		}
+		return area > 64 * 64 * 3 * 3 / 4;
+	});
+
+	ut.addTestCase("GMGlyphAtlas evicts the least recently used page", []() {
+		gm::GMGlyphAtlas atlas(32, 32, 3);
+		Vector<gm::GMGlyphAtlasRegion> regions;
+		gm::GMGlyphAtlasRegion region;
+		gm::GMint32 evictedPage = -1;
+
+		// 每一页放一个整页大小的区域
+		for (gm::GMint32 page = 0; page < 3; ++page)
+		{
+			atlas.nextFrame();
+			if (!atlas.allocate(31, 31, region, evictedPage) || region.page != page || evictedPage != -1)
+				return false;
+		}
+
+		// 第0页最近被使用过，第1页最久没有使用
+		atlas.nextFrame();
+		atlas.touch(0);
+		atlas.nextFrame();
+		if (!atlas.allocate(31, 31, region, evictedPage) || evictedPage != 1 || region.page != 1)
+			return false;
+
+		// 第1页在当前帧使用过，清空剩下的页中最久没有使用的第2页
+		if (!atlas.allocate(31, 31, region, evictedPage) || evictedPage != 2)
+			return false;
+
+		// 比一页还大的区域无法分配
+		return !atlas.allocate(40, 8, region, evictedPage);
+	});
+
+	ut.addTestCase("GMGlyphAtlas merges written regions into one dirty rect", []() {
+		gm::GMGlyphAtlas atlas(64, 64, 1);
+		gm::GMGlyphAtlasRegion a, b;
+		gm::GMint32 evictedPage = -1;
+		if (!atlas.allocate(4, 4, a, evictedPage) || !atlas.allocate(6, 3, b, evictedPage))
+			return false;
+
+		// 新的一页整页都是脏的
+		gm::GMRect rc;
+		if (!atlas.takeDirtyRect(0, rc) || rc.width != 64 || rc.height != 64)
+			return false;
+		if (atlas.takeDirtyRect(0, rc))
+			return false;
+
+		gm::GMbyte pixelsA[4 * 4], pixelsB[6 * 3];
+		memset(pixelsA, 0x11, sizeof(pixelsA));
+		memset(pixelsB, 0x22, sizeof(pixelsB));
+		atlas.write(a, pixelsA, 4);
+		atlas.write(b, pixelsB, 6);
+		if (!atlas.takeDirtyRect(0, rc))
+			return false;
+
+		gm::GMint32 left = std::min(a.x, b.x), top = std::min(a.y, b.y);
+		gm::GMint32 right = std::max(a.x + a.width, b.x + b.width), bottom = std::max(a.y + a.height, b.y + b.height);
+		if (rc.x != left || rc.y != top || rc.width != right - left || rc.height != bottom - top)
+			return false;
+
+		const gm::GMbyte* pixels = atlas.getPixels(0);
+		return pixels[a.y * 64 + a.x] == 0x11
+			&& pixels[(b.y + b.height - 1) * 64 + b.x + b.width - 1] == 0x22
+			&& !atlas.takeDirtyRect(0, rc);
+	});
+}
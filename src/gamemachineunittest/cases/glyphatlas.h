@@ -0,0 +1,16 @@
+﻿#ifndef __CASES_GLYPHATLAS_H__
+#define __CASES_GLYPHATLAS_H__
+#include "unittest_def.h"
+#include <gamemachine.h>
+#include "unittestcase.h"
+
+namespace cases
+{
+	struct GlyphAtlas : public UnitTestCase
+	{
+	public:
+		virtual void addToUnitTest(UnitTest& ut) override;
+	};
+}
+
+#endif
@@ -0,0 +1,66 @@
+﻿#include "stdafx.h"
+#include "instancing.h"
+#include <gmgameobject.h>
+
+namespace
+{
+	gm::GMModel* createModel(gm::GMModelType type, bool blend)
+	{
+		gm::GMModel* model = new gm::GMModel();
+		model->setType(type);
+		model->getShader().setBlend(blend);
+		return model;
+	}
+
+	gm::GMSceneAsset createScene(std::initializer_list<gm::GMModel*> models)
+	{
+		gm::GMScene* scene = new gm::GMScene();
+		for (auto model : models)
+		{
+			scene->addModelAsset(gm::GMAsset(gm::GMAssetType::Model, model));
+		}
+		return gm::GMAsset(gm::GMAssetType::Scene, scene);
+	}
+
+	bool canInstancing(gm::GMSceneAsset asset, bool instancing = true)
+	{
+		gm::GMGameObject object(asset);
+		object.setInstancing(instancing);
+		return object.canInstancing();
+	}
+}
+
+void cases::Instancing::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMGameObject canInstancing (opaque 3D)", []() {
+		return canInstancing(createScene({ createModel(gm::GMModelType::Model3D, false) }))
+			&& !canInstancing(createScene({ createModel(gm::GMModelType::Model3D, false) }), false);
+	});
+
+	ut.addTestCase("GMGameObject canInstancing (invisible)", []() {
+		gm::GMGameObject object(createScene({ createModel(gm::GMModelType::Model3D, false) }));
+		object.setInstancing(true);
+		object.setVisible(false);
+		return !object.canInstancing();
+	});
+
+	ut.addTestCase("GMGameObject canInstancing (animated)", []() {
+		gm::GMSceneAsset skeletal = createScene({ createModel(gm::GMModelType::Model3D, false) });
+		skeletal.getScene()->setAnimationType(gm::GMAnimationType::SkeletalAnimation);
+		gm::GMSceneAsset affine = createScene({ createModel(gm::GMModelType::Model3D, false) });
+		affine.getScene()->setAnimationType(gm::GMAnimationType::AffineAnimation);
+		return !canInstancing(skeletal) && !canInstancing(affine);
+	});
+
+	ut.addTestCase("GMGameObject canInstancing (transparent)", []() {
+		// 只要有一个模型开启了混合，整个对象都不能实例化
+		return !canInstancing(createScene({ createModel(gm::GMModelType::Model3D, true) }))
+			&& !canInstancing(createScene({ createModel(gm::GMModelType::Model3D, false), createModel(gm::GMModelType::Model3D, true) }));
+	});
+
+	ut.addTestCase("GMGameObject canInstancing (2D)", []() {
+		return !canInstancing(createScene({ createModel(gm::GMModelType::Model2D, false) }))
+			&& !canInstancing(createScene({ createModel(gm::GMModelType::Model3D, false), createModel(gm::GMModelType::Model2D, false) }))
+			&& !canInstancing(createScene({ createModel(gm::GMModelType::Text, false) }));
+	});
+}
@@ -0,0 +1,16 @@
+﻿#ifndef __CASES_INSTANCING_H__
+#define __CASES_INSTANCING_H__
+#include "unittest_def.h"
+#include <gamemachine.h>
+#include "unittestcase.h"
+
+namespace cases
+{
+	struct Instancing : public UnitTestCase
+	{
+	public:
+		virtual void addToUnitTest(UnitTest& ut) override;
+	};
+}
+
+#endif
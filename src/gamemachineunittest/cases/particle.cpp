@@ -0,0 +1,205 @@
+﻿#include "stdafx.h"
+#include "particle.h"
+#include <gmparticle.h>
+
+namespace
+{
+	const GMVec4 s_rotateStartVector = GMVec4(0, 1, 0, 1);
+
+	// 与之前以结构数组（AoS）存放粒子时的重力模式更新相同
+	void referenceGravityUpdate(gm::GMParticle_Cocos2DData& particle, const gm::GMParticleUpdateArgs_Cocos2D& args)
+	{
+		gm::GMDuration dt = args.dt;
+		particle.remainingLife -= dt;
+		GMVec3 radial = Zero<GMVec3>();
+		if (!FuzzyCompare(particle.changePosition.getX(), 0)
+			|| !FuzzyCompare(particle.changePosition.getY(), 0)
+			|| !FuzzyCompare(particle.changePosition.getZ(), 0))
+		{
+			radial = Normalize(particle.gravityModeData.initialVelocity);
+		}
+		GMVec3 tangential = radial;
+		radial *= particle.gravityModeData.radialAcceleration;
+
+		gm::GMfloat y = tangential.getX();
+		tangential.setX(-tangential.getY());
+		tangential.setY(y);
+		tangential *= particle.gravityModeData.tangentialAcceleration;
+
+		GMVec3 offset = (radial + tangential + args.gravity) * dt;
+		particle.gravityModeData.initialVelocity += offset;
+		particle.changePosition = particle.changePosition + particle.gravityModeData.initialVelocity * dt;
+		particle.color = particle.color + particle.deltaColor * dt;
+		particle.size = Max(0, particle.size + particle.deltaSize * dt);
+		particle.rotation = particle.rotation + particle.deltaRotation * dt;
+
+		if (args.motionMode == gm::GMParticleMotionMode::Relative)
+			particle.position = particle.changePosition + args.emitPosition - particle.startPosition;
+		else
+			particle.position = particle.changePosition;
+	}
+
+	// 与之前以结构数组（AoS）存放粒子时的半径模式更新相同
+	void referenceRadialUpdate(gm::GMParticle_Cocos2DData& particle, const gm::GMParticleUpdateArgs_Cocos2D& args)
+	{
+		gm::GMDuration dt = args.dt;
+		particle.remainingLife -= dt;
+		particle.radiusModeData.angle += particle.radiusModeData.degressPerSecond * dt;
+		particle.radiusModeData.radius += particle.radiusModeData.deltaRadius * dt;
+
+		GMQuat rotationQuat = Rotate(particle.radiusModeData.angle, args.rotationAxis);
+		GMVec4 changePosition = s_rotateStartVector * rotationQuat * particle.radiusModeData.radius;
+		particle.changePosition = GMVec3(changePosition.getX(), changePosition.getY(), changePosition.getZ());
+
+		if (args.motionMode == gm::GMParticleMotionMode::Relative)
+			particle.position = particle.changePosition + particle.startPosition;
+		else
+			particle.position = particle.changePosition + args.emitPosition;
+
+		particle.color = particle.color + particle.deltaColor * dt;
+		particle.size = Max(0, particle.size + particle.deltaSize * dt);
+		particle.rotation = particle.rotation + particle.deltaRotation * dt;
+	}
+
+	gm::GMParticle_Cocos2DData createParticle(gm::GMint32 seed)
+	{
+		gm::GMfloat s = static_cast<gm::GMfloat>(seed);
+		gm::GMParticle_Cocos2DData particle;
+		particle.position = GMVec3(s, 1, 2);
+		particle.startPosition = GMVec3(1, -s, 3);
+		// 第一个粒子还在发射点，没有径向加速度
+		particle.changePosition = seed == 0 ? Zero<GMVec3>() : GMVec3(.5f * s, .25f, -1);
+		particle.color = GMVec4(.1f, .2f, .3f, 1);
+		particle.deltaColor = GMVec4(.01f * s, -.02f, .03f, -.1f);
+		particle.size = 2 + s;
+		particle.deltaSize = -.5f;
+		particle.rotation = .1f * s;
+		particle.deltaRotation = .3f;
+		particle.remainingLife = 100;
+		particle.gravityModeData.initialVelocity = GMVec3(1 + s, 2, -.5f * s);
+		particle.gravityModeData.radialAcceleration = 3 - s;
+		particle.gravityModeData.tangentialAcceleration = .5f * s;
+		particle.radiusModeData.angle = .2f * s;
+		particle.radiusModeData.degressPerSecond = 1.5f;
+		particle.radiusModeData.radius = 10 + s;
+		particle.radiusModeData.deltaRadius = -.7f;
+		return particle;
+	}
+
+	bool fuzzyEqual(const GMVec3& a, const GMVec3& b)
+	{
+		return Fabs(a.getX() - b.getX()) < .001f && Fabs(a.getY() - b.getY()) < .001f && Fabs(a.getZ() - b.getZ()) < .001f;
+	}
+
+	bool fuzzyEqual(const gm::GMParticle_Cocos2DData& a, const gm::GMParticle_Cocos2DData& b)
+	{
+		return fuzzyEqual(a.position, b.position)
+			&& fuzzyEqual(a.changePosition, b.changePosition)
+			&& fuzzyEqual(a.gravityModeData.initialVelocity, b.gravityModeData.initialVelocity)
+			&& Fabs(Length(a.color - b.color)) < .001f
+			&& Fabs(a.size - b.size) < .001f
+			&& Fabs(a.rotation - b.rotation) < .001f
+			&& Fabs(a.remainingLife - b.remainingLife) < .001f
+			&& Fabs(a.radiusModeData.angle - b.radiusModeData.angle) < .001f
+			&& Fabs(a.radiusModeData.radius - b.radiusModeData.radius) < .001f;
+	}
+
+	template <typename Kernel, typename Reference>
+	bool matchesReference(Kernel kernel, Reference reference)
+	{
+		const gm::GMParticleMotionMode modes[] = { gm::GMParticleMotionMode::Free, gm::GMParticleMotionMode::Relative };
+		for (auto mode : modes)
+		{
+			gm::GMParticlePool_Cocos2D pool;
+			gm::AlignedVector<gm::GMParticle_Cocos2DData> expected;
+			for (gm::GMint32 i = 0; i < 37; ++i)
+			{
+				expected.push_back(createParticle(i));
+				pool.push_back(expected.back());
+			}
+
+			gm::GMParticleUpdateArgs_Cocos2D args;
+			args.dt = .016f;
+			args.motionMode = mode;
+			args.emitPosition = GMVec3(3, 4, 5);
+			args.gravity = GMVec3(0, -9.8f, 0);
+			args.rotationAxis = Normalize(GMVec3(1, 2, 3));
+			for (gm::GMint32 frame = 0; frame < 10; ++frame)
+			{
+				kernel(pool, 0, pool.size(), args);
+				for (auto& particle : expected)
+				{
+					reference(particle, args);
+				}
+			}
+
+			for (gm::GMsize_t i = 0; i < expected.size(); ++i)
+			{
+				if (!fuzzyEqual(pool.get(i), expected[i]))
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+void cases::Particle::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMParticlePool_Cocos2D gravity kernel matches AoS update", []() {
+		return matchesReference(&gm::GMGravityParticleEffect_Cocos2D::updateParticles, &referenceGravityUpdate);
+	});
+
+	ut.addTestCase("GMParticlePool_Cocos2D radial kernel matches AoS update", []() {
+		return matchesReference(&gm::GMRadialParticleEffect_Cocos2D::updateParticles, &referenceRadialUpdate);
+	});
+
+	ut.addTestCase("GMParticlePool_Cocos2D removes dead particles", []() {
+		gm::GMParticlePool_Cocos2D pool;
+		Set<gm::GMint32> alive;
+		for (gm::GMint32 i = 0; i < 100; ++i)
+		{
+			gm::GMParticle_Cocos2DData particle = createParticle(i);
+			// 以大小标记粒子，连续的和位于末尾的粒子都会死亡
+			particle.size = static_cast<gm::GMfloat>(i);
+			particle.remainingLife = (i % 3 == 0 || (i >= 40 && i < 50) || i >= 95) ? 0.f : 1.f;
+			if (particle.remainingLife > 0)
+				alive.insert(i);
+			pool.push_back(particle);
+		}
+
+		gm::GMsize_t removed = pool.removeDeadParticles();
+		if (removed != 100 - alive.size() || pool.size() != alive.size())
+			return false;
+
+		Set<gm::GMint32> remaining;
+		const gm::GMfloat* size = pool.getStream(gm::GMParticlePool_Cocos2D::Size);
+		for (gm::GMsize_t i = 0; i < pool.size(); ++i)
+		{
+			remaining.insert(static_cast<gm::GMint32>(size[i]));
+		}
+		return remaining == alive;
+	});
+
+	ut.addTestCase("GMParticlePool_Cocos2D pack and unpack", []() {
+		gm::GMParticlePool_Cocos2D pool;
+		for (gm::GMint32 i = 0; i < 5; ++i)
+		{
+			pool.push_back(createParticle(i));
+		}
+
+		gm::GMParticle_Cocos2DData* packed = pool.pack();
+		for (gm::GMint32 i = 0; i < 5; ++i)
+		{
+			if (!fuzzyEqual(packed[i], createParticle(i)))
+				return false;
+			packed[i].remainingLife = static_cast<gm::GMfloat>(i);
+		}
+
+		pool.unpack(packed);
+		pool.remove(0);
+		// 最后一个粒子被移动到了第0个位置
+		return pool.size() == 4
+			&& pool.get(0).remainingLife == 4
+			&& pool.get(3).remainingLife == 3;
+	});
+}
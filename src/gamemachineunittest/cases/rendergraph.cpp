@@ -0,0 +1,121 @@
+﻿#include "stdafx.h"
+#include "rendergraph.h"
+#include <gmrendergraph.h>
+
+namespace
+{
+	void emptyPass(gm::GMRenderGraph&)
+	{
+	}
+}
+
+void cases::RenderGraph::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMRenderGraph cullPasses", []() {
+		// 只编译不执行，不需要渲染环境
+		gm::GMRenderGraph graph(nullptr);
+		gm::GMRenderGraphTargetDesc desc;
+		gm::GMRenderGraphResource target = graph.importResource("Target", nullptr);
+		gm::GMRenderGraphResource a = graph.createTransientTarget("A", desc);
+		gm::GMRenderGraphResource unused = graph.createTransientTarget("Unused", desc);
+
+		gm::GMsize_t writeA = graph.addPass("WriteA", {}, { a }, emptyPass);
+		gm::GMsize_t resolve = graph.addPass("Resolve", { a }, { target }, emptyPass);
+		gm::GMsize_t writeUnused = graph.addPass("WriteUnused", { a }, { unused }, emptyPass);
+		gm::GMsize_t sideEffect = graph.addPass("SideEffect", {}, {}, emptyPass, true);
+		graph.markOutput(target);
+		graph.compile();
+
+		return !graph.isPassCulled(writeA)
+			&& !graph.isPassCulled(resolve)
+			&& graph.isPassCulled(writeUnused)
+			&& !graph.isPassCulled(sideEffect);
+	});
+
+	ut.addTestCase("GMRenderGraph cullPasses (transitive)", []() {
+		// 一个渲染阶段的输出只被被剔除的阶段读取时，它也应该被剔除
+		gm::GMRenderGraph graph(nullptr);
+		gm::GMRenderGraphTargetDesc desc;
+		gm::GMRenderGraphResource target = graph.importResource("Target", nullptr);
+		gm::GMRenderGraphResource a = graph.createTransientTarget("A", desc);
+		gm::GMRenderGraphResource b = graph.createTransientTarget("B", desc);
+
+		gm::GMsize_t writeA = graph.addPass("WriteA", {}, { a }, emptyPass);
+		gm::GMsize_t writeB = graph.addPass("WriteB", { a }, { b }, emptyPass);
+		gm::GMsize_t drawTarget = graph.addPass("DrawTarget", {}, { target }, emptyPass);
+		graph.markOutput(target);
+		graph.compile();
+
+		return graph.isPassCulled(writeA)
+			&& graph.isPassCulled(writeB)
+			&& !graph.isPassCulled(drawTarget)
+			&& graph.getTransientFramebuffersCount() == 0;
+	});
+
+	ut.addTestCase("GMRenderGraph aliasing", []() {
+		gm::GMRenderGraph graph(nullptr);
+		gm::GMRenderGraphTargetDesc desc;
+		gm::GMRenderGraphResource target = graph.importResource("Target", nullptr);
+		gm::GMRenderGraphResource a = graph.createTransientTarget("A", desc);
+		gm::GMRenderGraphResource b = graph.createTransientTarget("B", desc);
+
+		// A的生命周期在B开始之前结束，两者可以共用一个帧缓存
+		graph.addPass("WriteA", {}, { a }, emptyPass);
+		graph.addPass("ReadA", { a }, { target }, emptyPass);
+		graph.addPass("WriteB", {}, { b }, emptyPass);
+		graph.addPass("ReadB", { b }, { target }, emptyPass);
+		graph.markOutput(target);
+		graph.compile();
+		if (graph.getTransientFramebuffersCount() != 1)
+			return false;
+
+		// 生命周期重叠时不能共用
+		graph.reset();
+		target = graph.importResource("Target", nullptr);
+		a = graph.createTransientTarget("A", desc);
+		b = graph.createTransientTarget("B", desc);
+		graph.addPass("WriteA", {}, { a }, emptyPass);
+		graph.addPass("WriteB", {}, { b }, emptyPass);
+		graph.addPass("ReadAB", { a, b }, { target }, emptyPass);
+		graph.markOutput(target);
+		graph.compile();
+		if (graph.getTransientFramebuffersCount() != 2)
+			return false;
+
+		// 描述不同时不能共用
+		gm::GMRenderGraph otherGraph(nullptr);
+		gm::GMRenderGraphTargetDesc floatDesc;
+		floatDesc.formats = { gm::GMFramebufferFormat::R32G32B32A32_FLOAT };
+		target = otherGraph.importResource("Target", nullptr);
+		a = otherGraph.createTransientTarget("A", desc);
+		b = otherGraph.createTransientTarget("B", floatDesc);
+		otherGraph.addPass("WriteA", {}, { a }, emptyPass);
+		otherGraph.addPass("ReadA", { a }, { target }, emptyPass);
+		otherGraph.addPass("WriteB", {}, { b }, emptyPass);
+		otherGraph.addPass("ReadB", { b }, { target }, emptyPass);
+		otherGraph.markOutput(target);
+		otherGraph.compile();
+		return otherGraph.getTransientFramebuffersCount() == 2;
+	});
+
+	ut.addTestCase("GMRenderGraph pool eviction", []() {
+		// 渲染目标的描述改变之后（如跟随窗口改变的固定大小），旧的帧缓存应该被回收
+		gm::GMRenderGraph graph(nullptr);
+		for (gm::GMint32 i = 1; i <= 4; ++i)
+		{
+			gm::GMRenderGraphTargetDesc desc;
+			desc.width = 100 * i;
+			desc.height = 100 * i;
+			graph.reset();
+			gm::GMRenderGraphResource target = graph.importResource("Target", nullptr);
+			gm::GMRenderGraphResource a = graph.createTransientTarget("A", desc);
+			graph.addPass("WriteA", {}, { a }, emptyPass);
+			graph.addPass("ReadA", { a }, { target }, emptyPass);
+			graph.markOutput(target);
+			graph.compile();
+			if (graph.getTransientFramebuffersCount() != 1)
+				return false;
+		}
+		return true;
+	});
+}
@@ -0,0 +1,16 @@
+﻿#ifndef __CASE_RENDERGRAPH_H__
+#define __CASE_RENDERGRAPH_H__
+#include "unittest_def.h"
+#include <gamemachine.h>
+#include "unittestcase.h"
+
+namespace cases
+{
+	struct RenderGraph : public UnitTestCase
+	{
+	public:
+		virtual void addToUnitTest(UnitTest& ut) override;
+	};
+}
+
+#endif
@@ -0,0 +1,175 @@
+﻿#include "stdafx.h"
+#include "renderqueue.h"
+#include <gmrenderqueue.h>
+#include <gmgameobject.h>
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+	// 确定的伪随机数，保证每次运行的结果相同
+	struct Random
+	{
+		uint64_t seed = 12345;
+
+		uint64_t next()
+		{
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			return seed;
+		}
+	};
+
+	// 测试中不会解引用对象指针，只用来记录项原来的位置
+	gm::GMGameObject* fakeObject(gm::GMsize_t i)
+	{
+		return reinterpret_cast<gm::GMGameObject*>((i + 1) * 16);
+	}
+
+	bool radixSortMatchesStableSort(gm::GMRenderQueueKey keyMask)
+	{
+		Random random;
+		Vector<gm::GMRenderQueueItem> items;
+		for (gm::GMsize_t i = 0; i < 5000; ++i)
+		{
+			items.push_back({ random.next() & keyMask, fakeObject(i) });
+		}
+
+		Vector<gm::GMRenderQueueItem> expected = items;
+		std::stable_sort(expected.begin(), expected.end(), [](const gm::GMRenderQueueItem& a, const gm::GMRenderQueueItem& b) {
+			return a.key < b.key;
+		});
+
+		Vector<gm::GMRenderQueueItem> buffer(items.size());
+		gm::GMRenderQueue::radixSort(items.data(), items.size(), buffer.data());
+		for (gm::GMsize_t i = 0; i < items.size(); ++i)
+		{
+			if (items[i].key != expected[i].key || items[i].object != expected[i].object)
+				return false;
+		}
+		return true;
+	}
+
+	gm::GMSceneAsset createScene(bool blend)
+	{
+		gm::GMModel* model = new gm::GMModel();
+		model->setType(gm::GMModelType::Model3D);
+		model->getShader().setBlend(blend);
+		gm::GMScene* scene = new gm::GMScene();
+		scene->addModelAsset(gm::GMAsset(gm::GMAssetType::Model, model));
+		return gm::GMAsset(gm::GMAssetType::Scene, scene);
+	}
+
+	gm::GMGameObject* createObject(gm::GMSceneAsset scene, gm::GMfloat z)
+	{
+		gm::GMGameObject* object = new gm::GMGameObject(scene);
+		object->setTranslation(Translate(GMVec3(0, 0, z)));
+		return object;
+	}
+
+	bool queueEquals(const gm::GMRenderQueue& queue, std::initializer_list<gm::GMGameObject*> objects)
+	{
+		if (queue.getCount() != objects.size())
+			return false;
+
+		gm::GMsize_t i = 0;
+		for (auto object : objects)
+		{
+			if (queue.getObject(i++) != object)
+				return false;
+		}
+		return true;
+	}
+}
+
+void cases::RenderQueue::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMRenderQueue radixSort (random keys)", []() {
+		return radixSortMatchesStableSort(~gm::GMRenderQueueKey(0));
+	});
+
+	ut.addTestCase("GMRenderQueue radixSort (stable)", []() {
+		// 大量重复的键，并且只有部分字节不同，会跳过一些轮次
+		return radixSortMatchesStableSort(0x0F000000000000F0ull);
+	});
+
+	ut.addTestCase("GMRenderQueue makeKey ordering", []() {
+		// 每个字段都比所有低位字段的最大值更重要
+		gm::GMRenderQueueKeyFields high;
+		high.priority = 0;
+		high.segment = high.program = high.state = high.modelType = high.cull = high.texture = high.depth = 0xFFFFFFFF;
+
+		gm::GMRenderQueueKeyFields low;
+		low.priority = 1;
+		if (!(gm::GMRenderQueue::makeKey(high) < gm::GMRenderQueue::makeKey(low)))
+			return false;
+
+		gm::GMuint32 gm::GMRenderQueueKeyFields::* fields[] = {
+			&gm::GMRenderQueueKeyFields::segment,
+			&gm::GMRenderQueueKeyFields::program,
+			&gm::GMRenderQueueKeyFields::state,
+			&gm::GMRenderQueueKeyFields::modelType,
+			&gm::GMRenderQueueKeyFields::cull,
+			&gm::GMRenderQueueKeyFields::texture,
+			&gm::GMRenderQueueKeyFields::depth,
+		};
+		for (gm::GMsize_t i = 0; i < GM_array_size(fields); ++i)
+		{
+			gm::GMRenderQueueKeyFields a, b;
+			b.*fields[i] = 1;
+			for (gm::GMsize_t j = i + 1; j < GM_array_size(fields); ++j)
+			{
+				a.*fields[j] = 0xFFFFFFFF;
+			}
+			if (!(gm::GMRenderQueue::makeKey(a) < gm::GMRenderQueue::makeKey(b)))
+				return false;
+		}
+		return true;
+	});
+
+	ut.addTestCase("GMRenderQueue build (segments and priority)", []() {
+		gm::GMSceneAsset opaque = createScene(false);
+		gm::GMSceneAsset transparent = createScene(true);
+		std::unique_ptr<gm::GMGameObject> far(createObject(opaque, 10));
+		std::unique_ptr<gm::GMGameObject> near(createObject(opaque, 1));
+		std::unique_ptr<gm::GMGameObject> blend(createObject(transparent, 1));
+		std::unique_ptr<gm::GMGameObject> after(createObject(opaque, 5));
+		std::unique_ptr<gm::GMGameObject> high(createObject(opaque, 20));
+		high->setRenderPriority(gm::GMGameObjectRenderPriority::High);
+
+		// 混合的对象前后的对象不能越过它，同一个分段内从近到远，高优先级的对象最先绘制
+		gm::GMRenderQueue queue;
+		gm::GMGameObjectContainer objects = { far.get(), near.get(), blend.get(), after.get() };
+		queue.build(objects, GMVec3(0, 0, 0));
+		if (!queueEquals(queue, { near.get(), far.get(), blend.get(), after.get() }))
+			return false;
+
+		objects.push_back(high.get());
+		queue.build(objects, GMVec3(0, 0, 0));
+		return queueEquals(queue, { high.get(), near.get(), far.get(), blend.get(), after.get() });
+	});
+
+	ut.addTestCase("GMRenderQueue build (segment overflow)", []() {
+		// 分段用尽时，保持原来的顺序
+		gm::GMSceneAsset opaque = createScene(false);
+		gm::GMSceneAsset transparent = createScene(true);
+		Vector<std::unique_ptr<gm::GMGameObject>> storage;
+		gm::GMGameObjectContainer objects;
+		for (gm::GMint32 i = 0; i < 40000; ++i)
+		{
+			storage.emplace_back(createObject((i % 2) ? transparent : opaque, static_cast<gm::GMfloat>(40000 - i)));
+			objects.push_back(storage.back().get());
+		}
+
+		gm::GMRenderQueue queue;
+		queue.build(objects, GMVec3(0, 0, 0));
+		if (queue.getCount() != storage.size())
+			return false;
+
+		for (gm::GMsize_t i = 0; i < storage.size(); ++i)
+		{
+			if (queue.getObject(i) != storage[i].get())
+				return false;
+		}
+		return true;
+	});
+}
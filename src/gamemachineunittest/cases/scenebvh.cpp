@@ -0,0 +1,239 @@
+﻿#include "stdafx.h"
+#include "scenebvh.h"
+#include <gmscenebvh.h>
+#include <set>
+
+namespace
+{
+	struct Box
+	{
+		GMVec3 min;
+		GMVec3 max;
+	};
+
+	// 确定的伪随机数，保证每次运行的结果相同
+	struct Random
+	{
+		gm::GMuint32 seed = 12345;
+
+		gm::GMfloat next(gm::GMfloat lo, gm::GMfloat hi)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return lo + (hi - lo) * ((seed >> 8) / static_cast<gm::GMfloat>(1 << 24));
+		}
+	};
+
+	// 测试中不会解引用对象指针，只用来区分代理
+	gm::GMGameObject* fakeObject(gm::GMint32 i)
+	{
+		return reinterpret_cast<gm::GMGameObject*>(static_cast<intptr_t>(i + 1) * 16);
+	}
+
+	Box randomBox(Random& random)
+	{
+		GMVec3 center(random.next(-100, 100), random.next(-100, 100), random.next(-100, 100));
+		GMVec3 extents(random.next(.5f, 4), random.next(.5f, 4), random.next(.5f, 4));
+		return { center - extents, center + extents };
+	}
+
+	Box enlargeBox(const Box& box, gm::GMfloat ratio)
+	{
+		GMVec3 margin = (box.max - box.min) * ratio;
+		return { box.min - margin, box.max + margin };
+	}
+
+	// 一个轴对齐的盒状视锥体，法线指向内侧
+	gm::GMFrustumPlanes boxFrustum(const GMVec3& min, const GMVec3& max)
+	{
+		gm::GMFrustumPlanes planes;
+		planes.leftPlane = gm::GMPlane(GMVec4(1, 0, 0, -min.getX()));
+		planes.rightPlane = gm::GMPlane(GMVec4(-1, 0, 0, max.getX()));
+		planes.bottomPlane = gm::GMPlane(GMVec4(0, 1, 0, -min.getY()));
+		planes.topPlane = gm::GMPlane(GMVec4(0, -1, 0, max.getY()));
+		planes.nearPlane = gm::GMPlane(GMVec4(0, 0, 1, -min.getZ()));
+		planes.farPlane = gm::GMPlane(GMVec4(0, 0, -1, max.getZ()));
+		return planes;
+	}
+
+	// 逐个对象测试：只要有一个平面使包围盒的8个顶点都在其后方，包围盒就不可见
+	bool bruteForceVisible(const gm::GMFrustumPlanes& planes, const Box& box)
+	{
+		const gm::GMPlane* p[] = { &planes.farPlane, &planes.nearPlane, &planes.topPlane, &planes.bottomPlane, &planes.leftPlane, &planes.rightPlane };
+		for (auto plane : p)
+		{
+			bool allBehind = true;
+			for (gm::GMint32 i = 0; i < 8 && allBehind; ++i)
+			{
+				GMVec3 corner(
+					(i & 1) ? box.max.getX() : box.min.getX(),
+					(i & 2) ? box.max.getY() : box.min.getY(),
+					(i & 4) ? box.max.getZ() : box.min.getZ()
+				);
+				allBehind = plane->classifyPoint(corner) == gm::GMPointPosition::PointBehindPlane;
+			}
+			if (allBehind)
+				return false;
+		}
+		return true;
+	}
+
+	// 代理的包围盒被放大过，移动后最多放大到原来的0.4倍才会重新插入，因此结果应该介于两次暴力测试之间
+	bool queryMatchesBruteForce(gm::GMSceneBVH& bvh, const Vector<gm::GMint32>& proxies, const Vector<Box>& boxes, const gm::GMFrustumPlanes& planes)
+	{
+		Vector<gm::GMGameObject*> visible;
+		gm::GMsize_t count = bvh.query(planes, &visible);
+		if (count != visible.size())
+			return false;
+
+		std::set<gm::GMGameObject*> visibleSet(visible.begin(), visible.end());
+		for (gm::GMsize_t i = 0; i < proxies.size(); ++i)
+		{
+			if (proxies[i] == gm::GMSceneBVH::InvalidProxy)
+				continue;
+
+			bool inTree = visibleSet.count(bvh.getObject(proxies[i])) > 0;
+			if (inTree != bvh.isVisible(proxies[i]))
+				return false;
+			if (bruteForceVisible(planes, boxes[i]) && !inTree)
+				return false;
+			if (inTree && !bruteForceVisible(planes, enlargeBox(boxes[i], .45f)))
+				return false;
+		}
+		return true;
+	}
+}
+
+void cases::SceneBVH::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMSceneBVH insert and remove", []() {
+		gm::GMSceneBVH bvh;
+		if (bvh.getHeight() != 0 || bvh.getProxyCount() != 0)
+			return false;
+
+		Random random;
+		Vector<gm::GMint32> proxies;
+		for (gm::GMint32 i = 0; i < 100; ++i)
+		{
+			Box box = randomBox(random);
+			proxies.push_back(bvh.createProxy(box.min, box.max, fakeObject(i)));
+		}
+		if (bvh.getProxyCount() != 100)
+			return false;
+
+		for (gm::GMint32 i = 0; i < 100; ++i)
+		{
+			if (bvh.getObject(proxies[i]) != fakeObject(i))
+				return false;
+		}
+
+		for (gm::GMint32 i = 0; i < 100; i += 2)
+		{
+			bvh.destroyProxy(proxies[i]);
+		}
+		if (bvh.getProxyCount() != 50)
+			return false;
+
+		// 剩下的代理仍然指向原来的对象
+		for (gm::GMint32 i = 1; i < 100; i += 2)
+		{
+			if (bvh.getObject(proxies[i]) != fakeObject(i))
+				return false;
+		}
+
+		for (gm::GMint32 i = 1; i < 100; i += 2)
+		{
+			bvh.destroyProxy(proxies[i]);
+		}
+		return bvh.getProxyCount() == 0 && bvh.getHeight() == 0;
+	});
+
+	ut.addTestCase("GMSceneBVH balance", []() {
+		// 沿一条直线依次插入是不平衡插入的最坏情况
+		gm::GMSceneBVH bvh;
+		const gm::GMint32 count = 1024;
+		for (gm::GMint32 i = 0; i < count; ++i)
+		{
+			GMVec3 min(i * 2.f, 0, 0);
+			bvh.createProxy(min, min + GMVec3(1, 1, 1), fakeObject(i));
+		}
+
+		// 高度平衡的树的高度不超过2 * log2(n)
+		return bvh.getHeight() <= 2 * 10 + 1;
+	});
+
+	ut.addTestCase("GMSceneBVH move", []() {
+		gm::GMSceneBVH bvh;
+		GMVec3 min(0, 0, 0), max(10, 10, 10);
+		gm::GMint32 proxy = bvh.createProxy(min, max, fakeObject(0));
+		bvh.createProxy(GMVec3(100, 0, 0), GMVec3(110, 10, 10), fakeObject(1));
+
+		// 在放大的包围盒中移动，不需要改变树
+		if (bvh.moveProxy(proxy, min + GMVec3(.5f, 0, 0), max + GMVec3(.5f, 0, 0)))
+			return false;
+
+		// 移出放大的包围盒，需要重新插入
+		if (!bvh.moveProxy(proxy, min + GMVec3(50, 0, 0), max + GMVec3(50, 0, 0)))
+			return false;
+
+		// 移动后原来的位置不再可见，新的位置可见
+		if (bvh.query(boxFrustum(GMVec3(-5, -5, -5), GMVec3(5, 5, 5))) != 0)
+			return false;
+
+		Vector<gm::GMGameObject*> visible;
+		bvh.query(boxFrustum(GMVec3(55, 0, 0), GMVec3(56, 1, 1)), &visible);
+		return visible.size() == 1 && visible[0] == fakeObject(0) && bvh.isVisible(proxy);
+	});
+
+	ut.addTestCase("GMSceneBVH query (brute force)", []() {
+		gm::GMSceneBVH bvh;
+		Random random;
+		Vector<Box> boxes;
+		Vector<gm::GMint32> proxies;
+		for (gm::GMint32 i = 0; i < 500; ++i)
+		{
+			boxes.push_back(randomBox(random));
+			proxies.push_back(bvh.createProxy(boxes[i].min, boxes[i].max, fakeObject(i)));
+		}
+
+		Vector<gm::GMFrustumPlanes> frustums = {
+			boxFrustum(GMVec3(-50, -50, -50), GMVec3(50, 50, 50)),
+			boxFrustum(GMVec3(0, 0, 0), GMVec3(100, 20, 20)),
+			boxFrustum(GMVec3(-100, -100, -100), GMVec3(-90, 100, 100)),
+			boxFrustum(GMVec3(200, 200, 200), GMVec3(300, 300, 300)),
+		};
+
+		for (const auto& planes : frustums)
+		{
+			if (!queryMatchesBruteForce(bvh, proxies, boxes, planes))
+				return false;
+		}
+
+		// 移动、删除一部分对象之后再比较
+		for (gm::GMint32 i = 0; i < 500; ++i)
+		{
+			if (i % 3 == 0)
+			{
+				GMVec3 offset(random.next(-1, 1), random.next(-1, 1), random.next(-1, 1));
+				boxes[i] = { boxes[i].min + offset, boxes[i].max + offset };
+				bvh.moveProxy(proxies[i], boxes[i].min, boxes[i].max);
+			}
+			else if (i % 3 == 1)
+			{
+				boxes[i] = randomBox(random);
+				bvh.moveProxy(proxies[i], boxes[i].min, boxes[i].max);
+			}
+			else if (i % 7 == 0)
+			{
+				bvh.destroyProxy(proxies[i]);
+				proxies[i] = gm::GMSceneBVH::InvalidProxy;
+			}
+		}
+
+		for (const auto& planes : frustums)
+		{
+			if (!queryMatchesBruteForce(bvh, proxies, boxes, planes))
+				return false;
+		}
+		return true;
+	});
+}
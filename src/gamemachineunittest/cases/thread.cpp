@@ -126,4 +126,44 @@ void cases::Thread::addToUnitTest(UnitTest& ut)
 		thread.join();
 		return true;
 	});
+
+	ut.addTestCase("GMJobSystem parallelFor", []() {
+		gm::GMJobSystem jobSystem(4);
+		std::vector<int> values(10000, 0);
+		jobSystem.parallelFor(values.size(), 100, [&values](gm::GMsize_t begin, gm::GMsize_t end) {
+			for (gm::GMsize_t i = begin; i < end; ++i)
+			{
+				values[i] += static_cast<int>(i);
+			}
+		});
+
+		for (gm::GMsize_t i = 0; i < values.size(); ++i)
+		{
+			if (values[i] != static_cast<int>(i))
+				return false;
+		}
+		return true;
+	});
+
+	ut.addTestCase("GMJobSystem dependencies", []() {
+		gm::GMJobSystem jobSystem(4);
+		std::vector<int> order;
+		gm::GMMutex orderLock;
+		auto append = [&order, &orderLock](int v) {
+			orderLock.lock();
+			order.push_back(v);
+			orderLock.unlock();
+		};
+
+		gm::GMJobHandle first = jobSystem.createJob([&append]() { gm::GMThread::sleep(50); append(1); });
+		gm::GMJobHandle second = jobSystem.createJob([&append]() { append(2); });
+		gm::GMJobHandle third = jobSystem.createJob([&append]() { append(3); });
+		jobSystem.addDependency(second, first);
+		jobSystem.addDependency(third, second);
+		jobSystem.run(third);
+		jobSystem.run(second);
+		jobSystem.run(first);
+		jobSystem.wait(third);
+		return order.size() == 3 && order[0] == 1 && order[1] == 2 && order[2] == 3;
+	});
 }
\ No newline at end of file
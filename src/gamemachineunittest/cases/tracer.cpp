@@ -0,0 +1,195 @@
+﻿#include "stdafx.h"
+#include "tracer.h"
+#include <gmgputracer.h>
+
+namespace
+{
+	// 在测试期间开启跟踪，结束时恢复
+	struct ScopedTracing
+	{
+		ScopedTracing()
+			: previous(gm::GMTracer::isEnabled())
+		{
+			gm::GMTracer::reset();
+			gm::GMTracer::setEnabled(true);
+		}
+
+		~ScopedTracing()
+		{
+			gm::GMTracer::setEnabled(previous);
+			gm::GMTracer::reset();
+		}
+
+		bool previous;
+	};
+
+	// 时间戳由测试给出的GPU跟踪器
+	class FakeGPUTracer : public gm::GMGPUTracer
+	{
+	public:
+		bool available = true;
+		gm::GMint64 clock = 0;
+
+	protected:
+		virtual void beginQueries(gm::GMint32 frame) override
+		{
+			m_timestamps[frame].clear();
+		}
+
+		virtual void endQueries(gm::GMint32 frame) override
+		{
+		}
+
+		virtual gm::GMint32 queryTimestamp(gm::GMint32 frame) override
+		{
+			clock += 100;
+			m_timestamps[frame].push_back(clock);
+			return gm::gm_sizet_to_int(m_timestamps[frame].size()) - 1;
+		}
+
+		virtual bool resolveQueries(gm::GMint32 frame, OUT Vector<gm::GMint64>& timestamps) override
+		{
+			timestamps = m_timestamps[frame];
+			return available;
+		}
+
+	private:
+		Vector<gm::GMint64> m_timestamps[FramesInFlight];
+	};
+
+	bool contains(const std::string& str, const char* sub)
+	{
+		return str.find(sub) != std::string::npos;
+	}
+}
+
+void cases::Tracer::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMTracer records scopes and counters in order", []() {
+		ScopedTracing tracing;
+		{
+			GM_TRACE_SCOPE("outer");
+			{
+				GM_TRACE_SCOPE("inner");
+				GM_TRACE_COUNTER("objects", 42);
+			}
+		}
+
+		Vector<gm::GMTraceEvent> events;
+		gm::GMTracer::getThreadEvents(events);
+		if (events.size() != 5)
+			return false;
+
+		const gm::GMTraceEventType expected[] = {
+			gm::GMTraceEventType::Begin,
+			gm::GMTraceEventType::Begin,
+			gm::GMTraceEventType::Counter,
+			gm::GMTraceEventType::End,
+			gm::GMTraceEventType::End,
+		};
+		for (gm::GMsize_t i = 0; i < events.size(); ++i)
+		{
+			if (events[i].type != expected[i])
+				return false;
+			if (i > 0 && events[i].timestamp < events[i - 1].timestamp)
+				return false;
+		}
+		return std::wstring(events[0].name) == L"outer"
+			&& std::wstring(events[1].name) == L"inner"
+			&& events[2].value == 42;
+	});
+
+	ut.addTestCase("GMTracer records nothing when disabled", []() {
+		ScopedTracing tracing;
+		gm::GMTracer::setEnabled(false);
+		{
+			GM_TRACE_SCOPE("disabled");
+			// 作用域中途开启跟踪，不应该记录不成对的结束事件
+			gm::GMTracer::setEnabled(true);
+		}
+
+		Vector<gm::GMTraceEvent> events;
+		gm::GMTracer::getThreadEvents(events);
+		return events.empty();
+	});
+
+	ut.addTestCase("GMTracer keeps the latest events when the buffer wraps around", []() {
+		ScopedTracing tracing;
+		const gm::GMint64 count = gm::GMTracer::BufferCapacity + 10;
+		for (gm::GMint64 i = 0; i < count; ++i)
+		{
+			GM_TRACE_COUNTER("wrap", i);
+		}
+
+		Vector<gm::GMTraceEvent> events;
+		gm::GMTracer::getThreadEvents(events);
+		return events.size() == gm::GMTracer::BufferCapacity
+			&& events.front().value == count - gm::GMTracer::BufferCapacity
+			&& events.back().value == count - 1;
+	});
+
+	ut.addTestCase("GMTracer exports Chrome trace events", []() {
+		ScopedTracing tracing;
+		GM_TRACE_FRAME();
+		{
+			GM_TRACE_SCOPE("export \"scope\"");
+		}
+		GM_TRACE_COUNTER("exported", 7);
+		gm::GMTracer::gpuSpan(L"gpu pass", 1000, 3500);
+
+		std::string json = gm::GMTracer::exportChromeTrace();
+		return contains(json, "\"traceEvents\":[")
+			&& contains(json, "\"ph\":\"B\"")
+			&& contains(json, "\"name\":\"export \\\"scope\\\"\"")
+			&& contains(json, "\"ph\":\"E\"")
+			&& contains(json, "\"ph\":\"i\"")
+			&& contains(json, "\"name\":\"exported\",\"args\":{\"value\":7}")
+			&& contains(json, "\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":1.000,\"dur\":2.500,\"cat\":\"gpu\",\"name\":\"gpu pass\"");
+	});
+
+	ut.addTestCase("GMGPUTracer reports spans after the frames in flight", []() {
+		ScopedTracing tracing;
+		FakeGPUTracer gpuTracer;
+		gpuTracer.beginFrame();
+		gpuTracer.beginScope(L"pass");
+		gpuTracer.endScope();
+		gpuTracer.endFrame();
+
+		Vector<gm::GMTraceEvent> events;
+		for (gm::GMint32 i = 1; i < gm::GMGPUTracer::FramesInFlight; ++i)
+		{
+			gpuTracer.beginFrame();
+			gpuTracer.endFrame();
+			gm::GMTracer::getThreadEvents(events);
+			if (!events.empty())
+				return false;
+		}
+
+		// 回到第一帧的位置，读取它的结果
+		gpuTracer.beginFrame();
+		gpuTracer.endFrame();
+		gm::GMTracer::getThreadEvents(events);
+		return events.size() == 1
+			&& events[0].type == gm::GMTraceEventType::GPUSpan
+			&& std::wstring(events[0].name) == L"pass"
+			&& events[0].timestamp == 100
+			&& events[0].value == 200
+			&& gpuTracer.getDroppedFrames() == 0;
+	});
+
+	ut.addTestCase("GMGPUTracer drops frames whose results are not available", []() {
+		ScopedTracing tracing;
+		FakeGPUTracer gpuTracer;
+		gpuTracer.available = false;
+		for (gm::GMint32 i = 0; i <= gm::GMGPUTracer::FramesInFlight; ++i)
+		{
+			gpuTracer.beginFrame();
+			gpuTracer.beginScope(L"pass");
+			gpuTracer.endFrame(); // 未结束的作用域在这里结束
+		}
+
+		Vector<gm::GMTraceEvent> events;
+		gm::GMTracer::getThreadEvents(events);
+		return events.empty() && gpuTracer.getDroppedFrames() == 1;
+	});
+}
@@ -0,0 +1,137 @@
+﻿#include "stdafx.h"
+#include "vertexlayout.h"
+#include <gmmodel.h>
+#include <cstddef>
+
+namespace
+{
+	// 与着色器中的decode_octahedral相同
+	GMVec3 decodeOctahedral(const gm::GMbyte* data)
+	{
+		gm::GMshort e[2];
+		memcpy(e, data, sizeof(e));
+		gm::GMfloat x = Max(e[0] / 32767.f, -1.f);
+		gm::GMfloat y = Max(e[1] / 32767.f, -1.f);
+		gm::GMfloat z = 1 - Fabs(x) - Fabs(y);
+		if (z < 0)
+		{
+			gm::GMfloat ox = x;
+			x = (1 - Fabs(y)) * (ox >= 0 ? 1 : -1);
+			y = (1 - Fabs(ox)) * (y >= 0 ? 1 : -1);
+		}
+		return Normalize(GMVec3(x, y, z));
+	}
+
+	gm::GMushort readUShort(const gm::GMbyte* data, gm::GMsize_t index)
+	{
+		gm::GMushort v;
+		memcpy(&v, data + index * sizeof(v), sizeof(v));
+		return v;
+	}
+
+	gm::GMVertex makeVertex()
+	{
+		gm::GMVertex v = { 0 };
+		v.positions = { 1, 2, 3 };
+		v.texcoords = { .5f, -2.f };
+		v.color = { 1, .5f, 0, 2 };
+		v.boneIds = { 0, 1, 127, 255 };
+		v.weights = { 1, .5f, 0, -1 };
+		return v;
+	}
+}
+
+void cases::VertexLayout::addToUnitTest(UnitTest& ut)
+{
+	ut.addTestCase("GMVertexLayout default layout matches GMVertex", []() {
+		gm::GMVertexLayout layout;
+		if (!layout.isDefault() || layout.getStride() != sizeof(gm::GMVertex) || layout.getOctahedralMask() != 0)
+			return false;
+
+		const gm::GMuint32 offsets[] = {
+			offsetof(gm::GMVertex, positions),
+			offsetof(gm::GMVertex, normals),
+			offsetof(gm::GMVertex, texcoords),
+			offsetof(gm::GMVertex, tangents),
+			offsetof(gm::GMVertex, bitangents),
+			offsetof(gm::GMVertex, lightmaps),
+			offsetof(gm::GMVertex, color),
+			offsetof(gm::GMVertex, boneIds),
+			offsetof(gm::GMVertex, weights),
+		};
+		GM_FOREACH_ENUM_CLASS(type, gm::GMVertexDataType::Position, gm::GMVertexDataType::EndOfVertexDataType)
+		{
+			if (layout.getOffset(type) != offsets[static_cast<gm::GMsize_t>(type)])
+				return false;
+		}
+
+		gm::GMVertex v = makeVertex();
+		Vector<gm::GMbyte> buffer(layout.getStride());
+		layout.pack(v, buffer.data());
+		return memcmp(buffer.data(), &v, sizeof(v)) == 0;
+	});
+
+	ut.addTestCase("GMVertexLayout compact layout", []() {
+		gm::GMVertexLayout layout = gm::GMVertexLayout::compactLayout();
+		if (layout.isDefault() || layout.getStride() != 48 || layout.getOctahedralMask() != 7)
+			return false;
+
+		// 只需要位置和纹理坐标的模型
+		gm::GMVertexLayout sprite;
+		sprite.set(gm::GMVertexDataType::Texcoord, gm::GMVertexAttributeFormat::HalfFloat);
+		GM_FOREACH_ENUM_CLASS(type, gm::GMVertexDataType::Normal, gm::GMVertexDataType::EndOfVertexDataType)
+		{
+			if (type != gm::GMVertexDataType::Texcoord)
+				sprite.set(type, gm::GMVertexAttributeFormat::Unused);
+		}
+		return sprite.getStride() == 16
+			&& sprite.getComponentCount(gm::GMVertexDataType::Normal) == 0
+			&& sprite.getOffset(gm::GMVertexDataType::Texcoord) == 12;
+	});
+
+	ut.addTestCase("GMVertexLayout octahedral normals", []() {
+		gm::GMVertexLayout layout = gm::GMVertexLayout::compactLayout();
+		gm::GMuint32 offset = layout.getOffset(gm::GMVertexDataType::Normal);
+		Vector<gm::GMbyte> buffer(layout.getStride());
+		const GMVec3 normals[] = {
+			GMVec3(0, 0, 1),
+			GMVec3(0, 0, -1),
+			GMVec3(1, 0, 0),
+			GMVec3(0, -1, 0),
+			GMVec3(1, 1, 1),
+			GMVec3(-1, 2, -3),
+			GMVec3(.3f, -.4f, -.5f),
+		};
+		for (auto n : normals)
+		{
+			n = Normalize(n);
+			gm::GMVertex v = makeVertex();
+			CopyToArray(n, v.normals.data());
+			layout.pack(v, buffer.data());
+			if (Dot(decodeOctahedral(buffer.data() + offset), n) < .9999f)
+				return false;
+		}
+		return true;
+	});
+
+	ut.addTestCase("GMVertexLayout half floats and integers", []() {
+		gm::GMVertexLayout layout = gm::GMVertexLayout::compactLayout();
+		Vector<gm::GMbyte> buffer(layout.getStride());
+		layout.pack(makeVertex(), buffer.data());
+
+		const gm::GMbyte* texcoord = buffer.data() + layout.getOffset(gm::GMVertexDataType::Texcoord);
+		if (readUShort(texcoord, 0) != 0x3800 || readUShort(texcoord, 1) != 0xC000)
+			return false;
+
+		const gm::GMbyte* color = buffer.data() + layout.getOffset(gm::GMVertexDataType::Color);
+		if (color[0] != 255 || color[1] != 128 || color[2] != 0 || color[3] != 255)
+			return false;
+
+		const gm::GMbyte* boneIds = buffer.data() + layout.getOffset(gm::GMVertexDataType::BoneIds);
+		if (boneIds[0] != 0 || boneIds[1] != 1 || boneIds[2] != 127 || boneIds[3] != 255)
+			return false;
+
+		const gm::GMbyte* weights = buffer.data() + layout.getOffset(gm::GMVertexDataType::Weights);
+		return readUShort(weights, 0) == 65535 && readUShort(weights, 1) == 32768 && readUShort(weights, 2) == 0 && readUShort(weights, 3) == 0;
+	});
+}
@@ -7,6 +7,20 @@
 #include "cases/variant.h"
 #include "cases/lua.h"
 #include "cases/base64.h"
+#include "cases/rendergraph.h"
+#include "cases/scenebvh.h"
+#include "cases/instancing.h"
+#include "cases/renderqueue.h"
+#include "cases/vertexlayout.h"
+#include "cases/animationclip.h"
+#include "cases/bonepalette.h"
+#include "cases/particle.h"
+#include "cases/glyphatlas.h"
+#include "cases/debugger.h"
+#include "cases/tracer.h"
+#include "cases/gamepackage.h"
+#include "cases/assetstreamer.h"
+#include "cases/commandqueue.h"
 
 int main(int argc, char* argv[])
 {
@@ -20,6 +34,20 @@ int main(int argc, char* argv[])
 		new cases::Variant(),
 		new cases::Lua(),
 		new cases::Base64(),
+		new cases::RenderGraph(),
+		new cases::SceneBVH(),
+		new cases::Instancing(),
+		new cases::RenderQueue(),
+		new cases::VertexLayout(),
+		new cases::AnimationClip(),
+		new cases::BonePalette(),
+		new cases::Particle(),
+		new cases::GlyphAtlas(),
+		new cases::Debugger(),
+		new cases::Tracer(),
+		new cases::GamePackage(),
+		new cases::AssetStreamer(),
+		new cases::CommandQueue(),
 		new cases::Thread()
 	};
 